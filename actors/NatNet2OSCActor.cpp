@@ -1,10 +1,9 @@
 #include "libsphactor.h"
 #include "NatNet2OSCActor.h"
-#include "NatNetActor.h"
 #include <map>
 #include <algorithm>
+#include <math.h>
 
-//TODO: Add filter options
 const char * NatNet2OSC::capabilities = "capabilities\n"
                                 "    data\n"
                                 "        name = \"markers\"\n"
@@ -35,6 +34,72 @@ const char * NatNet2OSC::capabilities = "capabilities\n"
                                 "        api_call = \"SET VELOCITIES\"\n"
                                 "        api_value = \"s\"\n"
                                 "    data\n"
+                                "        name = \"velocityFilter\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Velocity filter: 0 = One-Euro, 1 = Savitzky-Golay, 2 = alpha-beta\"\n"
+                                "        value = \"0\"\n"
+                                "        min = \"0\"\n"
+                                "        max = \"2\"\n"
+                                "        step = \"1\"\n"
+                                "        api_call = \"SET VELOCITY FILTER\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"minCutoff\"\n"
+                                "        type = \"float\"\n"
+                                "        help = \"One-Euro cutoff frequency at rest (Hz), lower is smoother\"\n"
+                                "        value = \"1.0\"\n"
+                                "        min = \"0.01\"\n"
+                                "        max = \"10.0\"\n"
+                                "        api_call = \"SET MIN CUTOFF\"\n"
+                                "        api_value = \"f\"\n"
+                                "    data\n"
+                                "        name = \"beta\"\n"
+                                "        type = \"float\"\n"
+                                "        help = \"One-Euro speed coefficient, higher reacts faster to movement\"\n"
+                                "        value = \"0.05\"\n"
+                                "        min = \"0.0\"\n"
+                                "        max = \"1.0\"\n"
+                                "        api_call = \"SET BETA\"\n"
+                                "        api_value = \"f\"\n"
+                                "    data\n"
+                                "        name = \"window\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Savitzky-Golay window in frames (odd)\"\n"
+                                "        value = \"5\"\n"
+                                "        min = \"3\"\n"
+                                "        max = \"31\"\n"
+                                "        step = \"2\"\n"
+                                "        api_call = \"SET WINDOW\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"lag\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Savitzky-Golay lag in frames, 0 is lowest latency, window / 2 is smoothest\"\n"
+                                "        value = \"2\"\n"
+                                "        min = \"0\"\n"
+                                "        max = \"15\"\n"
+                                "        step = \"1\"\n"
+                                "        api_call = \"SET LAG\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"alpha\"\n"
+                                "        type = \"float\"\n"
+                                "        help = \"Alpha-beta position gain\"\n"
+                                "        value = \"0.5\"\n"
+                                "        min = \"0.0\"\n"
+                                "        max = \"1.0\"\n"
+                                "        api_call = \"SET AB ALPHA\"\n"
+                                "        api_value = \"f\"\n"
+                                "    data\n"
+                                "        name = \"abBeta\"\n"
+                                "        type = \"float\"\n"
+                                "        help = \"Alpha-beta velocity gain\"\n"
+                                "        value = \"0.1\"\n"
+                                "        min = \"0.0\"\n"
+                                "        max = \"1.0\"\n"
+                                "        api_call = \"SET AB BETA\"\n"
+                                "        api_value = \"f\"\n"
+                                "    data\n"
                                 "        name = \"hierarchy\"\n"
                                 "        type = \"bool\"\n"
                                 "        help = \"Send skeleton hierarchy\"\n"
@@ -48,6 +113,29 @@ const char * NatNet2OSC::capabilities = "capabilities\n"
                                 "        value = \"False\"\n"
                                 "        api_call = \"SET SKELETONDEF\"\n"
                                 "        api_value = \"s\"\n"
+                                "    data\n"
+                                "        name = \"bundles\"\n"
+                                "        type = \"bool\"\n"
+                                "        help = \"Send each frame as OSC bundles timed by the frame timestamp\"\n"
+                                "        value = \"False\"\n"
+                                "        api_call = \"SET BUNDLES\"\n"
+                                "        api_value = \"s\"\n"
+                                "    data\n"
+                                "        name = \"bundleSize\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Maximum bundle size in bytes, 1472 fits an ethernet frame\"\n"
+                                "        value = \"1472\"\n"
+                                "        min = \"256\"\n"
+                                "        max = \"8192\"\n"
+                                "        api_call = \"SET BUNDLE SIZE\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"binary\"\n"
+                                "        type = \"bool\"\n"
+                                "        help = \"Send the compact binary pose stream of PoseStream.h instead of OSC, split at the bundle size\"\n"
+                                "        value = \"False\"\n"
+                                "        api_call = \"SET BINARY\"\n"
+                                "        api_value = \"s\"\n"
                                 "inputs\n"
                                 "    input\n"
                                 "        type = \"NatNet\"\n" //TODO: NatNet input?
@@ -66,36 +154,32 @@ NatNet2OSC::handleSocket( sphactor_event_t *ev )
 {
     //zsys_info("SOCK");
 
-    //TODO: unpack msg and parse intozStr OSC
     zframe_t *zframe = zmsg_pop(ev->msg);
     if (zframe) {
-        byte *data = zframe_data(zframe);
-        Unpack((char **) &data);
-        zframe_destroy(&zframe);
+        // the frame is decoded by the NatNet actor, we read its arrays in place
+        if ( !frame.parse(zframe_data(zframe), zframe_size(zframe)) ) {
+            zsys_error("NatNet2OSC: received data is not a NatNet frame");
+            zframe_destroy(&zframe);
+            zmsg_destroy(&ev->msg);
+            return NULL;
+        }
 
-        //Send Frame
-        zmsg_t *oscMsg = zmsg_new();
+        if ( !loadDescriptions() ) {
+            zframe_destroy(&zframe);
+            zmsg_destroy(&ev->msg);
+            return NULL;
+        }
 
-        // Lock description mutex while building OSC message (since we loop them to construct it)
-        {
-            const std::lock_guard<std::mutex> lock(NatNet::desc_mutex);
-            //markers
-            if (sendMarkers) {
-                for (int i = 0; i < markers.size(); i++) {
-                    zosc_t* osc = zosc_create("/marker", "ifff", i, markers[i][0], markers[i][1], markers[i][2]);
-                    zmsg_add(oscMsg, zosc_pack(osc));
-                    //TODO: clean up osc* ?
-                }
-            }
+        int64_t start = zclock_usecs();
 
-            //rigidbodies
-            if (sendRigidbodies)
-                addRigidbodies(oscMsg);
+        //Send Frame
+        zmsg_t *oscMsg = buildMessages();
+        zframe_destroy(&zframe);
 
-            //skeletons
-            if (sendSkeletons)
-                addSkeletons(oscMsg);
-        }
+        buildUsecs += zclock_usecs() - start;
+        framesBuilt++;
+        packetsSent += zmsg_size(oscMsg);
+        setReport(ev->actor);
 
         if ( zmsg_content_size(oscMsg) != 0 ){
             //zsys_info("Sending zmsg of size: %i", zmsg_content_size(oscMsg));
@@ -111,6 +195,39 @@ NatNet2OSC::handleSocket( sphactor_event_t *ev )
     return NULL;
 }
 
+zmsg_t *
+NatNet2OSC::buildMessages()
+{
+    zmsg_t *oscMsg = zmsg_new();
+    if ( sendBinary ) {
+        addBinary(oscMsg);
+        return oscMsg;
+    }
+
+    if ( sendBundles )
+        updateTimetag();
+
+    //markers
+    if (sendMarkers) {
+        const float *m = frame.markers;
+        for (uint32_t i = 0; i < frame.header.markerCount; i++) {
+            zosc_t* osc = zosc_create("/marker", "ifff", frame.markerId[i], m[i*3], m[i*3+1], m[i*3+2]);
+            addMessage(oscMsg, &osc);
+        }
+    }
+
+    //rigidbodies
+    if (sendRigidbodies)
+        addRigidbodies(oscMsg);
+
+    //skeletons
+    if (sendSkeletons)
+        addSkeletons(oscMsg);
+
+    flushBundle(oscMsg);
+    return oscMsg;
+}
+
 zmsg_t *
 NatNet2OSC::handleAPI( sphactor_event_t *ev )
 {
@@ -137,6 +254,51 @@ NatNet2OSC::handleAPI( sphactor_event_t *ev )
             sendVelocities = streq( value, "True");
             //zsys_info("Got: %s, set to %s", value, sendVelocities ? "True" : "False");
         }
+        else if ( streq(cmd, "SET VELOCITY FILTER") ) {
+            char * value = zmsg_popstr(ev->msg);
+            velocities.setFilter(value ? atoi(value) : NATNET_VELOCITY_ONE_EURO);
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET MIN CUTOFF") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value && atof(value) > 0 )
+                velocities.minCutoff = (float)atof(value);
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET BETA") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value )
+                velocities.beta = std::max(0.0f, (float)atof(value));
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET WINDOW") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value ) {
+                velocityWindow = atoi(value);
+                velocities.setWindow(velocityWindow, velocityLag);
+            }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET LAG") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value ) {
+                velocityLag = atoi(value);
+                velocities.setWindow(velocityWindow, velocityLag);
+            }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET AB ALPHA") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value )
+                velocities.abAlpha = std::max(0.0f, std::min((float)atof(value), 1.0f));
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET AB BETA") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value )
+                velocities.abBeta = std::max(0.0f, std::min((float)atof(value), 1.0f));
+            zstr_free(&value);
+        }
         else if ( streq(cmd, "SET HIERARCHY") ) {
             char * value = zmsg_popstr(ev->msg);
             sendHierarchy = streq( value, "True");
@@ -147,6 +309,26 @@ NatNet2OSC::handleAPI( sphactor_event_t *ev )
             sendSkeletonDefinitions = streq( value, "True");
             //zsys_info("Got: %s, set to %s", value, sendSkeletonDefinitions ? "True" : "False");
         }
+        else if ( streq(cmd, "SET BUNDLES") ) {
+            char * value = zmsg_popstr(ev->msg);
+            sendBundles = streq( value, "True");
+            timetagValid = false;
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET BUNDLE SIZE") ) {
+            char * value = zmsg_popstr(ev->msg);
+            if ( value ) {
+                bundleSize = std::max(256, std::min(atoi(value), 8192));
+                poseWriter.packetSize = bundleSize;
+            }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET BINARY") ) {
+            char * value = zmsg_popstr(ev->msg);
+            sendBinary = streq( value, "True");
+            binaryVersion = 0;
+            zstr_free(&value);
+        }
 
         zstr_free(&cmd);
     }
@@ -155,167 +337,152 @@ NatNet2OSC::handleAPI( sphactor_event_t *ev )
     return NULL;
 }
 
-void NatNet2OSC::addRigidbodies(zmsg_t *zmsg)
+// Descriptions are usually in the same order as the frame, so try the hint first
+template <typename T>
+static const T *
+s_find_description(const std::vector<T> &descs, int id, size_t hint)
 {
-    for (int i = 0; i < rigidbodies.size(); i++)
-    {
-        RigidBodyDescription rbd = NatNet::rigidbody_descs[i];
-        RigidBody &RB = rigidbodies[rbd.id];
-
-        // Decompose to get the different elements
-        glm::vec3 position = RB.position;
-        glm::quat rotation;
-        rotation.x = RB.rotation[0];
-        rotation.y = RB.rotation[1];
-        rotation.z = RB.rotation[2];
-        rotation.w = RB.rotation[3];
-
-        //we're going to fetch or create this
-        //TODO: TEST re-implemented rigidbody histories for velocity data
-        RigidBodyHistory *rb;
-
-        //Get or create rigidbodyhistory
-        bool found = false;
-        for( int r = 0; r < rbHistory.size(); ++r )
-        {
-            if ( rbHistory[r].rigidBodyId == rbd.id )
-            {
-                rb = &rbHistory[r];
-                found = true;
-            }
-        }
-
-        if ( !found )
-        {
-            rb = new RigidBodyHistory( rbd.id, position, rotation );
-            rbHistory.push_back(*rb);
-        }
-
-        glm::vec3 velocity;
-        glm::vec3 angularVelocity;
-
-        if ( rb->firstRun )
-        {
-            rb->currentDataPoint = 0;
-            rb->firstRun = false;
-        }
-        else
-        {
-            //TODO: Get invFPS from timeout
-            float invFPS = ( 1.0f / 60.0f );
-            if ( rb->currentDataPoint < 2 * SMOOTHING + 1 )
-            {
-                rb->velocities[rb->currentDataPoint] = ( position - rb->previousPosition ) * invFPS;
-                glm::vec3 diff = glm::eulerAngles( rb->previousOrientation * glm::inverse(rotation) );
-                rb->angularVelocities[rb->currentDataPoint] = ( diff * invFPS );
-
-                rb->currentDataPoint++;
-            }
-            else
-            {
-                int count = 0;
-                int maxDist = SMOOTHING;
-                glm::vec3 totalVelocity;
-                glm::vec3 totalAngularVelocity;
-                //calculate smoothed velocity
-                for( int x = 0; x < SMOOTHING * 2 + 1; ++x )
-                {
-                    //calculate integer distance from "center"
-                    //above - maxDist = influence of data point
-                    int dist = abs( x - SMOOTHING );
-                    int infl = ( maxDist - dist ) + 1;
+    if ( hint < descs.size() && descs[hint].id == id )
+        return &descs[hint];
+    for ( const T &desc : descs ) {
+        if ( desc.id == id )
+            return &desc;
+    }
+    return nullptr;
+}
 
-                    //add all
-                    totalVelocity += rb->velocities[x] * glm::vec3(infl);
-                    totalAngularVelocity += rb->angularVelocities[x] * glm::vec3(infl);
-                    //count "influences"
-                    count += infl;
-                }
+uint32_t NatNet2OSC::rigidBodySlot(int id)
+{
+    int32_t *index;
+    if ( id >= 0 && id < NATNET2OSC_DENSE_IDS ) {
+        if ( (size_t)id >= rbSlotIndex.size() )
+            rbSlotIndex.resize(id + 1, -1);
+        index = &rbSlotIndex[id];
+    }
+    else {
+        auto it = rbSlotSparse.find(id);
+        if ( it != rbSlotSparse.end() )
+            return it->second;
+        rbSlotSparse[id] = (uint32_t)rbSlots.size();
+        rbSlots.emplace_back(id);
+        return (uint32_t)rbSlots.size() - 1;
+    }
 
-                //divide by total data point influences
-                velocity = totalVelocity / glm::vec3(count);
-                angularVelocity = totalAngularVelocity / glm::vec3(count);
+    if ( *index < 0 ) {
+        *index = (int32_t)rbSlots.size();
+        rbSlots.emplace_back(id);
+    }
+    return (uint32_t)*index;
+}
 
-                for( int x = 0; x < rb->currentDataPoint - 1; ++x )
-                {
-                    rb->velocities[x] = rb->velocities[x+1];
-                    rb->angularVelocities[x] = rb->angularVelocities[x+1];
-                }
-                rb->velocities[rb->currentDataPoint-1] = ( position - rb->previousPosition ) * invFPS;
+// Point the slots at the current descriptions and build their addresses,
+// only needed when the snapshot or the hierarchy option changes
+void NatNet2OSC::updateSlots()
+{
+    for ( RigidBodySlot &slot : rbSlots ) {
+        slot.description = nullptr;
+    }
+    for ( const RigidBodyDescription &rbd : descriptions->rigidbodies ) {
+        RigidBodySlot &slot = rbSlots[rigidBodySlot(rbd.id)];
+        slot.description = &rbd;
+        slot.address = "/rigidBody";
+        if ( sendHierarchy )
+            slot.address += "/" + rbd.name;
+    }
+    slotSource = descriptionSource->id();
+    slotVersion = descriptions->version;
+    slotHierarchy = sendHierarchy;
+}
 
-                glm::vec3 diff = glm::eulerAngles(( rb->previousOrientation * glm::inverse(rotation) ));
-                rb->angularVelocities[rb->currentDataPoint-1] = ( diff * invFPS );
-            }
+void NatNet2OSC::addRigidbodies(zmsg_t *zmsg)
+{
+    // a new snapshot can reuse the address of a freed one, compare its version
+    if ( slotVersion != descriptions->version || slotSource != descriptionSource->id() || slotHierarchy != sendHierarchy )
+        updateSlots();
 
-            rb->previousPosition = position;
-            rb->previousOrientation = rotation;
-        }
+    const NatNetPoses &rbs = frame.rigidBodies;
+    frameSlots.resize(rbs.count);
+    for (uint32_t i = 0; i < rbs.count; i++)
+        frameSlots[i] = rigidBodySlot(rbs.id[i]);
 
-        std::string address = "/rigidBody";
-        if ( sendHierarchy ) {
-            address += "/"+NatNet::rigidbody_descs[i].name;
-        }
+    // velocities of all bodies in one pass, timed by Motive's frame timestamp
+    if ( sendVelocities )
+    {
+        velocities.begin(frame.header.timestamp);
+        for (uint32_t i = 0; i < rbs.count; i++)
+            velocities.add(frameSlots[i], rbs.position + i * 3, rbs.rotation + i * 4);
+        velocities.update();
+    }
 
-        zosc_t *oscMsg = zosc_create(address.c_str(), "isfffffff",
-                                     rbd.id,
-                                     NatNet::rigidbody_descs[i].name.c_str(),
-                                     position.x,
-                                     position.y,
-                                     position.z,
-                                     rotation.x,
-                                     rotation.y,
-                                     rotation.z,
-                                     rotation.w
+    for (uint32_t i = 0; i < rbs.count; i++)
+    {
+        const RigidBodySlot &slot = rbSlots[frameSlots[i]];
+        const RigidBodyDescription *rbd = slot.description;
+        if ( rbd == nullptr )
+            continue;
+
+        const float *position = rbs.position + i * 3;
+        const float *rotation = rbs.rotation + i * 4;
+
+        zosc_t *oscMsg = zosc_create(slot.address.c_str(), "isfffffff",
+                                     rbd->id,
+                                     rbd->name.c_str(),
+                                     position[0],
+                                     position[1],
+                                     position[2],
+                                     rotation[0],
+                                     rotation[1],
+                                     rotation[2],
+                                     rotation[3]
         );
 
         if ( sendVelocities )
         {
+            float velocity[3], angularVelocity[3];
+            velocities.velocity(frameSlots[i], velocity, angularVelocity);
             zosc_append(oscMsg, "ffffff",
-                        //velocity over SMOOTHING * 2 + 1 frames
-                        velocity.x * 1000, velocity.y * 1000, velocity.z * 1000,
-                        //angular velocity (euler), also smoothed
-                        angularVelocity.x * 1000, angularVelocity.y * 1000, angularVelocity.z * 1000 );
+                        //velocity in m/s
+                        velocity[0], velocity[1], velocity[2],
+                        //angular velocity in rad/s around the world axes
+                        angularVelocity[0], angularVelocity[1], angularVelocity[2] );
         }
 
-        zosc_append(oscMsg, "i", (RB.isActive() ? 1 : 0));
+        zosc_append(oscMsg, "i", ((rbs.flags[i] & NATNET_POSE_ACTIVE) ? 1 : 0));
 
-        zmsg_add(zmsg, zosc_pack(oscMsg));
+        addMessage(zmsg, &oscMsg);
     }
 }
 
 void NatNet2OSC::addSkeletons(zmsg_t *zmsg)
 {
-    for (int j = 0; j < skeletons.size(); j++)
+    const NatNetPoses &joints = frame.joints;
+    for (uint32_t j = 0; j < frame.header.skeletonCount; j++)
     {
-        const Skeleton &S = skeletons[NatNet::skeleton_descs[j].id];
-        std::vector<RigidBodyDescription> rbd = NatNet::skeleton_descs[j].joints;
+        const SkeletonDescription *sd = s_find_description(descriptions->skeletons, frame.skeletonId[j], j);
+        if ( sd == nullptr )
+            continue;
+
+        const std::vector<RigidBodyDescription> &rbd = sd->joints;
+        uint32_t first = frame.skeletonJointStart[j];
+        uint32_t count = std::min(frame.skeletonJointCount[j], (uint32_t)rbd.size());
 
         if ( sendHierarchy )
         {
-            for (int i = 0; i < S.joints.size(); i++)
+            for (uint32_t i = 0; i < count; i++)
             {
-                RigidBody RB = S.joints[i];
-                std::string address = "/skeleton/" + NatNet::skeleton_descs[j].name + "/" + rbd[i].name;
-
-                // Get the matirx
-                //ofMatrix4x4 matrix = RB.matrix;
-
-                // Decompose to get the different elements
-                //Vec3 position;
-                //Vec4 rotation;
-                //Vec3 scale;
-                //Vec4 so;
-                //matrix.decompose(position, rotation, scale, so);
+                const float *position = joints.position + (first + i) * 3;
+                const float *rotation = joints.rotation + (first + i) * 4;
+                std::string address = "/skeleton/" + sd->name + "/" + rbd[i].name;
 
                 zosc_t *oscMsg = zosc_create( address.c_str(), "sfffffff",
                                               rbd[i].name.c_str(),
-                                              RB.position.x,
-                                              RB.position.y,
-                                              RB.position.z,
-                                              RB.rotation.x,
-                                              RB.rotation.y,
-                                              RB.rotation.z,
-                                              RB.rotation.w
+                                              position[0],
+                                              position[1],
+                                              position[2],
+                                              rotation[0],
+                                              rotation[1],
+                                              rotation[2],
+                                              rotation[3]
                 );
 
                 //needed for skeleton retargeting
@@ -329,38 +496,29 @@ void NatNet2OSC::addSkeletons(zmsg_t *zmsg)
                     );
                 }
 
-                zmsg_add(zmsg, zosc_pack(oscMsg));
+                addMessage(zmsg, &oscMsg);
             }
         }
         else
         {
             std::string address = "/skeleton";
 
-            zosc_t * oscMsg = zosc_create(address.c_str(), "si", NatNet::skeleton_descs[j].name.c_str(), S.id );
+            zosc_t * oscMsg = zosc_create(address.c_str(), "si", sd->name.c_str(), frame.skeletonId[j] );
 
-            for (int i = 0; i < S.joints.size(); i++)
+            for (uint32_t i = 0; i < count; i++)
             {
-                RigidBody RB = S.joints[i];
-
-                // Get the matirx
-                //ofMatrix4x4 matrix = RB.matrix;
-
-                // Decompose to get the different elements
-                //ofVec3f position;
-                //ofQuaternion rotation;
-                //ofVec3f scale;
-                //ofQuaternion so;
-                //matrix.decompose(position, rotation, scale, so);
+                const float *position = joints.position + (first + i) * 3;
+                const float *rotation = joints.rotation + (first + i) * 4;
 
                 zosc_append( oscMsg, "sfffffff",
                              rbd[i].name.c_str(),
-                             RB.position.x,
-                             RB.position.y,
-                             RB.position.z,
-                             RB.rotation.x,
-                             RB.rotation.y,
-                             RB.rotation.z,
-                             RB.rotation.w
+                             position[0],
+                             position[1],
+                             position[2],
+                             rotation[0],
+                             rotation[1],
+                             rotation[2],
+                             rotation[3]
                 );
 
                 //needed for skeleton retargeting
@@ -375,784 +533,153 @@ void NatNet2OSC::addSkeletons(zmsg_t *zmsg)
                 }
             }
 
-            zmsg_add(zmsg, zosc_pack(oscMsg));
+            addMessage(zmsg, &oscMsg);
         }
     }
 }
 
-char* NatNet2OSC::unpackMarkerSet(char* ptr, std::vector<Marker>& ref_markers)
+// Map Motive's frame timestamp onto the wall clock for the bundle timetag.
+// The offset is taken once so the timetags are spaced exactly as Motive
+// timed the frames, and taken again when the clocks drift apart or Motive
+// restarts.
+void NatNet2OSC::updateTimetag()
 {
-    int nMarkers = 0;
-    memcpy(&nMarkers, ptr, 4);
-    ptr += 4;
-
-    ref_markers.resize(nMarkers);
-
-    for (int j = 0; j < nMarkers; j++)
-    {
-        Marker p;
-        memcpy(&p[0], ptr, 4);
-        ptr += 4;
-        memcpy(&p[1], ptr, 4);
-        ptr += 4;
-        memcpy(&p[2], ptr, 4);
-        ptr += 4;
-
-        //TODO: Matrix, only used for scale previously
-        //p = transform.preMult(p);
-
-        ref_markers[j] = p;
+    // NTP time, seconds since 1900
+    double now = zclock_time() / 1000.0 + 2208988800.0;
+    double time = timetagOffset + frame.header.timestamp;
+    if ( !timetagValid || fabs(time - now) > 0.5 ) {
+        timetagOffset = now - frame.header.timestamp;
+        timetagValid = true;
+        time = now;
     }
-
-    return ptr;
+    uint64_t seconds = (uint64_t)time;
+    timetag = seconds << 32 | (uint64_t)((time - (double)seconds) * 4294967296.0);
 }
 
-char* NatNet2OSC::unpackRigidBodies(char* ptr, std::vector<RigidBody>& ref_rigidbodies)
+static void
+s_put_be32(std::vector<unsigned char> &buf, uint32_t v)
 {
-    //TODO: Access static natnet vars
-    int major = NatNet::NatNetVersion[0];
-    int minor = NatNet::NatNetVersion[1];
-
-    //TODO: Matrix, only used for scale previously
-    //ofQuaternion rot = transform.getRotate();
-
-    int nRigidBodies = 0;
-    memcpy(&nRigidBodies, ptr, 4);
-    ptr += 4;
-
-    ref_rigidbodies.resize(nRigidBodies);
-
-    for (int j = 0; j < nRigidBodies; j++)
-    {
-        RigidBody& RB = ref_rigidbodies[j];
-
-        glm::vec3 pp;
-        glm::vec4 q;
-
-        int ID = 0;
-        memcpy(&ID, ptr, 4);
-        ptr += 4;
-
-        memcpy(&pp[0], ptr, 4);
-        ptr += 4;
-
-        memcpy(&pp[1], ptr, 4);
-        ptr += 4;
-
-        memcpy(&pp[2], ptr, 4);
-        ptr += 4;
-
-        memcpy(&q[0], ptr, 4);
-        ptr += 4;
-
-        memcpy(&q[1], ptr, 4);
-        ptr += 4;
-
-        memcpy(&q[2], ptr, 4);
-        ptr += 4;
-
-        memcpy(&q[3], ptr, 4);
-        ptr += 4;
-
-        RB.id = ID;
-        RB.position = pp;
-        RB.rotation = q;
-
-        //TODO: These associated markers are no longer part of the 3.1 SDK example
-       //          -> Check if we can/need to remove this...
-        if ( major < 3 ) {
-            // associated marker positions
-            int nRigidMarkers = 0;
-            memcpy(&nRigidMarkers, ptr, 4);
-            ptr += 4;
-
-            int nBytes = nRigidMarkers * 3 * sizeof(float);
-            float *markerData = (float *) malloc(nBytes);
-            memcpy(markerData, ptr, nBytes);
-            ptr += nBytes;
-
-            if (major >= 2) {
-                // associated marker IDs
-                nBytes = nRigidMarkers * sizeof(int);
-                ptr += nBytes;
-
-                // associated marker sizes
-                nBytes = nRigidMarkers * sizeof(float);
-                ptr += nBytes;
-            }
-
-            RB.markers.resize(nRigidMarkers);
-
-            for (int k = 0; k < nRigidMarkers; k++) {
-                float x = markerData[k * 3];
-                float y = markerData[k * 3 + 1];
-                float z = markerData[k * 3 + 2];
-
-                glm::vec3 pp(x, y, z);
-                //TODO: Matrix, only used for scale previously
-                //pp = transform.preMult(pp);
-                RB.markers[k] = pp;
-            }
-
-            if (markerData) free(markerData);
-        }
-        // TODO: 3.1 SDK Contains everything after this again
-
-        if (major >= 2)
-        {
-            // Mean marker error
-            float fError = 0.0f;
-            memcpy(&fError, ptr, 4);
-            ptr += 4;
-
-            RB.mean_marker_error = fError;
-            RB._active = RB.mean_marker_error > 0;
-        } else {
-            RB.mean_marker_error = 0;
-        }
-
-        // 2.6 and later
-        if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0))
-        {
-            // params
-            short params = 0; memcpy(&params, ptr, 2); ptr += 2;
-            bool bTrackingValid = params & 0x01; // 0x01 : rigid body was successfully tracked in this frame
-        }
-
-    }  // next rigid body
-
-    return ptr;
+    unsigned char b[4] = { (unsigned char)(v >> 24), (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v };
+    buf.insert(buf.end(), b, b + 4);
 }
 
-void NatNet2OSC::Unpack( char ** pData ) {
-    int major = NatNet::NatNetVersion[0];
-    int minor = NatNet::NatNetVersion[1];
-
-    //TODO: Matrix, only used for scale previously
-    //Vec4 rotation = transform.getRotate();
-
-    char *ptr = *pData;
-
-    //zsys_info("Begin Packet\n-------\n");
-
-    // message ID
-    int MessageID = 0;
-    memcpy(&MessageID, ptr, 2); ptr += 2;
-    //zsys_info("Message ID : %d\n", MessageID);
-
-    // size
-    int nBytes = 0;
-    memcpy(&nBytes, ptr, 2); ptr += 2;
-    //zsys_info("Byte count : %d\n", nBytes);
-
-    if(MessageID == 7)      // FRAME OF MOCAP DATA packet
-    {
-        // temporary data containers
-        std::vector<std::vector<Marker> > tmp_markers_set;
-        std::vector<Skeleton> tmp_skeletons;
-        std::vector<Marker> tmp_markers;
-        std::vector<Marker> tmp_filtered_markers;
-        std::vector<RigidBody> tmp_rigidbodies;
-
-        // frame number
-        int frameNumber = 0; memcpy(&frameNumber, ptr, 4); ptr += 4;
-        //zsys_info("Frame # : %d\n", frameNumber);
-
-        // number of data sets (markersets, rigidbodies, etc)
-        int nMarkerSets = 0; memcpy(&nMarkerSets, ptr, 4); ptr += 4;
-        //zsys_info("Marker Set Count : %d\n", nMarkerSets);
-
-        tmp_markers_set.resize(nMarkerSets);
-
-        for (int i=0; i < nMarkerSets; i++)
-        {
-            // Markerset name
-            char szName[256];
-            strcpy(szName, ptr);
-            int nDataBytes = (int) strlen(szName) + 1;
-            ptr += nDataBytes;
-            //zsys_info("Model Name: %s\n", szName);
-
-            ptr = unpackMarkerSet(ptr, tmp_markers_set[i]);
-        }
-
-        // unidentified markers
-        ptr = unpackMarkerSet(ptr, tmp_markers);
-
-        // rigid bodies
-        ptr = unpackRigidBodies(ptr, tmp_rigidbodies);
-
-        // skeletons (version 2.1 and later)
-        if( ((major == 2)&&(minor>0)) || (major>2))
-        {
-            int nSkeletons = 0;
-            memcpy(&nSkeletons, ptr, 4); ptr += 4;
-            //zsys_info("Skeleton Count : %d\n", nSkeletons);
-
-            tmp_skeletons.resize(nSkeletons);
-
-            for (int j=0; j < nSkeletons; j++)
-            {
-                // skeleton id
-                int skeletonID = 0;
-                memcpy(&skeletonID, ptr, 4); ptr += 4;
-
-                tmp_skeletons[j].id = skeletonID;
-
-                ptr = unpackRigidBodies(ptr, tmp_skeletons[j].joints);
-            } // next skeleton
-        }
-
-        // labeled markers (version 2.3 and later)
-        if( ((major == 2)&&(minor>=3)) || (major>2))
-        {
-            int nLabeledMarkers = 0;
-            memcpy(&nLabeledMarkers, ptr, 4); ptr += 4;
-            //zsys_info("Labeled Marker Count : %d\n", nLabeledMarkers);
-            for (int j=0; j < nLabeledMarkers; j++)
-            {
-                // id
-                int ID = 0; memcpy(&ID, ptr, 4); ptr += 4;
-                // x
-                float x = 0.0f; memcpy(&x, ptr, 4); ptr += 4;
-                // y
-                float y = 0.0f; memcpy(&y, ptr, 4); ptr += 4;
-                // z
-                float z = 0.0f; memcpy(&z, ptr, 4); ptr += 4;
-                // size
-                float size = 0.0f; memcpy(&size, ptr, 4); ptr += 4;
-
-                // 2.6 and later
-                if( ((major == 2)&&(minor >= 6)) || (major > 2) || (major == 0) )
-                {
-                    // marker params
-                    short params = 0; memcpy(&params, ptr, 2); ptr += 2;
-                    bool bOccluded = params & 0x01;     // marker was not visible (occluded) in this frame
-                    bool bPCSolved = params & 0x02;     // position provided by point cloud solve
-                    bool bModelSolved = params & 0x04;  // position provided by model solve
-                    // 3.0 additions
-                    if ((major >= 3) || (major == 0))
-                    {
-                        bool bHasModel = (params & 0x08) != 0;     // marker has an associated asset in the data stream
-                        bool bUnlabeled = (params & 0x10) != 0;    // marker is 'unlabeled', but has a point cloud ID
-                        bool bActiveMarker = (params & 0x20) != 0; // marker is an actively labeled LED marker
-                    }
-                }
-
-                // NatNet version 3.0 and later
-                float residual = 0.0f;
-                if ((major >= 3) || (major == 0))
-                {
-                    // Marker residual
-                    memcpy(&residual, ptr, 4); ptr += 4;
-                }
-
-                //zsys_info("ID  : %d\n", ID);
-                //zsys_info("pos : [%3.2f,%3.2f,%3.2f]\n", x,y,z);
-                //zsys_info("size: [%3.2f]\n", size);
-
-                glm::vec3 pp(x, y, z);
-                //TODO: Matrix, only used for scale previously
-                //pp = transform.preMult(pp);
-                tmp_markers.push_back(pp);
-            }
-        }
-
-        // Force Plate data (version 2.9 and later)
-        if (((major == 2) && (minor >= 9)) || (major > 2))
-        {
-            int nForcePlates;
-            memcpy(&nForcePlates, ptr, 4); ptr += 4;
-            for (int iForcePlate = 0; iForcePlate < nForcePlates; iForcePlate++)
-            {
-                // ID
-                int ID = 0; memcpy(&ID, ptr, 4); ptr += 4;
-                //zsys_info("Force Plate : %d\n", ID);
-
-                // Channel Count
-                int nChannels = 0; memcpy(&nChannels, ptr, 4); ptr += 4;
-
-                // Channel Data
-                for (int i = 0; i < nChannels; i++)
-                {
-                    //zsys_info(" Channel %d : ", i);
-                    int nFrames = 0; memcpy(&nFrames, ptr, 4); ptr += 4;
-                    for (int j = 0; j < nFrames; j++)
-                    {
-                        float val = 0.0f;  memcpy(&val, ptr, 4); ptr += 4;
-                        //zsys_info("%3.2f   ", val);
-                    }
-                    //zsys_info("\n");
-                }
-            }
-        }
+// Add a message to the output, in bundle mode it's appended to the current
+// bundle which is sent first if the message doesn't fit anymore
+void NatNet2OSC::addMessage(zmsg_t *zmsg, zosc_t **osc)
+{
+    if ( !sendBundles ) {
+        zmsg_add(zmsg, zosc_packx(osc));
+        return;
+    }
 
-        // TODO: Device data (NatNet version 3.0 and later)
-        if (((major == 2) && (minor >= 11)) || (major > 2))
-        {
-            int nDevices;
-            memcpy(&nDevices, ptr, 4); ptr += 4;
-            for (int iDevice = 0; iDevice < nDevices; iDevice++)
-            {
-                // ID
-                int ID = 0; memcpy(&ID, ptr, 4); ptr += 4;
-                printf("Device : %d\n", ID);
+    size_t size = zosc_size(*osc);
+    if ( bundle.size() > 16 && bundle.size() + 4 + size > (size_t)bundleSize )
+        flushBundle(zmsg);
+    if ( bundle.empty() ) {
+        static const char header[8] = "#bundle";
+        bundle.insert(bundle.end(), header, header + 8);
+        s_put_be32(bundle, (uint32_t)(timetag >> 32));
+        s_put_be32(bundle, (uint32_t)timetag);
+    }
+    s_put_be32(bundle, (uint32_t)size);
+    const unsigned char *data = (const unsigned char *)zosc_data(*osc);
+    bundle.insert(bundle.end(), data, data + size);
+    zosc_destroy(osc);
+}
 
-                // Channel Count
-                int nChannels = 0; memcpy(&nChannels, ptr, 4); ptr += 4;
+void NatNet2OSC::flushBundle(zmsg_t *zmsg)
+{
+    if ( bundle.empty() )
+        return;
+    zmsg_addmem(zmsg, bundle.data(), bundle.size());
+    bundle.clear();
+}
 
-                // Channel Data
-                for (int i = 0; i < nChannels; i++)
-                {
-                    printf(" Channel %d : ", i);
-                    int nFrames = 0; memcpy(&nFrames, ptr, 4); ptr += 4;
-                    for (int j = 0; j < nFrames; j++)
-                    {
-                        float val = 0.0f;  memcpy(&val, ptr, 4); ptr += 4;
-                        printf("%3.2f   ", val);
-                    }
-                    printf("\n");
-                }
+// The selected poses as binary pose stream packets, preceded by the
+// descriptions when they changed or a second has passed
+void NatNet2OSC::addBinary(zmsg_t *zmsg)
+{
+    const NatNetPoses &rbs = frame.rigidBodies;
+    const NatNetPoses &joints = frame.joints;
+    const uint32_t version = descriptions->version;
+
+    int64_t now = zclock_mono();
+    if ( binaryVersion != version || binarySource != descriptionSource->id() || now - binaryDescriptionTime >= 1000 ) {
+        poseWriter.begin(zmsg, POSESTREAM_DESCRIPTION, frame.header.frameNumber, version, frame.header.timestamp);
+        for ( const RigidBodyDescription &rbd : descriptions->rigidbodies )
+            poseWriter.addDescription(rbd.id, rbd.parent_id, rbd.name.c_str());
+        for ( const SkeletonDescription &sd : descriptions->skeletons ) {
+            poseWriter.addDescription(sd.id, -1, sd.name.c_str());
+            for ( const RigidBodyDescription &joint : sd.joints ) {
+                int32_t parent = joint.parent_id > 0 ? sd.id << 16 | joint.parent_id : sd.id;
+                poseWriter.addDescription(sd.id << 16 | joint.id, parent, joint.name.c_str());
             }
         }
+        poseWriter.end();
+        binarySource = descriptionSource->id();
+        binaryVersion = version;
+        binaryDescriptionTime = now;
+    }
 
-        // latency, removed in 3.0
-        if (major < 3)
-        {
-            float latency = 0.0f; memcpy(&latency, ptr, 4);	ptr += 4;
-            //zsys_info("latency : %3.3f\n", latency);
-            this->latency = latency;
-        }
-
-        // timecode
-        unsigned int timecode = 0; 	memcpy(&timecode, ptr, 4);	ptr += 4;
-        unsigned int timecodeSub = 0; memcpy(&timecodeSub, ptr, 4); ptr += 4;
-        char szTimecode[128] = "";
-        TimecodeStringify(timecode, timecodeSub, szTimecode, 128);
-
-        // timestamp
-        double timestamp = 0.0f;
-        // 2.7 and later - increased from single to double precision
-        if( ((major == 2)&&(minor>=7)) || (major>2))
-        {
-            memcpy(&timestamp, ptr, 8); ptr += 8;
-        }
-        else
-        {
-            float fTemp = 0.0f;
-            memcpy(&fTemp, ptr, 4); ptr += 4;
-            timestamp = (double)fTemp;
-        }
-
-        // high res timestamps (version 3.0 and later)
-        if ((major >= 3) || (major == 0))
-        {
-            uint64_t cameraMidExposureTimestamp = 0;
-            memcpy(&cameraMidExposureTimestamp, ptr, 8); ptr += 8;
-            //printf("Mid-exposure timestamp : %" PRIu64"\n", cameraMidExposureTimestamp);
-
-            uint64_t cameraDataReceivedTimestamp = 0;
-            memcpy(&cameraDataReceivedTimestamp, ptr, 8); ptr += 8;
-            //printf("Camera data received timestamp : %" PRIu64"\n", cameraDataReceivedTimestamp);
-
-            uint64_t transmitTimestamp = 0;
-            memcpy(&transmitTimestamp, ptr, 8); ptr += 8;
-            //printf("Transmit timestamp : %" PRIu64"\n", transmitTimestamp);
+    poseWriter.begin(zmsg, POSESTREAM_FRAME, frame.header.frameNumber, version, frame.header.timestamp);
+    if ( sendMarkers ) {
+        static const float identity[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        for ( uint32_t i = 0; i < frame.header.markerCount; i++ )
+            poseWriter.addPose(frame.markerId[i], frame.markers + i * 3, identity, POSESTREAM_MARKER | POSESTREAM_TRACKED);
+    }
+    if ( sendRigidbodies ) {
+        for ( uint32_t i = 0; i < rbs.count; i++ ) {
+            uint32_t flags = POSESTREAM_RIGIDBODY | ((rbs.flags[i] & NATNET_POSE_ACTIVE) ? POSESTREAM_TRACKED : 0);
+            poseWriter.addPose(rbs.id[i], rbs.position + i * 3, rbs.rotation + i * 4, flags);
         }
-
-        // frame params
-        short params = 0;  memcpy(&params, ptr, 2); ptr += 2;
-        bool bIsRecording = params & 0x01;                  // 0x01 Motive is recording
-        bool bTrackedModelsChanged = params & 0x02;         // 0x02 Actively tracked model list has changed
-
-
-        // end of data tag
-        int eod = 0; memcpy(&eod, ptr, 4); ptr += 4;
-        //zsys_info("End Packet\n-------------\n");
-
-        // filter markers
-        // TODO: Test re-implemented marker filtering (replaced remove_dups)
-        if (duplicated_point_removal_distance > 0)
-        {
-            std::map<int, RigidBody>::iterator it =
-                    this->rigidbodies.begin();
-            while (it != this->rigidbodies.end())
-            {
-                RigidBody& RB = it->second;
-
-                for (int i = 0; i < RB.markers.size(); i++)
-                {
-                    glm::vec3& v = RB.markers[i];
-                    std::vector<Marker>::iterator it = std::remove_if(
-                            tmp_filtered_markers.begin(), tmp_filtered_markers.end(),
-                            remove_dups(v, duplicated_point_removal_distance));
-                    tmp_filtered_markers.erase(it, tmp_filtered_markers.end());
-                }
-
-                it++;
+    }
+    if ( sendSkeletons ) {
+        for ( uint32_t j = 0; j < frame.header.skeletonCount; j++ ) {
+            const SkeletonDescription *sd = s_find_description(descriptions->skeletons, frame.skeletonId[j], j);
+            if ( sd == nullptr )
+                continue;
+            uint32_t first = frame.skeletonJointStart[j];
+            uint32_t count = std::min(frame.skeletonJointCount[j], (uint32_t)sd->joints.size());
+            for ( uint32_t i = 0; i < count; i++ ) {
+                uint32_t flags = POSESTREAM_JOINT | ((joints.flags[first + i] & NATNET_POSE_ACTIVE) ? POSESTREAM_TRACKED : 0);
+                poseWriter.addPose(sd->id << 16 | sd->joints[i].id, joints.position + (first + i) * 3,
+                                   joints.rotation + (first + i) * 4, flags);
             }
         }
+    }
+    poseWriter.end();
+}
 
-        //Copy data to instance...
-        this->latency = latency;
-        this->frame_number = frameNumber;
-        this->markers_set = tmp_markers_set;
-        this->markers = tmp_markers;
-        this->filtered_markers = tmp_filtered_markers;
-        // fill the rigidbodies map
-        {
-            for (int i = 0; i < tmp_rigidbodies.size(); i++) {
-                RigidBody &RB = tmp_rigidbodies[i];
-                RigidBody &tRB = this->rigidbodies[RB.id];
-                tRB = RB;
-            }
-        }
-        {
-            for (int i = 0; i < tmp_skeletons.size(); i++) {
-                Skeleton &S = tmp_skeletons[i];
-                Skeleton &tS = this->skeletons[S.id];
-                tS = S;
-            }
+// Get the description snapshot the current frame was sent with, this only
+// touches the shared state when the sender or its descriptions changed
+bool NatNet2OSC::loadDescriptions()
+{
+    if ( descriptionSource == nullptr || descriptionSource->id() != frame.header.source ) {
+        descriptionSource = NatNetDescriptionSource::find(frame.header.source);
+        descriptions = nullptr;
+        if ( descriptionSource == nullptr ) {
+            zsys_error("NatNet2OSC: the NatNet actor sending this frame is gone");
+            return false;
         }
     }
-    // this is stored centrally on static NatNet:: lists
-    else if(MessageID == 5) // Data Descriptions
-    {
-        //std::vector<RigidBodyDescription> tmp_rigidbody_descs;
-        //std::vector<SkeletonDescription> tmp_skeleton_descs;
-        //std::vector<MarkerSetDescription> tmp_markerset_descs;
-
-        // number of datasets
-        int nDatasets = 0; memcpy(&nDatasets, ptr, 4);
-        ptr += 4;
-        //zsys_info("Dataset Count : %d\n", nDatasets);
-
-        for(int i=0; i < nDatasets; i++)
-        {
-            //zsys_info("Dataset %d\n", i);
-
-            int type = 0; memcpy(&type, ptr, 4); ptr += 4;
-            //zsys_info("Type : %d\n", i, type);
-
-            if(type == 0)   // markerset
-            {
-                //MarkerSetDescription description;
-
-                // name
-                char szName[256];
-                strcpy(szName, ptr);
-                int nDataBytes = (int) strlen(szName) + 1;
-                ptr += nDataBytes;
-                //zsys_info("Markerset Name: %s\n", szName);
-                //description.name = szName;
-
-                // marker data
-                int nMarkers = 0; memcpy(&nMarkers, ptr, 4); ptr += 4;
-                //zsys_info("Marker Count : %d\n", nMarkers);
-
-                for(int j=0; j < nMarkers; j++)
-                {
-                    char szName[256];
-                    strcpy(szName, ptr);
-                    int nDataBytes = (int) strlen(szName) + 1;
-                    ptr += nDataBytes;
-                    //zsys_info("Marker Name: %s\n", szName);
-                    //description.marker_names.push_back(szName);
-                }
-                //tmp_markerset_descs.push_back(description);
-            }
-            else if(type ==1)   // rigid body
-            {
-                //RigidBodyDescription description;
-
-                if(major >= 2)
-                {
-                    // name
-                    char szName[MAX_NAMELENGTH];
-                    strcpy(szName, ptr);
-                    ptr += strlen(ptr) + 1;
-                    //zsys_info("Name: %s\n", szName);
-                    //description.name = szName;
-                }
-
-                int ID = 0; memcpy(&ID, ptr, 4); ptr +=4;
-                //zsys_info("ID : %d\n", ID);
-                //description.id = ID;
-
-                int parentID = 0; memcpy(&parentID, ptr, 4); ptr +=4;
-                //zsys_info("Parent ID : %d\n", parentID);
-                //description.parent_id = parentID;
-
-                float xoffset = 0; memcpy(&xoffset, ptr, 4); ptr +=4;
-                //zsys_info("X Offset : %3.2f\n", xoffset);
-
-                float yoffset = 0; memcpy(&yoffset, ptr, 4); ptr +=4;
-                //zsys_info("Y Offset : %3.2f\n", yoffset);
-
-                float zoffset = 0; memcpy(&zoffset, ptr, 4); ptr +=4;
-                //zsys_info("Z Offset : %3.2f\n", zoffset);
-
-                //description.offset[0] = xoffset;
-                //description.offset[1] = xoffset;
-                //description.offset[2] = xoffset;
-
-                // TODO: Per-marker data (NatNet 3.0 and later)
-                if (major >= 3)
-                {
-                    int nMarkers = 0; memcpy(&nMarkers, ptr, 4); ptr += 4;
-
-                    // Marker positions
-                    nBytes = nMarkers * 3 * sizeof(float);
-                    float* markerPositions = (float*)malloc(nBytes);
-                    memcpy(markerPositions, ptr, nBytes);
-                    ptr += nBytes;
-
-                    // Marker required active labels
-                    nBytes = nMarkers * sizeof(int);
-                    int* markerRequiredLabels = (int*)malloc(nBytes);
-                    memcpy(markerRequiredLabels, ptr, nBytes);
-                    ptr += nBytes;
-
-                    for (int markerIdx = 0; markerIdx < nMarkers; ++markerIdx)
-                    {
-                        float* markerPosition = markerPositions + markerIdx * 3;
-                        const int markerRequiredLabel = markerRequiredLabels[markerIdx];
-
-                        //printf("\tMarker #%d:\n", markerIdx);
-                        //printf("\t\tPosition: %.2f, %.2f, %.2f\n", markerPosition[0], markerPosition[1], markerPosition[2]);
-
-                        //if (markerRequiredLabel != 0)
-                        //{
-                        //    printf("\t\tRequired active label: %d\n", markerRequiredLabel);
-                        //}
-                    }
-
-                    free(markerPositions);
-                    free(markerRequiredLabels);
-                }
-
-                //tmp_rigidbody_descs.push_back(description);
-            }
-            else if(type ==2)   // skeleton
-            {
-                //SkeletonDescription description;
-
-                char szName[MAX_NAMELENGTH];
-                strcpy(szName, ptr);
-                ptr += strlen(ptr) + 1;
-                //zsys_info("Name: %s\n", szName);
-                //description.name = szName;
-
-                int ID = 0; memcpy(&ID, ptr, 4); ptr +=4;
-                //zsys_info("ID : %d\n", ID);
-                //description.id = ID;
-
-                int nRigidBodies = 0; memcpy(&nRigidBodies, ptr, 4); ptr +=4;
-                //zsys_info("RigidBody (Bone) Count : %d\n", nRigidBodies);
-                //description.joints.resize(nRigidBodies);
-
-                for(int i=0; i< nRigidBodies; i++) {
-                    if (major >= 2) {
-                        // RB name
-                        char szName[MAX_NAMELENGTH];
-                        strcpy(szName, ptr);
-                        ptr += strlen(ptr) + 1;
-                        //zsys_info("Rigid Body Name: %s\n", szName);
-                        //description.joints[i].name = szName;
-                    }
-
-                    int ID = 0;
-                    memcpy(&ID, ptr, 4);
-                    ptr += 4;
-                    //zsys_info("RigidBody ID : %d\n", ID);
-                    //description.joints[i].id = ID;
-
-                    int parentID = 0;
-                    memcpy(&parentID, ptr, 4);
-                    ptr += 4;
-                    //zsys_info("Parent ID : %d\n", parentID);
-                    //description.joints[i].parent_id = parentID;
-
-                    float xoffset = 0;
-                    memcpy(&xoffset, ptr, 4);
-                    ptr += 4;
-                    //zsys_info("X Offset : %3.2f\n", xoffset);
-
-                    float yoffset = 0;
-                    memcpy(&yoffset, ptr, 4);
-                    ptr += 4;
-                    //zsys_info("Y Offset : %3.2f\n", yoffset);
-
-                    float zoffset = 0;
-                    memcpy(&zoffset, ptr, 4);
-                    ptr += 4;
-                    //zsys_info("Z Offset : %3.2f\n", zoffset);
-
-                    //description.joints[i].offset[0] = xoffset;
-                    //description.joints[i].offset[0] = yoffset;
-                    //description.joints[i].offset[0] = zoffset;
-
-                    if (major >= 3) {
-                        // Extra # of markers attached to each rigidbody (always 0 for skeletons, but still 4 bytes)
-                        ptr += 4;
-                    }
-                }
-                //tmp_skeleton_descs.push_back(description);
-            }
-            else if ( major >= 3 ) {
-                // Force Plate
-                if ( type == 3 ) {
-                    int ID = 0; memcpy(&ID, ptr, 4); ptr += 4;
-                    // printf("ID : %d\n", ID);
-
-                    // Serial Number
-                    char strSerialNo[128];
-                    strcpy(strSerialNo, ptr);
-                    ptr += strlen(ptr) + 1;
-                    // printf("Serial Number : %s\n", strSerialNo);
-
-                    // Dimensions
-                    float fWidth = 0; memcpy(&fWidth, ptr, 4); ptr += 4;
-                    // printf("Width : %3.2f\n", fWidth);
-
-                    float fLength = 0; memcpy(&fLength, ptr, 4); ptr += 4;
-                    // printf("Length : %3.2f\n", fLength);
-
-                    // Origin
-                    float fOriginX = 0; memcpy(&fOriginX, ptr, 4); ptr += 4;
-                    float fOriginY = 0; memcpy(&fOriginY, ptr, 4); ptr += 4;
-                    float fOriginZ = 0; memcpy(&fOriginZ, ptr, 4); ptr += 4;
-                    // printf("Origin : %3.2f,  %3.2f,  %3.2f\n", fOriginX, fOriginY, fOriginZ);
-
-                    // Calibration Matrix
-                    const int kCalMatX = 12;
-                    const int kCalMatY = 12;
-                    float fCalMat[kCalMatX][kCalMatY];
-                    // printf("Cal Matrix\n");
-                    for (int calMatX = 0; calMatX < kCalMatX; ++calMatX)
-                    {
-                        printf("  ");
-                        for (int calMatY = 0; calMatY < kCalMatY; ++calMatY)
-                        {
-                            memcpy(&fCalMat[calMatX][calMatY], ptr, 4); ptr += 4;
-                            printf("%3.3e ", fCalMat[calMatX][calMatY]);
-                        }
-                        printf("\n");
-                    }
-
-                    // Corners
-                    const int kCornerX = 4;
-                    const int kCornerY = 3;
-                    float fCorners[kCornerX][kCornerY] = { {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0} };
-                    // printf("Corners\n");
-                    for (int cornerX = 0; cornerX < kCornerX; ++cornerX)
-                    {
-                        printf("  ");
-                        for (int cornerY = 0; cornerY < kCornerY; ++cornerY)
-                        {
-                            memcpy(&fCorners[cornerX][cornerY], ptr, 4); ptr += 4;
-                            // printf("%3.3e ", fCorners[cornerX][cornerY]);
-                        }
-                        printf("\n");
-                    }
-
-                    // Plate Type
-                    int iPlateType = 0; memcpy(&iPlateType, ptr, 4); ptr += 4;
-                    // printf("Plate Type : %d\n", iPlateType);
-
-                    // Channel Data Type
-                    int iChannelDataType = 0; memcpy(&iChannelDataType, ptr, 4); ptr += 4;
-                    // printf("Channel Data Type : %d\n", iChannelDataType);
-
-                    // Number of Channels
-                    int nChannels = 0; memcpy(&nChannels, ptr, 4); ptr += 4;
-                    // printf("  Number of Channels : %d\n", nChannels);
-
-                    for (int chNum = 0; chNum < nChannels; ++chNum)
-                    {
-                        char szName[MAX_NAMELENGTH];
-                        strcpy(szName, ptr);
-                        int nDataBytes = (int)strlen(szName) + 1;
-                        ptr += nDataBytes;
-                        // printf("    Channel Name %d: %s\n",chNum,  szName);
-                    }
-                }
-                    // Device
-                else if ( type == 4 ) {
-                    int ID = 0; memcpy(&ID, ptr, 4); ptr += 4;
-                    //printf("ID : %d\n", ID);
-
-                    // Name
-                    char strName[128];
-                    strcpy(strName, ptr);
-                    ptr += strlen(ptr) + 1;
-                    //printf("Device Name :       %s\n", strName);
-
-                    // Serial Number
-                    char strSerialNo[128];
-                    strcpy(strSerialNo, ptr);
-                    ptr += strlen(ptr) + 1;
-                    //printf("Serial Number :     %s\n", strSerialNo);
-
-                    int iDeviceType = 0; memcpy(&iDeviceType, ptr, 4); ptr += 4;
-                    //printf("Device Type :        %d\n", iDeviceType);
-
-                    int iChannelDataType = 0; memcpy(&iChannelDataType, ptr, 4); ptr += 4;
-                    //printf("Channel Data Type : %d\n", iChannelDataType);
-
-                    int nChannels = 0; memcpy(&nChannels, ptr, 4); ptr += 4;
-                    printf("Number of Channels : %d\n", nChannels);
-                    char szChannelName[MAX_NAMELENGTH];
-
-                    for (int chNum = 0; chNum < nChannels; ++chNum) {
-                        strcpy(szChannelName, ptr);
-                        ptr += strlen(ptr) + 1;
-                        printf("  Channel Name %d:     %s\n", chNum, szChannelName);
-                    }
-                }
-                // Camera
-                if (type == 5) {
-                    // Name
-                    char szName[MAX_NAMELENGTH];
-                    strcpy(szName, ptr);
-                    ptr += strlen(ptr) + 1;
-                    //MakeAlnum(szName, MAX_NAMELENGTH);
-                    //printf("Camera Name  : %s\n", szName);
-
-                    // Pos
-                    float cameraPosition[3];
-                    memcpy(cameraPosition+0, ptr, 4); ptr += 4;
-                    memcpy(cameraPosition+1, ptr, 4); ptr += 4;
-                    memcpy(cameraPosition+2, ptr, 4); ptr += 4;
-                    //printf("  Position   : %3.2f, %3.2f, %3.2f\n",
-                    //       cameraPosition[0], cameraPosition[1],
-                    //       cameraPosition[2]);
-
-                    // Ori
-                    float cameraOriQuat[4]; // x, y, z, w
-                    memcpy(cameraOriQuat + 0, ptr, 4); ptr += 4;
-                    memcpy(cameraOriQuat + 1, ptr, 4); ptr += 4;
-                    memcpy(cameraOriQuat + 2, ptr, 4); ptr += 4;
-                    memcpy(cameraOriQuat + 3, ptr, 4); ptr += 4;
-                    //printf("  Orientation: %3.2f, %3.2f, %3.2f, %3.2f\n",
-                    //       cameraOriQuat[0], cameraOriQuat[1],
-                    //       cameraOriQuat[2], cameraOriQuat[3] );
-                }
-            }
-
-        }   // next dataset
-
-        //zsys_info("End Packet\n-------------\n");
+    if ( descriptions == nullptr || descriptions->version != frame.header.descriptionVersion )
+        descriptions = descriptionSource->load();
+    return true;
+}
 
-        //Store descriptions, skipped here
-        //this->markerset_descs = tmp_markerset_descs;
-        //this->rigidbody_descs = tmp_rigidbody_descs;
-        //this->skeleton_descs = tmp_skeleton_descs;
-    }
-    else
-    {
-        zsys_info("Unrecognized Packet Type: %i.\n", MessageID);
-    }
+void NatNet2OSC::setReport( sphactor_actor_t *actor )
+{
+    char stat[32], packets[32];
+    snprintf(stat, sizeof(stat), "%.1f", framesBuilt ? (double)buildUsecs / framesBuilt : 0.0);
+    snprintf(packets, sizeof(packets), "%.1f", framesBuilt ? (double)packetsSent / framesBuilt : 0.0);
+    zosc_t * msg = zosc_create("/report", "sisisisissss",
+                               "Frame", frame.header.frameNumber,
+                               "Rigid bodies", (int)frame.header.rigidBodyCount,
+                               "Skeletons", (int)frame.header.skeletonCount,
+                               "Markers", (int)frame.header.markerCount,
+                               "Build usec/frame", stat,
+                               "Packets/frame", packets);
+    sphactor_actor_set_custom_report_data(actor, msg);
 }
 
 void NatNet2OSC::fixRanges( glm::vec3 *euler )
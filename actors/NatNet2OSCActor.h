@@ -3,7 +3,26 @@
 
 #include "libsphactor.hpp"
 #include "NatNetDataTypes.h"
+#include "NatNetFrame.h"
+#include "NatNetDescriptions.h"
+#include "NatNetVelocity.h"
+#include "PoseStreamWriter.h"
 #include <map>
+#include <unordered_map>
+
+// ids below this are looked up in a dense table, others in a hash map
+#define NATNET2OSC_DENSE_IDS    65536
+
+// State of a rigid body. A body keeps its slot for the lifetime of the
+// actor so its velocity filter survives description updates.
+struct RigidBodySlot
+{
+    int id;
+    const RigidBodyDescription *description = nullptr;  // in the current snapshot
+    std::string address;                                // precomputed OSC address
+
+    explicit RigidBodySlot(int id) : id(id) {}
+};
 
 class NatNet2OSC : public Sphactor
 {
@@ -17,31 +36,59 @@ public:
     bool sendVelocities = false;
     bool sendHierarchy = true;
 
-    int frame_number;
-    float latency;
-    float timeout;
-    int sentRequest;
-    float duplicated_point_removal_distance = 0;
+    // whole frames as OSC bundles of at most bundleSize bytes
+    bool sendBundles = false;
+    int bundleSize = 1472;
+    std::vector<unsigned char> bundle;
+    double timetagOffset = 0;               // NatNet timestamp to seconds since 1900
+    bool timetagValid = false;
+    uint64_t timetag = 0;
+    uint64_t packetsSent = 0;
+
+    // compact binary pose stream instead of OSC
+    bool sendBinary = false;
+    PoseStreamWriter poseWriter;
+    uint32_t binarySource = 0;              // descriptions last sent, 0 if none
+    uint32_t binaryVersion = 0;
+    int64_t binaryDescriptionTime = 0;
+
+    // decoded frame as sent by the NatNet actor
+    NatNetFrameView frame;
+    std::shared_ptr<NatNetDescriptionSource> descriptionSource;
+    std::shared_ptr<const NatNetDescriptions> descriptions;
+    uint64_t framesBuilt = 0;
+    int64_t buildUsecs = 0;
 
-    std::vector<std::vector<Marker> > markers_set;
-    std::vector<Marker> filtered_markers;
-    std::vector<Marker> markers;
-    std::map<int, RigidBody> rigidbodies;
-    std::map<int, Skeleton> skeletons;
+    // rigid body slots and their index by id
+    std::vector<RigidBodySlot> rbSlots;
+    std::vector<int32_t> rbSlotIndex;
+    std::unordered_map<int, uint32_t> rbSlotSparse;
+    uint32_t slotSource = 0;                // source and version of the descriptions the
+    uint32_t slotVersion = 0;               // slots point into, versions start at 1
+    bool slotHierarchy = true;
+    std::vector<uint32_t> frameSlots;       // slot of each rigid body in the frame
 
-    std::vector<RigidBodyHistory> rbHistory;
+    // velocities of all slots, filtered per frame
+    NatNetVelocityBank velocities;
+    int velocityWindow = 5;
+    int velocityLag = 2;
 
     zmsg_t *handleInit( sphactor_event_t *ev );
     zmsg_t *handleSocket( sphactor_event_t *ev );
     zmsg_t *handleAPI( sphactor_event_t *ev );
 
-    //NatNet parse functions
-    void Unpack( char ** pData );
-    char* unpackRigidBodies(char* ptr, std::vector<RigidBody>& ref_rigidbodies);
-    char* unpackMarkerSet(char* ptr, std::vector<Marker>& ref_markers);
-    void sendRequestDescription();
+    void setReport( sphactor_actor_t *actor );
+    bool loadDescriptions();
+    uint32_t rigidBodySlot(int id);
+    void updateSlots();
 
     //OSC Sending Functions
+    // messages of the parsed frame, the descriptions must be loaded
+    zmsg_t *buildMessages();
+    void addMessage(zmsg_t *zmsg, zosc_t **osc);
+    void flushBundle(zmsg_t *zmsg);
+    void updateTimetag();
+    void addBinary(zmsg_t *zmsg);
     void addRigidbodies(zmsg_t *zmsg);
     void addSkeletons(zmsg_t *zmsg);
     void fixRanges( glm::vec3 *euler );
@@ -1,15 +1,12 @@
 #include "NatNetActor.h"
 #include <string>
 #include <algorithm>
+#include <chrono>
 #include <time.h>
 
 //static variable definitions
 int* NatNet::NatNetVersion = new int[4]{0,0,0,0};
 int* NatNet::ServerVersion = new int[4]{0,0,0,0};
-std::vector<RigidBodyDescription> NatNet::rigidbody_descs;
-std::vector<SkeletonDescription> NatNet::skeleton_descs;
-std::vector<MarkerSetDescription> NatNet::markerset_descs;
-std::mutex NatNet::desc_mutex;
 
 const char * NatNet::capabilities =
                                 "capabilities\n"
@@ -36,6 +33,31 @@ const char * NatNet::capabilities =
                                 "        api_value = \"i\"\n"           // optional picture format used in zsock_send
                                 "        min = 1\n"
                                 "    data\n"
+                                "        name = \"immediate\"\n"
+                                "        type = \"bool\"\n"
+                                "        help = \"Send every frame as it arrives, otherwise only the latest frame is sent on each timer tick\"\n"
+                                "        value = \"True\"\n"
+                                "        api_call = \"SET IMMEDIATE\"\n"
+                                "        api_value = \"s\"\n"
+                                "    data\n"
+                                "        name = \"dedupDistance\"\n"
+                                "        type = \"float\"\n"
+                                "        help = \"Remove markers closer than this to another marker or a rigid body marker (meters), 0 disables\"\n"
+                                "        value = \"0.0\"\n"
+                                "        min = \"0.0\"\n"
+                                "        max = \"0.1\"\n"
+                                "        api_call = \"SET DEDUP DISTANCE\"\n"
+                                "        api_value = \"f\"\n"
+                                "    data\n"
+                                "        name = \"trackDistance\"\n"
+                                "        type = \"float\"\n"
+                                "        help = \"Keep marker ids from frame to frame for markers moving less than this per frame (meters), 0 numbers the markers per frame\"\n"
+                                "        value = \"0.0\"\n"
+                                "        min = \"0.0\"\n"
+                                "        max = \"0.2\"\n"
+                                "        api_call = \"SET TRACK DISTANCE\"\n"
+                                "        api_value = \"f\"\n"
+                                "    data\n"
                                 "        name = \"Reset\"\n"
                                 "        type = \"trigger\"\n"
                                 "        help = \"Re-retrieve the motive definitions\"\n"
@@ -69,38 +91,87 @@ zmsg_t * NatNet::handleInit( sphactor_event_t * ev )
     // initially we use the first interface
     activeInterface = ifNames[0];
 
+    // a datagram can be as big as UDP allows
+    receiveBuffer.resize(sizeof(sPacket));
+
     // Setup the receive socket on port DATA_PORT
-    std::string url = "udp://" + activeInterface + ";" + MULTICAST_ADDRESS + ":" + PORT_DATA_STR;
-    DataSocket = zsock_new(ZMQ_DGRAM);
-    assert( DataSocket );
-    //zsock_connect(DataSocket, "%s", url.c_str());
-    int rc = zsock_bind(DataSocket, "%s", url.c_str());
-    assert( rc != -1 );
-    rc = sphactor_actor_poller_add((sphactor_actor_t*)ev->actor, DataSocket );
+    if ( !OpenDataSocket(ev->actor, ifAddresses[0]) )
+        zsys_error("NatNet: can't receive frames on port %s", PORT_DATA_STR.c_str());
+
+    // replies come back on the ephemeral port we send the commands from
+    CommandSocket = zsys_udp_new(false);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    int rc = bind(CommandSocket, (struct sockaddr *)&address, sizeof(address));
+    assert( rc == 0 );
+    rc = sphactor_actor_poller_add(ev->actor, &CommandSocket );
     assert(rc == 0);
 
+    return NULL;
+}
 
-    url = "udp://*:*";
-    CommandSocket = zsock_new_dgram(url.c_str());
-    assert( CommandSocket );
-    rc = sphactor_actor_poller_add((sphactor_actor_t*)ev->actor, CommandSocket );
+bool NatNet::OpenDataSocket( sphactor_actor_t *actor, const std::string &address )
+{
+    CloseSocket(actor, &DataSocket);
+
+    // zsys_udp_new sets SO_REUSEADDR so other clients on this host can join the group as well
+    DataSocket = zsys_udp_new(false);
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(DataSocket, SOL_SOCKET, SO_RCVBUF, (const char *)&rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_in bindAddress;
+    memset(&bindAddress, 0, sizeof(bindAddress));
+    bindAddress.sin_family = AF_INET;
+    bindAddress.sin_port = htons(PORT_DATA);
+    bindAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    if ( bind(DataSocket, (struct sockaddr *)&bindAddress, sizeof(bindAddress)) != 0 ) {
+        zsys_udp_close(DataSocket);
+        DataSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    // join the multicast group on the selected interface
+    struct ip_mreq group;
+    group.imr_multiaddr.s_addr = inet_addr(MULTICAST_ADDRESS.c_str());
+    group.imr_interface.s_addr = inet_addr(address.c_str());
+    if ( setsockopt(DataSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&group, sizeof(group)) != 0 )
+        zsys_warning("NatNet: can't join %s on %s", MULTICAST_ADDRESS.c_str(), address.c_str());
+
+    int rc = sphactor_actor_poller_add(actor, &DataSocket);
     assert(rc == 0);
+    return true;
+}
 
-    return NULL;
+void NatNet::CloseSocket( sphactor_actor_t *actor, SOCKET *socket )
+{
+    if ( *socket != INVALID_SOCKET ) {
+        sphactor_actor_poller_remove(actor, socket);
+        zsys_udp_close(*socket);
+        *socket = INVALID_SOCKET;
+    }
+}
+
+bool NatNet::SendPacket( sPacket *packet )
+{
+    if ( CommandSocket == INVALID_SOCKET )
+        return false;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT_COMMAND);
+    address.sin_addr.s_addr = inet_addr(host.c_str());
+    int size = 4 + packet->nDataBytes;
+    return sendto(CommandSocket, (const char *)packet, size, 0, (const struct sockaddr *)&address, sizeof(address)) == size;
 }
 
 zmsg_t * NatNet::handleStop( sphactor_event_t * ev )
 {
-    if ( CommandSocket != NULL ) {
-        sphactor_actor_poller_remove((sphactor_actor_t*)ev->actor, CommandSocket);
-        zsock_destroy(&CommandSocket);
-        CommandSocket = NULL;
-    }
-    if ( DataSocket != NULL ) {
-        sphactor_actor_poller_remove((sphactor_actor_t*)ev->actor, DataSocket);
-        zsock_destroy(&DataSocket);
-        DataSocket = NULL;
-    }
+    CloseSocket(ev->actor, &CommandSocket);
+    CloseSocket(ev->actor, &DataSocket);
 
     return NULL;
 }
@@ -129,6 +200,8 @@ zmsg_t * NatNet::handleAPI( sphactor_event_t * ev )
             this->rigidbodiesReady = false;
             this->skeletonsReady = false;
             this->sentRequest = 0;
+            this->minArrivalOffset = 0;
+            this->markerFilter.reset();
 
             // re-send ping as well to force response packet
             SendPing();
@@ -139,10 +212,32 @@ zmsg_t * NatNet::handleAPI( sphactor_event_t * ev )
             zsys_info("SET HOST: %s", host_addr);
             zstr_free(&host_addr);
 
-            if ( CommandSocket != nullptr ) {
+            if ( CommandSocket != INVALID_SOCKET ) {
                 SendPing();
             }
         }
+        else if ( streq(cmd, "SET IMMEDIATE") ) {
+            char *value = zmsg_popstr(ev->msg);
+            forwardImmediately = streq(value, "True");
+            zstr_free(&value);
+
+            if ( forwardImmediately && lastData != nullptr )
+                zmsg_destroy(&lastData);
+        }
+        else if ( streq(cmd, "SET DEDUP DISTANCE") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value )
+                markerFilter.dedupDistance = std::max(0.0f, (float)atof(value));
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET TRACK DISTANCE") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value ) {
+                markerFilter.trackDistance = std::max(0.0f, (float)atof(value));
+                markerFilter.reset();
+            }
+            zstr_free(&value);
+        }
         else if ( streq(cmd, "SET INTERFACE") ) {
             char* ifChar = zmsg_popstr(ev->msg);
             int ifIndex = std::stoi(ifChar);
@@ -151,19 +246,8 @@ zmsg_t * NatNet::handleAPI( sphactor_event_t * ev )
             // zsys_info("SET INTERFACE: %i", ifIndex);
             if ( ifIndex < ifNames.size() ) {
                 activeInterface = ifNames[ifIndex];
-
-                if (DataSocket != NULL) {
-                    sphactor_actor_poller_remove((sphactor_actor_t *) ev->actor, DataSocket);
-                    zsock_destroy(&DataSocket);
-                }
-
-                std::string url = "udp://" + activeInterface + ";" + MULTICAST_ADDRESS + ":" + PORT_DATA_STR;
-                DataSocket = zsock_new(ZMQ_DGRAM);
-                //zsock_connect(DataSocket, "%s", url.c_str());
-                zsock_bind(DataSocket, "%s", url.c_str());
-                assert(DataSocket);
-                int rc = sphactor_actor_poller_add((sphactor_actor_t *) ev->actor, DataSocket);
-                assert(rc == 0);
+                if ( !OpenDataSocket(ev->actor, ifAddresses[ifIndex]) )
+                    zsys_error("NatNet: can't receive frames on port %s", PORT_DATA_STR.c_str());
             }
             else {
                 zsys_info("ERROR: Invalid interface number");
@@ -184,12 +268,8 @@ void NatNet::SendPing() {
     PacketOut.nDataBytes = 0;
     int nTries = 3;
     while (nTries--) {
-        //int iRet = sendto(CommandSocket, (char *)&PacketOut, 4 + PacketOut.nDataBytes, 0, (sockaddr *)&HostAddr, sizeof(HostAddr));
-        std::string url = host + ":" + PORT_COMMAND_STR;
-        zstr_sendm(CommandSocket, url.c_str());
-        int rc = zsock_send(CommandSocket, "b", (char *) &PacketOut, 4 + PacketOut.nDataBytes);
-        if (rc != -1) {
-            zsys_info("Sent ping to %s", url.c_str());
+        if ( SendPacket(&PacketOut) ) {
+            zsys_info("Sent ping to %s:%s", host.c_str(), PORT_COMMAND_STR.c_str());
         }
     }
 }
@@ -203,168 +283,146 @@ zmsg_t * NatNet::handleCustomSocket( sphactor_event_t * ev )
 
     // Get the socket...
     assert(ev->msg);
+    zmsg_t *retMsg = nullptr;
     zframe_t *frame = zmsg_pop(ev->msg);
     if (zframe_size(frame) == sizeof( void *) )
     {
         void *p = *(void **)zframe_data(frame);
-        if ( zsock_is( p ) )
+        if ( p == &CommandSocket || p == &DataSocket )
         {
-            zsock_t* which = (zsock_t*)p;
-
-            if ( which == CommandSocket ) {
-                // zsys_info("CMD SOCKET");
-                // Parse command
-                int addr_len;
-                int nDataBytesReceived;
-                char str[256];
-                sPacket PacketIn;
-                addr_len = sizeof(struct sockaddr);
-
-                //int rc = zmq_recv(CommandSocket, (char *) &PacketIn, sizeof(sPacket), 0);
-                zmsg_t* zmsg = zmsg_recv(CommandSocket);
-                if ( zmsg ) {
-                    // pop the source address off
-                    char* zStr = zmsg_popstr(zmsg);
-                    if ( zStr ) {
-                        //zsys_info("zStr: %s", zStr );
-                        zstr_free(&zStr);
-                    }
-
-                    zframe_t *zframe = zmsg_pop(zmsg);
-                    if ( zframe ) {
-                        sPacket *packet = (sPacket*) zframe_data(zframe);
-                        if ( packet->iMessage == 7 && validVersion ) {
-                            // zsys_info("Got frame of data");
-                            size_t len = zframe_size(zframe);
-                            Unpack((char **) &packet);
-
-                            //zsys_info("rigidbodies after handled frame: %i, %i", rigidbodies.size(), rigidbody_descs.size());
-
-                            // if there is a difference do natnet.questDescription(); to get up to date rigidbody descriptions and thus names
-                            if (rigidbody_descs.size() != rigidbodies.size() || !rigidbodiesReady)
-                            {
-                                if (sentRequest <= 0) {
-                                    sendRequestDescription();
-                                    sentRequest = 60; //1 second
-                                }
-                                rigidbodiesReady = false;
-                            }
-
-                            //get & check skeletons size
-                            if (skeleton_descs.size() != skeletons.size() || !skeletonsReady)
-                            {
-                                if (sentRequest <= 0) {
-                                    sendRequestDescription();
-                                    sentRequest = 60; //1 second
-                                }
-                                skeletonsReady = false;
-                            }
-
-                            if (sentRequest > 0) sentRequest--;
-
-                            // re-append the zframe that was popped
-                            // only send if definitions are updated
-                            if ( skeletonsReady && rigidbodiesReady ) {
-                                SetReport(ev->actor);
-
-                                if ( lastData != nullptr ) {
-                                    zmsg_destroy(&lastData);
-                                }
-                                lastData = zmsg_new();
-                                zmsg_addmem(lastData, (byte*)packet, len);
-
-                                zframe_destroy(&zframe);
-                                return nullptr;
-                            }
-                        }
-                        else {
-                            HandleCommand(packet);
-                        }
-                        zframe_destroy(&zframe);
-                    }
-                    zmsg_destroy(&zmsg);
+            SOCKET which = *(SOCKET *)p;
+
+            // Frames of mocap data arrive on the data socket, or on the
+            // command socket when requested. Everything else is a reply.
+            int size = (int)recv(which, receiveBuffer.data(), (int)receiveBuffer.size(), 0);
+            if ( size >= 4 ) {
+                sPacket *packet = (sPacket*) receiveBuffer.data();
+                if ( packet->iMessage == NAT_FRAMEOFDATA ) {
+                    if ( validVersion )
+                        retMsg = HandleFrame(ev, (char *) packet);
+                }
+                else {
+                    HandleCommand(packet);
                 }
             }
-            else if ( which == DataSocket ) {
-                //zsys_info("DATA SOCKET");
-                zmsg_destroy(&ev->msg);
-
-                //TODO: Send data packet to connected natnet2osc clients
-                //          this will allow for multiple filters
-                //Parse packet
-                zmsg_t* zmsg = zmsg_recv(DataSocket);
-
-                // We're still unpacking the data here because it might contain definitions we need to store
-                // TODO: Find a way to optimize getting definitions
-                if ( zmsg ) {
-                    // pop the source address off
-                    char* zStr = zmsg_popstr(zmsg);
-                    if ( zStr ) {
-                        //zsys_info("zStr: %s", zStr );
-                        zstr_free(&zStr);
-                    }
+        }
+    }
+    else
+        zsys_error("received pointer is not a socket (%s:%d)", __FILE__, __LINE__);
 
-                    // parse the remaining bytes as mocap data message
-                    zframe_t *zframe = zmsg_pop(zmsg);
-                    if (zframe && validVersion) {
-                        byte *data = zframe_data(zframe);
-                        size_t len = zframe_size(zframe);
-                        Unpack((char **) &data);
+    zframe_destroy(&frame);
+    zmsg_destroy(&ev->msg);
 
-                        //zsys_info("rigidbodies after handled frame: %i, %i", rigidbodies.size(), rigidbody_descs.size());
+    return retMsg;
+}
 
-                        // if there is a difference do natnet.questDescription(); to get up to date rigidbody descriptions and thus names
-                        if (rigidbody_descs.size() != rigidbodies.size() || !rigidbodiesReady)
-                        {
-                            if (sentRequest <= 0) {
-                                sendRequestDescription();
-                                sentRequest = 60; //1 second
-                            }
-                            rigidbodiesReady = false;
-                        }
+zmsg_t * NatNet::HandleFrame( sphactor_event_t *ev, char *data )
+{
+    int64_t arrival = zclock_usecs();
+    auto start = std::chrono::steady_clock::now();
+    Unpack(&data);
+    auto unpacked = std::chrono::steady_clock::now();
+    unpackNsecs += std::chrono::duration_cast<std::chrono::nanoseconds>(unpacked - start).count();
+    framesUnpacked++;
 
-                        //get & check skeletons size
-                        if (skeleton_descs.size() != skeletons.size() || !skeletonsReady)
-                        {
-                            if (sentRequest <= 0) {
-                                sendRequestDescription();
-                                sentRequest = 60; //1 second
-                            }
-                            skeletonsReady = false;
-                        }
+    //zsys_info("rigidbodies after handled frame: %i, %i", rigidbodies.size(), descriptions->rigidbodies.size());
 
-                        if (sentRequest > 0) sentRequest--;
+    // if there is a difference do natnet.questDescription(); to get up to date rigidbody descriptions and thus names
+    if (descriptions->rigidbodies.size() != rigidbodies.size() || !rigidbodiesReady)
+    {
+        if (sentRequest <= 0) {
+            sendRequestDescription();
+            sentRequest = 60; //1 second
+        }
+        rigidbodiesReady = false;
+    }
 
-                        // re-append the zframe that was popped
-                        // only send if definitions are updated
-                        if ( skeletonsReady && rigidbodiesReady ) {
-                            SetReport(ev->actor);
+    //get & check skeletons size
+    if (descriptions->skeletons.size() != skeletons.size() || !skeletonsReady)
+    {
+        if (sentRequest <= 0) {
+            sendRequestDescription();
+            sentRequest = 60; //1 second
+        }
+        skeletonsReady = false;
+    }
 
-                            if ( lastData != nullptr ) {
-                                zmsg_destroy(&lastData);
-                            }
-                            lastData = zmsg_new();
-                            zmsg_addmem(lastData, data, len);
+    if (sentRequest > 0) sentRequest--;
+
+    // Motive's latency from mid exposure until the frame was sent
+    if ( clockFrequency > 0 && transmitTimestamp > cameraMidExposureTimestamp )
+        motiveLatency = (double)(transmitTimestamp - cameraMidExposureTimestamp) * 1000.0 / clockFrequency;
+
+    // The offset between our clock and Motive's includes the transport
+    // delay, the smallest offset seen is taken as the fastest delivery.
+    // A jump of more than a second means Motive's clock was restarted.
+    double offset = (double)arrival / 1000000.0 - timestamp;
+    if ( minArrivalOffset == 0 || offset < minArrivalOffset || offset - minArrivalOffset > 1.0 )
+        minArrivalOffset = offset;
+    arrivalDelay = (offset - minArrivalOffset) * 1000.0;
+
+    // only send if definitions are updated
+    if ( skeletonsReady && rigidbodiesReady ) {
+        zframe_t *frame = EncodeFrame();
+        encodeNsecs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - unpacked).count();
+        framesSent++;
+
+        SetReport(ev->actor);
+
+        zmsg_t *msg = zmsg_new();
+        zmsg_append(msg, &frame);
+        if ( forwardImmediately )
+            return msg;
+
+        // the timer only sends the latest frame
+        if ( lastData != nullptr ) {
+            zmsg_destroy(&lastData);
+            framesDropped++;
+        }
+        lastData = msg;
+    }
+    return nullptr;
+}
 
-                            zframe_destroy(&zframe);
-                            return nullptr;
-                        }
-                    }
-                    // nothing valid or not sent on, so clean up
-                    zmsg_destroy(&zmsg);
-                    return NULL;
-                }
+zframe_t * NatNet::EncodeFrame()
+{
+    NatNetFrameHeader header;
+    header.params = (uint16_t)frameParams;
+    header.frameNumber = frame_number;
+    header.timecode = timecode;
+    header.timecodeSub = timecodeSub;
+    header.latency = latency;
+    header.timestamp = timestamp;
+    header.source = descriptionSource->id();
+    header.descriptionVersion = descriptions->version;
+    header.markerCount = (uint32_t)markers.size();
+    header.rigidBodyCount = (uint32_t)rigidbodies.size();
+    header.skeletonCount = (uint32_t)skeletons.size();
+    header.jointCount = 0;
+    for ( auto &it : skeletons ) {
+        header.jointCount += (uint32_t)it.second.joints.size();
+    }
 
-                return NULL;
-            }
+    // the maps keep every body and skeleton we've seen, ordered by id
+    zframe_t *frame = frameWriter.create(header);
+    for ( uint32_t i = 0; i < header.markerCount; i++ ) {
+        frameWriter.setMarker(i, markerFilter.ids()[i], markers[i]);
+    }
+    uint32_t index = 0;
+    for ( auto &it : rigidbodies ) {
+        frameWriter.setRigidBody(index++, it.second);
+    }
+    index = 0;
+    uint32_t joint = 0;
+    for ( auto &it : skeletons ) {
+        const Skeleton &S = it.second;
+        frameWriter.setSkeleton(index++, S.id, joint, (uint32_t)S.joints.size());
+        for ( const RigidBody &RB : S.joints ) {
+            frameWriter.setJoint(joint++, RB);
         }
     }
-    else
-        zsys_error("received pointer is not a zsock instance (%s:%d)", __FILE__, __LINE__);
-
-    zframe_destroy(&frame);
 
-    return NULL;
+    return frame;
 }
 
 bool DecodeTimecode(unsigned int inTimecode, unsigned int inTimecodeSubframe, int* hour, int* minute, int* second, int* frame, int* subframe)
@@ -386,7 +444,7 @@ bool TimecodeStringify(unsigned int inTimecode, unsigned int inTimecodeSubframe,
     int hour, minute, second, frame, subframe;
     bValid = DecodeTimecode(inTimecode, inTimecodeSubframe, &hour, &minute, &second, &frame, &subframe);
 
-    zsys_sprintf(Buffer,BufferSize,"%2d:%2d:%2d:%2d.%d",hour, minute, second, frame, subframe);
+    snprintf(Buffer,BufferSize,"%2d:%2d:%2d:%2d.%d",hour, minute, second, frame, subframe);
     for(unsigned int i=0; i<strlen(Buffer); i++)
         if(Buffer[i]==' ')
             Buffer[i]='0';
@@ -399,13 +457,23 @@ bool NatNet::IPAddress_StringToAddr(char *szNameOrAddress, struct in_addr *Addre
     return false;
 }
 
+// Resize a reused frame buffer, counting the times it has to grow
+template <typename T>
+static inline void
+s_resize(std::vector<T> &buffer, size_t size, uint64_t &allocations)
+{
+    if ( size > buffer.capacity() )
+        allocations++;
+    buffer.resize(size);
+}
+
 char* NatNet::unpackMarkerSet(char* ptr, std::vector<Marker>& ref_markers)
 {
     int nMarkers = 0;
     memcpy(&nMarkers, ptr, 4);
     ptr += 4;
 
-    ref_markers.resize(nMarkers);
+    s_resize(ref_markers, nMarkers, unpackAllocations);
 
     for (int j = 0; j < nMarkers; j++)
     {
@@ -438,7 +506,7 @@ char* NatNet::unpackRigidBodies(char* ptr, std::vector<RigidBody>& ref_rigidbodi
     memcpy(&nRigidBodies, ptr, 4);
     ptr += 4;
 
-    ref_rigidbodies.resize(nRigidBodies);
+    s_resize(ref_rigidbodies, nRigidBodies, unpackAllocations);
 
     for (int j = 0; j < nRigidBodies; j++)
     {
@@ -485,35 +553,31 @@ char* NatNet::unpackRigidBodies(char* ptr, std::vector<RigidBody>& ref_rigidbodi
             memcpy(&nRigidMarkers, ptr, 4);
             ptr += 4;
 
-            int nBytes = nRigidMarkers * 3 * sizeof(float);
-            float *markerData = (float *) malloc(nBytes);
-            memcpy(markerData, ptr, nBytes);
-            ptr += nBytes;
+            s_resize(RB.markers, nRigidMarkers, unpackAllocations);
+
+            for (int k = 0; k < nRigidMarkers; k++) {
+                float xyz[3];
+                memcpy(xyz, ptr, 12);
+                ptr += 12;
+
+                glm::vec3 pp(xyz[0], xyz[1], xyz[2]);
+                //TODO: Matrix, only used for scale previously
+                //pp = transform.preMult(pp);
+                RB.markers[k] = pp;
+            }
 
             if (major >= 2) {
                 // associated marker IDs
-                nBytes = nRigidMarkers * sizeof(int);
+                int nBytes = nRigidMarkers * sizeof(int);
                 ptr += nBytes;
 
                 // associated marker sizes
                 nBytes = nRigidMarkers * sizeof(float);
                 ptr += nBytes;
             }
-
-            RB.markers.resize(nRigidMarkers);
-
-            for (int k = 0; k < nRigidMarkers; k++) {
-                float x = markerData[k * 3];
-                float y = markerData[k * 3 + 1];
-                float z = markerData[k * 3 + 2];
-
-                glm::vec3 pp(x, y, z);
-                //TODO: Matrix, only used for scale previously
-                //pp = transform.preMult(pp);
-                RB.markers[k] = pp;
-            }
-
-            if (markerData) free(markerData);
+        }
+        else {
+            RB.markers.clear();
         }
         // TODO: 3.1 SDK Contains everything after this again
 
@@ -528,14 +592,16 @@ char* NatNet::unpackRigidBodies(char* ptr, std::vector<RigidBody>& ref_rigidbodi
             RB._active = RB.mean_marker_error > 0;
         } else {
             RB.mean_marker_error = 0;
+            RB._active = false;
         }
 
         // 2.6 and later
+        RB._tracked = true;
         if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0))
         {
             // params
             short params = 0; memcpy(&params, ptr, 2); ptr += 2;
-            bool bTrackingValid = params & 0x01; // 0x01 : rigid body was successfully tracked in this frame
+            RB._tracked = params & 0x01; // 0x01 : rigid body was successfully tracked in this frame
         }
 
     }  // next rigid body
@@ -568,12 +634,8 @@ void NatNet::Unpack( char ** pData ) {
 
     if(MessageID == 7)      // FRAME OF MOCAP DATA packet
     {
-        // temporary data containers
-        std::vector<std::vector<Marker> > tmp_markers_set;
-        std::vector<Skeleton> tmp_skeletons;
-        std::vector<Marker> tmp_markers;
-        std::vector<Marker> tmp_filtered_markers;
-        std::vector<RigidBody> tmp_rigidbodies;
+        // The frame is parsed into buffers kept from the previous frames,
+        // they only grow when the scene gets bigger
 
         // frame number
         int frameNumber = 0; memcpy(&frameNumber, ptr, 4); ptr += 4;
@@ -583,7 +645,7 @@ void NatNet::Unpack( char ** pData ) {
         int nMarkerSets = 0; memcpy(&nMarkerSets, ptr, 4); ptr += 4;
         //zsys_info("Marker Set Count : %d\n", nMarkerSets);
 
-        tmp_markers_set.resize(nMarkerSets);
+        s_resize(markers_set, nMarkerSets, unpackAllocations);
 
         for (int i=0; i < nMarkerSets; i++)
         {
@@ -594,14 +656,14 @@ void NatNet::Unpack( char ** pData ) {
             ptr += nDataBytes;
             //zsys_info("Model Name: %s\n", szName);
 
-            ptr = unpackMarkerSet(ptr, tmp_markers_set[i]);
+            ptr = unpackMarkerSet(ptr, markers_set[i]);
         }
 
         // unidentified markers
-        ptr = unpackMarkerSet(ptr, tmp_markers);
+        ptr = unpackMarkerSet(ptr, markers);
 
         // rigid bodies
-        ptr = unpackRigidBodies(ptr, tmp_rigidbodies);
+        ptr = unpackRigidBodies(ptr, frameRigidbodies);
 
         // skeletons (version 2.1 and later)
         if( ((major == 2)&&(minor>0)) || (major>2))
@@ -610,7 +672,7 @@ void NatNet::Unpack( char ** pData ) {
             memcpy(&nSkeletons, ptr, 4); ptr += 4;
             //zsys_info("Skeleton Count : %d\n", nSkeletons);
 
-            tmp_skeletons.resize(nSkeletons);
+            s_resize(frameSkeletons, nSkeletons, unpackAllocations);
 
             for (int j=0; j < nSkeletons; j++)
             {
@@ -618,11 +680,14 @@ void NatNet::Unpack( char ** pData ) {
                 int skeletonID = 0;
                 memcpy(&skeletonID, ptr, 4); ptr += 4;
 
-                tmp_skeletons[j].id = skeletonID;
+                frameSkeletons[j].id = skeletonID;
 
-                ptr = unpackRigidBodies(ptr, tmp_skeletons[j].joints);
+                ptr = unpackRigidBodies(ptr, frameSkeletons[j].joints);
             } // next skeleton
         }
+        else {
+            frameSkeletons.clear();
+        }
 
         // labeled markers (version 2.3 and later)
         if( ((major == 2)&&(minor>=3)) || (major>2))
@@ -630,6 +695,10 @@ void NatNet::Unpack( char ** pData ) {
             int nLabeledMarkers = 0;
             memcpy(&nLabeledMarkers, ptr, 4); ptr += 4;
             //zsys_info("Labeled Marker Count : %d\n", nLabeledMarkers);
+            size_t nMarkers = markers.size();
+            if ( nMarkers + nLabeledMarkers > markers.capacity() )
+                unpackAllocations++;
+            markers.reserve(nMarkers + nLabeledMarkers);
             for (int j=0; j < nLabeledMarkers; j++)
             {
                 // id
@@ -675,7 +744,7 @@ void NatNet::Unpack( char ** pData ) {
                 glm::vec3 pp(x, y, z);
                 //TODO: Matrix, only used for scale previously
                 //pp = transform.preMult(pp);
-                tmp_markers.push_back(pp);
+                markers.push_back(pp);
             }
         }
 
@@ -748,8 +817,6 @@ void NatNet::Unpack( char ** pData ) {
         // timecode
         unsigned int timecode = 0; 	memcpy(&timecode, ptr, 4);	ptr += 4;
         unsigned int timecodeSub = 0; memcpy(&timecodeSub, ptr, 4); ptr += 4;
-        char szTimecode[128] = "";
-        TimecodeStringify(timecode, timecodeSub, szTimecode, 128);
 
         // timestamp
         double timestamp = 0.0f;
@@ -768,7 +835,6 @@ void NatNet::Unpack( char ** pData ) {
         // high res timestamps (version 3.0 and later)
         if ((major >= 3) || (major == 0))
         {
-            uint64_t cameraMidExposureTimestamp = 0;
             memcpy(&cameraMidExposureTimestamp, ptr, 8); ptr += 8;
             //printf("Mid-exposure timestamp : %" PRIu64"\n", cameraMidExposureTimestamp);
 
@@ -776,7 +842,6 @@ void NatNet::Unpack( char ** pData ) {
             memcpy(&cameraDataReceivedTimestamp, ptr, 8); ptr += 8;
             //printf("Camera data received timestamp : %" PRIu64"\n", cameraDataReceivedTimestamp);
 
-            uint64_t transmitTimestamp = 0;
             memcpy(&transmitTimestamp, ptr, 8); ptr += 8;
             //printf("Transmit timestamp : %" PRIu64"\n", transmitTimestamp);
         }
@@ -791,57 +856,51 @@ void NatNet::Unpack( char ** pData ) {
         int eod = 0; memcpy(&eod, ptr, 4); ptr += 4;
         //zsys_info("End Packet\n-------------\n");
 
-        // filter markers
-        // TODO: Test re-implemented marker filtering (replaced remove_dups)
-        if (duplicated_point_removal_distance > 0)
-        {
-            std::map<int, RigidBody>::iterator it =
-                    this->rigidbodies.begin();
-            while (it != this->rigidbodies.end())
-            {
-                RigidBody& RB = it->second;
-
-                for (int i = 0; i < RB.markers.size(); i++)
-                {
-                    glm::vec3& v = RB.markers[i];
-                    std::vector<Marker>::iterator it = std::remove_if(
-                            tmp_filtered_markers.begin(), tmp_filtered_markers.end(),
-                            remove_dups(v, duplicated_point_removal_distance));
-                    tmp_filtered_markers.erase(it, tmp_filtered_markers.end());
-                }
-
-                it++;
+        // filter markers, the markers of rigid bodies are left out
+        rigidbodyMarkers.clear();
+        if ( markerFilter.dedupDistance > 0 ) {
+            for (size_t i = 0; i < frameRigidbodies.size(); i++) {
+                const std::vector<Marker> &rbMarkers = frameRigidbodies[i].markers;
+                rigidbodyMarkers.insert(rigidbodyMarkers.end(), rbMarkers.begin(), rbMarkers.end());
             }
         }
+        markerFilter.process(markers, rigidbodyMarkers);
 
         //Copy data to instance...
-        this->latency = latency;
         this->frame_number = frameNumber;
-        this->markers_set = tmp_markers_set;
-        this->markers = tmp_markers;
-        this->filtered_markers = tmp_filtered_markers;
+        this->timestamp = timestamp;
+        this->timecode = timecode;
+        this->timecodeSub = timecodeSub;
+        this->frameParams = params;
 
-        // fill the rigidbodies map
+        // fill the rigidbodies map, swapping keeps the buffers of both
+        // the map entry and the frame buffer for the next frame
         {
-            for (int i = 0; i < tmp_rigidbodies.size(); i++) {
-                RigidBody &RB = tmp_rigidbodies[i];
-                RigidBody &tRB = this->rigidbodies[RB.id];
-                tRB = RB;
+            for (size_t i = 0; i < frameRigidbodies.size(); i++) {
+                RigidBody &RB = frameRigidbodies[i];
+                auto it = this->rigidbodies.find(RB.id);
+                if ( it == this->rigidbodies.end() ) {
+                    it = this->rigidbodies.emplace(RB.id, RigidBody()).first;
+                    unpackAllocations++;
+                }
+                std::swap(it->second, RB);
             }
         }
         {
-            for (int i = 0; i < tmp_skeletons.size(); i++) {
-                Skeleton &S = tmp_skeletons[i];
-                Skeleton &tS = this->skeletons[S.id];
-                tS = S;
+            for (size_t i = 0; i < frameSkeletons.size(); i++) {
+                Skeleton &S = frameSkeletons[i];
+                auto it = this->skeletons.find(S.id);
+                if ( it == this->skeletons.end() ) {
+                    it = this->skeletons.emplace(S.id, Skeleton()).first;
+                    unpackAllocations++;
+                }
+                std::swap(it->second, S);
             }
         }
     }
     else if(MessageID == 5) // Data Descriptions
     {
-        std::vector<RigidBodyDescription> tmp_rigidbody_descs;
-        std::vector<SkeletonDescription> tmp_skeleton_descs;
-        std::vector<MarkerSetDescription> tmp_markerset_descs;
+        NatNetDescriptions updated;
 
         // number of datasets
         int nDatasets = 0; memcpy(&nDatasets, ptr, 4); ptr += 4;
@@ -878,7 +937,7 @@ void NatNet::Unpack( char ** pData ) {
                     //zsys_info("Marker Name: %s\n", szName);
                     description.marker_names.push_back(szName);
                 }
-                tmp_markerset_descs.push_back(description);
+                updated.markersets.push_back(description);
             }
             else if(type ==1)   // rigid body
             {
@@ -950,7 +1009,7 @@ void NatNet::Unpack( char ** pData ) {
                     free(markerRequiredLabels);
                 }
 
-                tmp_rigidbody_descs.push_back(description);
+                updated.rigidbodies.push_back(description);
             }
             else if(type ==2)   // skeleton
             {
@@ -1008,7 +1067,7 @@ void NatNet::Unpack( char ** pData ) {
                         ptr += 4;
                     }
                 }
-                tmp_skeleton_descs.push_back(description);
+                updated.skeletons.push_back(description);
             }
             else if ( major >= 3 ) {
                 // Force Plate
@@ -1156,13 +1215,8 @@ void NatNet::Unpack( char ** pData ) {
         //zsys_info("End Packet\n-------------\n");
 
         //Store data
-        // Lock while doing this (loops to read them must finish and can't start @ NatNet2OSCActor)
-        {
-            const std::lock_guard<std::mutex> lock(desc_mutex);
-            this->markerset_descs = tmp_markerset_descs;
-            this->rigidbody_descs = tmp_rigidbody_descs;
-            this->skeleton_descs = tmp_skeleton_descs;
-        }
+        // Consumers still using the previous snapshot keep it until they're done
+        this->descriptions = descriptionSource->publish(std::move(updated));
     }
     else
     {
@@ -1180,10 +1234,7 @@ void NatNet::sendRequestDescription() {
     packet.iMessage = NAT_REQUEST_MODELDEF;
     packet.nDataBytes = 0;
 
-    std::string url = host+":"+PORT_COMMAND_STR;
-    zstr_sendm(CommandSocket, url.c_str());
-    int rc = zsock_send(CommandSocket,  "b", (char*)&packet, 4 + packet.nDataBytes);
-    if(rc != 0)
+    if ( !SendPacket(&packet) )
     {
         zsys_info("Socket error sending command: NAT_REQUEST_MODELDEF");
     }
@@ -1199,12 +1250,7 @@ int NatNet::SendCommand(char* szCommand) {
     commandPacket.iMessage = NAT_REQUEST;
     commandPacket.nDataBytes = (int)strlen(commandPacket.Data.szData) + 1;
 
-    //TODO: Check if replacement works...
-    //int iRet = sendto(CommandSocket, (char *)&commandPacket, 4 + commandPacket.nDataBytes, 0, (sockaddr *)&HostAddr, sizeof(HostAddr));
-    std::string url = host+":"+PORT_COMMAND_STR;
-    zstr_sendm(CommandSocket, url.c_str());
-    int rc = zsock_send(CommandSocket,  "b", (char*)&commandPacket, 4 + commandPacket.nDataBytes);
-    if(rc != 0)
+    if ( !SendPacket(&commandPacket) )
     {
         zsys_info("Socket error sending command: %s", szCommand);
     }
@@ -1233,6 +1279,9 @@ void NatNet::HandleCommand( sPacket *PacketIn ) {
                 NatNetVersion[i] = (int)PacketIn->Data.Sender.NatNetVersion[i];
                 ServerVersion[i] = (int)PacketIn->Data.Sender.Version[i];
             }
+            // NatNet 3 servers append the frequency of their high resolution clock
+            if ( PacketIn->nDataBytes >= sizeof(sSender) + 8 )
+                memcpy(&clockFrequency, PacketIn->Data.cData + sizeof(sSender), 8);
             break;
         case NAT_RESPONSE:
             gCommandResponseSize = PacketIn->nDataBytes;
@@ -1264,5 +1313,30 @@ void NatNet::SetReport(const sphactor_actor_t* actor)
         zosc_append(msg, "ss", (std::to_string(i)).c_str(), (ifNames[i] + " ("+ifAddresses[i]+")").c_str());
     }
 
+    if ( framesUnpacked > 0 ) {
+        char stat[32];
+        zosc_append(msg, "si", "Frames sent", (int)framesSent);
+        snprintf(stat, sizeof(stat), "%.0f", (double)unpackNsecs / framesUnpacked);
+        zosc_append(msg, "ss", "Unpack nsec/frame", stat);
+        snprintf(stat, sizeof(stat), "%.3f", (double)unpackAllocations / framesUnpacked);
+        zosc_append(msg, "ss", "Unpack allocations/frame", stat);
+        if ( framesSent > 0 ) {
+            snprintf(stat, sizeof(stat), "%.0f", (double)encodeNsecs / framesSent);
+            zosc_append(msg, "ss", "Encode nsec/frame", stat);
+        }
+
+        zosc_append(msg, "ss", "Forwarding", forwardImmediately ? "immediate" : "timer");
+        if ( !forwardImmediately )
+            zosc_append(msg, "si", "Frames dropped", (int)framesDropped);
+        if ( clockFrequency > 0 ) {
+            snprintf(stat, sizeof(stat), "%.2f", motiveLatency);
+            zosc_append(msg, "ss", "Motive latency ms", stat);
+        }
+        snprintf(stat, sizeof(stat), "%.2f", arrivalDelay);
+        zosc_append(msg, "ss", "Arrival delay ms", stat);
+        if ( markerFilter.dedupDistance > 0 )
+            zosc_append(msg, "si", "Duplicate markers removed", (int)markerFilter.removed);
+    }
+
     sphactor_actor_set_custom_report_data((sphactor_actor_t *)actor, msg);
 }
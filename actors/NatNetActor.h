@@ -6,19 +6,27 @@
 #include <vector>
 #include <map>
 #include "NatNetDataTypes.h"
-#include <mutex>
+#include "NatNetFrame.h"
+#include "NatNetDescriptions.h"
+#include "NatNetMarkers.h"
 
 class NatNet : public Sphactor {
 public:
     static const char *capabilities;
 
-    // DataSocket;
-    zsock_t* DataSocket = NULL;
+    // Plain UDP sockets, libzmq's ZMQ_DGRAM truncates datagrams to 8KB
+    // and the frames of a big scene are larger than that.
+    // DataSocket receives the multicast frames
+    SOCKET DataSocket = INVALID_SOCKET;
 
     // CommandSocket;
-    zsock_t* CommandSocket = NULL;
+    SOCKET CommandSocket = INVALID_SOCKET;
+    std::vector<char> receiveBuffer;     // one datagram, sized in handleInit
 
+    // send each frame when it arrives, or the latest one on the timer
+    bool forwardImmediately = true;
     zmsg_t * lastData = nullptr;
+    uint64_t framesDropped = 0;
 
     // Actor Settings
     // ServerAddress
@@ -39,24 +47,49 @@ public:
     unsigned char gCommandResponseString[260]; //MAX_PATH = 260?
     int gCommandResponseCode = 0;
 
-    int frame_number;
-    float latency;
+    int frame_number = 0;
+    float latency = 0;
     float timeout;
-    int sentRequest;
-    float duplicated_point_removal_distance = 0;
+    int sentRequest = 0;
+    double timestamp = 0;
+    uint64_t cameraMidExposureTimestamp = 0;
+    uint64_t transmitTimestamp = 0;
+    uint64_t clockFrequency = 0;        // of the high resolution timestamps, from the ping response
+
+    // latency of the last frame in ms, Motive's own and the arrival delay
+    // relative to the fastest frame seen as the clocks aren't synchronised
+    double motiveLatency = 0;
+    double arrivalDelay = 0;
+    double minArrivalOffset = 0;
+    unsigned int timecode = 0;
+    unsigned int timecodeSub = 0;
+    short frameParams = 0;
 
     std::vector<std::vector<Marker> > markers_set;
-    std::vector<Marker> filtered_markers;
     std::vector<Marker> markers;
 
+    // deduplicates the markers and gives them stable ids
+    NatNetMarkerFilter markerFilter;
+    std::vector<Marker> rigidbodyMarkers;
+
     std::map<int, RigidBody> rigidbodies;
     std::map<int, Skeleton> skeletons;
 
-    static std::vector<RigidBodyDescription> rigidbody_descs;
-    static std::vector<SkeletonDescription> skeleton_descs;
-    static std::vector<MarkerSetDescription> markerset_descs;
+    // reused by Unpack for the bodies of the current frame
+    std::vector<RigidBody> frameRigidbodies;
+    std::vector<Skeleton> frameSkeletons;
+
+    // descriptions of this instance, published to our consumers
+    std::shared_ptr<NatNetDescriptionSource> descriptionSource = NatNetDescriptionSource::create();
+    std::shared_ptr<const NatNetDescriptions> descriptions = descriptionSource->load();
 
-    static std::mutex desc_mutex;
+    // decoded frames sent to our consumers
+    NatNetFrameWriter frameWriter;
+    uint64_t framesUnpacked = 0;
+    uint64_t framesSent = 0;
+    uint64_t unpackAllocations = 0;     // times a frame buffer had to grow
+    int64_t unpackNsecs = 0;
+    int64_t encodeNsecs = 0;
 
     zmsg_t* handleInit(sphactor_event_t *ev);
     zmsg_t* handleTimer(sphactor_event_t *ev);
@@ -68,7 +101,12 @@ public:
     //NatNet parse functions
     int SendCommand(char* szCOmmand);
     void HandleCommand(sPacket *PacketIn);
+    zmsg_t* HandleFrame(sphactor_event_t *ev, char *data);
+    zframe_t* EncodeFrame();
     void SendPing();
+    bool OpenDataSocket(sphactor_actor_t *actor, const std::string &address);
+    void CloseSocket(sphactor_actor_t *actor, SOCKET *socket);
+    bool SendPacket(sPacket *packet);
 
     void Unpack( char ** pData );
     char* unpackRigidBodies(char* ptr, std::vector<RigidBody>& ref_rigidbodies);
@@ -0,0 +1,303 @@
+//
+// NatNet packets captured from a Motive server
+//
+
+#include "NatNetCapture.h"
+#include "NatNetDataTypes.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define NATNET_CAPTURE_MAX_PENDING  64      // incomplete fragmented datagrams
+
+static uint16_t
+s_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t
+s_swap32(uint32_t v, bool swap)
+{
+    if ( !swap )
+        return v;
+    return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+static uint16_t
+s_swap16(uint16_t v, bool swap)
+{
+    return swap ? (uint16_t)(v >> 8 | v << 8) : v;
+}
+
+// Skip the link layer header, returns nullptr if it isn't IPv4
+static const uint8_t *
+s_link_ipv4(uint32_t linktype, const uint8_t *data, size_t *size)
+{
+    size_t skip;
+    switch ( linktype ) {
+        case 0: {       // BSD loopback, address family in host order
+            if ( *size < 4 )
+                return nullptr;
+            uint32_t family; memcpy(&family, data, 4);
+            if ( family != 2 && s_swap32(family, true) != 2 )
+                return nullptr;
+            skip = 4;
+        } break;
+        case 1: {       // ethernet, possibly with a vlan tag
+            if ( *size < 14 )
+                return nullptr;
+            skip = 14;
+            uint16_t type = s_get16(data + 12);
+            if ( type == 0x8100 && *size >= 18 ) {
+                type = s_get16(data + 16);
+                skip = 18;
+            }
+            if ( type != 0x0800 )
+                return nullptr;
+        } break;
+        case 101:       // raw ip
+        case 228:       // raw ipv4
+            skip = 0;
+            break;
+        case 113:       // linux cooked capture
+            if ( *size < 16 || s_get16(data + 14) != 0x0800 )
+                return nullptr;
+            skip = 16;
+            break;
+        case 276:       // linux cooked capture v2
+            if ( *size < 20 || s_get16(data) != 0x0800 )
+                return nullptr;
+            skip = 20;
+            break;
+        default:
+            return nullptr;
+    }
+    if ( *size <= skip )
+        return nullptr;
+    *size -= skip;
+    return data + skip;
+}
+
+bool
+NatNetCapture::open(const char *path)
+{
+    clear();
+    FILE *file = fopen(path, "rb");
+    if ( file == nullptr )
+        return false;
+
+    std::vector<uint8_t> buf;
+    uint32_t magic = 0;
+    bool ok = fread(&magic, 4, 1, file) == 1;
+
+    if ( ok && magic == 0x0a0d0d0a ) {
+        // pcapng: section header, interface descriptions and packet blocks
+        std::vector<uint32_t> linktypes;
+        std::vector<int64_t> resolution;    // ticks per second per interface
+        bool swap = false;
+        fseek(file, 0, SEEK_SET);
+        uint32_t head[2];
+        while ( fread(head, 4, 2, file) == 2 ) {
+            uint32_t type = head[0];
+            uint32_t length = s_swap32(head[1], swap);
+            if ( type == 0x0a0d0d0a ) {
+                // the byte order magic tells how to read the rest
+                uint32_t bom = 0;
+                if ( fread(&bom, 4, 1, file) != 1 )
+                    break;
+                swap = bom != 0x1a2b3c4d;
+                length = s_swap32(head[1], swap);
+                if ( length < 16 )
+                    break;
+                buf.resize(length - 16);
+                linktypes.clear();
+                resolution.clear();
+            }
+            else {
+                if ( length < 12 )
+                    break;
+                buf.resize(length - 12);
+            }
+            if ( fread(buf.data(), 1, buf.size(), file) != buf.size() )
+                break;
+            uint32_t trailer;
+            if ( fread(&trailer, 4, 1, file) != 1 )
+                break;
+            type = s_swap32(type, swap);
+
+            if ( type == 1 && buf.size() >= 8 ) {
+                // interface description, look for if_tsresol
+                uint16_t linktype; memcpy(&linktype, buf.data(), 2);
+                linktypes.push_back(s_swap16(linktype, swap));
+                int64_t ticks = 1000000;
+                size_t o = 8;
+                while ( o + 4 <= buf.size() ) {
+                    uint16_t code, len;
+                    memcpy(&code, &buf[o], 2); memcpy(&len, &buf[o + 2], 2);
+                    code = s_swap16(code, swap); len = s_swap16(len, swap);
+                    if ( code == 0 || o + 4 + len > buf.size() )
+                        break;
+                    if ( code == 9 && len >= 1 ) {
+                        uint8_t r = buf[o + 4];
+                        ticks = 1;
+                        for ( int i = 0; i < (r & 0x7f); i++ )
+                            ticks *= (r & 0x80) ? 2 : 10;
+                    }
+                    o += 4 + ((len + 3) & ~3u);
+                }
+                resolution.push_back(ticks);
+            }
+            else if ( type == 6 && buf.size() >= 20 ) {
+                // enhanced packet
+                uint32_t fields[5];
+                memcpy(fields, buf.data(), 20);
+                uint32_t iface = s_swap32(fields[0], swap);
+                uint64_t ts = (uint64_t)s_swap32(fields[1], swap) << 32 | s_swap32(fields[2], swap);
+                size_t caplen = s_swap32(fields[3], swap);
+                if ( iface >= linktypes.size() || 20 + caplen > buf.size() )
+                    continue;
+                int64_t ticks = resolution[iface];
+                int64_t usecs = ticks == 1000000 ? (int64_t)ts : (int64_t)((double)ts * 1e6 / ticks);
+                const uint8_t *ip = s_link_ipv4(linktypes[iface], buf.data() + 20, &caplen);
+                if ( ip )
+                    addIPv4(usecs, ip, caplen);
+            }
+        }
+    }
+    else if ( ok ) {
+        // classic pcap, in either byte order with micro or nano seconds
+        bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+        uint32_t native = s_swap32(magic, swap);
+        bool nanos = native == 0xa1b23c4d;
+        uint32_t header[5];
+        if ( (native != 0xa1b2c3d4 && !nanos) || fread(header, 4, 5, file) != 5 ) {
+            fclose(file);
+            return false;
+        }
+        uint32_t linktype = s_swap32(header[4], swap);
+
+        uint32_t record[4];
+        while ( fread(record, 4, 4, file) == 4 ) {
+            size_t caplen = s_swap32(record[2], swap);
+            if ( caplen > 0x4000000 )
+                break;
+            buf.resize(caplen);
+            if ( fread(buf.data(), 1, caplen, file) != caplen )
+                break;
+            int64_t usecs = (int64_t)s_swap32(record[0], swap) * 1000000
+                          + ( nanos ? s_swap32(record[1], swap) / 1000 : s_swap32(record[1], swap) );
+            const uint8_t *ip = s_link_ipv4(linktype, buf.data(), &caplen);
+            if ( ip )
+                addIPv4(usecs, ip, caplen);
+        }
+    }
+    fclose(file);
+    pending.clear();
+
+    // frames are replayed relative to the first one
+    if ( !frames.empty() ) {
+        int64_t first = frames.front().time;
+        for ( Packet &packet : frames )
+            packet.time -= first;
+    }
+    return !frames.empty();
+}
+
+void
+NatNetCapture::addIPv4(int64_t time, const uint8_t *data, size_t size)
+{
+    if ( size < 20 || (data[0] >> 4) != 4 )
+        return;
+    size_t ihl = (size_t)(data[0] & 0x0f) * 4;
+    size_t total = s_get16(data + 2);
+    if ( ihl < 20 || total < ihl || total > size || data[9] != 17 )
+        return;
+
+    const uint8_t *payload = data + ihl;
+    size_t length = total - ihl;
+    uint16_t fragment = s_get16(data + 6);
+    bool more = (fragment & 0x2000) != 0;
+    size_t offset = (size_t)(fragment & 0x1fff) * 8;
+
+    if ( !more && offset == 0 ) {
+        addUDP(time, payload, length);
+        return;
+    }
+
+    // fragment of a bigger datagram
+    uint32_t key[3];
+    memcpy(&key[0], data + 12, 4);
+    memcpy(&key[1], data + 16, 4);
+    key[2] = (uint32_t)data[9] << 16 | s_get16(data + 4);
+    Fragments *f = nullptr;
+    for ( Fragments &p : pending ) {
+        if ( memcmp(p.key, key, sizeof(key)) == 0 ) {
+            f = &p;
+            break;
+        }
+    }
+    if ( f == nullptr ) {
+        if ( pending.size() >= NATNET_CAPTURE_MAX_PENDING )
+            pending.erase(pending.begin());
+        pending.emplace_back();
+        f = &pending.back();
+        memcpy(f->key, key, sizeof(key));
+    }
+
+    if ( f->data.size() < offset + length ) {
+        f->data.resize(offset + length);
+        f->have.resize((offset + length + 7) / 8, false);
+    }
+    memcpy(&f->data[offset], payload, length);
+    for ( size_t b = offset / 8; b < (offset + length + 7) / 8; b++ )
+        f->have[b] = true;
+    if ( !more )
+        f->total = offset + length;
+
+    if ( f->total == 0 || f->data.size() < f->total )
+        return;
+    for ( size_t b = 0; b < (f->total + 7) / 8; b++ ) {
+        if ( !f->have[b] )
+            return;
+    }
+
+    // complete, the reassembled payload starts with the udp header
+    std::string udp;
+    udp.swap(f->data);
+    size_t udpTotal = f->total;
+    pending.erase(pending.begin() + (f - pending.data()));
+    addUDP(time, (const uint8_t *)udp.data(), udpTotal);
+}
+
+// Keep the NatNet packets from or to Motive's command and data ports
+void
+NatNetCapture::addUDP(int64_t time, const uint8_t *udp, size_t length)
+{
+    if ( length < 8 )
+        return;
+    uint16_t source = s_get16(udp), destination = s_get16(udp + 2);
+    bool natnet = source == PORT_COMMAND || source == PORT_DATA
+               || destination == PORT_COMMAND || destination == PORT_DATA;
+    size_t size = std::min(length, (size_t)s_get16(udp + 4));
+    if ( !natnet || size < 12 )
+        return;
+    const uint8_t *data = udp + 8;
+    size -= 8;
+    uint16_t message = (uint16_t)(data[0] | data[1] << 8);
+    if ( message == NAT_FRAMEOFDATA )
+        frames.push_back({ time, std::string((const char *)data, size) });
+    else if ( message == NAT_PINGRESPONSE )
+        pingResponse.assign((const char *)data, size);
+    else if ( message == NAT_MODELDEF )
+        modelDef.assign((const char *)data, size);
+}
+
+void
+NatNetCapture::clear()
+{
+    frames.clear();
+    pingResponse.clear();
+    modelDef.clear();
+    pending.clear();
+}
@@ -0,0 +1,46 @@
+//
+// NatNet packets captured from a Motive server
+//
+
+#ifndef GAZEBOSC_NATNETCAPTURE_H
+#define GAZEBOSC_NATNETCAPTURE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Reads the NatNet traffic of a pcap capture (Wireshark, tcpdump) of a
+// Motive server: the frames it streamed and, when the capture has them,
+// its ping response and model definitions. IPv4 fragments are reassembled
+// as Motive's frames are usually bigger than the MTU.
+class NatNetCapture
+{
+public:
+    struct Packet
+    {
+        int64_t time;           // usecs since the first frame
+        std::string data;       // NatNet packet, starting with the message id
+    };
+
+    bool open(const char *path);
+    void clear();
+
+    std::vector<Packet> frames;
+    std::string pingResponse;   // empty if not captured
+    std::string modelDef;
+
+private:
+    void addUDP(int64_t time, const uint8_t *udp, size_t length);
+    void addIPv4(int64_t time, const uint8_t *data, size_t size);
+
+    struct Fragments
+    {
+        uint32_t key[3];        // source, destination, protocol << 16 | id
+        std::string data;
+        std::vector<bool> have; // per 8 bytes
+        size_t total = 0;       // known once the last fragment arrived
+    };
+    std::vector<Fragments> pending;
+};
+
+#endif //GAZEBOSC_NATNETCAPTURE_H
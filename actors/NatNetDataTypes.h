@@ -8,13 +8,11 @@
 #include "../ext/glm/glm/gtc/quaternion.hpp"
 
 // Custom data structs
-#define SMOOTHING                   2
-
 typedef glm::vec3 Marker;
 
 struct RigidBody
 {
-    int id;
+    int id = 0;
 
     //TODO: matrix...?
     //ofMatrix4x4 matrix;
@@ -23,13 +21,15 @@ struct RigidBody
 
     std::vector<Marker> markers;
 
-    float mean_marker_error;
+    float mean_marker_error = 0;
 
     inline bool isActive() const { return _active; }
+    inline bool isTracked() const { return _tracked; }
     //TODO: matrix...?
     //const ofMatrix4x4& getMatrix() const { return matrix; }
 
-    bool _active;
+    bool _active = false;
+    bool _tracked = true;
 };
 
 struct Skeleton
@@ -60,48 +60,6 @@ struct MarkerSetDescription
     std::vector<std::string> marker_names;
 };
 
-struct RigidBodyHistory {
-public:
-    int rigidBodyId;
-    glm::vec3 previousPosition;
-    glm::quat previousOrientation;
-
-    std::vector<glm::vec3> velocities;
-    std::vector<glm::vec3> angularVelocities;
-
-    bool firstRun = true;
-    int currentDataPoint = 0;
-    int framesInactive = 0;
-
-    RigidBodyHistory( int id, glm::vec3 p, glm::quat r )
-    {
-        previousPosition = p;
-        previousOrientation = r;
-        rigidBodyId = id;
-
-        currentDataPoint = 0;
-        firstRun = true;
-        framesInactive = 0;
-
-        velocities.resize(2 * SMOOTHING + 1);
-        angularVelocities.resize(2 * SMOOTHING + 1);
-    }
-};
-
-struct remove_dups
-{
-    glm::vec3 v;
-    float dist;
-
-    remove_dups(const glm::vec3& v, float dist)
-            : v(v)
-            , dist(dist)
-    {
-    }
-
-    bool operator()(const glm::vec3& t) { return glm::distance(v, t) <= dist; }
-};
-
 // time decode helper functions
 bool DecodeTimecode(unsigned int inTimecode, unsigned int inTimecodeSubframe, int* hour, int* minute, int* second, int* frame, int* subframe);
 bool TimecodeStringify(unsigned int inTimecode, unsigned int inTimecodeSubframe, char *Buffer, int BufferSize);
@@ -0,0 +1,61 @@
+//
+// Rigid body, skeleton and marker set descriptions of a NatNet actor
+//
+
+#include "NatNetDescriptions.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+
+static std::mutex s_sources_mutex;
+static std::map<uint32_t, std::weak_ptr<NatNetDescriptionSource>> s_sources;
+static uint32_t s_next_source = 1;
+
+std::shared_ptr<NatNetDescriptionSource>
+NatNetDescriptionSource::create()
+{
+    std::lock_guard<std::mutex> lock(s_sources_mutex);
+    // forget sources of actors that are gone
+    for ( auto it = s_sources.begin(); it != s_sources.end(); ) {
+        if ( it->second.expired() )
+            it = s_sources.erase(it);
+        else
+            ++it;
+    }
+
+    std::shared_ptr<NatNetDescriptionSource> source = std::make_shared<NatNetDescriptionSource>(s_next_source++);
+    s_sources[source->id()] = source;
+    return source;
+}
+
+std::shared_ptr<NatNetDescriptionSource>
+NatNetDescriptionSource::find(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(s_sources_mutex);
+    auto it = s_sources.find(id);
+    if ( it == s_sources.end() )
+        return nullptr;
+    return it->second.lock();
+}
+
+NatNetDescriptionSource::NatNetDescriptionSource(uint32_t id)
+    : sourceId(id)
+    , current(std::make_shared<const NatNetDescriptions>())
+{
+}
+
+std::shared_ptr<const NatNetDescriptions>
+NatNetDescriptionSource::publish(NatNetDescriptions &&descriptions)
+{
+    // only the owning actor publishes, so the version needs no atomics
+    descriptions.version = nextVersion++;
+    std::shared_ptr<const NatNetDescriptions> snapshot = std::make_shared<const NatNetDescriptions>(std::move(descriptions));
+    std::atomic_store(&current, snapshot);
+    return snapshot;
+}
+
+std::shared_ptr<const NatNetDescriptions>
+NatNetDescriptionSource::load() const
+{
+    return std::atomic_load(&current);
+}
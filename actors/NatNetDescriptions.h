@@ -0,0 +1,48 @@
+//
+// Rigid body, skeleton and marker set descriptions of a NatNet actor
+//
+
+#ifndef GAZEBOSC_NATNETDESCRIPTIONS_H
+#define GAZEBOSC_NATNETDESCRIPTIONS_H
+
+#include "NatNetDataTypes.h"
+#include <memory>
+#include <vector>
+
+// An immutable snapshot of the descriptions Motive sent
+struct NatNetDescriptions
+{
+    uint32_t version = 0;
+    std::vector<RigidBodyDescription> rigidbodies;
+    std::vector<SkeletonDescription> skeletons;
+    std::vector<MarkerSetDescription> markersets;
+};
+
+// Each NatNet actor publishes its descriptions through its own source. A
+// new snapshot replaces the current one atomically and readers keep the
+// snapshot they loaded alive while they use it, so neither side locks.
+//
+// Frames carry the source id and description version. Consumers look a
+// source up by id, which locks the registry, only when the id changes.
+class NatNetDescriptionSource
+{
+public:
+    // Create and register a source with a new id
+    static std::shared_ptr<NatNetDescriptionSource> create();
+    static std::shared_ptr<NatNetDescriptionSource> find(uint32_t id);
+
+    explicit NatNetDescriptionSource(uint32_t id);
+
+    uint32_t id() const { return sourceId; }
+
+    // Publish a new snapshot, its version is set by the source
+    std::shared_ptr<const NatNetDescriptions> publish(NatNetDescriptions &&descriptions);
+    std::shared_ptr<const NatNetDescriptions> load() const;
+
+private:
+    uint32_t sourceId;
+    uint32_t nextVersion = 1;
+    std::shared_ptr<const NatNetDescriptions> current;
+};
+
+#endif //GAZEBOSC_NATNETDESCRIPTIONS_H
@@ -0,0 +1,127 @@
+//
+// Decoded NatNet frame as sent from the NatNet actor to its consumers
+//
+
+#include "NatNetFrame.h"
+
+static_assert(sizeof(NatNetFrameHeader) == 56, "NatNet frame header must not be padded");
+
+#define NATNET_POSE_SIZE        40      // id, position, rotation, error, flags
+#define NATNET_SKELETON_SIZE    12      // id, jointStart, jointCount
+
+static void
+s_poses(NatNetPoses &poses, const byte *base, uint32_t count)
+{
+    poses.count = count;
+    poses.id = (const int32_t *)base;
+    poses.position = (const float *)(base + count * 4);
+    poses.rotation = (const float *)(base + count * 16);
+    poses.error = (const float *)(base + count * 32);
+    poses.flags = (const uint32_t *)(base + count * 36);
+}
+
+void
+NatNetFrameLayout::compute(const NatNetFrameHeader &header)
+{
+    markers = sizeof(NatNetFrameHeader);
+    rigidBodies = markers + (size_t)header.markerCount * 16;
+    skeletons = rigidBodies + (size_t)header.rigidBodyCount * NATNET_POSE_SIZE;
+    joints = skeletons + (size_t)header.skeletonCount * NATNET_SKELETON_SIZE;
+    size = joints + (size_t)header.jointCount * NATNET_POSE_SIZE;
+}
+
+bool
+NatNetFrameView::parse(const byte *data, size_t size)
+{
+    if ( size < sizeof(NatNetFrameHeader) )
+        return false;
+    memcpy(&header, data, sizeof(NatNetFrameHeader));
+    if ( memcmp(header.magic, NATNET_FRAME_MAGIC, 4) != 0 || header.version != NATNET_FRAME_VERSION )
+        return false;
+
+    NatNetFrameLayout layout;
+    layout.compute(header);
+    if ( layout.size != size )
+        return false;
+
+    // the arrays are read in place which needs 4 byte alignment
+    if ( (uintptr_t)data & 3 ) {
+        aligned.resize((size + 3) / 4);
+        memcpy(aligned.data(), data, size);
+        data = (const byte *)aligned.data();
+    }
+
+    markers = (const float *)(data + layout.markers);
+    markerId = (const int32_t *)(markers + header.markerCount * 3);
+    s_poses(rigidBodies, data + layout.rigidBodies, header.rigidBodyCount);
+    skeletonId = (const int32_t *)(data + layout.skeletons);
+    skeletonJointStart = (const uint32_t *)(skeletonId + header.skeletonCount);
+    skeletonJointCount = skeletonJointStart + header.skeletonCount;
+    s_poses(joints, data + layout.joints, header.jointCount);
+
+    for ( uint32_t i = 0; i < header.skeletonCount; i++ ) {
+        if ( (uint64_t)skeletonJointStart[i] + skeletonJointCount[i] > header.jointCount )
+            return false;
+    }
+    return true;
+}
+
+zframe_t *
+NatNetFrameWriter::create(const NatNetFrameHeader &header)
+{
+    this->header = header;
+    memcpy(this->header.magic, NATNET_FRAME_MAGIC, 4);
+    this->header.version = NATNET_FRAME_VERSION;
+    layout.compute(this->header);
+
+    zframe_t *frame = zframe_new(NULL, layout.size);
+    data = zframe_data(frame);
+    memcpy(data, &this->header, sizeof(NatNetFrameHeader));
+    return frame;
+}
+
+void
+NatNetFrameWriter::setMarker(uint32_t index, int32_t id, const Marker &marker)
+{
+    float position[3] = { marker.x, marker.y, marker.z };
+    memcpy(data + layout.markers + index * 12, position, 12);
+    memcpy(data + layout.markers + header.markerCount * 12 + index * 4, &id, 4);
+}
+
+void
+NatNetFrameWriter::setPose(size_t offset, uint32_t count, uint32_t index, const RigidBody &rb)
+{
+    byte *base = data + offset;
+    int32_t id = rb.id;
+    float position[3] = { rb.position.x, rb.position.y, rb.position.z };
+    float rotation[4] = { rb.rotation.x, rb.rotation.y, rb.rotation.z, rb.rotation.w };
+    uint32_t flags = ( rb.isActive() ? NATNET_POSE_ACTIVE : 0 ) | ( rb.isTracked() ? NATNET_POSE_TRACKED : 0 );
+
+    memcpy(base + index * 4, &id, 4);
+    memcpy(base + count * 4 + index * 12, position, 12);
+    memcpy(base + count * 16 + index * 16, rotation, 16);
+    memcpy(base + count * 32 + index * 4, &rb.mean_marker_error, 4);
+    memcpy(base + count * 36 + index * 4, &flags, 4);
+}
+
+void
+NatNetFrameWriter::setRigidBody(uint32_t index, const RigidBody &rb)
+{
+    setPose(layout.rigidBodies, header.rigidBodyCount, index, rb);
+}
+
+void
+NatNetFrameWriter::setSkeleton(uint32_t index, int32_t id, uint32_t jointStart, uint32_t jointCount)
+{
+    byte *base = data + layout.skeletons;
+    uint32_t count = header.skeletonCount;
+    memcpy(base + index * 4, &id, 4);
+    memcpy(base + count * 4 + index * 4, &jointStart, 4);
+    memcpy(base + count * 8 + index * 4, &jointCount, 4);
+}
+
+void
+NatNetFrameWriter::setJoint(uint32_t index, const RigidBody &joint)
+{
+    setPose(layout.joints, header.jointCount, index, joint);
+}
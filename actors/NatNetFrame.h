@@ -0,0 +1,115 @@
+//
+// Decoded NatNet frame as sent from the NatNet actor to its consumers
+//
+
+#ifndef GAZEBOSC_NATNETFRAME_H
+#define GAZEBOSC_NATNETFRAME_H
+
+#include "czmq.h"
+#include "NatNetDataTypes.h"
+#include <vector>
+
+#define NATNET_FRAME_MAGIC          "GZNF"
+#define NATNET_FRAME_VERSION        3
+
+// frame params, as sent by Motive
+#define NATNET_FRAME_RECORDING      0x01    // Motive is recording
+#define NATNET_FRAME_MODELS_CHANGED 0x02    // tracked model list has changed
+
+// pose flags
+#define NATNET_POSE_ACTIVE          0x01    // mean marker error > 0
+#define NATNET_POSE_TRACKED         0x02    // tracked by Motive in this frame
+
+// A frame is the header followed by flat arrays in host byte order, each
+// starting at a 4 byte aligned offset:
+//
+//  markers       float position[n][3], int32 id[n]             n = markerCount
+//  rigid bodies  int32 id[n], float position[n][3], float rotation[n][4] (x y z w),
+//                float error[n], uint32 flags[n]               n = rigidBodyCount
+//  skeletons     int32 id[n], uint32 jointStart[n], uint32 jointCount[n]
+//  joints        the same arrays as the rigid bodies           n = jointCount
+//
+// Consumers read the arrays in place, nothing needs to be unpacked.
+struct NatNetFrameHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t params;
+    int32_t frameNumber;
+    uint32_t timecode;
+    uint32_t timecodeSub;
+    float latency;
+    double timestamp;           // seconds since Motive started
+    uint32_t source;            // NatNetDescriptionSource of the sender
+    uint32_t descriptionVersion;
+    uint32_t markerCount;
+    uint32_t rigidBodyCount;
+    uint32_t skeletonCount;
+    uint32_t jointCount;
+};
+
+// Offsets of the arrays in a frame
+struct NatNetFrameLayout
+{
+    size_t markers = 0;
+    size_t rigidBodies = 0;
+    size_t skeletons = 0;
+    size_t joints = 0;
+    size_t size = 0;
+
+    void compute(const NatNetFrameHeader &header);
+};
+
+// Poses of rigid bodies or skeleton joints
+struct NatNetPoses
+{
+    uint32_t count = 0;
+    const int32_t *id = nullptr;
+    const float *position = nullptr;    // count * 3
+    const float *rotation = nullptr;    // count * 4
+    const float *error = nullptr;
+    const uint32_t *flags = nullptr;
+};
+
+// Read-only view of a frame, the arrays point into the frame data so the
+// frame must outlive the view
+class NatNetFrameView
+{
+public:
+    // Returns false if the data is not a valid frame of this version
+    bool parse(const byte *data, size_t size);
+
+    NatNetFrameHeader header;
+    const float *markers = nullptr;     // markerCount * 3
+    const int32_t *markerId = nullptr;
+    NatNetPoses rigidBodies;
+    const int32_t *skeletonId = nullptr;
+    const uint32_t *skeletonJointStart = nullptr;
+    const uint32_t *skeletonJointCount = nullptr;
+    NatNetPoses joints;
+
+private:
+    std::vector<uint32_t> aligned;      // copy of unaligned frame data
+};
+
+// Builds a frame directly in the data of a zframe
+class NatNetFrameWriter
+{
+public:
+    // Allocate a frame for the counts in header and write the header
+    zframe_t *create(const NatNetFrameHeader &header);
+
+    void setMarker(uint32_t index, int32_t id, const Marker &marker);
+    void setRigidBody(uint32_t index, const RigidBody &rb);
+    void setSkeleton(uint32_t index, int32_t id, uint32_t jointStart, uint32_t jointCount);
+    void setJoint(uint32_t index, const RigidBody &joint);
+
+private:
+    void setPose(size_t offset, uint32_t count, uint32_t index, const RigidBody &rb);
+
+    byte *data = nullptr;
+    NatNetFrameHeader header;
+    NatNetFrameLayout layout;
+};
+
+#endif //GAZEBOSC_NATNETFRAME_H
@@ -0,0 +1,149 @@
+//
+// Marker deduplication and frame to frame labeling for the NatNet actor
+//
+
+#include "NatNetMarkers.h"
+#include <algorithm>
+
+static inline float
+s_distance2(const Marker &a, const Marker &b)
+{
+    float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+    return x * x + y * y + z * z;
+}
+
+void
+NatNetMarkerGrid::build(const Marker *points, uint32_t count, float radius)
+{
+    invCell = 0.5f / radius;
+
+    // four buckets per point keeps collisions rare
+    uint32_t size = 16;
+    while ( size < count * 4 )
+        size <<= 1;
+    mask = size - 1;
+
+    // counting sort of the points by bucket
+    start.assign(size + 1, 0);
+    buckets.resize(count);
+    for ( uint32_t i = 0; i < count; i++ ) {
+        const Marker &p = points[i];
+        buckets[i] = bucket(cell(p.x), cell(p.y), cell(p.z));
+        start[buckets[i] + 1]++;
+    }
+    for ( uint32_t b = 0; b < size; b++ )
+        start[b + 1] += start[b];
+
+    entries.resize(count);
+    for ( uint32_t i = 0; i < count; i++ )
+        entries[start[buckets[i]]++] = i;
+
+    // the fill moved each start to the end of its bucket, shift them back
+    for ( uint32_t b = size; b > 0; b-- )
+        start[b] = start[b - 1];
+    start[0] = 0;
+}
+
+void
+NatNetMarkerFilter::process(std::vector<Marker> &markers, const std::vector<Marker> &exclude)
+{
+    if ( dedupDistance > 0 )
+        dedup(markers, exclude);
+
+    if ( trackDistance > 0 )
+        track(markers);
+    else {
+        markerIds.resize(markers.size());
+        for ( size_t i = 0; i < markers.size(); i++ )
+            markerIds[i] = (int32_t)i;
+    }
+}
+
+void
+NatNetMarkerFilter::dedup(std::vector<Marker> &markers, const std::vector<Marker> &exclude)
+{
+    const float d2 = dedupDistance * dedupDistance;
+    uint32_t count = (uint32_t)markers.size();
+    grid.build(markers.data(), count, dedupDistance);
+    keep.assign(count, 1);
+
+    // markers of rigid bodies
+    for ( const Marker &e : exclude ) {
+        grid.query(e, [&](uint32_t j) {
+            if ( s_distance2(e, markers[j]) <= d2 )
+                keep[j] = 0;
+        });
+    }
+
+    // the first of a group of close markers wins
+    for ( uint32_t i = 0; i < count; i++ ) {
+        if ( !keep[i] )
+            continue;
+        const Marker &m = markers[i];
+        grid.query(m, [&](uint32_t j) {
+            if ( j < i && keep[j] && s_distance2(m, markers[j]) <= d2 )
+                keep[i] = 0;
+        });
+    }
+
+    uint32_t n = 0;
+    for ( uint32_t i = 0; i < count; i++ ) {
+        if ( keep[i] )
+            markers[n++] = markers[i];
+    }
+    removed += count - n;
+    markers.resize(n);
+}
+
+// Match the markers to the previous frame, closest pairs first. Markers
+// without a match within the tracking distance get a new id.
+void
+NatNetMarkerFilter::track(const std::vector<Marker> &markers)
+{
+    const float d2 = trackDistance * trackDistance;
+    uint32_t count = (uint32_t)markers.size();
+
+    matches.clear();
+    if ( !previous.empty() ) {
+        grid.build(previous.data(), (uint32_t)previous.size(), trackDistance);
+        for ( uint32_t i = 0; i < count; i++ ) {
+            const Marker &m = markers[i];
+            grid.query(m, [&](uint32_t j) {
+                float d = s_distance2(m, previous[j]);
+                if ( d <= d2 )
+                    matches.push_back({ d, i, j });
+            });
+        }
+        std::sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) {
+            return a.distance < b.distance;
+        });
+    }
+
+    markerIds.assign(count, -1);
+    claimed.assign(previous.size(), 0);
+    for ( const Match &match : matches ) {
+        if ( markerIds[match.marker] >= 0 || claimed[match.previous] )
+            continue;
+        markerIds[match.marker] = previousIds[match.previous];
+        claimed[match.previous] = 1;
+    }
+    for ( uint32_t i = 0; i < count; i++ ) {
+        if ( markerIds[i] < 0 ) {
+            markerIds[i] = nextId;
+            nextId = nextId == INT32_MAX ? 0 : nextId + 1;
+        }
+    }
+
+    previous.assign(markers.begin(), markers.end());
+    previousIds.assign(markerIds.begin(), markerIds.end());
+}
+
+void
+NatNetMarkerFilter::reset()
+{
+    previous.clear();
+    previousIds.clear();
+    markerIds.clear();
+    nextId = 0;
+    removed = 0;
+}
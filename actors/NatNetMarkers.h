@@ -0,0 +1,98 @@
+//
+// Marker deduplication and frame to frame labeling for the NatNet actor
+//
+
+#ifndef GAZEBOSC_NATNETMARKERS_H
+#define GAZEBOSC_NATNETMARKERS_H
+
+#include "NatNetDataTypes.h"
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+// Spatial hash of points for radius queries. The cells are twice the query
+// radius so a query only visits the 8 cells of the octant around a point.
+// Cells share hash buckets, so candidates must still be checked for distance.
+class NatNetMarkerGrid
+{
+public:
+    void build(const Marker *points, uint32_t count, float radius);
+
+    // Call f(index) for every point that may be within radius of p
+    template <typename F>
+    void query(const Marker &p, F f) const
+    {
+        if ( entries.empty() )
+            return;
+        int x[2], y[2], z[2];
+        octant(p.x, x);
+        octant(p.y, y);
+        octant(p.z, z);
+        for ( int i = 0; i < 8; i++ ) {
+            uint32_t b = bucket(x[i & 1], y[(i >> 1) & 1], z[i >> 2]);
+            for ( uint32_t e = start[b]; e < start[b + 1]; e++ )
+                f(entries[e]);
+        }
+    }
+
+private:
+    int cell(float v) const { return (int)floorf(v * invCell); }
+    // the cell of v and its neighbour on the side closest to v
+    void octant(float v, int *cells) const
+    {
+        float f = v * invCell;
+        cells[0] = (int)floorf(f);
+        cells[1] = f - cells[0] < 0.5f ? cells[0] - 1 : cells[0] + 1;
+    }
+    uint32_t bucket(int x, int y, int z) const
+    {
+        return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u) & mask;
+    }
+
+    float invCell = 1.0f;
+    uint32_t mask = 0;
+    std::vector<uint32_t> start;        // first entry of each bucket, mask + 2 long
+    std::vector<uint32_t> entries;      // point indices sorted by bucket
+    std::vector<uint32_t> buckets;      // bucket of each point
+};
+
+// Removes duplicate markers and gives the remaining markers ids that are
+// stable from frame to frame as long as a marker moves less than the
+// tracking distance per frame.
+class NatNetMarkerFilter
+{
+public:
+    float dedupDistance = 0;    // meters, 0 disables deduplication
+    float trackDistance = 0;    // meters, 0 disables tracking: the id is the index
+
+    // Remove markers closer than dedupDistance to an excluded marker (the
+    // markers of rigid bodies) or to an earlier marker, and label the rest
+    void process(std::vector<Marker> &markers, const std::vector<Marker> &exclude);
+
+    const std::vector<int32_t> &ids() const { return markerIds; }
+    uint64_t removed = 0;       // duplicates removed in total
+
+    void reset();
+
+private:
+    void dedup(std::vector<Marker> &markers, const std::vector<Marker> &exclude);
+    void track(const std::vector<Marker> &markers);
+
+    struct Match
+    {
+        float distance;
+        uint32_t marker;
+        uint32_t previous;
+    };
+
+    NatNetMarkerGrid grid;
+    std::vector<uint8_t> keep;
+    std::vector<Match> matches;
+    std::vector<uint8_t> claimed;
+    std::vector<Marker> previous;
+    std::vector<int32_t> previousIds;
+    std::vector<int32_t> markerIds;
+    int32_t nextId = 0;
+};
+
+#endif //GAZEBOSC_NATNETMARKERS_H
@@ -0,0 +1,720 @@
+#include "NatNetSimulatorActor.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+
+#define NATNET_SIM_MAX_DATAGRAM     65507   // biggest UDP payload
+#define NATNET_SIM_MAX_BURST        4       // frames sent at once before skipping ahead
+#define NATNET_SIM_CLOCK_FREQUENCY  1000000 // high resolution timestamps are in usecs
+#define NATNET_SIM_EXPOSURE_DELAY   3000    // usecs from mid exposure until a frame is sent
+
+const char * NatNetSimulator::capabilities =
+                                "capabilities\n"
+                                "    data\n"
+                                "        name = \"stream\"\n"
+                                "        type = \"mediacontrol\"\n"
+                                "    data\n"
+                                "        name = \"rate\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Frames per second\"\n"
+                                "        value = \"120\"\n"
+                                "        min = \"1\"\n"
+                                "        max = \"1000\"\n"
+                                "        api_call = \"SET RATE\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"rigidbodies\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Number of rigid bodies\"\n"
+                                "        value = \"10\"\n"
+                                "        min = \"0\"\n"
+                                "        max = \"1000\"\n"
+                                "        api_call = \"SET RIGIDBODIES\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"skeletons\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Number of skeletons of 21 joints\"\n"
+                                "        value = \"1\"\n"
+                                "        min = \"0\"\n"
+                                "        max = \"50\"\n"
+                                "        api_call = \"SET SKELETONS\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"markers\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Number of markers\"\n"
+                                "        value = \"50\"\n"
+                                "        min = \"0\"\n"
+                                "        max = \"5000\"\n"
+                                "        api_call = \"SET MARKERS\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"natnetVersion\"\n"
+                                "        type = \"string\"\n"
+                                "        help = \"NatNet version to speak, major.minor\"\n"
+                                "        value = \"3.1\"\n"
+                                "        api_call = \"SET VERSION\"\n"
+                                "        api_value = \"s\"\n"
+                                "    data\n"
+                                "        name = \"network_interface\"\n"
+                                "        type = \"int\"\n"
+                                "        help = \"Interface to send the multicast frames on\"\n"
+                                "        value = \"0\"\n"
+                                "        api_call = \"SET INTERFACE\"\n"
+                                "        api_value = \"i\"\n"
+                                "    data\n"
+                                "        name = \"unicast\"\n"
+                                "        type = \"bool\"\n"
+                                "        help = \"Send the frames to the last client that pinged instead of multicast\"\n"
+                                "        value = \"False\"\n"
+                                "        api_call = \"SET UNICAST\"\n"
+                                "        api_value = \"s\"\n"
+                                "    data\n"
+                                "        name = \"replay\"\n"
+                                "        type = \"filename\"\n"
+                                "        help = \"Replay the frames of a Motive capture (pcap or pcapng) instead\"\n"
+                                "        value = \"\"\n"
+                                "        valid_files = \"*.pcap,*.pcapng\"\n"
+                                "        api_call = \"SET REPLAY\"\n"
+                                "        api_value = \"s\"\n"
+                                "    data\n"
+                                "        name = \"loop\"\n"
+                                "        type = \"bool\"\n"
+                                "        help = \"Loop the replay\"\n"
+                                "        value = \"True\"\n"
+                                "        api_call = \"SET LOOP\"\n"
+                                "        api_value = \"s\"\n";
+
+// The 21 joints of a Motive skeleton: name, parent (0 is none) and offset
+// from the parent in meters
+struct SimulatorJoint
+{
+    const char *name;
+    int parent;
+    float offset[3];
+};
+
+static const SimulatorJoint s_joints[] = {
+    { "Hip",        0,  { 0.0f,   0.95f,  0.0f } },
+    { "Ab",         1,  { 0.0f,   0.08f,  0.0f } },
+    { "Chest",      2,  { 0.0f,   0.2f,   0.0f } },
+    { "Neck",       3,  { 0.0f,   0.22f,  0.0f } },
+    { "Head",       4,  { 0.0f,   0.12f,  0.0f } },
+    { "LShoulder",  3,  { 0.04f,  0.17f,  0.0f } },
+    { "LUArm",      6,  { 0.14f,  0.0f,   0.0f } },
+    { "LFArm",      7,  { 0.28f,  0.0f,   0.0f } },
+    { "LHand",      8,  { 0.24f,  0.0f,   0.0f } },
+    { "RShoulder",  3,  { -0.04f, 0.17f,  0.0f } },
+    { "RUArm",      10, { -0.14f, 0.0f,   0.0f } },
+    { "RFArm",      11, { -0.28f, 0.0f,   0.0f } },
+    { "RHand",      12, { -0.24f, 0.0f,   0.0f } },
+    { "LThigh",     1,  { 0.09f,  0.0f,   0.0f } },
+    { "LShin",      14, { 0.0f,   -0.43f, 0.0f } },
+    { "LFoot",      15, { 0.0f,   -0.42f, 0.0f } },
+    { "RThigh",     1,  { -0.09f, 0.0f,   0.0f } },
+    { "RShin",      17, { 0.0f,   -0.43f, 0.0f } },
+    { "RFoot",      18, { 0.0f,   -0.42f, 0.0f } },
+    { "LToe",       16, { 0.0f,   -0.06f, 0.13f } },
+    { "RToe",       19, { 0.0f,   -0.06f, 0.13f } },
+};
+#define NATNET_SIM_JOINTS   (int)(sizeof(s_joints) / sizeof(s_joints[0]))
+
+template <typename T>
+static void
+s_put(std::vector<char> &packet, T value)
+{
+    const char *bytes = (const char *)&value;
+    packet.insert(packet.end(), bytes, bytes + sizeof(T));
+}
+
+static void
+s_put_string(std::vector<char> &packet, const char *s)
+{
+    packet.insert(packet.end(), s, s + strlen(s) + 1);
+}
+
+static void
+s_begin(std::vector<char> &packet, uint16_t message)
+{
+    packet.clear();
+    s_put<uint16_t>(packet, message);
+    s_put<uint16_t>(packet, 0);
+}
+
+static void
+s_end(std::vector<char> &packet)
+{
+    uint16_t size = (uint16_t)std::min(packet.size() - 4, (size_t)0xffff);
+    memcpy(packet.data() + 2, &size, 2);
+}
+
+zmsg_t *
+NatNetSimulator::handleInit( sphactor_event_t *ev )
+{
+    ziflist_t * ifList = ziflist_new();
+    const char* cur = ziflist_first(ifList);
+    while( cur != nullptr ) {
+        ifNames.push_back(cur);
+        ifAddresses.push_back(ziflist_address(ifList));
+        cur = ziflist_next(ifList);
+    }
+    ziflist_destroy(&ifList);
+
+    requestBuffer.resize(NATNET_SIM_MAX_DATAGRAM);
+    if ( !openSockets(ev->actor) )
+        zsys_error("NatNet Simulator: can't open the NatNet ports, is Motive running here?");
+    setReport(ev->actor);
+    return nullptr;
+}
+
+zmsg_t *
+NatNetSimulator::handleStop( sphactor_event_t *ev )
+{
+    stopStreaming(ev->actor);
+    closeSockets(ev->actor);
+    return nullptr;
+}
+
+bool
+NatNetSimulator::openSockets( sphactor_actor_t *actor )
+{
+    closeSockets(actor);
+
+    // requests arrive on the command port
+    commandSocket = zsys_udp_new(false);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT_COMMAND);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if ( bind(commandSocket, (struct sockaddr *)&address, sizeof(address)) != 0 ) {
+        zsys_udp_close(commandSocket);
+        commandSocket = INVALID_SOCKET;
+        return false;
+    }
+    int rc = sphactor_actor_poller_add(actor, &commandSocket);
+    assert(rc == 0);
+
+    // frames go to the multicast group on the selected interface
+    dataSocket = zsys_udp_new(false);
+    int ttl = 1, loopback = 1, sndbuf = 4 * 1024 * 1024;
+    setsockopt(dataSocket, IPPROTO_IP, IP_MULTICAST_TTL, (const char *)&ttl, sizeof(ttl));
+    setsockopt(dataSocket, IPPROTO_IP, IP_MULTICAST_LOOP, (const char *)&loopback, sizeof(loopback));
+    setsockopt(dataSocket, SOL_SOCKET, SO_SNDBUF, (const char *)&sndbuf, sizeof(sndbuf));
+    setsockopt(commandSocket, SOL_SOCKET, SO_SNDBUF, (const char *)&sndbuf, sizeof(sndbuf));
+    if ( interfaceIndex < (int)ifAddresses.size() ) {
+        struct in_addr iface;
+        iface.s_addr = inet_addr(ifAddresses[interfaceIndex].c_str());
+        setsockopt(dataSocket, IPPROTO_IP, IP_MULTICAST_IF, (const char *)&iface, sizeof(iface));
+    }
+    return true;
+}
+
+void
+NatNetSimulator::closeSockets( sphactor_actor_t *actor )
+{
+    if ( commandSocket != INVALID_SOCKET ) {
+        sphactor_actor_poller_remove(actor, &commandSocket);
+        zsys_udp_close(commandSocket);
+        commandSocket = INVALID_SOCKET;
+    }
+    if ( dataSocket != INVALID_SOCKET ) {
+        zsys_udp_close(dataSocket);
+        dataSocket = INVALID_SOCKET;
+    }
+}
+
+zmsg_t *
+NatNetSimulator::handleCustomSocket( sphactor_event_t *ev )
+{
+    zframe_t *frame = zmsg_pop(ev->msg);
+    if ( zframe_size(frame) == sizeof(void *) ) {
+        void *p = *(void **)zframe_data(frame);
+        if ( p == &commandSocket ) {
+            struct sockaddr_in from;
+            socklen_t fromSize = sizeof(from);
+            int size = (int)recvfrom(commandSocket, requestBuffer.data(), (int)requestBuffer.size(), 0, (struct sockaddr *)&from, &fromSize);
+            if ( size >= 4 )
+                handleRequest(requestBuffer.data(), (size_t)size, from);
+        }
+    }
+    zframe_destroy(&frame);
+    zmsg_destroy(&ev->msg);
+    return nullptr;
+}
+
+void
+NatNetSimulator::handleRequest( const char *data, size_t size, const struct sockaddr_in &from )
+{
+    uint16_t message;
+    memcpy(&message, data, 2);
+
+    switch ( message ) {
+        case NAT_PING:
+            client = from;
+            hasClient = true;
+            if ( replaying && !capture.pingResponse.empty() )
+                packet.assign(capture.pingResponse.begin(), capture.pingResponse.end());
+            else
+                buildPingResponse();
+            break;
+        case NAT_REQUEST_MODELDEF:
+            if ( replaying ) {
+                if ( capture.modelDef.empty() ) {
+                    zsys_warning("NatNet Simulator: the capture has no model definitions");
+                    return;
+                }
+                packet.assign(capture.modelDef.begin(), capture.modelDef.end());
+            }
+            else
+                buildModelDef();
+            break;
+        case NAT_REQUEST_FRAMEOFDATA:
+            buildFrame(zclock_usecs() / 1e6);
+            break;
+        case NAT_REQUEST:
+            // commands like TimelinePlay, we pretend they all succeed
+            s_begin(packet, NAT_RESPONSE);
+            s_put<int32_t>(packet, 0);
+            s_end(packet);
+            break;
+        default:
+            s_begin(packet, NAT_UNRECOGNIZED_REQUEST);
+            s_end(packet);
+            break;
+    }
+    sendPacket(from, false);
+    requestsAnswered++;
+}
+
+void
+NatNetSimulator::sendPacket( const struct sockaddr_in &to, bool data )
+{
+    if ( packet.size() > NATNET_SIM_MAX_DATAGRAM ) {
+        framesTooBig++;
+        return;
+    }
+    SOCKET socket = data ? dataSocket : commandSocket;
+    if ( socket == INVALID_SOCKET )
+        return;
+    int rc = (int)sendto(socket, packet.data(), (int)packet.size(), 0, (const struct sockaddr *)&to, sizeof(to));
+    if ( rc > 0 )
+        bytesSent += rc;
+}
+
+void
+NatNetSimulator::buildPingResponse()
+{
+    sSender sender;
+    memset(&sender, 0, sizeof(sender));
+    snprintf(sender.szName, sizeof(sender.szName), "Gazebosc NatNet Simulator");
+    sender.Version[0] = (unsigned char)major;
+    sender.Version[1] = (unsigned char)minor;
+    sender.NatNetVersion[0] = (unsigned char)major;
+    sender.NatNetVersion[1] = (unsigned char)minor;
+
+    s_begin(packet, NAT_PINGRESPONSE);
+    const char *bytes = (const char *)&sender;
+    packet.insert(packet.end(), bytes, bytes + sizeof(sender));
+    // NatNet 3 appends the frequency of the high resolution timestamps
+    if ( major >= 3 )
+        s_put<uint64_t>(packet, NATNET_SIM_CLOCK_FREQUENCY);
+    s_end(packet);
+}
+
+void
+NatNetSimulator::buildModelDef()
+{
+    char name[64];
+    s_begin(packet, NAT_MODELDEF);
+    s_put<int32_t>(packet, rigidbodyCount + skeletonCount);
+
+    for ( int i = 0; i < rigidbodyCount; i++ ) {
+        s_put<int32_t>(packet, 1);
+        if ( major >= 2 ) {
+            snprintf(name, sizeof(name), "RigidBody%d", i + 1);
+            s_put_string(packet, name);
+        }
+        s_put<int32_t>(packet, i + 1);      // id
+        s_put<int32_t>(packet, -1);         // parent
+        s_put<float>(packet, 0.0f);
+        s_put<float>(packet, 0.0f);
+        s_put<float>(packet, 0.0f);
+        if ( major >= 3 )
+            s_put<int32_t>(packet, 0);      // no markers
+    }
+
+    for ( int s = 0; s < skeletonCount; s++ ) {
+        s_put<int32_t>(packet, 2);
+        snprintf(name, sizeof(name), "Skeleton%d", s + 1);
+        s_put_string(packet, name);
+        s_put<int32_t>(packet, rigidbodyCount + s + 1);
+        s_put<int32_t>(packet, NATNET_SIM_JOINTS);
+        for ( int j = 0; j < NATNET_SIM_JOINTS; j++ ) {
+            const SimulatorJoint &joint = s_joints[j];
+            if ( major >= 2 ) {
+                snprintf(name, sizeof(name), "Skeleton%d_%s", s + 1, joint.name);
+                s_put_string(packet, name);
+            }
+            s_put<int32_t>(packet, j + 1);
+            s_put<int32_t>(packet, joint.parent);
+            s_put<float>(packet, joint.offset[0]);
+            s_put<float>(packet, joint.offset[1]);
+            s_put<float>(packet, joint.offset[2]);
+            if ( major >= 3 )
+                s_put<int32_t>(packet, 0);
+        }
+    }
+    s_end(packet);
+}
+
+// A rigid body or joint as unpacked by the NatNet actor for this version
+static void
+s_put_pose(std::vector<char> &packet, int major, int minor, int32_t id, const float *p, const float *q)
+{
+    s_put<int32_t>(packet, id);
+    for ( int i = 0; i < 3; i++ )
+        s_put<float>(packet, p[i]);
+    for ( int i = 0; i < 4; i++ )
+        s_put<float>(packet, q[i]);
+    if ( major < 3 )
+        s_put<int32_t>(packet, 0);          // no associated markers
+    if ( major >= 2 )
+        s_put<float>(packet, 0.0005f);      // mean marker error
+    if ( (major == 2 && minor >= 6) || major > 2 )
+        s_put<int16_t>(packet, 0x01);       // tracked
+}
+
+void
+NatNetSimulator::buildFrame( double timestamp )
+{
+    auto start = std::chrono::steady_clock::now();
+    bool v21 = (major == 2 && minor >= 1) || major > 2;
+    bool v23 = (major == 2 && minor >= 3) || major > 2;
+    bool v26 = (major == 2 && minor >= 6) || major > 2;
+    float t = (float)timestamp;
+
+    s_begin(packet, NAT_FRAMEOFDATA);
+    s_put<int32_t>(packet, frameNumber++);
+    s_put<int32_t>(packet, 0);              // marker sets
+
+    // before 2.3 the markers go in the unidentified list
+    s_put<int32_t>(packet, v23 ? 0 : markerCount);
+    float markers[3];
+    for ( int m = 0; !v23 && m < markerCount; m++ ) {
+        // spread over a sphere, each wobbling a bit
+        float a = m * 2.39996f, h = 1.0f - 2.0f * (m + 0.5f) / markerCount, r = sqrtf(1.0f - h * h);
+        markers[0] = 1.5f * r * cosf(a) + 0.02f * sinf(t * 2.0f + m);
+        markers[1] = 1.2f + 1.0f * h;
+        markers[2] = 1.5f * r * sinf(a) + 0.02f * cosf(t * 2.0f + m);
+        for ( int i = 0; i < 3; i++ )
+            s_put<float>(packet, markers[i]);
+    }
+
+    // rigid bodies circle the origin at their own speed
+    s_put<int32_t>(packet, rigidbodyCount);
+    for ( int i = 0; i < rigidbodyCount; i++ ) {
+        float angle = t * (0.5f + 0.05f * (i % 7)) + i * 0.7f;
+        float radius = 1.0f + 0.25f * (i % 8);
+        float p[3] = { radius * cosf(angle), 1.0f + 0.1f * (i % 5), radius * sinf(angle) };
+        float q[4] = { 0.0f, sinf(-angle / 2), 0.0f, cosf(-angle / 2) };
+        s_put_pose(packet, major, minor, i + 1, p, q);
+    }
+
+    // skeletons walk in a circle swinging their limbs, joints are local
+    if ( v21 ) {
+        s_put<int32_t>(packet, skeletonCount);
+        for ( int s = 0; s < skeletonCount; s++ ) {
+            int32_t id = rigidbodyCount + s + 1;
+            s_put<int32_t>(packet, id);
+            s_put<int32_t>(packet, NATNET_SIM_JOINTS);
+            float angle = t * 0.3f + s * 1.3f;
+            float swing = 0.4f * sinf(t * 4.0f + s);
+            for ( int j = 0; j < NATNET_SIM_JOINTS; j++ ) {
+                float p[3] = { s_joints[j].offset[0], s_joints[j].offset[1], s_joints[j].offset[2] };
+                float q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                if ( j == 0 ) {
+                    p[0] = 2.0f * cosf(angle);
+                    p[2] = 2.0f * sinf(angle);
+                    q[1] = sinf(-angle / 2);
+                    q[3] = cosf(-angle / 2);
+                }
+                else if ( s_joints[j].parent == 1 || s_joints[j].parent == 3 ) {
+                    // legs and arms, left and right out of phase
+                    float a = (s_joints[j].offset[0] > 0 ? swing : -swing) / 2;
+                    q[0] = sinf(a);
+                    q[3] = cosf(a);
+                }
+                s_put_pose(packet, major, minor, id << 16 | (j + 1), p, q);
+            }
+        }
+    }
+
+    if ( v23 ) {
+        s_put<int32_t>(packet, markerCount);
+        for ( int m = 0; m < markerCount; m++ ) {
+            float a = m * 2.39996f, h = 1.0f - 2.0f * (m + 0.5f) / markerCount, r = sqrtf(1.0f - h * h);
+            s_put<int32_t>(packet, m + 1);  // model 0: unlabeled
+            s_put<float>(packet, 1.5f * r * cosf(a) + 0.02f * sinf(t * 2.0f + m));
+            s_put<float>(packet, 1.2f + 1.0f * h);
+            s_put<float>(packet, 1.5f * r * sinf(a) + 0.02f * cosf(t * 2.0f + m));
+            s_put<float>(packet, 0.014f);   // size
+            if ( v26 )
+                s_put<int16_t>(packet, 0x10);
+            if ( major >= 3 )
+                s_put<float>(packet, 0.0002f);
+        }
+    }
+
+    if ( (major == 2 && minor >= 9) || major > 2 )
+        s_put<int32_t>(packet, 0);          // force plates
+    if ( (major == 2 && minor >= 11) || major > 2 )
+        s_put<int32_t>(packet, 0);          // devices
+    if ( major < 3 )
+        s_put<float>(packet, NATNET_SIM_EXPOSURE_DELAY / 1000.0f);
+
+    s_put<uint32_t>(packet, 0);             // timecode
+    s_put<uint32_t>(packet, 0);
+    if ( (major == 2 && minor >= 7) || major > 2 )
+        s_put<double>(packet, timestamp);
+    else
+        s_put<float>(packet, (float)timestamp);
+
+    if ( major >= 3 ) {
+        uint64_t now = (uint64_t)zclock_usecs();
+        s_put<uint64_t>(packet, now - NATNET_SIM_EXPOSURE_DELAY);  // mid exposure
+        s_put<uint64_t>(packet, now - NATNET_SIM_EXPOSURE_DELAY / 2); // camera data received
+        s_put<uint64_t>(packet, now);                               // transmit
+    }
+    s_put<int16_t>(packet, 0);              // params
+    s_put<int32_t>(packet, 0);              // end of data
+    s_end(packet);
+
+    buildNsecs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void
+NatNetSimulator::startStreaming( sphactor_actor_t *actor )
+{
+    streaming = true;
+    startTime = zclock_usecs();
+    frameIndex = 0;
+    replayIndex = 0;
+    replayOffset = 0;
+    schedule(actor);
+}
+
+void
+NatNetSimulator::stopStreaming( sphactor_actor_t *actor )
+{
+    streaming = false;
+    sphactor_actor_set_timeout(actor, -1);
+}
+
+void
+NatNetSimulator::schedule( sphactor_actor_t *actor )
+{
+    if ( !streaming ) {
+        sphactor_actor_set_timeout(actor, -1);
+        return;
+    }
+    int64_t due = replaying ? startTime + replayOffset + capture.frames[replayIndex].time
+                            : startTime + (int64_t)(frameIndex * 1000000 / rate);
+    int64_t timeout = (due - zclock_usecs()) / 1000;
+    // the timer has millisecond resolution, frames may be sent up to 1ms late
+    if ( timeout <= 0 )
+        timeout = 1;
+    sphactor_actor_set_timeout(actor, timeout);
+}
+
+zmsg_t *
+NatNetSimulator::handleTimer( sphactor_event_t *ev )
+{
+    zmsg_destroy(&ev->msg);
+    if ( !streaming )
+        return nullptr;
+
+    struct sockaddr_in group;
+    memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_port = htons(PORT_DATA);
+    group.sin_addr.s_addr = inet_addr(MULTICAST_ADDRESS.c_str());
+    const struct sockaddr_in &to = unicast && hasClient ? client : group;
+
+    int64_t interval = 1000000 / rate;
+    int64_t now = zclock_usecs();
+    for ( int burst = 0; streaming; burst++ ) {
+        int64_t due = replaying ? startTime + replayOffset + capture.frames[replayIndex].time
+                                : startTime + (int64_t)(frameIndex * 1000000 / rate);
+        if ( due > now )
+            break;
+
+        // far behind, skip to the present instead of sending a burst
+        if ( burst == NATNET_SIM_MAX_BURST ) {
+            if ( replaying )
+                replayOffset = now - startTime - capture.frames[replayIndex].time;
+            else
+                frameIndex = (uint64_t)((now - startTime) * rate / 1000000);
+            continue;
+        }
+
+        if ( now - due > interval )
+            framesLate++;
+        lateUsecs += now - due;
+
+        if ( replaying ) {
+            const NatNetCapture::Packet &frame = capture.frames[replayIndex];
+            packet.assign(frame.data.begin(), frame.data.end());
+            if ( ++replayIndex == capture.frames.size() ) {
+                if ( !loop )
+                    stopStreaming(ev->actor);
+                replayIndex = 0;
+                replayOffset += frame.time + interval;
+            }
+        }
+        else {
+            buildFrame((double)(due - startTime) / 1e6);
+            frameIndex++;
+        }
+
+        sendPacket(to, !(unicast && hasClient));
+        framesSent++;
+    }
+
+    schedule(ev->actor);
+    if ( framesSent % 60 == 0 )
+        setReport(ev->actor);
+    return nullptr;
+}
+
+zmsg_t *
+NatNetSimulator::handleAPI( sphactor_event_t *ev )
+{
+    char * cmd = zmsg_popstr(ev->msg);
+    if (cmd) {
+        if ( streq(cmd, "PLAY") ) {
+            if ( !streaming )
+                startStreaming(ev->actor);
+        }
+        else if ( streq(cmd, "PAUSE") ) {
+            stopStreaming(ev->actor);
+        }
+        else if ( streq(cmd, "BACK") ) {
+            if ( streaming )
+                startStreaming(ev->actor);
+        }
+        else if ( streq(cmd, "SET RATE") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value ) {
+                rate = std::max(1, std::min(atoi(value), 1000));
+                // restart the schedule at the new rate
+                if ( streaming && !replaying )
+                    startStreaming(ev->actor);
+            }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET RIGIDBODIES") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value )
+                rigidbodyCount = std::max(0, atoi(value));
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET SKELETONS") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value )
+                skeletonCount = std::max(0, atoi(value));
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET MARKERS") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value )
+                markerCount = std::max(0, atoi(value));
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET VERSION") ) {
+            char *value = zmsg_popstr(ev->msg);
+            int ma = 0, mi = 0;
+            if ( value && sscanf(value, "%d.%d", &ma, &mi) >= 1 && ma >= 2 && ma <= 4 ) {
+                major = ma;
+                minor = mi;
+            }
+            else
+                zsys_error("NatNet Simulator: unsupported version %s", value ? value : "");
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET INTERFACE") ) {
+            char *value = zmsg_popstr(ev->msg);
+            if ( value ) {
+                interfaceIndex = atoi(value);
+                if ( interfaceIndex < 0 || interfaceIndex >= (int)ifNames.size() )
+                    zsys_info("ERROR: Invalid interface number");
+                else if ( !openSockets(ev->actor) )
+                    zsys_error("NatNet Simulator: can't open the NatNet ports");
+            }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET UNICAST") ) {
+            char *value = zmsg_popstr(ev->msg);
+            unicast = value && streq(value, "True");
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET LOOP") ) {
+            char *value = zmsg_popstr(ev->msg);
+            loop = value && streq(value, "True");
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET REPLAY") ) {
+            char *value = zmsg_popstr(ev->msg);
+            replaying = false;
+            capture.clear();
+            if ( value && strlen(value) ) {
+                replaying = capture.open(value);
+                if ( replaying )
+                    zsys_info("NatNet Simulator: replaying %zu frames from %s", capture.frames.size(), value);
+                else
+                    zsys_error("NatNet Simulator: no NatNet frames found in %s", value);
+            }
+            if ( streaming )
+                startStreaming(ev->actor);
+            zstr_free(&value);
+        }
+
+        zstr_free(&cmd);
+    }
+
+    setReport(ev->actor);
+    zmsg_destroy(&ev->msg);
+    return nullptr;
+}
+
+void
+NatNetSimulator::setReport( sphactor_actor_t *actor )
+{
+    char stat[64];
+    zosc_t * msg = zosc_create("/report", "ss", "State", streaming ? (replaying ? "replaying" : "streaming") : "stopped");
+    if ( replaying ) {
+        snprintf(stat, sizeof(stat), "%zu frames", capture.frames.size());
+        zosc_append(msg, "ss", "Capture", stat);
+    }
+    if ( hasClient ) {
+        snprintf(stat, sizeof(stat), "%s:%d", inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+        zosc_append(msg, "ss", "Client", stat);
+    }
+    zosc_append(msg, "si", "Frames sent", (int)framesSent);
+    zosc_append(msg, "si", "Requests answered", (int)requestsAnswered);
+    if ( framesSent > 0 ) {
+        snprintf(stat, sizeof(stat), "%.0f", (double)bytesSent / framesSent);
+        zosc_append(msg, "ss", "Bytes/frame", stat);
+        if ( !replaying ) {
+            snprintf(stat, sizeof(stat), "%.0f", (double)buildNsecs / framesSent);
+            zosc_append(msg, "ss", "Build nsec/frame", stat);
+        }
+        snprintf(stat, sizeof(stat), "%.0f", (double)lateUsecs / framesSent);
+        zosc_append(msg, "ss", "Send delay usec", stat);
+        zosc_append(msg, "si", "Late frames", (int)framesLate);
+    }
+    if ( framesTooBig > 0 )
+        zosc_append(msg, "si", "Frames too big for UDP", (int)framesTooBig);
+    sphactor_actor_set_custom_report_data(actor, msg);
+}
@@ -0,0 +1,91 @@
+#ifndef GAZEBOSC_NATNETSIMULATORACTOR_H
+#define GAZEBOSC_NATNETSIMULATORACTOR_H
+
+#include "libsphactor.hpp"
+#include "NatNetDataTypes.h"
+#include "NatNetCapture.h"
+#include <string>
+#include <vector>
+
+// Stand-in for a Motive server. It answers pings and model definition
+// requests on the command port and streams frames of animated rigid
+// bodies, skeletons and markers, or replays a capture of a real server.
+//
+// The sockets are plain UDP sockets, a ZMQ_DGRAM socket can't send the
+// datagrams bigger than 8KB a big scene needs.
+class NatNetSimulator : public Sphactor
+{
+public:
+    static const char *capabilities;
+
+    // Settings
+    int rate = 120;
+    int rigidbodyCount = 10;
+    int skeletonCount = 1;
+    int markerCount = 50;
+    int major = 3;
+    int minor = 1;
+    bool unicast = false;
+    bool loop = true;
+    std::vector<std::string> ifNames;
+    std::vector<std::string> ifAddresses;
+    int interfaceIndex = 0;
+
+    // Sockets
+    SOCKET commandSocket = INVALID_SOCKET;
+    SOCKET dataSocket = INVALID_SOCKET;
+    std::vector<char> requestBuffer;    // one command datagram, sized in handleInit
+    struct sockaddr_in client;          // last client that pinged us
+    bool hasClient = false;
+
+    // Streaming, frame n is due at startTime + n / rate
+    bool streaming = false;
+    int64_t startTime = 0;
+    uint64_t frameIndex = 0;
+    int32_t frameNumber = 0;
+
+    // Replay
+    NatNetCapture capture;
+    bool replaying = false;
+    size_t replayIndex = 0;
+    int64_t replayOffset = 0;           // added to the capture times for this loop
+
+    // Statistics
+    uint64_t framesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t framesLate = 0;            // sent more than a frame interval after they were due
+    uint64_t framesTooBig = 0;
+    uint64_t requestsAnswered = 0;
+    int64_t buildNsecs = 0;
+    int64_t lateUsecs = 0;
+
+    std::vector<char> packet;
+
+    zmsg_t *handleInit( sphactor_event_t *ev );
+    zmsg_t *handleTimer( sphactor_event_t *ev );
+    zmsg_t *handleAPI( sphactor_event_t *ev );
+    zmsg_t *handleCustomSocket( sphactor_event_t *ev );
+    zmsg_t *handleStop( sphactor_event_t *ev );
+
+    bool openSockets( sphactor_actor_t *actor );
+    void closeSockets( sphactor_actor_t *actor );
+    void handleRequest( const char *data, size_t size, const struct sockaddr_in &from );
+    void sendPacket( const struct sockaddr_in &to, bool data );
+
+    void buildPingResponse();
+    void buildModelDef();
+    void buildFrame( double timestamp );
+    void startStreaming( sphactor_actor_t *actor );
+    void stopStreaming( sphactor_actor_t *actor );
+    void schedule( sphactor_actor_t *actor );
+    void setReport( sphactor_actor_t *actor );
+
+    NatNetSimulator() {
+        memset(&client, 0, sizeof(client));
+    }
+
+    ~NatNetSimulator() {
+    }
+};
+
+#endif //GAZEBOSC_NATNETSIMULATORACTOR_H
@@ -0,0 +1,295 @@
+//
+// Velocity estimation for rigid bodies from timestamped NatNet frames
+//
+
+#include "NatNetVelocity.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#define NATNET_VELOCITY_TWO_PI  6.28318530718f
+
+// Rotation vector (axis * angle) of the rotation from a to b, both unit
+// quaternions x y z w, in the world frame: b = d * a
+static void
+s_rotation_delta(const float *a, const float *b, float *rv)
+{
+    // d = b * conjugate(a)
+    float ax = -a[0], ay = -a[1], az = -a[2], aw = a[3];
+    float x = b[3] * ax + b[0] * aw + b[1] * az - b[2] * ay;
+    float y = b[3] * ay - b[0] * az + b[1] * aw + b[2] * ax;
+    float z = b[3] * az + b[0] * ay - b[1] * ax + b[2] * aw;
+    float w = b[3] * aw - b[0] * ax - b[1] * ay - b[2] * az;
+
+    // take the short way round
+    if ( w < 0 ) {
+        x = -x; y = -y; z = -z; w = -w;
+    }
+    float s = sqrtf(x * x + y * y + z * z);
+    float scale = s > 1e-9f ? 2.0f * atan2f(s, w) / s : 2.0f;
+    rv[0] = x * scale;
+    rv[1] = y * scale;
+    rv[2] = z * scale;
+}
+
+void
+NatNetVelocityBank::setFilter(int filter)
+{
+    type = std::max(NATNET_VELOCITY_ONE_EURO, std::min(filter, NATNET_VELOCITY_ALPHA_BETA));
+    reset();
+}
+
+void
+NatNetVelocityBank::setWindow(int window, int lag)
+{
+    window = std::max(3, std::min(window, NATNET_VELOCITY_MAX_WINDOW));
+    if ( window % 2 == 0 )
+        window--;
+    this->window = window;
+    this->lag = std::max(0, std::min(lag, window / 2));
+    computeWeights();
+    resize(size);
+    reset();
+}
+
+// Least squares weights of a quadratic through the last window samples,
+// evaluated lag samples behind the newest. Sample k is at t = -k.
+void
+NatNetVelocityBank::computeWeights()
+{
+    double m[3][3] = {};
+    for ( int k = 0; k < window; k++ ) {
+        double t[3] = { 1.0, -(double)k, (double)k * k };
+        for ( int r = 0; r < 3; r++ )
+            for ( int c = 0; c < 3; c++ )
+                m[r][c] += t[r] * t[c];
+    }
+
+    // solve m * y = (1, -lag, lag^2) by Cramer's rule
+    double e[3] = { 1.0, -(double)lag, (double)lag * lag };
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+               - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+               + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    double y[3];
+    for ( int i = 0; i < 3; i++ ) {
+        double a[3][3];
+        memcpy(a, m, sizeof(a));
+        for ( int r = 0; r < 3; r++ )
+            a[r][i] = e[r];
+        y[i] = ( a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+               - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+               + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]) ) / det;
+    }
+
+    for ( int k = 0; k < window; k++ )
+        weights[k] = (float)(y[0] - y[1] * k + y[2] * k * k);
+}
+
+void
+NatNetVelocityBank::resize(size_t count)
+{
+    size = count;
+    lastTime.resize(count, 0.0);
+    lastPose.resize(count * 7, 0.0f);
+    valid.resize(count, 0);
+    present.resize(count, 0.0f);
+    dt.resize(count, 0.0f);
+    invDt.resize(count, 0.0f);
+    samples.resize(count, 0.0f);
+    for ( int c = 0; c < NATNET_VELOCITY_CHANNELS; c++ ) {
+        delta[c].resize(count, 0.0f);
+        out[c].resize(count, 0.0f);
+        state[c].resize(count, 0.0f);
+        for ( int k = 0; k < window; k++ )
+            history[c][k].resize(count, 0.0f);
+    }
+}
+
+void
+NatNetVelocityBank::resetSlot(uint32_t slot)
+{
+    samples[slot] = 0.0f;
+    for ( int c = 0; c < NATNET_VELOCITY_CHANNELS; c++ ) {
+        out[c][slot] = 0.0f;
+        state[c][slot] = 0.0f;
+        for ( int k = 0; k < window; k++ )
+            history[c][k][slot] = 0.0f;
+    }
+}
+
+void
+NatNetVelocityBank::reset()
+{
+    head = 0;
+    std::fill(valid.begin(), valid.end(), 0);
+    for ( uint32_t slot = 0; slot < size; slot++ )
+        resetSlot(slot);
+}
+
+void
+NatNetVelocityBank::begin(double timestamp)
+{
+    now = timestamp;
+    std::fill(present.begin(), present.end(), 0.0f);
+    std::fill(dt.begin(), dt.end(), 0.0f);
+    std::fill(invDt.begin(), invDt.end(), 0.0f);
+    for ( int c = 0; c < NATNET_VELOCITY_CHANNELS; c++ )
+        std::fill(delta[c].begin(), delta[c].end(), 0.0f);
+}
+
+void
+NatNetVelocityBank::add(uint32_t slot, const float *position, const float *rotation)
+{
+    if ( slot >= size )
+        resize(slot + 1);
+
+    float *pose = &lastPose[slot * 7];
+    double elapsed = now - lastTime[slot];
+    if ( valid[slot] && elapsed > 0 && elapsed <= maxGap ) {
+        float rv[3];
+        s_rotation_delta(pose + 3, rotation, rv);
+        for ( int c = 0; c < 3; c++ ) {
+            delta[c][slot] = position[c] - pose[c];
+            delta[c + 3][slot] = rv[c];
+        }
+        present[slot] = 1.0f;
+        dt[slot] = (float)elapsed;
+        invDt[slot] = (float)(1.0 / elapsed);
+    }
+    else if ( !valid[slot] || elapsed != 0 ) {
+        // first pose or a gap (or the clock went back): start over from here
+        resetSlot(slot);
+        valid[slot] = 1;
+    }
+    else
+        return;     // same timestamp again, keep the first pose
+
+    memcpy(pose, position, 3 * sizeof(float));
+    memcpy(pose + 3, rotation, 4 * sizeof(float));
+    lastTime[slot] = now;
+}
+
+void
+NatNetVelocityBank::update()
+{
+    if ( type == NATNET_VELOCITY_SAVITZKY_GOLAY )
+        head = (head + 1) % window;
+
+    for ( int c = 0; c < NATNET_VELOCITY_CHANNELS; c++ ) {
+        if ( type == NATNET_VELOCITY_ONE_EURO )
+            updateOneEuro(c);
+        else if ( type == NATNET_VELOCITY_SAVITZKY_GOLAY )
+            updateSavitzkyGolay(c);
+        else
+            updateAlphaBeta(c);
+    }
+
+    float limit = type == NATNET_VELOCITY_SAVITZKY_GOLAY ? (float)window : 1.0f;
+    float *__restrict n = samples.data();
+    const float *__restrict p = present.data();
+    for ( size_t s = 0; s < size; s++ )
+        n[s] = std::min(n[s] + p[s], limit);
+}
+
+// One-Euro filter on the raw velocity, alpha = dt / (dt + tau). A slot that
+// is not present has dt = 0 so alpha = 0 and its state stays as it is.
+void
+NatNetVelocityBank::updateOneEuro(int channel)
+{
+    const float tauD = 1.0f / (NATNET_VELOCITY_TWO_PI * derivativeCutoff);
+    const float minC = minCutoff, b = beta;
+    const float *__restrict d = delta[channel].data();
+    const float *__restrict t = dt.data();
+    const float *__restrict it = invDt.data();
+    const float *__restrict n = samples.data();
+    float *__restrict v = out[channel].data();
+    float *__restrict dv = state[channel].data();
+
+    for ( size_t s = 0; s < size; s++ ) {
+        float raw = d[s] * it[s];
+        // the first sample initialises the filter
+        float first = n[s] > 0.0f ? 0.0f : 1.0f;
+        float ad = t[s] / (t[s] + tauD);
+        float dvs = dv[s] + ad * ((raw - v[s]) * it[s] - dv[s]) * (1.0f - first);
+        float cutoff = minC + b * fabsf(dvs);
+        float tau = 1.0f / (NATNET_VELOCITY_TWO_PI * cutoff);
+        float a = t[s] / (t[s] + tau);
+        a = a + first * (t[s] > 0.0f ? 1.0f - a : 0.0f);
+        v[s] = v[s] + a * (raw - v[s]);
+        dv[s] = dvs;
+    }
+}
+
+// Quadratic least squares over the last window raw velocities. Until the
+// window has filled up the raw velocity is used.
+void
+NatNetVelocityBank::updateSavitzkyGolay(int channel)
+{
+    const float *__restrict d = delta[channel].data();
+    const float *__restrict it = invDt.data();
+    const float *__restrict p = present.data();
+    const float *__restrict n = samples.data();
+    const float *__restrict prev = history[channel][(head + window - 1) % window].data();
+    float *__restrict h = history[channel][head].data();
+    float *__restrict v = out[channel].data();
+
+    // newest row, missing slots repeat their previous sample
+    for ( size_t s = 0; s < size; s++ )
+        h[s] = p[s] > 0.0f ? d[s] * it[s] : prev[s];
+
+    const float full = (float)(window - 1);
+    for ( size_t s = 0; s < size; s++ )
+        v[s] = p[s] > 0.0f && n[s] < full ? h[s] : v[s];
+
+    for ( int k = 0; k < window; k++ ) {
+        const float w = weights[k];
+        const float *__restrict row = history[channel][(head + window - k) % window].data();
+        float *__restrict acc = state[channel].data();
+        if ( k == 0 ) {
+            for ( size_t s = 0; s < size; s++ )
+                acc[s] = w * row[s];
+        }
+        else {
+            for ( size_t s = 0; s < size; s++ )
+                acc[s] += w * row[s];
+        }
+    }
+
+    const float *__restrict acc = state[channel].data();
+    for ( size_t s = 0; s < size; s++ )
+        v[s] = p[s] > 0.0f && n[s] >= full ? acc[s] : v[s];
+}
+
+// Alpha-beta tracker in coordinates relative to the previous measurement:
+// e is the position estimate minus the previous measurement. The first
+// sample takes the raw velocity.
+void
+NatNetVelocityBank::updateAlphaBeta(int channel)
+{
+    const float al = abAlpha, be = abBeta;
+    const float *__restrict d = delta[channel].data();
+    const float *__restrict t = dt.data();
+    const float *__restrict it = invDt.data();
+    const float *__restrict p = present.data();
+    const float *__restrict n = samples.data();
+    float *__restrict v = out[channel].data();
+    float *__restrict e = state[channel].data();
+
+    for ( size_t s = 0; s < size; s++ ) {
+        float residual = d[s] - (e[s] + v[s] * t[s]);
+        float tracked = n[s] > 0.0f ? 1.0f : 0.0f;
+        float vs = tracked > 0.0f ? v[s] + be * residual * it[s] : d[s] * it[s];
+        float es = (al - 1.0f) * residual * tracked;
+        v[s] = p[s] > 0.0f ? vs : v[s];
+        e[s] = p[s] > 0.0f ? es : e[s];
+    }
+}
+
+void
+NatNetVelocityBank::velocity(uint32_t slot, float *linear, float *angular) const
+{
+    for ( int c = 0; c < 3; c++ ) {
+        linear[c] = slot < size ? out[c][slot] : 0.0f;
+        angular[c] = slot < size ? out[c + 3][slot] : 0.0f;
+    }
+}
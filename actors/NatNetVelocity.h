@@ -0,0 +1,94 @@
+//
+// Velocity estimation for rigid bodies from timestamped NatNet frames
+//
+
+#ifndef GAZEBOSC_NATNETVELOCITY_H
+#define GAZEBOSC_NATNETVELOCITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define NATNET_VELOCITY_ONE_EURO        0   // adaptive low pass, smooth at rest, fast when moving
+#define NATNET_VELOCITY_SAVITZKY_GOLAY  1   // quadratic least squares fit, lag is configurable
+#define NATNET_VELOCITY_ALPHA_BETA      2   // constant velocity tracker
+
+#define NATNET_VELOCITY_CHANNELS        6   // linear x y z, angular x y z
+#define NATNET_VELOCITY_MAX_WINDOW      31
+
+// Estimates linear (m/s) and angular (rad/s, world frame) velocities of
+// all rigid bodies of a frame at once. Per frame the poses are added with
+// add() and then update() runs the selected filter over every slot.
+//
+// The filter state is kept per channel in flat arrays indexed by slot, so
+// update() is a handful of branch free loops the compiler can vectorize.
+// Slots that are missing from a frame keep their state.
+class NatNetVelocityBank
+{
+public:
+    NatNetVelocityBank() { computeWeights(); }
+
+    // Select the filter, this resets all slots
+    void setFilter(int filter);
+    int filter() const { return type; }
+
+    // One-Euro: cutoff in Hz at rest and how fast it rises with speed
+    float minCutoff = 1.0f;
+    float beta = 0.05f;
+    float derivativeCutoff = 1.0f;
+
+    // Savitzky-Golay: odd window of frames, lag in frames behind the newest
+    void setWindow(int window, int lag);
+
+    // Alpha-beta gains
+    float abAlpha = 0.5f;
+    float abBeta = 0.1f;
+
+    // A slot restarts when it was missing for longer than this (seconds)
+    float maxGap = 0.5f;
+
+    // Start a frame taken at timestamp (seconds)
+    void begin(double timestamp);
+    // Add the pose of a slot, rotation is a quaternion x y z w
+    void add(uint32_t slot, const float *position, const float *rotation);
+    // Update the velocities of all slots added since begin()
+    void update();
+
+    void velocity(uint32_t slot, float *linear, float *angular) const;
+    void reset();
+
+private:
+    void resize(size_t count);
+    void resetSlot(uint32_t slot);
+    void computeWeights();
+
+    void updateOneEuro(int channel);
+    void updateSavitzkyGolay(int channel);
+    void updateAlphaBeta(int channel);
+
+    int type = NATNET_VELOCITY_ONE_EURO;
+    int window = 5;
+    int lag = 2;
+    float weights[NATNET_VELOCITY_MAX_WINDOW];  // newest sample first
+
+    double now = 0;
+    size_t size = 0;
+    int head = 0;               // newest row of the Savitzky-Golay history
+
+    // per slot
+    std::vector<double> lastTime;
+    std::vector<float> lastPose;                // position xyz, rotation xyzw
+    std::vector<uint8_t> valid;
+    std::vector<float> present;                 // 1 if added in this frame
+    std::vector<float> dt;                      // 0 if not added
+    std::vector<float> invDt;
+    std::vector<float> samples;                 // number of velocity samples, up to the window
+
+    // per channel, per slot
+    std::vector<float> delta[NATNET_VELOCITY_CHANNELS];
+    std::vector<float> out[NATNET_VELOCITY_CHANNELS];
+    std::vector<float> state[NATNET_VELOCITY_CHANNELS];    // one euro derivative, alpha-beta position error
+    std::vector<float> history[NATNET_VELOCITY_CHANNELS][NATNET_VELOCITY_MAX_WINDOW];
+};
+
+#endif //GAZEBOSC_NATNETVELOCITY_H
@@ -25,6 +25,13 @@ const char *OpenVR::capabilities =
         "        value = \"True\"\n"
         "        api_call = \"SET DEVICES\"\n"
         "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"binary\"\n"
+        "        type = \"bool\"\n"
+        "        help = \"Send the compact binary pose stream of PoseStream.h instead of OSC\"\n"
+        "        value = \"False\"\n"
+        "        api_call = \"SET BINARY\"\n"
+        "        api_value = \"s\"\n"
         "outputs\n"
         "    output\n"
         "        type = \"OSC\"\n";
@@ -59,6 +66,12 @@ zmsg_t * OpenVR::handleAPI( sphactor_event_t *ev )
             char * value = zmsg_popstr(ev->msg);
             sendDevices = streq( value, "True");
         }
+        else if  ( streq(cmd, "SET BINARY") ) {
+            char * value = zmsg_popstr(ev->msg);
+            sendBinary = streq( value, "True");
+            describedDevices = 0;
+            zstr_free(&value);
+        }
 
         zstr_free(&cmd);
     }
@@ -73,6 +86,11 @@ zmsg_t* OpenVR::handleTimer(sphactor_event_t* ev)
         zmsg_destroy(&ev->msg);
         zmsg_t* msg = zmsg_new();
 
+        if ( sendBinary ) {
+            addBinary(msg);
+            return msg;
+        }
+
         //parse and build OSC Message
         if ( sendTrackers ) {
             std::vector<Device *> *trackers = devices.getTrackers();
@@ -132,6 +150,38 @@ zmsg_t* OpenVR::handleTimer(sphactor_event_t* ev)
     return Sphactor::handleTimer(ev);
 }
 
+// The connected devices as binary pose stream packets, preceded by their
+// serial numbers when a device was added or a second has passed
+void OpenVR::addBinary(zmsg_t *msg)
+{
+    std::vector<Device *> *all = devices.getDevices();
+    int64_t now = zclock_mono();
+    double timestamp = now / 1000.0;
+
+    if ( all->size() != describedDevices || now - descriptionTime >= 1000 ) {
+        if ( all->size() != describedDevices )
+            descriptionVersion++;
+        poseWriter.begin(msg, POSESTREAM_DESCRIPTION, frameCount, descriptionVersion, timestamp);
+        for (int i = 0; i < all->size(); ++i)
+            poseWriter.addDescription(i, -1, all->at(i)->serialNumber.c_str());
+        poseWriter.end();
+        describedDevices = all->size();
+        descriptionTime = now;
+    }
+
+    poseWriter.begin(msg, POSESTREAM_FRAME, frameCount++, descriptionVersion, timestamp);
+    for (int i = 0; i < all->size(); ++i) {
+        Device *device = all->at(i);
+        if ( !device->bConnected || !(sendDevices || (sendTrackers && device->isGenericTracker())) )
+            continue;
+        float position[3] = { device->position.x, device->position.y, device->position.z };
+        float rotation[4] = { device->quaternion.x, device->quaternion.y, device->quaternion.z, device->quaternion.w };
+        uint32_t flags = POSESTREAM_DEVICE | (uint32_t)device->type << 8 | (device->bTracking ? POSESTREAM_TRACKED : 0);
+        poseWriter.addPose(i, position, rotation, flags);
+    }
+    poseWriter.end();
+}
+
 zmsg_t * OpenVR::handleCustomSocket( sphactor_event_t *ev )
 {
     return nullptr;
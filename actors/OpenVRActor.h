@@ -5,12 +5,23 @@
 #include <string>
 #include "../ext/openvr/headers/openvr.h"
 #include "DeviceList.hpp"
+#include "PoseStreamWriter.h"
 
 class OpenVR : public Sphactor {
 private:
     bool sendTrackers = true;
     bool sendDevices = true;
 
+    // compact binary pose stream instead of OSC, ids are device indices
+    bool sendBinary = false;
+    PoseStreamWriter poseWriter;
+    uint32_t frameCount = 0;
+    uint32_t descriptionVersion = 0;
+    size_t describedDevices = 0;
+    int64_t descriptionTime = 0;
+
+    void addBinary(zmsg_t *msg);
+
     vr::IVRSystem* vrSystem;
     DeviceList devices;
 
@@ -0,0 +1,104 @@
+//
+// Compact binary pose stream, reference decoder
+//
+// This header has no dependencies and can be copied into a client as is.
+//
+// Every UDP packet starts with a PoseStreamHeader followed by `count`
+// fixed size records. All fields are little-endian and naturally aligned,
+// so on little-endian machines (x86, ARM) a record is read with a memcpy,
+// which is what the functions below do. Big-endian clients have to swap
+// the bytes of every field after reading it.
+//
+//     PoseStreamHeader header;
+//     if ( !posestream_header(data, size, &header) )
+//         return;
+//     for ( int i = 0; i < header.count; i++ ) {
+//         PoseStreamPose pose;
+//         posestream_pose(data, i, &pose);
+//         ...
+//     }
+//
+// Frame packets (POSESTREAM_FRAME) carry PoseStreamPose records. A frame
+// bigger than a packet is split over several packets with the same frame
+// number. Description packets (POSESTREAM_DESCRIPTION) carry the names and
+// parents of the ids. They are sent when the descriptions change and
+// every second, a client can match them to the frames by
+// descriptionVersion.
+//
+
+#ifndef GAZEBOSC_POSESTREAM_H
+#define GAZEBOSC_POSESTREAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define POSESTREAM_MAGIC            0x53505a47  // "GZPS"
+#define POSESTREAM_VERSION          1
+
+// packet types
+#define POSESTREAM_FRAME            0
+#define POSESTREAM_DESCRIPTION      1
+
+// pose flags
+#define POSESTREAM_TRACKED          0x01        // pose is valid this frame
+#define POSESTREAM_RIGIDBODY        0x02
+#define POSESTREAM_JOINT            0x04        // id is skeleton id << 16 | joint id
+#define POSESTREAM_MARKER           0x08        // rotation is identity
+#define POSESTREAM_DEVICE           0x10        // OpenVR device, class in bits 8..15
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t count;                 // records in this packet
+    uint32_t frame;
+    uint32_t descriptionVersion;
+    double timestamp;               // seconds
+} PoseStreamHeader;
+
+typedef struct {
+    int32_t id;
+    float position[3];              // meters
+    float rotation[4];              // quaternion x, y, z, w
+    uint32_t flags;
+} PoseStreamPose;
+
+typedef struct {
+    int32_t id;
+    int32_t parent;                 // id of the parent, -1 if none
+    char name[56];                  // zero terminated
+} PoseStreamDescription;
+
+#ifdef __cplusplus
+static_assert(sizeof(PoseStreamHeader) == 24, "PoseStreamHeader must be 24 bytes");
+static_assert(sizeof(PoseStreamPose) == 36, "PoseStreamPose must be 36 bytes");
+static_assert(sizeof(PoseStreamDescription) == 64, "PoseStreamDescription must be 64 bytes");
+#endif
+
+// Read and check the header, returns 0 if the packet is not a valid pose
+// stream packet
+static inline int
+posestream_header(const void *data, size_t size, PoseStreamHeader *header)
+{
+    if ( size < sizeof(PoseStreamHeader) )
+        return 0;
+    memcpy(header, data, sizeof(PoseStreamHeader));
+    if ( header->magic != POSESTREAM_MAGIC || header->version != POSESTREAM_VERSION )
+        return 0;
+    size_t record = header->type == POSESTREAM_DESCRIPTION ? sizeof(PoseStreamDescription) : sizeof(PoseStreamPose);
+    return size >= sizeof(PoseStreamHeader) + header->count * record;
+}
+
+static inline void
+posestream_pose(const void *data, int index, PoseStreamPose *pose)
+{
+    memcpy(pose, (const char *)data + sizeof(PoseStreamHeader) + index * sizeof(PoseStreamPose), sizeof(PoseStreamPose));
+}
+
+static inline void
+posestream_description(const void *data, int index, PoseStreamDescription *description)
+{
+    memcpy(description, (const char *)data + sizeof(PoseStreamHeader) + index * sizeof(PoseStreamDescription), sizeof(PoseStreamDescription));
+}
+
+#endif //GAZEBOSC_POSESTREAM_H
@@ -0,0 +1,117 @@
+//
+// Writes the compact binary pose stream of PoseStream.h
+//
+
+#include "PoseStreamWriter.h"
+#include <algorithm>
+
+// The fields are stored little-endian whatever the byte order of the host
+
+static unsigned char *
+putU16(unsigned char *p, uint16_t v)
+{
+    p[0] = v; p[1] = v >> 8;
+    return p + 2;
+}
+
+static unsigned char *
+putU32(unsigned char *p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    return p + 4;
+}
+
+static unsigned char *
+putFloat(unsigned char *p, float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return putU32(p, v);
+}
+
+static unsigned char *
+putDouble(unsigned char *p, double d)
+{
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    p = putU32(p, (uint32_t)v);
+    return putU32(p, (uint32_t)(v >> 32));
+}
+
+void
+PoseStreamWriter::begin(zmsg_t *zmsg, uint8_t type, uint32_t frame, uint32_t descriptionVersion, double timestamp)
+{
+    out = zmsg;
+    memset(&header, 0, sizeof(header));
+    header.magic = POSESTREAM_MAGIC;
+    header.version = POSESTREAM_VERSION;
+    header.type = type;
+    header.frame = frame;
+    header.descriptionVersion = descriptionVersion;
+    header.timestamp = timestamp;
+    packet.clear();
+}
+
+// Room for a record, the packet is sent first when it doesn't fit
+void *
+PoseStreamWriter::reserve(size_t size)
+{
+    size_t limit = std::max(packetSize, sizeof(PoseStreamHeader) + size);
+    if ( !packet.empty() && (packet.size() + size > limit || header.count == UINT16_MAX) )
+        flush();
+    if ( packet.empty() )
+        packet.resize(sizeof(PoseStreamHeader));
+    packet.resize(packet.size() + size);
+    header.count++;
+    return packet.data() + packet.size() - size;
+}
+
+void
+PoseStreamWriter::addPose(int32_t id, const float *position, const float *rotation, uint32_t flags)
+{
+    unsigned char *p = (unsigned char *)reserve(sizeof(PoseStreamPose));
+    p = putU32(p, (uint32_t)id);
+    for ( int i = 0; i < 3; i++ )
+        p = putFloat(p, position[i]);
+    for ( int i = 0; i < 4; i++ )
+        p = putFloat(p, rotation[i]);
+    putU32(p, flags);
+}
+
+void
+PoseStreamWriter::addDescription(int32_t id, int32_t parent, const char *name)
+{
+    unsigned char *p = (unsigned char *)reserve(sizeof(PoseStreamDescription));
+    p = putU32(p, (uint32_t)id);
+    p = putU32(p, (uint32_t)parent);
+    memset(p, 0, sizeof(PoseStreamDescription::name));
+    strncpy((char *)p, name, sizeof(PoseStreamDescription::name) - 1);
+}
+
+void
+PoseStreamWriter::flush()
+{
+    if ( packet.empty() )
+        return;
+    unsigned char *p = packet.data();
+    p = putU32(p, header.magic);
+    *p++ = header.version;
+    *p++ = header.type;
+    p = putU16(p, header.count);
+    p = putU32(p, header.frame);
+    p = putU32(p, header.descriptionVersion);
+    putDouble(p, header.timestamp);
+    zmsg_addmem(out, packet.data(), packet.size());
+    packet.clear();
+    header.count = 0;
+}
+
+void
+PoseStreamWriter::end()
+{
+    // an empty frame is still sent so clients see the frame
+    if ( packet.empty() )
+        packet.resize(sizeof(PoseStreamHeader));
+    flush();
+    out = nullptr;
+}
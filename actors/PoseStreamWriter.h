@@ -0,0 +1,33 @@
+//
+// Writes the compact binary pose stream of PoseStream.h
+//
+
+#ifndef GAZEBOSC_POSESTREAMWRITER_H
+#define GAZEBOSC_POSESTREAMWRITER_H
+
+#include "libsphactor.h"
+#include "PoseStream.h"
+#include <vector>
+
+// Packs poses or descriptions into packets of at most packetSize bytes,
+// each added to the zmsg as a frame.
+class PoseStreamWriter
+{
+public:
+    size_t packetSize = 1472;
+
+    void begin(zmsg_t *zmsg, uint8_t type, uint32_t frame, uint32_t descriptionVersion, double timestamp);
+    void addPose(int32_t id, const float *position, const float *rotation, uint32_t flags);
+    void addDescription(int32_t id, int32_t parent, const char *name);
+    void end();
+
+private:
+    void *reserve(size_t size);
+    void flush();
+
+    zmsg_t *out = nullptr;
+    PoseStreamHeader header;
+    std::vector<unsigned char> packet;
+};
+
+#endif //GAZEBOSC_POSESTREAMWRITER_H
@@ -45,6 +45,89 @@ const char * Record::capabilities =
         "        api_call = \"SET BLOCKING\"\n"
         "        value = \"False\"\n"
         "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"compress\"\n"
+        "        type = \"bool\"\n"
+        "        help = \"Write a delta encoded and compressed recording\"\n"
+        "        api_call = \"SET COMPRESS\"\n"
+        "        value = \"False\"\n"
+        "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"rotateSeconds\"\n"
+        "        type = \"int\"\n"
+        "        help = \"Start a new segment file every n seconds, 0 writes a single file\"\n"
+        "        value = \"0\"\n"
+        "        min = \"0\"\n"
+        "        max = \"86400\"\n"
+        "        api_call = \"SET ROTATE_SECONDS\"\n"
+        "        api_value = \"i\"\n"
+        "    data\n"
+        "        name = \"rotateSize\"\n"
+        "        type = \"int\"\n"
+        "        help = \"Start a new segment file every n MB, 0 writes a single file\"\n"
+        "        value = \"0\"\n"
+        "        min = \"0\"\n"
+        "        max = \"65536\"\n"
+        "        api_call = \"SET ROTATE_SIZE\"\n"
+        "        api_value = \"i\"\n"
+        "    data\n"
+        "        name = \"session\"\n"
+        "        type = \"string\"\n"
+        "        help = \"Record actors with the same session name record and play back in lockstep\"\n"
+        "        value = \"\"\n"
+        "        api_call = \"SET SESSION\"\n"
+        "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"rate\"\n"
+        "        type = \"float\"\n"
+        "        help = \"Playback rate, 0 pauses playback\"\n"
+        "        value = \"1.0\"\n"
+        "        min = \"0.0\"\n"
+        "        max = \"4.0\"\n"
+        "        api_call = \"SET RATE\"\n"
+        "        api_value = \"f\"\n"
+        "    data\n"
+        "        name = \"seek\"\n"
+        "        type = \"int\"\n"
+        "        help = \"Jump to a position in the recording (milliseconds)\"\n"
+        "        value = \"0\"\n"
+        "        min = \"0\"\n"
+        "        step = \"1000\"\n"
+        "        api_call = \"SEEK\"\n"
+        "        api_value = \"i\"\n"
+        "    data\n"
+        "        name = \"replay\"\n"
+        "        type = \"bool\"\n"
+        "        help = \"Keep the last messages in memory for an instant replay\"\n"
+        "        api_call = \"SET REPLAY\"\n"
+        "        value = \"False\"\n"
+        "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"replaySeconds\"\n"
+        "        type = \"int\"\n"
+        "        help = \"Number of seconds to keep for an instant replay, 0 keeps as much as fits\"\n"
+        "        value = \"30\"\n"
+        "        min = \"0\"\n"
+        "        max = \"3600\"\n"
+        "        api_call = \"SET REPLAY_SECONDS\"\n"
+        "        api_value = \"i\"\n"
+        "    data\n"
+        "        name = \"replaySize\"\n"
+        "        type = \"int\"\n"
+        "        help = \"Memory reserved for an instant replay in MB\"\n"
+        "        value = \"64\"\n"
+        "        min = \"1\"\n"
+        "        max = \"4096\"\n"
+        "        api_call = \"SET REPLAY_SIZE\"\n"
+        "        api_value = \"i\"\n"
+        "    data\n"
+        "        name = \"Replay\"\n"
+        "        type = \"trigger\"\n"
+        "        api_call = \"PLAY_REPLAY\"\n"
+        "    data\n"
+        "        name = \"Save replay\"\n"
+        "        type = \"trigger\"\n"
+        "        api_call = \"DUMP_REPLAY\"\n"
         "inputs\n"
         "    input\n"
         "        type = \"OSC\"\n"
@@ -53,37 +136,307 @@ const char * Record::capabilities =
         "        type = \"OSC\"\n";
 
 
-void Record::handleEOF(sphactor_actor_t* actor) {
-    if ( loop ) {
-        // reset playback values
-        read_offset = 0;
-        startTimeCode = zclock_mono();
+void Record::startRecording(sphactor_actor_t* actor) {
+    if ( writer.isOpen() || playing ) {
+        zsys_info("already recording");
+        return;
+    }
+    if ( fileName == nullptr ) {
+        zsys_info("Invalid output file");
+        return;
+    }
 
-        // calculate timeout for next read
-        zchunk_t * chunk = zfile_read(file, sizeof(time_bytes), read_offset);
-        read_offset += sizeof(time_bytes);
+    // if file does not exist
+    if ( !zfile_exists(fileName) || overwrite ) {
+        if (zfile_exists(fileName)) {
+            // delete the contents of the file
+            zfile_delete(fileName);
+        }
 
-        current_tc = (time_bytes*)zchunk_data(chunk);
-        startRecordTimeCode = current_tc->timeCode;
+        if ( writer.open(resolvePath(fileName).c_str(), compress) ) {
+            zsys_info("file created");
 
-        // handle this first message immediately
-        sphactor_actor_set_timeout(actor, 1);
+            // Build report
+            zosc_t* msg = zosc_create("/report", "ss", "Recording", "...");
+            sphactor_actor_set_custom_report_data(actor, msg);
+        }
+        else{
+            zsys_info("Invalid output file");
+        }
     }
     else {
-        playing = false;
-        zfile_close(file);
-        file = nullptr;
+        zsys_info("File exists. Check overwrite to replace before hitting record.");
+    }
+}
+
+void Record::stopRecording(sphactor_actor_t* actor) {
+    if ( !writer.isOpen() )
+        return;
+
+    zsys_info("closing file");
+    writer.close();
+
+    zosc_t * report = nullptr;
+    if ( writer.isCompressed() ) {
+        // report compression ratio and throughput of the recording
+        char ratio[32], stats[32];
+        snprintf(ratio, sizeof(ratio), "%.2fx", writer.bytesOut ? (double)writer.bytesIn / writer.bytesOut : 0.0);
+        snprintf(stats, sizeof(stats), "%.1f MB/s", writer.encodeUsecs ? (double)writer.bytesIn / writer.encodeUsecs : 0.0);
+        report = zosc_create("/report", "ssss", "Ratio", ratio, "Encode", stats);
+        zsys_info("compressed %llu to %llu bytes", (unsigned long long)writer.bytesIn, (unsigned long long)writer.bytesOut);
+    }
+    if ( writer.segmentCount() > 1 ) {
+        if ( report == nullptr )
+            report = zosc_new("/report");
+        char segments[16];
+        snprintf(segments, sizeof(segments), "%zu", writer.segmentCount());
+        zosc_append(report, "ss", "Segments", segments);
+    }
+    sphactor_actor_set_custom_report_data(actor, report);
+}
+
+bool Record::openPlayback() {
+    if ( fileName == nullptr || !zfile_exists(fileName) || !reader.open(resolvePath(fileName).c_str()) )
+        return false;
+
+    reader.decoder.bytesOut = 0;
+    reader.decoder.decodeUsecs = 0;
+    zframe_destroy(&nextFrame);
+    replaying = false;
+    return true;
+}
+
+zframe_t * Record::readNext(unsigned int *timeCode) {
+    if ( replaying )
+        return replay.next(timeCode);
+    return reader.next(timeCode);
+}
+
+bool Record::startPlayback(sphactor_actor_t* actor) {
+    if ( !openPlayback() ) {
+        zsys_info("Invalid file path/name");
+        return false;
+    }
+
+    // the first message is media time 0
+    nextFrame = reader.next(&nextTimeCode);
+    if ( nextFrame == nullptr ) {
+        reader.close();
+        return false;
+    }
+
+    transport.play(nextTimeCode, zclock_mono());
+    playing = true;
+    schedule(actor);
+    return true;
+}
+
+bool Record::startReplay(sphactor_actor_t* actor) {
+    if ( ring.count() == 0 ) {
+        zsys_info("Nothing to replay");
+        return false;
+    }
+
+    // play from a copy so capturing continues during the replay
+    reader.close();
+    zframe_destroy(&nextFrame);
+    ring.snapshot(replay);
+    replaying = true;
+
+    nextFrame = replay.next(&nextTimeCode);
+    transport.play(nextTimeCode, zclock_mono());
+    playing = true;
+    schedule(actor);
+    return true;
+}
+
+void Record::dumpReplay() {
+    if ( fileName == nullptr ) {
+        zsys_info("Invalid output file");
+        return;
+    }
+    if ( zfile_exists(fileName) && !overwrite ) {
+        zsys_info("File exists. Check overwrite to replace before saving the replay.");
+        return;
+    }
+    if ( writer.isOpen() ) {
+        zsys_info("already recording");
+        return;
+    }
+
+    if ( zfile_exists(fileName) )
+        zfile_delete(fileName);
+    if ( !writer.open(resolvePath(fileName).c_str(), compress) ) {
+        zsys_info("Invalid output file");
+        return;
+    }
+
+    unsigned int timeCode;
+    size_t size;
+    const byte * data;
+    ring.rewind();
+    while ( (data = ring.nextData(&timeCode, &size)) ) {
+        writer.write(timeCode, data, size);
+    }
+    writer.close();
+    zsys_info("saved %zu messages to %s", ring.count(), fileName);
+}
+
+void Record::configureReplay() {
+    if ( replayMode )
+        ring.configure((size_t)replaySize * 1024 * 1024, (unsigned int)replaySeconds * 1000);
+    else {
+        ring.release();
+        replay.release();
+    }
+}
+
+void Record::seekPlayback() {
+    unsigned int target = transport.origin + (unsigned int)transport.anchorMedia;
+
+    // only rewind when seeking backwards
+    if ( nextFrame == nullptr || (int32_t)(target - nextTimeCode) < 0 ) {
+        zframe_destroy(&nextFrame);
+        if ( replaying )
+            replay.rewind();
+        else
+            reader.rewind();
+        nextFrame = readNext(&nextTimeCode);
+    }
+
+    // skip everything before the seek position
+    while ( nextFrame && (int32_t)(nextTimeCode - target) < 0 ) {
+        zframe_destroy(&nextFrame);
+        nextFrame = readNext(&nextTimeCode);
+    }
+}
+
+void Record::stopPlayback(sphactor_actor_t* actor) {
+    playing = false;
+    replaying = false;
+    reader.close();
+    zframe_destroy(&nextFrame);
+    transport.state = RecordTransport::IDLE;
+    sphactor_actor_set_timeout(actor, -1);
+    sphactor_actor_set_custom_report_data(actor, nullptr);
+}
+
+void Record::schedule(sphactor_actor_t* actor) {
+    int64_t timeout = nextFrame ? transport.timeout(nextTimeCode, zclock_mono()) : -1;
+    // handle due messages immediately
+    if ( timeout == 0 )
+        timeout = 1;
+    sphactor_actor_set_timeout(actor, timeout);
+}
+
+void Record::joinSession(sphactor_actor_t* actor, const char* name) {
+    leaveSession(actor);
+    if ( name == nullptr || strlen(name) == 0 )
+        return;
+
+    session = RecordSession::join(name);
+    sessionSub = session->subscribe();
+    if ( sessionSub )
+        sphactor_actor_poller_add(actor, sessionSub);
+    if ( fileName )
+        session->setTrack(this, resolvePath(fileName));
+    zsys_info("Joined session %s", name);
+}
+
+void Record::leaveSession(sphactor_actor_t* actor) {
+    if ( sessionSub ) {
+        sphactor_actor_poller_remove(actor, sessionSub);
+        zsock_destroy(&sessionSub);
+    }
+    if ( session ) {
+        session->removeTrack(this);
+        session.reset();
+    }
+}
+
+void Record::syncSession(sphactor_actor_t* actor) {
+    RecordTransport t = session->transport();
+
+    // the session transport takes over from a local replay
+    if ( replaying )
+        stopPlayback(actor);
+
+    if ( t.state == RecordTransport::RECORDING ) {
+        if ( playing )
+            stopPlayback(actor);
+        if ( !writer.isOpen() )
+            startRecording(actor);
+        return;
+    }
+    stopRecording(actor);
+
+    if ( t.state == RecordTransport::PLAYING ) {
+        bool reposition = !playing || t.seekGeneration != transport.seekGeneration;
+        transport = t;
+        if ( !playing ) {
+            // tracks without a recording just follow along
+            if ( !openPlayback() )
+                return;
+            playing = true;
+        }
+        if ( reposition )
+            seekPlayback();
+        schedule(actor);
+        setReport(actor);
+    }
+    else if ( playing ) {
+        stopPlayback(actor);
+    }
+}
+
+void Record::handleEOF(sphactor_actor_t* actor) {
+    if ( session && !replaying ) {
+        // keep the recording open, the session can still seek back
         sphactor_actor_set_timeout(actor, -1);
+        return;
     }
+
+    if ( loop ) {
+        transport.seek(0, zclock_mono());
+        seekPlayback();
+        if ( nextFrame ) {
+            schedule(actor);
+            return;
+        }
+    }
+
+    stopPlayback(actor);
 }
 
 void Record::setReport(sphactor_actor_t* actor) {
     // Build report
-    std::string time_display;
-    time_display += zsys_sprintf("%i", read_offset);
-    time_display += " / ";
-    time_display += zsys_sprintf("%i", zfile_cursize(file));
-    zosc_t * msg = zosc_create("/report", "ss", "Playing", time_display.c_str());
+    char time_display[64];
+    zosc_t * msg;
+    if ( replaying ) {
+        snprintf(time_display, sizeof(time_display), "%zu messages", replay.count());
+        msg = zosc_create("/report", "ss", "Replaying", time_display);
+    }
+    else {
+        if ( reader.segmentCount() > 1 )
+            snprintf(time_display, sizeof(time_display), "%zu / %zu (%zu/%zu)", reader.offset(), reader.size(),
+                     reader.segmentIndex() + 1, reader.segmentCount());
+        else
+            snprintf(time_display, sizeof(time_display), "%zu / %zu", reader.offset(), reader.size());
+        msg = zosc_create("/report", "ss", "Playing", time_display);
+    }
+
+    char position[32];
+    snprintf(position, sizeof(position), "%.1f s (x%.2f)", transport.mediaTime(zclock_mono()) / 1000.0, transport.rate);
+    zosc_append(msg, "ss", "Position", position);
+    if ( session )
+        zosc_append(msg, "ss", "Session", session->getName().c_str());
+
+    if ( !replaying && reader.isCompressed() ) {
+        const RecordDecoder &dec = reader.decoder;
+        char stats[32];
+        snprintf(stats, sizeof(stats), "%.1f MB/s", dec.decodeUsecs ? (double)dec.bytesOut / dec.decodeUsecs : 0.0);
+        zosc_append(msg, "ss", "Decode", stats);
+    }
 
     sphactor_actor_set_custom_report_data(actor, msg);
 }
@@ -91,165 +444,135 @@ void Record::setReport(sphactor_actor_t* actor) {
 zmsg_t *
 Record::handleTimer(sphactor_event_t *ev ) {
     zmsg_destroy(&ev->msg);
+    sphactor_actor_t * actor = (sphactor_actor_t*)ev->actor;
 
-    // Read data from current message
-    zchunk_t * dataChunk = zfile_read(file, current_tc->bytes, read_offset);
-    read_offset += current_tc->bytes + 1; // one byte for endline character
-
-    // Create return message, add data (we assume it's there)
-    zmsg_t * retMsg = zmsg_new();
-    zframe_t * frame = zchunk_packx(&dataChunk);
-    zmsg_append( retMsg, &frame);
-
-    // Read next timeCode chunk
-    zchunk_t * chunk = zfile_read(file, sizeof(time_bytes), read_offset);
-    read_offset += sizeof(time_bytes);
+    if ( !playing || nextFrame == nullptr )
+        return nullptr;
 
-    if ( chunk == nullptr || zfile_eof(file) ) {
-        handleEOF((sphactor_actor_t*)ev->actor);
-        sphactor_actor_set_custom_report_data((sphactor_actor_t*)ev->actor, nullptr);
-        return retMsg;
+    // Append all messages which are due
+    zmsg_t * retMsg = nullptr;
+    int64_t now = zclock_mono();
+    while ( nextFrame && transport.timeout(nextTimeCode, now) == 0 ) {
+        if ( retMsg == nullptr )
+            retMsg = zmsg_new();
+        zmsg_append( retMsg, &nextFrame );
+        nextFrame = readNext(&nextTimeCode);
     }
-    else {
-        current_tc = (time_bytes*)zchunk_data(chunk);
-
-        //calculate next timeout
-        unsigned int cur_delta = zclock_mono() - startTimeCode;
-        int next_timeout = ( current_tc->timeCode - startRecordTimeCode ) - cur_delta;
-        while( next_timeout <= 0 ) {
-            // read bytes from current message
-            zchunk_t * dataChunk = zfile_read(file, current_tc->bytes, read_offset);
-            read_offset += current_tc->bytes + 1; //one byte for endline char
-
-            // append to msg as frame
-            zframe_t * frame = zchunk_packx(&dataChunk);
-            zmsg_append( retMsg, &frame);
-
-            // read next timeCode chunk
-            zchunk_t * chunk = zfile_read(file, sizeof(time_bytes), read_offset);
-            read_offset += sizeof(time_bytes);
-
-            if ( chunk == nullptr || zfile_eof(file) ) {
-                handleEOF((sphactor_actor_t*)ev->actor);
-                sphactor_actor_set_custom_report_data((sphactor_actor_t*)ev->actor, nullptr);
-                return retMsg;
-            }
-            else
-            {
-                current_tc = (time_bytes*)zchunk_data(chunk);
 
-                //calculate next timeout
-                cur_delta = zclock_mono() - startTimeCode;
-                next_timeout = ( current_tc->timeCode - startRecordTimeCode ) - cur_delta;
-            }
-        }
-        sphactor_actor_set_timeout((sphactor_actor_t*)ev->actor, next_timeout);
-        setReport((sphactor_actor_t*)ev->actor);
+    if ( nextFrame == nullptr ) {
+        handleEOF(actor);
         return retMsg;
     }
 
-    return nullptr;
+    schedule(actor);
+    setReport(actor);
+    return retMsg;
 }
 
 zmsg_t *
 Record::handleAPI(sphactor_event_t *ev )
 {
+    sphactor_actor_t * actor = (sphactor_actor_t*)ev->actor;
+
     //pop msg for command
     char * cmd = zmsg_popstr(ev->msg);
     if (cmd) {
         if ( streq(cmd, "START_RECORD") ) {
-            // if file does not exist
-            if ( file == nullptr ) {
-                if ( !zfile_exists(fileName) || overwrite ) {
-                    if (zfile_exists(fileName)) {
-                        // delete the contents of the file
-                        zfile_delete(fileName);
-                    }
-
-                    //TODO: Check if fileName is relative path or not
-                    if (isAbsolutePath(fileName)) {
-                        file = zfile_new(NULL, fileName);
-                    }
-                    else {
-                        char path[PATH_MAX];
-                        getcwd(path, PATH_MAX);
-                        file = zfile_new(path, fileName);
-                    }
-                    int rc = zfile_output(file);
-                    if (rc == 0) {
-                        write_offset = 0;
-                        zsys_info("file created");
-
-                        // Build report
-                        zosc_t* msg = zosc_create("/report", "ss", "Recording", "...");
-                        sphactor_actor_set_custom_report_data((sphactor_actor_t*)ev->actor, msg);
-                    }
-                    else{
-                        file = nullptr;
-                        zsys_info("Invalid output file");
-                    }
-                }
-                else {
-                    zsys_info("File exists. Check overwrite to replace before hitting record.");
-                }
-            }
-            else {
-                zsys_info("already recording");
-            }
+            if ( session )
+                session->record();
+            else
+                startRecording(actor);
         }
         else if ( streq(cmd, "STOP_RECORD") ) {
-            if ( file ) {
-                zsys_info("closing file");
-                zfile_close(file);
-
-                sphactor_actor_set_timeout((sphactor_actor_t*)ev->actor, -1);
-                sphactor_actor_set_custom_report_data((sphactor_actor_t*)ev->actor, nullptr);
-
-                file = nullptr;
-                playing = false;
+            if ( session )
+                session->stop();
+            else {
+                stopRecording(actor);
+                if ( playing )
+                    stopPlayback(actor);
+                else
+                    sphactor_actor_set_timeout(actor, -1);
             }
         }
         else if ( streq(cmd, "PLAY_RECORDING") ) {
-            if ( file == nullptr && !playing ) {
-                if ( zfile_exists(fileName) ) {
-                    if (isAbsolutePath(fileName)) {
-                        file = zfile_new(NULL, fileName);
-                    }
-                    else {
-                        char path[PATH_MAX];
-                        getcwd(path, PATH_MAX);
-                        file = zfile_new(path, fileName);
-                    }
-                    zfile_input(file);
-                    playing = true;
-                    startTimeCode = zclock_mono();
-                    read_offset = 0;
-
-                    // read the next message and store its future timecode
-                    zchunk_t * chunk = zfile_read(file, sizeof(time_bytes), read_offset);
-                    read_offset += sizeof(time_bytes);
-
-                    if ( chunk == nullptr || zfile_eof(file) ) {
-                        playing = false;
-                        zfile_close(file);
-                        file = nullptr;
-                    }
-                    else {
-                        // calculate timeout for next read
-                        current_tc = (time_bytes*)zchunk_data(chunk);
-                        startRecordTimeCode = current_tc->timeCode;
-
-                        sphactor_actor_set_timeout((sphactor_actor_t*)ev->actor, 1);
-                    }
-                }
-                else {
-                    zsys_info("Invalid file path/name");
-                }
+            if ( session )
+                session->play();
+            else if ( !writer.isOpen() && !playing )
+                startPlayback(actor);
+        }
+        else if ( streq(cmd, "PLAY_REPLAY") ) {
+            if ( !writer.isOpen() )
+                startReplay(actor);
+        }
+        else if ( streq(cmd, "DUMP_REPLAY") ) {
+            dumpReplay();
+        }
+        else if ( streq(cmd, "SET REPLAY") ) {
+            char * value = zmsg_popstr(ev->msg);
+            replayMode = value && streq(value, "True");
+            configureReplay();
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET REPLAY_SECONDS") ) {
+            char * value = zmsg_popstr(ev->msg);
+            replaySeconds = value ? atoi(value) : 0;
+            ring.setDuration((unsigned int)replaySeconds * 1000);
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET REPLAY_SIZE") ) {
+            char * value = zmsg_popstr(ev->msg);
+            replaySize = value ? atoi(value) : 0;
+            if ( replaySize < 1 )
+                replaySize = 1;
+            // reallocating drops what was captured so far
+            configureReplay();
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SEEK") ) {
+            char * value = zmsg_popstr(ev->msg);
+            int64_t media = value ? atoll(value) : 0;
+            if ( session )
+                session->seek(media);
+            else if ( playing ) {
+                transport.seek(media, zclock_mono());
+                seekPlayback();
+                schedule(actor);
             }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET RATE") ) {
+            char * value = zmsg_popstr(ev->msg);
+            double rate = value ? atof(value) : 1.0;
+            if ( session )
+                session->setRate(rate);
+            else {
+                transport.setRate(rate, zclock_mono());
+                if ( playing )
+                    schedule(actor);
+            }
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET ROTATE_SECONDS") || streq(cmd, "SET ROTATE_SIZE") ) {
+            char * value = zmsg_popstr(ev->msg);
+            int n = value ? atoi(value) : 0;
+            if ( streq(cmd, "SET ROTATE_SECONDS") )
+                rotateSeconds = n < 0 ? 0 : n;
+            else
+                rotateSize = n < 0 ? 0 : n;
+            // applies to the next recording
+            writer.setRotation((unsigned int)rotateSeconds * 1000, (size_t)rotateSize * 1024 * 1024);
+            zstr_free(&value);
+        }
+        else if ( streq(cmd, "SET SESSION") ) {
+            char * name = zmsg_popstr(ev->msg);
+            joinSession(actor, name);
+            zstr_free(&name);
         }
         else if ( streq(cmd, "SET FILE") ) {
             fileName = zmsg_popstr(ev->msg);
             zsys_info("GOT FILE: %s", fileName);
+            if ( session && fileName )
+                session->setTrack(this, resolvePath(fileName));
         }
         else if ( streq(cmd, "SET LOOPING") ) {
             loop = streq( zmsg_popstr(ev->msg), "True" );
@@ -260,6 +583,12 @@ Record::handleAPI(sphactor_event_t *ev )
         else if ( streq(cmd, "SET OVERWRITE") ) {
             overwrite = streq( zmsg_popstr(ev->msg), "True" );
         }
+        else if ( streq(cmd, "SET COMPRESS") ) {
+            char * value = zmsg_popstr(ev->msg);
+            compress = value && streq(value, "True");
+            zstr_free(&value);
+        }
+        zstr_free(&cmd);
     }
 
     zmsg_destroy(&ev->msg);
@@ -267,48 +596,63 @@ Record::handleAPI(sphactor_event_t *ev )
 }
 
 zmsg_t *
-Record::handleSocket(sphactor_event_t *ev )
+Record::handleCustomSocket(sphactor_event_t *ev )
 {
-    if ( file && !playing ) {
-        zframe_t * frame = zmsg_pop(ev->msg);
-        const char * retChar = "\n";
-
-        zmsg_t * passthrough = zmsg_new();
-
+    assert(ev->msg);
+    zframe_t *frame = zmsg_pop(ev->msg);
+    if (zframe_size(frame) == sizeof( void *) )
+    {
+        void *p = *(void **)zframe_data(frame);
+        if ( zsock_is( p ) && p == sessionSub )
+        {
+            // drain the notifications, we only need the latest transport
+            do {
+                char * notification = zstr_recv(sessionSub);
+                zstr_free(&notification);
+            } while ( zsock_events(sessionSub) & ZMQ_POLLIN );
+
+            syncSession((sphactor_actor_t*)ev->actor);
+        }
+    }
+    zframe_destroy(&frame);
+    zmsg_destroy(&ev->msg);
+    return nullptr;
+}
 
-        zchunk_t *endLineChunk = zchunk_new(retChar, 1);
+zmsg_t *
+Record::handleStop(sphactor_event_t *ev )
+{
+    sphactor_actor_t * actor = (sphactor_actor_t*)ev->actor;
+    leaveSession(actor);
+    writer.close();
+    reader.close();
+    zframe_destroy(&nextFrame);
+    playing = false;
+
+    return Sphactor::handleStop(ev);
+}
 
+zmsg_t *
+Record::handleSocket(sphactor_event_t *ev )
+{
+    if ( replayMode ) {
+        unsigned int timeCode = zclock_mono();
+        zframe_t * frame = zmsg_first(ev->msg);
         while ( frame ) {
-            zchunk_t *chunk = zchunk_new(zframe_data(frame), zframe_size(frame));
-
-            time_bytes * tc = new time_bytes();
-            tc->timeCode = zclock_mono();
-            tc->bytes = zchunk_size(chunk);
-            zchunk_t *headerChunk = zchunk_new(tc, sizeof(time_bytes));
-
-            int rc = zfile_write(file, headerChunk, write_offset);
-            write_offset += zchunk_size(headerChunk);
-            rc = zfile_write(file, chunk, write_offset);
-            write_offset += zchunk_size(chunk);
-            rc = zfile_write(file, endLineChunk, write_offset);
-            write_offset += zchunk_size(endLineChunk);
-
-            if ( rc != 0 ) {
-                zsys_info("error writing");
-            }
-
-            free(tc);
-            zchunk_destroy(&chunk);
-            zchunk_destroy(&headerChunk);
-
-            zmsg_append( passthrough, &frame );
-
-            frame = zmsg_pop(ev->msg);
+            ring.append(timeCode, zframe_data(frame), zframe_size(frame));
+            frame = zmsg_next(ev->msg);
         }
+    }
 
-        zchunk_destroy(&endLineChunk);
+    if ( writer.isOpen() && !playing ) {
+        unsigned int timeCode = zclock_mono();
+        zframe_t * frame = zmsg_first(ev->msg);
+        while ( frame ) {
+            writer.write(timeCode, zframe_data(frame), zframe_size(frame));
+            frame = zmsg_next(ev->msg);
+        }
 
-        return passthrough;
+        return ev->msg;
     }
 
     // Passthrough if no file
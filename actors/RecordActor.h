@@ -6,13 +6,12 @@
 #define GAZEBOSC_RECORDACTOR_H
 
 #include "libsphactor.hpp"
+#include "RecordCodec.h"
+#include "RecordSegments.h"
+#include "RecordSession.h"
+#include "RecordRing.h"
 #include <string>
-
-struct time_bytes {
-public:
-    unsigned int timeCode;
-    unsigned int bytes;
-};
+#include <memory>
 
 class Record : public Sphactor {
 private:
@@ -21,24 +20,38 @@ public:
     static const char *capabilities;
 
     // State variables
-    zfile_t * file = nullptr;
+    RecordReader reader;
+    RecordSegmentWriter writer;
     bool playing = false;
-    unsigned int startTimeCode = 0;
-    unsigned int startRecordTimeCode = 0;
-    unsigned int read_offset = 0;
-    unsigned int write_offset = 0;
-    time_bytes * current_tc = nullptr;
+    RecordTransport transport;
+    unsigned int nextTimeCode = 0;
+    zframe_t * nextFrame = nullptr;
+    std::shared_ptr<RecordSession> session;
+    zsock_t * sessionSub = nullptr;
+    RecordRing ring;
+    RecordRing replay;
+    bool replaying = false;
 
     // Controls
     const char* fileName = nullptr;
     bool loop = false;
     bool blockDuringPlay = false;
     bool overwrite = false;
+    bool compress = false;
+    bool replayMode = false;
+    int replaySeconds = 30;
+    int replaySize = 64;
+    int rotateSeconds = 0;
+    int rotateSize = 0;
 
     Record() : Sphactor() {
 
     }
 
+    ~Record() {
+        zframe_destroy(&nextFrame);
+    }
+
     bool isAbsolutePath(const char* path) {
 #if WIN32
         return (path[1] == ':' && ( path[2] == '\\' || path[2] == '/' ));
@@ -47,14 +60,36 @@ public:
 #endif
     }
 
+    std::string resolvePath(const char* path) {
+        if ( isAbsolutePath(path) )
+            return path;
+        char cwd[PATH_MAX];
+        getcwd(cwd, PATH_MAX);
+        return std::string(cwd) + "/" + path;
+    }
+
+    void startRecording( sphactor_actor_t * actor );
+    void stopRecording( sphactor_actor_t * actor );
+    bool openPlayback();
+    bool startPlayback( sphactor_actor_t * actor );
+    bool startReplay( sphactor_actor_t * actor );
+    void dumpReplay();
+    void configureReplay();
+    zframe_t * readNext( unsigned int *timeCode );
+    void seekPlayback();
+    void stopPlayback( sphactor_actor_t * actor );
+    void schedule( sphactor_actor_t * actor );
+    void joinSession( sphactor_actor_t * actor, const char * name );
+    void leaveSession( sphactor_actor_t * actor );
+    void syncSession( sphactor_actor_t * actor );
     void handleEOF( sphactor_actor_t * actor );
     void setReport( sphactor_actor_t * actor );
 
     zmsg_t * handleTimer( sphactor_event_t *ev );
     zmsg_t * handleSocket( sphactor_event_t *ev );
     zmsg_t * handleAPI( sphactor_event_t *ev );
-
-    // Or perhaps a fixed buffer, that writes when something is bigger than it can store?
+    zmsg_t * handleCustomSocket( sphactor_event_t *ev );
+    zmsg_t * handleStop( sphactor_event_t *ev );
 };
 
 #endif //GAZEBOSC_RECORDACTOR_H
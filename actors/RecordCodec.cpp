@@ -0,0 +1,929 @@
+//
+// Compressed recording format for the Record actor
+//
+
+#include "RecordCodec.h"
+
+#define RECORD_LZ_HASHLOG   12
+#define RECORD_LZ_MINMATCH  4
+
+static inline uint32_t
+s_read32(const byte *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t
+s_be32(const byte *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline uint64_t
+s_be64(const byte *p)
+{
+    return (uint64_t)s_be32(p) << 32 | (uint64_t)s_be32(p + 4);
+}
+
+static inline uint32_t
+s_le32(const byte *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void
+s_put_le32(std::vector<byte> &out, uint32_t v)
+{
+    out.push_back((byte)v);
+    out.push_back((byte)(v >> 8));
+    out.push_back((byte)(v >> 16));
+    out.push_back((byte)(v >> 24));
+}
+
+static inline void
+s_put_be32(std::vector<byte> &out, uint32_t v)
+{
+    out.push_back((byte)(v >> 24));
+    out.push_back((byte)(v >> 16));
+    out.push_back((byte)(v >> 8));
+    out.push_back((byte)v);
+}
+
+static inline void
+s_put_be64(std::vector<byte> &out, uint64_t v)
+{
+    s_put_be32(out, (uint32_t)(v >> 32));
+    s_put_be32(out, (uint32_t)v);
+}
+
+static inline void
+s_put_varint(std::vector<byte> &out, uint64_t v)
+{
+    while ( v >= 0x80 ) {
+        out.push_back((byte)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((byte)v);
+}
+
+static inline bool
+s_get_varint(const std::vector<byte> &in, size_t &pos, uint64_t *v)
+{
+    uint64_t result = 0;
+    int shift = 0;
+    while ( pos < in.size() && shift < 64 ) {
+        byte b = in[pos++];
+        result |= (uint64_t)(b & 0x7f) << shift;
+        if ( !(b & 0x80) ) {
+            *v = result;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+static inline uint64_t
+s_zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t
+s_unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Size of an OSC argument: 4 or 8 for fixed size numbers, 0 for arguments
+// without data, -1 for strings, -2 for blobs and -3 for unsupported types
+static inline int
+s_osc_argsize(char type)
+{
+    switch (type) {
+        case 'i': case 'f': case 'c': case 'r': case 'm':
+            return 4;
+        case 'h': case 'd': case 't':
+            return 8;
+        case 'T': case 'F': case 'N': case 'I': case '[': case ']':
+            return 0;
+        case 's': case 'S':
+            return -1;
+        case 'b':
+            return -2;
+        default:
+            return -3;
+    }
+}
+
+// Check whether data is a plain OSC message we can encode and find the
+// offsets of its typetag and arguments
+static bool
+s_osc_parse(const byte *data, size_t size, size_t *addrLen, size_t *tagOffset, size_t *tagLen, size_t *argOffset)
+{
+    if ( size < 8 || data[0] != '/' )
+        return false;
+
+    const byte *end = (const byte *)memchr(data, 0, size);
+    if ( end == nullptr )
+        return false;
+    *addrLen = end - data;
+    *tagOffset = (*addrLen + 4) & ~(size_t)3;
+    if ( *tagOffset >= size || data[*tagOffset] != ',' )
+        return false;
+
+    end = (const byte *)memchr(data + *tagOffset, 0, size - *tagOffset);
+    if ( end == nullptr )
+        return false;
+    *tagLen = end - (data + *tagOffset);  // including the ','
+    *argOffset = *tagOffset + ((*tagLen + 4) & ~(size_t)3);
+    if ( *argOffset > size )
+        return false;
+
+    size_t offset = *argOffset;
+    for ( size_t i = 1; i < *tagLen; i++ ) {
+        int argsize = s_osc_argsize(data[*tagOffset + i]);
+        if ( argsize > 0 ) {
+            if ( offset + argsize > size )
+                return false;
+            offset += argsize;
+        }
+        else if ( argsize == -1 ) {
+            end = (const byte *)memchr(data + offset, 0, size - offset);
+            if ( end == nullptr )
+                return false;
+            offset += ((end - (data + offset)) + 4) & ~(size_t)3;
+            if ( offset > size )
+                return false;
+        }
+        else if ( argsize == -2 ) {
+            if ( offset + 4 > size )
+                return false;
+            size_t padded = ((size_t)s_be32(data + offset) + 3) & ~(size_t)3;
+            offset += 4;
+            if ( padded > size - offset )
+                return false;
+            offset += padded;
+        }
+        else if ( argsize == -3 ) {
+            return false;
+        }
+    }
+    return offset == size;
+}
+
+static inline byte *
+s_lz_put_length(byte *op, size_t len)
+{
+    while ( len >= 255 ) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (byte)len;
+    return op;
+}
+
+static inline bool
+s_lz_get_length(const byte *&ip, const byte *iend, size_t *len)
+{
+    byte b;
+    do {
+        if ( ip >= iend )
+            return false;
+        b = *ip++;
+        *len += b;
+    } while ( b == 255 );
+    return true;
+}
+
+size_t
+record_lz_bound(size_t srcSize)
+{
+    return srcSize + srcSize / 255 + 16;
+}
+
+void
+record_read_block_header(const byte *data, uint32_t *rawSize, uint32_t *compSize)
+{
+    *rawSize = s_le32(data);
+    *compSize = s_le32(data + 4);
+}
+
+size_t
+record_lz_compress(const byte *src, size_t srcSize, byte *dst, size_t dstCapacity)
+{
+    uint32_t table[1 << RECORD_LZ_HASHLOG];
+    memset(table, 0, sizeof(table));
+
+    const byte *ip = src;
+    const byte *anchor = src;
+    const byte *end = src + srcSize;
+    byte *op = dst;
+    byte *oend = dst + dstCapacity;
+
+    if ( srcSize > 12 ) {
+        const byte *mflimit = end - 12;     // a match needs to start before this
+        const byte *matchlimit = end - 5;   // the last 5 bytes are always literals
+        while ( ip < mflimit ) {
+            uint32_t seq = s_read32(ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - RECORD_LZ_HASHLOG);
+            const byte *ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if ( ref >= ip || ip - ref > 65535 || s_read32(ref) != seq ) {
+                ip++;
+                continue;
+            }
+
+            const byte *mp = ip + RECORD_LZ_MINMATCH;
+            const byte *rp = ref + RECORD_LZ_MINMATCH;
+            while ( mp < matchlimit && *mp == *rp ) {
+                mp++;
+                rp++;
+            }
+
+            size_t litLen = ip - anchor;
+            size_t matchLen = mp - ip - RECORD_LZ_MINMATCH;
+            if ( op + litLen + litLen / 255 + matchLen / 255 + 5 > oend )
+                return 0;
+
+            byte *token = op++;
+            *token = (byte)((litLen >= 15 ? 15 : litLen) << 4);
+            if ( litLen >= 15 )
+                op = s_lz_put_length(op, litLen - 15);
+            memcpy(op, anchor, litLen);
+            op += litLen;
+
+            size_t offset = ip - ref;
+            *op++ = (byte)offset;
+            *op++ = (byte)(offset >> 8);
+
+            *token |= (byte)(matchLen >= 15 ? 15 : matchLen);
+            if ( matchLen >= 15 )
+                op = s_lz_put_length(op, matchLen - 15);
+
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    // last literals
+    size_t litLen = end - anchor;
+    if ( op + litLen + litLen / 255 + 2 > oend )
+        return 0;
+    *op++ = (byte)((litLen >= 15 ? 15 : litLen) << 4);
+    if ( litLen >= 15 )
+        op = s_lz_put_length(op, litLen - 15);
+    memcpy(op, anchor, litLen);
+    op += litLen;
+
+    return op - dst;
+}
+
+int
+record_lz_decompress(const byte *src, size_t srcSize, byte *dst, size_t dstSize)
+{
+    const byte *ip = src;
+    const byte *iend = src + srcSize;
+    byte *op = dst;
+    byte *oend = dst + dstSize;
+
+    while ( ip < iend ) {
+        unsigned int token = *ip++;
+
+        size_t litLen = token >> 4;
+        if ( litLen == 15 && !s_lz_get_length(ip, iend, &litLen) )
+            return -1;
+        if ( litLen > (size_t)(iend - ip) || litLen > (size_t)(oend - op) )
+            return -1;
+        memcpy(op, ip, litLen);
+        op += litLen;
+        ip += litLen;
+
+        // the last sequence has no match
+        if ( ip == iend )
+            break;
+
+        if ( iend - ip < 2 )
+            return -1;
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if ( offset == 0 || offset > (size_t)(op - dst) )
+            return -1;
+
+        size_t matchLen = token & 15;
+        if ( matchLen == 15 && !s_lz_get_length(ip, iend, &matchLen) )
+            return -1;
+        matchLen += RECORD_LZ_MINMATCH;
+        if ( matchLen > (size_t)(oend - op) )
+            return -1;
+
+        const byte *match = op - offset;
+        if ( offset >= matchLen ) {
+            memcpy(op, match, matchLen);
+            op += matchLen;
+        }
+        else {
+            // overlapping copy
+            while ( matchLen-- )
+                *op++ = *match++;
+        }
+    }
+
+    return op == oend ? 0 : -1;
+}
+
+RecordEncoder::RecordEncoder()
+{
+    raw.reserve(RECORD_CODEC_BLOCK_SIZE + 1024);
+}
+
+void
+RecordEncoder::reset()
+{
+    raw.clear();
+    addresses.clear();
+    typetags.clear();
+    streams.clear();
+    lastTimeCode = 0;
+}
+
+void
+RecordEncoder::append(unsigned int timeCode, const byte *data, size_t size)
+{
+    int64_t start = zclock_usecs();
+    bytesIn += size;
+
+    // the first timecode in a block is absolute as lastTimeCode is reset to 0
+    s_put_varint(raw, (uint32_t)(timeCode - lastTimeCode));
+    lastTimeCode = timeCode;
+
+    size_t addrLen, tagOffset, tagLen, argOffset;
+    if ( !s_osc_parse(data, size, &addrLen, &tagOffset, &tagLen, &argOffset) ) {
+        // not an OSC message we understand, store it as is
+        s_put_varint(raw, 0);
+        s_put_varint(raw, size);
+        raw.insert(raw.end(), data, data + size);
+        encodeUsecs += zclock_usecs() - start;
+        return;
+    }
+
+    // address dictionary, 0 is reserved for raw messages
+    int addrId;
+    key.assign((const char *)data, addrLen);
+    auto ait = addresses.find(key);
+    if ( ait == addresses.end() ) {
+        addrId = (int)addresses.size();
+        addresses.emplace(key, addrId);
+        streams.emplace_back();
+        s_put_varint(raw, addrId + 1);
+        s_put_varint(raw, addrLen);
+        raw.insert(raw.end(), data, data + addrLen);
+    }
+    else {
+        addrId = ait->second;
+        s_put_varint(raw, addrId + 1);
+    }
+
+    // typetag dictionary, without the leading ','
+    const byte *tags = data + tagOffset + 1;
+    size_t nTags = tagLen - 1;
+    int typeId;
+    key.assign((const char *)tags, nTags);
+    auto tit = typetags.find(key);
+    if ( tit == typetags.end() ) {
+        typeId = (int)typetags.size();
+        typetags.emplace(key, typeId);
+        s_put_varint(raw, typeId);
+        s_put_varint(raw, nTags);
+        raw.insert(raw.end(), tags, tags + nTags);
+    }
+    else {
+        typeId = tit->second;
+        s_put_varint(raw, typeId);
+    }
+
+    // numbers are delta encoded against the previous message on this address
+    RecordStream &stream = streams[addrId];
+    if ( stream.typeId != typeId ) {
+        stream.typeId = typeId;
+        stream.args.assign(nTags, 0);
+    }
+
+    const byte *arg = data + argOffset;
+    for ( size_t i = 0; i < nTags; i++ ) {
+        int argsize = s_osc_argsize(tags[i]);
+        if ( argsize == 4 ) {
+            uint32_t v = s_be32(arg);
+            s_put_varint(raw, s_zigzag((int32_t)(v - (uint32_t)stream.args[i])));
+            stream.args[i] = v;
+            arg += 4;
+        }
+        else if ( argsize == 8 ) {
+            uint64_t v = s_be64(arg);
+            s_put_varint(raw, s_zigzag((int64_t)(v - stream.args[i])));
+            stream.args[i] = v;
+            arg += 8;
+        }
+        else if ( argsize == -1 ) {
+            size_t len = strlen((const char *)arg);
+            raw.insert(raw.end(), arg, arg + len + 1);
+            arg += (len + 4) & ~(size_t)3;
+        }
+        else if ( argsize == -2 ) {
+            uint32_t len = s_be32(arg);
+            arg += 4;
+            s_put_varint(raw, len);
+            raw.insert(raw.end(), arg, arg + len);
+            arg += (len + 3) & ~(size_t)3;
+        }
+    }
+
+    encodeUsecs += zclock_usecs() - start;
+}
+
+void
+RecordEncoder::flush(std::vector<byte> &out)
+{
+    if ( raw.empty() )
+        return;
+
+    int64_t start = zclock_usecs();
+    comp.resize(record_lz_bound(raw.size()));
+    size_t compSize = record_lz_compress(raw.data(), raw.size(), comp.data(), comp.size());
+
+    const byte *payload = comp.data();
+    uint32_t compField = (uint32_t)compSize;
+    if ( compSize == 0 || compSize >= raw.size() ) {
+        // incompressible, store the block as is
+        payload = raw.data();
+        compSize = raw.size();
+        compField = (uint32_t)compSize | RECORD_CODEC_STORED;
+    }
+
+    s_put_le32(out, (uint32_t)raw.size());
+    s_put_le32(out, compField);
+    out.insert(out.end(), payload, payload + compSize);
+    bytesOut += RECORD_CODEC_BLOCK_HEADER + compSize;
+
+    reset();
+    encodeUsecs += zclock_usecs() - start;
+}
+
+bool
+RecordDecoder::load(const byte *data, uint32_t rawSize, uint32_t compSize)
+{
+    int64_t start = zclock_usecs();
+    addresses.clear();
+    typetags.clear();
+    streams.clear();
+    lastTimeCode = 0;
+    pos = 0;
+
+    size_t dataSize = compSize & ~RECORD_CODEC_STORED;
+    if ( rawSize > RECORD_CODEC_MAX_BLOCK || dataSize > record_lz_bound(rawSize) ) {
+        raw.clear();
+        return false;
+    }
+    raw.resize(rawSize);
+    int rc = 0;
+    if ( compSize & RECORD_CODEC_STORED ) {
+        if ( (compSize & ~RECORD_CODEC_STORED) != rawSize )
+            rc = -1;
+        else if ( rawSize )
+            memcpy(raw.data(), data, rawSize);
+    }
+    else
+        rc = record_lz_decompress(data, compSize, raw.data(), rawSize);
+
+    decodeUsecs += zclock_usecs() - start;
+    if ( rc != 0 ) {
+        raw.clear();
+        return false;
+    }
+    return true;
+}
+
+bool
+RecordDecoder::next(unsigned int *timeCode, std::vector<byte> &out)
+{
+    if ( pos >= raw.size() )
+        return false;
+
+    int64_t start = zclock_usecs();
+    uint64_t delta, addrRef, typeRef, len;
+    if ( !s_get_varint(raw, pos, &delta) || !s_get_varint(raw, pos, &addrRef) )
+        goto corrupt;
+    lastTimeCode += (unsigned int)delta;
+    *timeCode = lastTimeCode;
+    out.clear();
+
+    if ( addrRef == 0 ) {
+        // raw message
+        if ( !s_get_varint(raw, pos, &len) || len > raw.size() - pos )
+            goto corrupt;
+        out.insert(out.end(), raw.data() + pos, raw.data() + pos + len);
+        pos += len;
+    }
+    else {
+        size_t addrId = addrRef - 1;
+        if ( addrId == addresses.size() ) {
+            if ( !s_get_varint(raw, pos, &len) || len > raw.size() - pos )
+                goto corrupt;
+            addresses.emplace_back((const char *)raw.data() + pos, len);
+            streams.emplace_back();
+            pos += len;
+        }
+        else if ( addrId > addresses.size() )
+            goto corrupt;
+
+        if ( !s_get_varint(raw, pos, &typeRef) )
+            goto corrupt;
+        size_t typeId = typeRef;
+        if ( typeId == typetags.size() ) {
+            if ( !s_get_varint(raw, pos, &len) || len > raw.size() - pos )
+                goto corrupt;
+            typetags.emplace_back((const char *)raw.data() + pos, len);
+            pos += len;
+        }
+        else if ( typeId > typetags.size() )
+            goto corrupt;
+
+        const std::string &address = addresses[addrId];
+        const std::string &tags = typetags[typeId];
+        RecordStream &stream = streams[addrId];
+        if ( stream.typeId != (int)typeId ) {
+            stream.typeId = (int)typeId;
+            stream.args.assign(tags.size(), 0);
+        }
+
+        // address and typetag are zero padded to a multiple of 4 bytes
+        size_t offset = out.size();
+        out.insert(out.end(), address.begin(), address.end());
+        out.resize(offset + ((address.size() + 4) & ~(size_t)3), 0);
+        offset = out.size();
+        out.push_back(',');
+        out.insert(out.end(), tags.begin(), tags.end());
+        out.resize(offset + ((tags.size() + 5) & ~(size_t)3), 0);
+
+        for ( size_t i = 0; i < tags.size(); i++ ) {
+            int argsize = s_osc_argsize(tags[i]);
+            if ( argsize == 4 ) {
+                if ( !s_get_varint(raw, pos, &delta) )
+                    goto corrupt;
+                uint32_t v = (uint32_t)stream.args[i] + (uint32_t)s_unzigzag(delta);
+                stream.args[i] = v;
+                s_put_be32(out, v);
+            }
+            else if ( argsize == 8 ) {
+                if ( !s_get_varint(raw, pos, &delta) )
+                    goto corrupt;
+                uint64_t v = stream.args[i] + (uint64_t)s_unzigzag(delta);
+                stream.args[i] = v;
+                s_put_be64(out, v);
+            }
+            else if ( argsize == -1 ) {
+                const byte *str = raw.data() + pos;
+                const byte *end = (const byte *)memchr(str, 0, raw.size() - pos);
+                if ( end == nullptr )
+                    goto corrupt;
+                len = end - str;
+                offset = out.size();
+                out.insert(out.end(), str, end);
+                out.resize(offset + ((len + 4) & ~(size_t)3), 0);
+                pos += len + 1;
+            }
+            else if ( argsize == -2 ) {
+                if ( !s_get_varint(raw, pos, &len) || len > raw.size() - pos )
+                    goto corrupt;
+                s_put_be32(out, (uint32_t)len);
+                offset = out.size();
+                out.insert(out.end(), raw.data() + pos, raw.data() + pos + len);
+                out.resize(offset + ((len + 3) & ~(size_t)3), 0);
+                pos += len;
+            }
+            else if ( argsize == -3 )
+                goto corrupt;
+        }
+    }
+
+    bytesOut += out.size();
+    decodeUsecs += zclock_usecs() - start;
+    return true;
+
+corrupt:
+    zsys_error("Corrupt message in recording block at %zu", pos);
+    pos = raw.size();
+    return false;
+}
+
+bool
+RecordReader::open(const char *path)
+{
+    close();
+    if ( !openFile(path) )
+        return false;
+    if ( !isManifest )
+        return true;
+
+    if ( !loadManifest(path) || segments.empty() ) {
+        zsys_error("Invalid recording manifest %s", path);
+        close();
+        return false;
+    }
+    segment = 0;
+    if ( !openFile(segments[0].c_str()) || isManifest ) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void
+RecordReader::close()
+{
+    if ( file )
+        zfile_destroy(&file);
+    compressed = false;
+    isManifest = false;
+    readOffset = 0;
+    segments.clear();
+    segment = 0;
+}
+
+bool
+RecordReader::openFile(const char *path)
+{
+    if ( file )
+        zfile_destroy(&file);
+    file = zfile_new(NULL, path);
+    if ( file == nullptr )
+        return false;
+    if ( zfile_input(file) != 0 || !readHeader() ) {
+        zfile_destroy(&file);
+        return false;
+    }
+    return true;
+}
+
+bool
+RecordReader::loadManifest(const char *path)
+{
+    zchunk_t *chunk = zfile_read(file, zfile_cursize(file), 0);
+    zfile_destroy(&file);
+    if ( chunk == nullptr )
+        return false;
+
+    // segments are relative to the manifest
+    std::string dir = path;
+    size_t sep = dir.find_last_of("/\\");
+    dir = sep == std::string::npos ? "" : dir.substr(0, sep + 1);
+
+    std::string text((const char *)zchunk_data(chunk), zchunk_size(chunk));
+    zchunk_destroy(&chunk);
+    size_t pos = text.find('\n');  // skip the header line
+    while ( pos != std::string::npos && pos + 1 < text.size() ) {
+        size_t eol = text.find('\n', pos + 1);
+        std::string name = text.substr(pos + 1, eol == std::string::npos ? std::string::npos : eol - pos - 1);
+        if ( !name.empty() && name.back() == '\r' )
+            name.pop_back();
+        if ( !name.empty() )
+            segments.push_back(dir + name);
+        pos = eol;
+    }
+    return true;
+}
+
+bool
+RecordReader::rewind()
+{
+    if ( file == nullptr )
+        return false;
+    if ( segment != 0 ) {
+        segment = 0;
+        return openFile(segments[0].c_str());
+    }
+    return readHeader();
+}
+
+bool
+RecordReader::readHeader()
+{
+    readOffset = 0;
+    compressed = false;
+    isManifest = false;
+
+    zchunk_t *chunk = zfile_read(file, RECORD_CODEC_HEADER_SIZE, 0);
+    if ( chunk && zchunk_size(chunk) >= 4
+         && memcmp(zchunk_data(chunk), RECORD_MANIFEST_MAGIC, 4) == 0 ) {
+        zchunk_destroy(&chunk);
+        isManifest = true;
+        return true;
+    }
+    if ( chunk && zchunk_size(chunk) == RECORD_CODEC_HEADER_SIZE
+         && memcmp(zchunk_data(chunk), RECORD_CODEC_MAGIC, 4) == 0 ) {
+        byte version = zchunk_data(chunk)[4];
+        zchunk_destroy(&chunk);
+        if ( version > RECORD_CODEC_VERSION ) {
+            zsys_error("Unsupported recording version %i", version);
+            return false;
+        }
+        compressed = true;
+        readOffset = RECORD_CODEC_HEADER_SIZE;
+        // start with an empty block
+        decoder.load(nullptr, 0, 0);
+        return true;
+    }
+
+    zchunk_destroy(&chunk);
+    return true;
+}
+
+size_t
+RecordReader::size() const
+{
+    return file ? (size_t)zfile_cursize(file) : 0;
+}
+
+size_t
+RecordReader::totalSize() const
+{
+    if ( segments.empty() )
+        return size();
+    size_t total = 0;
+    for ( const std::string &path : segments ) {
+        ssize_t size = zsys_file_size(path.c_str());
+        if ( size > 0 )
+            total += size;
+    }
+    return total;
+}
+
+bool
+RecordReader::readBlock()
+{
+    zchunk_t *chunk = zfile_read(file, RECORD_CODEC_BLOCK_HEADER, readOffset);
+    if ( chunk == nullptr || zchunk_size(chunk) < RECORD_CODEC_BLOCK_HEADER ) {
+        zchunk_destroy(&chunk);
+        return false;
+    }
+    uint32_t rawSize, compSize;
+    record_read_block_header(zchunk_data(chunk), &rawSize, &compSize);
+    zchunk_destroy(&chunk);
+
+    // don't read what a corrupt header claims
+    size_t dataSize = compSize & ~RECORD_CODEC_STORED;
+    if ( rawSize > RECORD_CODEC_MAX_BLOCK || dataSize > record_lz_bound(rawSize) ) {
+        zsys_error("Corrupt block header in recording at %zu", readOffset);
+        return false;
+    }
+    chunk = zfile_read(file, dataSize, readOffset + RECORD_CODEC_BLOCK_HEADER);
+    if ( chunk == nullptr || zchunk_size(chunk) < dataSize ) {
+        zsys_error("Truncated block in recording at %zu", readOffset);
+        zchunk_destroy(&chunk);
+        return false;
+    }
+    readOffset += RECORD_CODEC_BLOCK_HEADER + dataSize;
+
+    bool rc = decoder.load(zchunk_data(chunk), rawSize, compSize);
+    zchunk_destroy(&chunk);
+    if ( !rc )
+        zsys_error("Corrupt block in recording at %zu", readOffset);
+    return rc;
+}
+
+zframe_t *
+RecordReader::next(unsigned int *timeCode)
+{
+    for (;;) {
+        zframe_t *frame = nextInFile(timeCode);
+        if ( frame || segment + 1 >= segments.size() )
+            return frame;
+        // continue with the next segment
+        if ( !openFile(segments[++segment].c_str()) || isManifest )
+            return nullptr;
+    }
+}
+
+zframe_t *
+RecordReader::nextInFile(unsigned int *timeCode)
+{
+    if ( file == nullptr )
+        return nullptr;
+
+    if ( compressed ) {
+        while ( !decoder.next(timeCode, message) ) {
+            if ( !readBlock() )
+                return nullptr;
+        }
+        return zframe_new(message.data(), message.size());
+    }
+
+    zchunk_t *chunk = zfile_read(file, sizeof(time_bytes), readOffset);
+    if ( chunk == nullptr || zchunk_size(chunk) < sizeof(time_bytes) ) {
+        zchunk_destroy(&chunk);
+        return nullptr;
+    }
+    time_bytes tc;
+    memcpy(&tc, zchunk_data(chunk), sizeof(time_bytes));
+    zchunk_destroy(&chunk);
+
+    chunk = zfile_read(file, tc.bytes, readOffset + sizeof(time_bytes));
+    if ( chunk == nullptr || zchunk_size(chunk) < tc.bytes ) {
+        zchunk_destroy(&chunk);
+        return nullptr;
+    }
+    readOffset += sizeof(time_bytes) + tc.bytes + 1; // one byte for endline character
+    *timeCode = tc.timeCode;
+    return zchunk_packx(&chunk);
+}
+
+bool
+RecordWriter::open(const char *path, bool compress)
+{
+    close();
+    // zfile_output doesn't truncate existing files
+    if ( zfile_exists(path) )
+        zfile_delete(path);
+    file = zfile_new(NULL, path);
+    if ( file == nullptr )
+        return false;
+    if ( zfile_output(file) != 0 ) {
+        zfile_destroy(&file);
+        return false;
+    }
+
+    compressed = compress;
+    writeOffset = 0;
+    encoder.reset();
+    encoder.bytesIn = 0;
+    encoder.bytesOut = 0;
+    encoder.encodeUsecs = 0;
+
+    if ( compressed ) {
+        byte header[RECORD_CODEC_HEADER_SIZE] = { 'G', 'Z', 'B', 'R', RECORD_CODEC_VERSION, 0, 0, 0 };
+        if ( writeBytes(header, sizeof(header)) != 0 ) {
+            zfile_destroy(&file);
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+RecordWriter::close()
+{
+    if ( file == nullptr )
+        return;
+    flush();
+    zfile_destroy(&file);
+}
+
+int
+RecordWriter::write(unsigned int timeCode, const byte *data, size_t size)
+{
+    if ( compressed ) {
+        if ( size > RECORD_CODEC_MAX_MESSAGE ) {
+            zsys_warning("Skipping a message of %zu bytes, too large to record compressed", size);
+            return 0;
+        }
+        encoder.append(timeCode, data, size);
+        if ( encoder.pending() >= RECORD_CODEC_BLOCK_SIZE )
+            return flush();
+        return 0;
+    }
+
+    // time_bytes header, the message and an endline character
+    time_bytes tc;
+    tc.timeCode = timeCode;
+    tc.bytes = (unsigned int)size;
+    block.resize(sizeof(time_bytes) + size + 1);
+    memcpy(block.data(), &tc, sizeof(time_bytes));
+    memcpy(block.data() + sizeof(time_bytes), data, size);
+    block.back() = '\n';
+    return writeBytes(block.data(), block.size());
+}
+
+int
+RecordWriter::flush()
+{
+    if ( !compressed || encoder.pending() == 0 )
+        return 0;
+    block.clear();
+    encoder.flush(block);
+    return writeBytes(block.data(), block.size());
+}
+
+int
+RecordWriter::writeBytes(const void *data, size_t size)
+{
+    zchunk_t *chunk = zchunk_new(data, size);
+    int rc = zfile_write(file, chunk, writeOffset);
+    zchunk_destroy(&chunk);
+    if ( rc == 0 )
+        writeOffset += size;
+    else
+        zsys_info("error writing");
+    return rc;
+}
@@ -0,0 +1,182 @@
+//
+// Compressed recording format for the Record actor
+//
+
+#ifndef GAZEBOSC_RECORDCODEC_H
+#define GAZEBOSC_RECORDCODEC_H
+
+#include "czmq.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// A compressed recording starts with an 8 byte file header followed by blocks:
+//
+//  header := "GZBR" version(u8) reserved(3 bytes)
+//  block  := rawSize(u32) compSize(u32) data[compSize]
+//
+// The block sizes are little-endian whatever host wrote the recording.
+// If the high bit of compSize is set the block data is stored uncompressed.
+// Every block resets the address/typetag dictionaries and the delta state so
+// a block can always be decoded on its own.
+#define RECORD_CODEC_MAGIC          "GZBR"
+#define RECORD_CODEC_VERSION        1
+#define RECORD_CODEC_HEADER_SIZE    8
+#define RECORD_CODEC_BLOCK_HEADER   8
+#define RECORD_CODEC_BLOCK_SIZE     65536
+#define RECORD_CODEC_STORED         0x80000000u
+
+// Larger messages aren't recorded compressed. A block holds up to
+// RECORD_CODEC_BLOCK_SIZE bytes plus the last encoded message, which the
+// varint deltas can make up to 1.25 times the message. Readers reject blocks
+// above RECORD_CODEC_MAX_BLOCK instead of allocating what a corrupt header says.
+#define RECORD_CODEC_MAX_MESSAGE    (16 << 20)
+#define RECORD_CODEC_MAX_BLOCK      (RECORD_CODEC_BLOCK_SIZE + 2 * RECORD_CODEC_MAX_MESSAGE)
+
+// A segmented recording is a text manifest listing its segments, relative
+// to the manifest, one per line:
+//
+//  GZBM 1
+//  take.rec.0000
+//  take.rec.0001
+#define RECORD_MANIFEST_MAGIC       "GZBM"
+
+// Record header of the raw format: time_bytes, message, '\n'
+struct time_bytes {
+public:
+    unsigned int timeCode;
+    unsigned int bytes;
+};
+
+// LZ77 block compression (LZ4 style sequences)
+// Returns the compressed size or 0 if dst is too small
+size_t record_lz_compress(const byte *src, size_t srcSize, byte *dst, size_t dstCapacity);
+// Returns 0 on success, -1 on corrupt input
+int record_lz_decompress(const byte *src, size_t srcSize, byte *dst, size_t dstSize);
+// Worst case compressed size for srcSize bytes
+size_t record_lz_bound(size_t srcSize);
+
+// Reads the sizes of the block header at data
+void record_read_block_header(const byte *data, uint32_t *rawSize, uint32_t *compSize);
+
+// Per address delta state
+struct RecordStream {
+    int typeId = -1;
+    std::vector<uint64_t> args;
+};
+
+class RecordEncoder {
+public:
+    RecordEncoder();
+
+    // Encode a message into the current block
+    void append(unsigned int timeCode, const byte *data, size_t size);
+    // Size of the uncompressed current block
+    size_t pending() const { return raw.size(); }
+    // Compress the current block into out (including the block header) and reset
+    void flush(std::vector<byte> &out);
+    void reset();
+
+    // Statistics
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    int64_t encodeUsecs = 0;
+
+private:
+    std::vector<byte> raw;
+    std::vector<byte> comp;
+    std::unordered_map<std::string, int> addresses;
+    std::unordered_map<std::string, int> typetags;
+    std::vector<RecordStream> streams;
+    std::string key;
+    unsigned int lastTimeCode = 0;
+};
+
+class RecordDecoder {
+public:
+    // Load a block (without its block header), returns false if it's corrupt
+    bool load(const byte *data, uint32_t rawSize, uint32_t compSize);
+    // Decode the next message into out, returns false at the end of the block
+    bool next(unsigned int *timeCode, std::vector<byte> &out);
+
+    // Statistics
+    uint64_t bytesOut = 0;
+    int64_t decodeUsecs = 0;
+
+private:
+    std::vector<byte> raw;
+    size_t pos = 0;
+    std::vector<std::string> addresses;
+    std::vector<std::string> typetags;
+    std::vector<RecordStream> streams;
+    unsigned int lastTimeCode = 0;
+};
+
+// Reads old (raw) and compressed recordings, a manifest is read as one
+// continuous recording
+class RecordReader {
+public:
+    ~RecordReader() { close(); }
+
+    bool open(const char *path);
+    void close();
+    bool rewind();
+    // Returns the next message or nullptr at the end of the recording
+    zframe_t *next(unsigned int *timeCode);
+
+    bool isOpen() const { return file != nullptr; }
+    bool isCompressed() const { return compressed; }
+    // Position in the current segment
+    size_t offset() const { return readOffset; }
+    size_t size() const;
+    // Size of all segments of a manifest, the file size otherwise
+    size_t totalSize() const;
+    bool isSegmented() const { return !segments.empty(); }
+    size_t segmentIndex() const { return segment; }
+    size_t segmentCount() const { return segments.empty() ? 1 : segments.size(); }
+
+    RecordDecoder decoder;
+
+private:
+    bool openFile(const char *path);
+    bool loadManifest(const char *path);
+    bool readHeader();
+    bool readBlock();
+    zframe_t *nextInFile(unsigned int *timeCode);
+
+    zfile_t *file = nullptr;
+    bool compressed = false;
+    bool isManifest = false;
+    size_t readOffset = 0;
+    std::vector<byte> message;
+    std::vector<std::string> segments;
+    size_t segment = 0;
+};
+
+// Writes old (raw) or compressed recordings
+class RecordWriter {
+public:
+    ~RecordWriter() { close(); }
+
+    bool open(const char *path, bool compress);
+    void close();
+    int write(unsigned int timeCode, const byte *data, size_t size);
+    // Write out the pending block (compressed mode only)
+    int flush();
+
+    bool isOpen() const { return file != nullptr; }
+    bool isCompressed() const { return compressed; }
+    size_t offset() const { return writeOffset; }
+
+    RecordEncoder encoder;
+
+private:
+    int writeBytes(const void *data, size_t size);
+
+    zfile_t *file = nullptr;
+    bool compressed = false;
+    size_t writeOffset = 0;
+    std::vector<byte> block;
+};
+
+#endif //GAZEBOSC_RECORDCODEC_H
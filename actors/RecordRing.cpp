@@ -0,0 +1,166 @@
+//
+// Ring buffer of recent messages for the Record actor's instant replay
+//
+
+#include "RecordRing.h"
+
+#define RECORD_RING_HEADER  8
+
+static inline size_t
+s_record_size(size_t size)
+{
+    return RECORD_RING_HEADER + ((size + 3) & ~(size_t)3);
+}
+
+void
+RecordRing::configure(size_t capacity, unsigned int duration)
+{
+    arena.assign(capacity & ~(size_t)3, 0);
+    this->duration = duration;
+    clear();
+}
+
+void
+RecordRing::release()
+{
+    std::vector<byte>().swap(arena);
+    clear();
+}
+
+void
+RecordRing::clear()
+{
+    head = tail = end = 0;
+    wrapped = false;
+    messages = 0;
+    rewind();
+}
+
+size_t
+RecordRing::used() const
+{
+    if ( wrapped )
+        return (end - head) + tail;
+    return tail - head;
+}
+
+void
+RecordRing::evictOldest()
+{
+    uint32_t size;
+    memcpy(&size, arena.data() + head + 4, 4);
+    head += s_record_size(size);
+    messages--;
+
+    if ( messages == 0 )
+        clear();
+    else if ( wrapped && head == end ) {
+        head = 0;
+        wrapped = false;
+    }
+}
+
+bool
+RecordRing::append(unsigned int timeCode, const byte *data, size_t size)
+{
+    size_t n = s_record_size(size);
+    if ( n > arena.size() )
+        return false;
+
+    for (;;) {
+        if ( !wrapped ) {
+            if ( arena.size() - tail >= n )
+                break;
+            // continue at the start of the arena
+            end = tail;
+            tail = 0;
+            wrapped = true;
+            if ( head == end ) {
+                // nothing was stored
+                clear();
+                continue;
+            }
+        }
+        if ( head - tail >= n )
+            break;
+        evictOldest();
+    }
+
+    byte *p = arena.data() + tail;
+    uint32_t header[2] = { timeCode, (uint32_t)size };
+    memcpy(p, header, RECORD_RING_HEADER);
+    memcpy(p + RECORD_RING_HEADER, data, size);
+    tail += n;
+    messages++;
+
+    // drop what's older than the duration
+    while ( duration && messages > 1 ) {
+        uint32_t oldest;
+        memcpy(&oldest, arena.data() + head, 4);
+        if ( (int32_t)(timeCode - oldest) <= (int32_t)duration )
+            break;
+        evictOldest();
+    }
+    return true;
+}
+
+void
+RecordRing::snapshot(RecordRing &dst) const
+{
+    if ( dst.arena.size() != arena.size() )
+        dst.arena.resize(arena.size());
+
+    // only copy the parts of the arena in use
+    if ( wrapped ) {
+        memcpy(dst.arena.data() + head, arena.data() + head, end - head);
+        memcpy(dst.arena.data(), arena.data(), tail);
+    }
+    else
+        memcpy(dst.arena.data() + head, arena.data() + head, tail - head);
+
+    dst.duration = duration;
+    dst.head = head;
+    dst.tail = tail;
+    dst.end = end;
+    dst.wrapped = wrapped;
+    dst.messages = messages;
+    dst.rewind();
+}
+
+void
+RecordRing::rewind()
+{
+    cursor = head;
+    cursorWrapped = wrapped;
+}
+
+const byte *
+RecordRing::nextData(unsigned int *timeCode, size_t *size)
+{
+    if ( messages == 0 )
+        return nullptr;
+    if ( cursorWrapped && cursor == end ) {
+        cursor = 0;
+        cursorWrapped = false;
+    }
+    if ( !cursorWrapped && cursor == tail )
+        return nullptr;
+
+    uint32_t header[2];
+    memcpy(header, arena.data() + cursor, RECORD_RING_HEADER);
+    *timeCode = header[0];
+    *size = header[1];
+    const byte *data = arena.data() + cursor + RECORD_RING_HEADER;
+    cursor += s_record_size(header[1]);
+    return data;
+}
+
+zframe_t *
+RecordRing::next(unsigned int *timeCode)
+{
+    size_t size;
+    const byte *data = nextData(timeCode, &size);
+    if ( data == nullptr )
+        return nullptr;
+    return zframe_new(data, size);
+}
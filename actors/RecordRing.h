@@ -0,0 +1,57 @@
+//
+// Ring buffer of recent messages for the Record actor's instant replay
+//
+
+#ifndef GAZEBOSC_RECORDRING_H
+#define GAZEBOSC_RECORDRING_H
+
+#include "czmq.h"
+#include <vector>
+
+// Messages are stored in a preallocated arena as:
+//
+//  timeCode(u32) size(u32) data[size] padding to 4 bytes
+//
+// A message is never split. If it doesn't fit at the end of the arena the
+// ring wraps to the start and evicts the oldest messages until there is
+// room. Messages older than the duration are evicted as well.
+class RecordRing {
+public:
+    // Allocate the arena, this drops all messages
+    void configure(size_t capacity, unsigned int duration);
+    void release();
+    void clear();
+    void setDuration(unsigned int duration) { this->duration = duration; }
+
+    // Store a message, returns false if it's bigger than the arena
+    bool append(unsigned int timeCode, const byte *data, size_t size);
+
+    // Copy the contents into dst, reusing its arena if it's big enough
+    void snapshot(RecordRing &dst) const;
+
+    // Iterate from the oldest message
+    void rewind();
+    const byte *nextData(unsigned int *timeCode, size_t *size);
+    zframe_t *next(unsigned int *timeCode);
+
+    bool isConfigured() const { return !arena.empty(); }
+    size_t count() const { return messages; }
+    size_t used() const;
+    size_t capacity() const { return arena.size(); }
+
+private:
+    void evictOldest();
+
+    std::vector<byte> arena;
+    unsigned int duration = 0;  // ms, 0 is unlimited
+    size_t head = 0;            // oldest message
+    size_t tail = 0;            // where the next message is written
+    size_t end = 0;             // end of the messages before the wrap
+    bool wrapped = false;       // messages are in [head, end) and [0, tail)
+    size_t messages = 0;
+
+    size_t cursor = 0;
+    bool cursorWrapped = false;
+};
+
+#endif //GAZEBOSC_RECORDRING_H
@@ -0,0 +1,192 @@
+//
+// Time/size segmented recordings for the Record actor
+//
+
+#include "RecordSegments.h"
+
+void
+RecordSegmentWriter::setRotation(unsigned int duration, size_t size)
+{
+    // only used for the next recording
+    this->duration = duration;
+    maxSize = size;
+}
+
+std::string
+RecordSegmentWriter::segmentName(unsigned int index) const
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%04u", index);
+    return base + suffix;
+}
+
+bool
+RecordSegmentWriter::openSegment(std::unique_ptr<RecordWriter> &writer, unsigned int index)
+{
+    writer.reset(new RecordWriter());
+    if ( writer->open((dir + segmentName(index)).c_str(), compressed) )
+        return true;
+    writer.reset();
+    return false;
+}
+
+int
+RecordSegmentWriter::appendManifest(const std::string &line)
+{
+    std::string text = line + "\n";
+    zchunk_t *chunk = zchunk_new(text.data(), text.size());
+    int rc = zfile_write(manifest, chunk, manifestOffset);
+    zchunk_destroy(&chunk);
+    if ( rc == 0 ) {
+        manifestOffset += text.size();
+        // the manifest needs to be complete if we crash
+        fflush(zfile_handle(manifest));
+    }
+    else
+        zsys_info("error writing manifest");
+    return rc;
+}
+
+bool
+RecordSegmentWriter::open(const char *path, bool compress)
+{
+    close();
+    compressed = compress;
+    segmented = duration || maxSize;
+    index = 0;
+    segmentEmpty = true;
+    bytesIn = 0;
+    bytesOut = 0;
+    encodeUsecs = 0;
+
+    std::string p = path;
+    size_t sep = p.find_last_of("/\\");
+    dir = sep == std::string::npos ? "" : p.substr(0, sep + 1);
+    base = sep == std::string::npos ? p : p.substr(sep + 1);
+
+    if ( !segmented ) {
+        current.reset(new RecordWriter());
+        if ( current->open(path, compress) )
+            return true;
+        current.reset();
+        return false;
+    }
+
+    if ( zfile_exists(path) )
+        zfile_delete(path);
+    manifest = zfile_new(NULL, path);
+    if ( manifest == nullptr || zfile_output(manifest) != 0 ) {
+        zfile_destroy(&manifest);
+        return false;
+    }
+    manifestOffset = 0;
+
+    if ( appendManifest(RECORD_MANIFEST_MAGIC " 1") != 0 || !openSegment(current, 0)
+         || appendManifest(segmentName(0)) != 0 ) {
+        close();
+        return false;
+    }
+    prepareNext();
+    return true;
+}
+
+void
+RecordSegmentWriter::close()
+{
+    waitNext();
+    if ( current ) {
+        current->close();
+        collect(*current);
+        current.reset();
+    }
+    if ( next ) {
+        next->close();
+        next.reset();
+    }
+    if ( base.size() ) {
+        // remove the pre-opened segment which was never used and the
+        // segments of an earlier, longer take recorded over
+        unsigned int first = segmented ? index + 1 : 0;
+        for ( unsigned int i = first; zfile_exists((dir + segmentName(i)).c_str()); i++ )
+            zfile_delete((dir + segmentName(i)).c_str());
+        base.clear();
+    }
+    if ( manifest )
+        zfile_destroy(&manifest);
+}
+
+int
+RecordSegmentWriter::write(unsigned int timeCode, const byte *data, size_t size)
+{
+    if ( current == nullptr )
+        return -1;
+
+    if ( segmented && !segmentEmpty
+         && ( (duration && timeCode - segmentStart >= duration)
+              || (maxSize && current->offset() >= maxSize) ) ) {
+        // on failure keep writing the current segment and retry later
+        if ( rotate() != 0 )
+            segmentStart = timeCode;
+    }
+
+    if ( segmentEmpty ) {
+        segmentStart = timeCode;
+        segmentEmpty = false;
+    }
+    return current->write(timeCode, data, size);
+}
+
+void
+RecordSegmentWriter::prepareNext()
+{
+    unsigned int nextIndex = index + 1;
+    worker = std::thread([this, nextIndex]() {
+        if ( retired )
+            retired->close();
+        openSegment(next, nextIndex);
+    });
+}
+
+void
+RecordSegmentWriter::waitNext()
+{
+    if ( worker.joinable() )
+        worker.join();
+    if ( retired ) {
+        collect(*retired);
+        retired.reset();
+    }
+}
+
+void
+RecordSegmentWriter::collect(RecordWriter &writer)
+{
+    if ( compressed ) {
+        bytesIn += writer.encoder.bytesIn;
+        bytesOut += writer.encoder.bytesOut;
+        encodeUsecs += writer.encoder.encodeUsecs;
+    }
+    else {
+        bytesIn += writer.offset();
+        bytesOut += writer.offset();
+    }
+}
+
+int
+RecordSegmentWriter::rotate()
+{
+    // normally the helper thread finished long ago
+    waitNext();
+    if ( next == nullptr && !openSegment(next, index + 1) ) {
+        zsys_error("Could not open segment %s", segmentName(index + 1).c_str());
+        return -1;
+    }
+
+    retired = std::move(current);
+    current = std::move(next);
+    index++;
+    segmentEmpty = true;
+    int rc = appendManifest(segmentName(index));
+    prepareNext();
+    return rc;
+}
@@ -0,0 +1,70 @@
+//
+// Time/size segmented recordings for the Record actor
+//
+
+#ifndef GAZEBOSC_RECORDSEGMENTS_H
+#define GAZEBOSC_RECORDSEGMENTS_H
+
+#include "RecordCodec.h"
+#include <memory>
+#include <string>
+#include <thread>
+
+// Writes a recording as a manifest plus segment files (path.0000,
+// path.0001, ...) which are rotated by duration and/or size. Without a
+// rotation limit it writes a single plain recording to path.
+//
+// The next segment is opened and the previous one is flushed and closed on
+// a helper thread, so a rotation only swaps writers on the actor thread.
+//
+// Recording over an earlier take replaces it, closing removes its segments
+// past the new last one.
+class RecordSegmentWriter {
+public:
+    ~RecordSegmentWriter() { close(); }
+
+    // duration in ms and size in bytes, 0 disables the limit
+    void setRotation(unsigned int duration, size_t size);
+
+    bool open(const char *path, bool compress);
+    void close();
+    int write(unsigned int timeCode, const byte *data, size_t size);
+
+    bool isOpen() const { return current != nullptr; }
+    bool isCompressed() const { return compressed; }
+    size_t segmentCount() const { return index + 1; }
+
+    // Statistics of all closed segments
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    int64_t encodeUsecs = 0;
+
+private:
+    std::string segmentName(unsigned int index) const;
+    int appendManifest(const std::string &line);
+    bool openSegment(std::unique_ptr<RecordWriter> &writer, unsigned int index);
+    void prepareNext();
+    void waitNext();
+    void collect(RecordWriter &writer);
+    int rotate();
+
+    std::string dir;
+    std::string base;
+    bool compressed = false;
+    bool segmented = false;
+    unsigned int duration = 0;
+    size_t maxSize = 0;
+
+    std::unique_ptr<RecordWriter> current;
+    std::unique_ptr<RecordWriter> next;
+    std::unique_ptr<RecordWriter> retired;
+    std::thread worker;
+    unsigned int index = 0;
+    unsigned int segmentStart = 0;
+    bool segmentEmpty = true;
+
+    zfile_t *manifest = nullptr;
+    size_t manifestOffset = 0;
+};
+
+#endif //GAZEBOSC_RECORDSEGMENTS_H
@@ -0,0 +1,197 @@
+//
+// Shared transport clock for Record actors
+//
+
+#include "RecordSession.h"
+#include "RecordCodec.h"
+#include <cmath>
+
+static std::mutex s_sessions_mutex;
+static std::map<std::string, std::weak_ptr<RecordSession>> s_sessions;
+
+int64_t
+RecordTransport::mediaTime(int64_t now) const
+{
+    if ( state != PLAYING )
+        return anchorMedia;
+    return anchorMedia + (int64_t)std::floor((now - anchorWall) * rate);
+}
+
+unsigned int
+RecordTransport::timeCode(int64_t now) const
+{
+    return origin + (unsigned int)mediaTime(now);
+}
+
+int64_t
+RecordTransport::timeout(unsigned int timeCode, int64_t now) const
+{
+    if ( state != PLAYING || rate <= 0. )
+        return -1;
+    int64_t media = (int32_t)(timeCode - origin);
+    int64_t due = anchorWall + (int64_t)std::ceil((media - anchorMedia) / rate);
+    return due > now ? due - now : 0;
+}
+
+void
+RecordTransport::play(unsigned int origin, int64_t now)
+{
+    this->origin = origin;
+    state = PLAYING;
+    anchorWall = now;
+    anchorMedia = 0;
+    seekGeneration++;
+}
+
+void
+RecordTransport::seek(int64_t media, int64_t now)
+{
+    anchorWall = now;
+    anchorMedia = media < 0 ? 0 : media;
+    seekGeneration++;
+}
+
+void
+RecordTransport::setRate(double rate, int64_t now)
+{
+    // re-anchor so the media time doesn't jump
+    anchorMedia = mediaTime(now);
+    anchorWall = now;
+    this->rate = rate < 0. ? 0. : rate;
+}
+
+std::shared_ptr<RecordSession>
+RecordSession::join(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(s_sessions_mutex);
+    std::shared_ptr<RecordSession> session = s_sessions[name].lock();
+    if ( session == nullptr ) {
+        session = std::make_shared<RecordSession>(name);
+        s_sessions[name] = session;
+    }
+    return session;
+}
+
+RecordSession::RecordSession(const std::string &name)
+    : name(name)
+{
+    endpoint = "inproc://record-session-" + name;
+    pub = zsock_new_pub(endpoint.c_str());
+    if ( pub == nullptr )
+        zsys_error("Could not bind session endpoint %s", endpoint.c_str());
+}
+
+RecordSession::~RecordSession()
+{
+    zsock_destroy(&pub);
+
+    // forget the name, unless a new session joined under it meanwhile
+    std::lock_guard<std::mutex> lock(s_sessions_mutex);
+    auto it = s_sessions.find(name);
+    if ( it != s_sessions.end() && it->second.expired() )
+        s_sessions.erase(it);
+}
+
+zsock_t *
+RecordSession::subscribe()
+{
+    return zsock_new_sub(endpoint.c_str(), "");
+}
+
+void
+RecordSession::setTrack(void *member, const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tracks[member] = path;
+}
+
+void
+RecordSession::removeTrack(void *member)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tracks.erase(member);
+}
+
+RecordTransport
+RecordSession::transport()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return state;
+}
+
+void
+RecordSession::record()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( state.state != RecordTransport::IDLE )
+        return;
+    state.state = RecordTransport::RECORDING;
+    publish();
+}
+
+void
+RecordSession::play()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( state.state == RecordTransport::RECORDING ) {
+        zsys_info("Session %s is recording, stop it before playing", name.c_str());
+        return;
+    }
+
+    // All tracks are recorded against the same monotonic clock, so the
+    // earliest first timecode of all tracks is the start of the session
+    bool found = false;
+    unsigned int origin = 0;
+    for ( auto &track : tracks ) {
+        RecordReader reader;
+        unsigned int timeCode;
+        if ( track.second.empty() || !reader.open(track.second.c_str()) )
+            continue;
+        zframe_t *frame = reader.next(&timeCode);
+        if ( frame == nullptr )
+            continue;
+        zframe_destroy(&frame);
+        if ( !found || (int32_t)(timeCode - origin) < 0 )
+            origin = timeCode;
+        found = true;
+    }
+    if ( !found ) {
+        zsys_info("Session %s has no recordings to play", name.c_str());
+        return;
+    }
+
+    state.play(origin, zclock_mono());
+    publish();
+}
+
+void
+RecordSession::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    state.state = RecordTransport::IDLE;
+    publish();
+}
+
+void
+RecordSession::seek(int64_t media)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    state.seek(media, zclock_mono());
+    publish();
+}
+
+void
+RecordSession::setRate(double rate)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    state.setRate(rate, zclock_mono());
+    publish();
+}
+
+void
+RecordSession::publish()
+{
+    // members only need a wakeup, they read the transport themselves
+    if ( pub )
+        zstr_send(pub, "TRANSPORT");
+}
@@ -0,0 +1,80 @@
+//
+// Shared transport clock for Record actors
+//
+
+#ifndef GAZEBOSC_RECORDSESSION_H
+#define GAZEBOSC_RECORDSESSION_H
+
+#include "czmq.h"
+#include <string>
+#include <memory>
+#include <mutex>
+#include <map>
+
+// Maps recorded timecodes onto wall clock time. A recorded timecode t is
+// due at:
+//
+//  anchorWall + (t - origin - anchorMedia) / rate
+//
+// As every track in a session computes this from the same values, messages
+// with the same timecode are due at the same moment in all tracks.
+struct RecordTransport {
+    enum State { IDLE, RECORDING, PLAYING };
+
+    State state = IDLE;
+    unsigned int seekGeneration = 0;  // bumped on play and seek
+    unsigned int origin = 0;          // recorded timecode at media time 0
+    int64_t anchorWall = 0;           // zclock_mono() at the last change
+    int64_t anchorMedia = 0;          // media time (ms) at anchorWall
+    double rate = 1.0;
+
+    // Media time (ms) at wall time now
+    int64_t mediaTime(int64_t now) const;
+    // Recorded timecode which is due at wall time now
+    unsigned int timeCode(int64_t now) const;
+    // Milliseconds until timeCode is due (0 if it is due), -1 if it will never
+    // be due because the transport is stopped or paused
+    int64_t timeout(unsigned int timeCode, int64_t now) const;
+
+    void play(unsigned int origin, int64_t now);
+    void seek(int64_t media, int64_t now);
+    void setRate(double rate, int64_t now);
+};
+
+// Record actors joined to the same session share one transport. Changes
+// are published on an inproc PUB socket, members subscribe to it and
+// sync their state in handleCustomSocket.
+class RecordSession {
+public:
+    static std::shared_ptr<RecordSession> join(const std::string &name);
+
+    explicit RecordSession(const std::string &name);
+    ~RecordSession();
+
+    const std::string &getName() const { return name; }
+    // Subscribe socket for transport changes, owned by the caller
+    zsock_t *subscribe();
+    // Set the recording of a member, used to align the tracks on play
+    void setTrack(void *member, const std::string &path);
+    void removeTrack(void *member);
+
+    RecordTransport transport();
+
+    void record();
+    void play();
+    void stop();
+    void seek(int64_t media);
+    void setRate(double rate);
+
+private:
+    void publish();
+
+    std::string name;
+    std::string endpoint;
+    std::mutex mutex;
+    zsock_t *pub = nullptr;
+    RecordTransport state;
+    std::map<void *, std::string> tracks;
+};
+
+#endif //GAZEBOSC_RECORDSESSION_H
@@ -0,0 +1,419 @@
+//
+// Offline inspection and conversion of Record actor recordings
+//
+
+#include "RecordTool.h"
+#include "RecordCodec.h"
+#include <string>
+#include <map>
+
+#define RECORD_TOOL_GAPS        5
+#define RECORD_TOOL_UDP_MAX     65507
+
+struct AddressStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    unsigned int first = 0;
+    unsigned int last = 0;
+    unsigned int maxGap = 0;
+};
+
+struct Gap {
+    unsigned int at = 0;
+    unsigned int length = 0;
+};
+
+static void
+s_usage()
+{
+    fprintf(stderr,
+            "usage: gazebosc --record-tool <command> <recording> [output] [options]\n"
+            "\n"
+            "  stats   <recording>                     message rate per address and gaps\n"
+            "  csv     <recording> [out.csv]           time, address, typetag and arguments\n"
+            "  pcap    <recording> <out.pcap>          OSC over UDP for Wireshark\n"
+            "          --port <port>                   UDP port to use (default 6200)\n"
+            "  convert <recording> <out>               rewrite in the raw recording format\n"
+            "          --compress                      rewrite in the compressed recording format\n");
+}
+
+// Returns the OSC address of a message or bundle, nullptr if it's not OSC
+static const char *
+s_osc_address(const byte *data, size_t size, size_t *len)
+{
+    if ( size < 4 || (data[0] != '/' && data[0] != '#') )
+        return nullptr;
+    const byte *end = (const byte *)memchr(data, 0, size);
+    if ( end == nullptr )
+        return nullptr;
+    *len = end - data;
+    return (const char *)data;
+}
+
+// Whether zosc can safely parse the message: an address followed by a typetag
+static bool
+s_is_osc_message(const byte *data, size_t size)
+{
+    size_t len;
+    if ( s_osc_address(data, size, &len) == nullptr || data[0] != '/' )
+        return false;
+    size_t tagOffset = (len + 4) & ~(size_t)3;
+    return tagOffset < size && data[tagOffset] == ','
+           && memchr(data + tagOffset, 0, size - tagOffset) != nullptr;
+}
+
+static void
+s_csv_string(FILE *out, const char *str, size_t len)
+{
+    fputc('"', out);
+    for ( size_t i = 0; i < len; i++ ) {
+        if ( str[i] == '"' )
+            fputc('"', out);
+        fputc(str[i], out);
+    }
+    fputc('"', out);
+}
+
+static void
+s_csv_osc(FILE *out, zframe_t **frame)
+{
+    zosc_t *osc = zosc_fromframe(*frame);  // becomes owner of frame and destroys it
+    *frame = nullptr;
+    if ( osc == nullptr )
+        return;
+
+    s_csv_string(out, zosc_address(osc), strlen(zosc_address(osc)));
+    fprintf(out, ",%s", zosc_format(osc));
+
+    char type = '0';
+    const void *data = zosc_first(osc, &type);
+    while ( data ) {
+        fputc(',', out);
+        switch (type) {
+            case 'i': {
+                int32_t value;
+                zosc_pop_int32(osc, &value);
+                fprintf(out, "%i", value);
+            } break;
+            case 'h': {
+                int64_t value;
+                zosc_pop_int64(osc, &value);
+                fprintf(out, "%lld", (long long)value);
+            } break;
+            case 'f': {
+                float value;
+                zosc_pop_float(osc, &value);
+                fprintf(out, "%.9g", value);
+            } break;
+            case 'd': {
+                double value;
+                zosc_pop_double(osc, &value);
+                fprintf(out, "%.17g", value);
+            } break;
+            case 's':
+            case 'S': {
+                char *value;
+                if ( zosc_pop_string(osc, &value) == 0 ) {
+                    s_csv_string(out, value, strlen(value));
+                    zstr_free(&value);
+                }
+            } break;
+            case 'c': {
+                char value;
+                zosc_pop_char(osc, &value);
+                fprintf(out, "%c", value);
+            } break;
+            case 'm': {
+                uint32_t value;
+                zosc_pop_midi(osc, &value);
+                fprintf(out, "0x%08x", value);
+            } break;
+            case 'T':
+                fprintf(out, "true");
+                break;
+            case 'F':
+                fprintf(out, "false");
+                break;
+            case 'N':
+                fprintf(out, "nil");
+                break;
+            case 'I':
+                fprintf(out, "impulse");
+                break;
+            default:
+                fprintf(out, "<%c>", type);
+                break;
+        }
+        data = zosc_next(osc, &type);
+    }
+    zosc_destroy(&osc);
+}
+
+static int
+s_record_csv(RecordReader &reader, FILE *out)
+{
+    unsigned int timeCode, first = 0;
+    bool started = false;
+    zframe_t *frame;
+
+    fprintf(out, "time_ms,address,typetag,arguments\n");
+    while ( (frame = reader.next(&timeCode)) ) {
+        if ( !started ) {
+            first = timeCode;
+            started = true;
+        }
+        fprintf(out, "%u,", timeCode - first);
+
+        const byte *data = zframe_data(frame);
+        size_t size = zframe_size(frame);
+        size_t len;
+        if ( s_is_osc_message(data, size) )
+            s_csv_osc(out, &frame);
+        else if ( s_osc_address(data, size, &len) )
+            s_csv_string(out, (const char *)data, len);
+        else
+            fprintf(out, "\"<raw>\",,%zu", size);
+        fputc('\n', out);
+        zframe_destroy(&frame);
+    }
+    return 0;
+}
+
+static void
+s_put16(byte *p, uint16_t v)
+{
+    p[0] = (byte)(v >> 8);
+    p[1] = (byte)v;
+}
+
+static int
+s_record_pcap(RecordReader &reader, FILE *out, uint16_t port)
+{
+    // pcap file header, LINKTYPE_RAW so packets start with the IPv4 header
+    uint32_t magic = 0xa1b2c3d4, snaplen = 65535, network = 101, sigfigs = 0;
+    uint16_t major = 2, minor = 4;
+    int32_t thiszone = 0;
+    fwrite(&magic, 4, 1, out);
+    fwrite(&major, 2, 1, out);
+    fwrite(&minor, 2, 1, out);
+    fwrite(&thiszone, 4, 1, out);
+    fwrite(&sigfigs, 4, 1, out);
+    fwrite(&snaplen, 4, 1, out);
+    fwrite(&network, 4, 1, out);
+
+    unsigned int timeCode, first = 0;
+    bool started = false;
+    uint16_t id = 0;
+    uint64_t skipped = 0;
+    zframe_t *frame;
+    while ( (frame = reader.next(&timeCode)) ) {
+        if ( !started ) {
+            first = timeCode;
+            started = true;
+        }
+        size_t size = zframe_size(frame);
+        if ( size > RECORD_TOOL_UDP_MAX ) {
+            skipped++;
+            zframe_destroy(&frame);
+            continue;
+        }
+
+        // IPv4 and UDP header, 127.0.0.1 to 127.0.0.1
+        byte header[28] = { 0 };
+        header[0] = 0x45;
+        s_put16(header + 2, (uint16_t)(28 + size));
+        s_put16(header + 4, id++);
+        header[6] = 0x40;   // don't fragment
+        header[8] = 64;     // ttl
+        header[9] = 17;     // udp
+        header[12] = 127; header[15] = 1;
+        header[16] = 127; header[19] = 1;
+        uint32_t sum = 0;
+        for ( int i = 0; i < 20; i += 2 )
+            sum += (uint32_t)header[i] << 8 | header[i + 1];
+        while ( sum >> 16 )
+            sum = (sum & 0xffff) + (sum >> 16);
+        s_put16(header + 10, (uint16_t)~sum);
+        s_put16(header + 20, port);
+        s_put16(header + 22, port);
+        s_put16(header + 24, (uint16_t)(8 + size));   // udp checksum is optional for IPv4
+
+        unsigned int elapsed = timeCode - first;
+        uint32_t record[4] = { elapsed / 1000, (elapsed % 1000) * 1000,
+                               (uint32_t)(28 + size), (uint32_t)(28 + size) };
+        fwrite(record, 4, 4, out);
+        fwrite(header, 1, sizeof(header), out);
+        fwrite(zframe_data(frame), 1, size, out);
+        zframe_destroy(&frame);
+    }
+
+    if ( skipped )
+        fprintf(stderr, "skipped %llu messages too big for UDP\n", (unsigned long long)skipped);
+    return 0;
+}
+
+static int
+s_record_convert(RecordReader &reader, const char *path, bool compress)
+{
+    RecordWriter writer;
+    if ( !writer.open(path, compress) ) {
+        fprintf(stderr, "can't write %s\n", path);
+        return 1;
+    }
+
+    unsigned int timeCode;
+    zframe_t *frame;
+    int rc = 0;
+    while ( rc == 0 && (frame = reader.next(&timeCode)) ) {
+        rc = writer.write(timeCode, zframe_data(frame), zframe_size(frame));
+        zframe_destroy(&frame);
+    }
+    if ( rc == 0 )
+        rc = writer.flush();
+    writer.close();
+
+    if ( compress && writer.encoder.bytesOut )
+        printf("%llu -> %llu bytes (%.2fx)\n", (unsigned long long)writer.encoder.bytesIn,
+               (unsigned long long)writer.encoder.bytesOut,
+               (double)writer.encoder.bytesIn / writer.encoder.bytesOut);
+    return rc == 0 ? 0 : 1;
+}
+
+static int
+s_record_stats(RecordReader &reader)
+{
+    std::map<std::string, AddressStats> addresses;
+    Gap gaps[RECORD_TOOL_GAPS];
+    std::string key;
+    unsigned int timeCode, first = 0, last = 0;
+    uint64_t count = 0, bytes = 0;
+    zframe_t *frame;
+
+    while ( (frame = reader.next(&timeCode)) ) {
+        const byte *data = zframe_data(frame);
+        size_t size = zframe_size(frame);
+        size_t len;
+        const char *address = s_osc_address(data, size, &len);
+        if ( address )
+            key.assign(address, len);
+        else
+            key.assign("<raw>");
+
+        if ( count == 0 )
+            first = last = timeCode;
+
+        // keep the largest gaps between any two messages
+        int32_t delta = (int32_t)(timeCode - last);
+        unsigned int gap = delta > 0 ? (unsigned int)delta : 0;
+        for ( int i = 0; i < RECORD_TOOL_GAPS; i++ ) {
+            if ( gap > gaps[i].length ) {
+                memmove(&gaps[i + 1], &gaps[i], (RECORD_TOOL_GAPS - i - 1) * sizeof(Gap));
+                gaps[i].at = last - first;
+                gaps[i].length = gap;
+                break;
+            }
+        }
+
+        AddressStats &stats = addresses[key];
+        if ( stats.count == 0 )
+            stats.first = timeCode;
+        else if ( (int32_t)(timeCode - stats.last) > (int32_t)stats.maxGap )
+            stats.maxGap = timeCode - stats.last;
+        stats.last = timeCode;
+        stats.count++;
+        stats.bytes += size;
+
+        last = timeCode;
+        count++;
+        bytes += size;
+        zframe_destroy(&frame);
+    }
+
+    double duration = (last - first) / 1000.0;
+    const char *format = reader.isCompressed() ? "compressed" : "raw";
+    if ( reader.isSegmented() )
+        printf("format:   manifest, %zu %s segments\n", reader.segmentCount(), format);
+    else
+        printf("format:   %s\n", format);
+    printf("size:     %zu bytes\n", reader.totalSize());
+    printf("messages: %llu (%llu bytes)\n", (unsigned long long)count, (unsigned long long)bytes);
+    printf("duration: %.3f s\n", duration);
+    if ( duration > 0 )
+        printf("rate:     %.1f msg/s\n", count / duration);
+
+    printf("\n%-40s %10s %10s %12s %12s\n", "address", "messages", "msg/s", "bytes", "max gap ms");
+    for ( auto &it : addresses ) {
+        const AddressStats &stats = it.second;
+        double span = (stats.last - stats.first) / 1000.0;
+        printf("%-40s %10llu %10.1f %12llu %12u\n", it.first.c_str(), (unsigned long long)stats.count,
+               span > 0 ? (stats.count - 1) / span : 0.0, (unsigned long long)stats.bytes, stats.maxGap);
+    }
+
+    printf("\nlargest gaps:\n");
+    for ( int i = 0; i < RECORD_TOOL_GAPS && gaps[i].length; i++ )
+        printf("  %8u ms at %.3f s\n", gaps[i].length, gaps[i].at / 1000.0);
+    return 0;
+}
+
+int
+record_tool(int argc, char **argv)
+{
+    const char *command = nullptr;
+    const char *input = nullptr;
+    const char *output = nullptr;
+    bool compress = false;
+    long port = 6200;
+
+    for ( int i = 0; i < argc; i++ ) {
+        if ( streq(argv[i], "--compress") )
+            compress = true;
+        else if ( streq(argv[i], "--port") && i + 1 < argc )
+            port = strtol(argv[++i], nullptr, 10);
+        else if ( command == nullptr )
+            command = argv[i];
+        else if ( input == nullptr )
+            input = argv[i];
+        else if ( output == nullptr )
+            output = argv[i];
+    }
+    if ( command == nullptr || input == nullptr || port <= 0 || port > 65535 ) {
+        s_usage();
+        return 1;
+    }
+
+    RecordReader reader;
+    if ( !reader.open(input) ) {
+        fprintf(stderr, "can't read %s\n", input);
+        return 1;
+    }
+
+    if ( streq(command, "stats") )
+        return s_record_stats(reader);
+    if ( streq(command, "convert") ) {
+        if ( output == nullptr ) {
+            s_usage();
+            return 1;
+        }
+        return s_record_convert(reader, output, compress);
+    }
+
+    bool pcap = streq(command, "pcap");
+    if ( !pcap && !streq(command, "csv") ) {
+        s_usage();
+        return 1;
+    }
+    if ( pcap && output == nullptr ) {
+        s_usage();
+        return 1;
+    }
+
+    FILE *out = output ? fopen(output, pcap ? "wb" : "w") : stdout;
+    if ( out == nullptr ) {
+        fprintf(stderr, "can't write %s\n", output);
+        return 1;
+    }
+    int rc = pcap ? s_record_pcap(reader, out, (uint16_t)port) : s_record_csv(reader, out);
+    if ( out != stdout )
+        fclose(out);
+    return rc;
+}
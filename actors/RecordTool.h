@@ -0,0 +1,18 @@
+//
+// Offline inspection and conversion of Record actor recordings
+//
+
+#ifndef GAZEBOSC_RECORDTOOL_H
+#define GAZEBOSC_RECORDTOOL_H
+
+// Entry point for: gazebosc --record-tool <command> <recording> [output] [options]
+//
+//  stats   <recording>                      message rate per address and gaps
+//  csv     <recording> [out.csv]            time, address, typetag and arguments
+//  pcap    <recording> <out.pcap> [--port]  OSC over UDP for Wireshark
+//  convert <recording> <out> [--compress]   rewrite in the raw or compressed format
+//
+// All commands stream the recording so memory use doesn't depend on its size.
+int record_tool(int argc, char **argv);
+
+#endif //GAZEBOSC_RECORDTOOL_H
@@ -8,9 +8,11 @@
 #include "Midi2OSCActor.h"
 #include "NatNetActor.h"
 #include "NatNet2OSCActor.h"
+#include "NatNetSimulatorActor.h"
 #include "OpenVRActor.h"
 #include "OSCInputActor.h"
 #include "RecordActor.h"
+#include "RecordTool.h"
 #include "ModPlayerActor.h"
 #include "ProcessActor.h"
 #include "DmxActor.h"
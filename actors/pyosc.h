@@ -0,0 +1,591 @@
+#ifndef PYOSC_H
+#define PYOSC_H
+#include <Python.h>
+#include <structmember.h>
+#include <czmq.h>
+#include "helpers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  sph.OscMessage wraps a packed OSC message without decoding it. The
+//  address and arguments are decoded when accessed, blobs are memoryviews
+//  into the message and the object exports the packed message through the
+//  buffer protocol. Returned from a handler it is sent as is.
+typedef struct {
+    PyObject_HEAD
+    zframe_t *frame;        // the packed message, owned
+    const byte *data;
+    size_t size;
+    const char *types;      // type tags without the leading ','
+    size_t argstart;        // offset of the first argument
+    Py_ssize_t count;       // number of arguments, arrays are flattened
+    char *tags;             // per argument type tag, NULL until decoded
+    uint32_t *offsets;      // per argument offset
+    PyObject *address;      // cached address string
+} PyOscMessageObject;
+
+//  Exports a run of equally typed OSC numbers as a typed big-endian buffer,
+//  what OscMessage.array() returns a memoryview of
+typedef struct {
+    PyObject_HEAD
+    PyObject *message;      // the OscMessage holding the data
+    const byte *data;
+    Py_ssize_t count;
+    Py_ssize_t itemsize;
+    char format[3];
+} PyOscRunObject;
+
+typedef struct {
+    PyObject *runtype;
+} pyosc_state;
+
+static void
+PyOscRun_dealloc(PyOscRunObject *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_CLEAR(self->message);
+    tp->tp_free((PyObject *) self);
+    Py_DECREF(tp);
+}
+
+static int
+PyOscRun_getbuffer(PyOscRunObject *self, Py_buffer *view, int flags)
+{
+    if ( self->message == NULL || (flags & PyBUF_WRITABLE) )
+    {
+        PyErr_SetString(PyExc_BufferError, "OSC arguments are read only");
+        view->obj = NULL;
+        return -1;
+    }
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->buf = (void *)self->data;
+    view->len = self->count * self->itemsize;
+    view->readonly = 1;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? self->format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &self->count : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyType_Slot PyOscRun_slots[] = {
+    {Py_tp_dealloc, PyOscRun_dealloc},
+    {Py_bf_getbuffer, PyOscRun_getbuffer},
+    {0, NULL}
+};
+
+static PyType_Spec PyOscRun_spec = {
+    .name = "internal.OscRun",
+    .basicsize = sizeof(PyOscRunObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = PyOscRun_slots,
+};
+
+static size_t
+s_osc_padded(size_t len)
+{
+    return (len + 4) & ~(size_t)3;  // string and its terminator on 4 bytes
+}
+
+static uint32_t
+s_osc_u32(const byte *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t
+s_osc_u64(const byte *p)
+{
+    return (uint64_t)s_osc_u32(p) << 32 | s_osc_u32(p + 4);
+}
+
+//  Find the type tags, returns -1 and sets an error if it's not OSC
+static int
+s_pyosc_parse(PyOscMessageObject *self)
+{
+    const byte *end = self->data + self->size;
+    if ( self->size < 8 || self->data[0] != '/' )
+        goto invalid;
+    const byte *nul = (const byte *)memchr(self->data, 0, self->size);
+    if ( nul == NULL )
+        goto invalid;
+    size_t typestart = s_osc_padded(nul - self->data);
+    if ( typestart >= self->size || self->data[typestart] != ',' )
+        goto invalid;
+    nul = (const byte *)memchr(self->data + typestart, 0, self->size - typestart);
+    if ( nul == NULL )
+        goto invalid;
+    self->types = (const char *)self->data + typestart + 1;
+    self->argstart = typestart + s_osc_padded(nul - (self->data + typestart));
+    if ( self->data + self->argstart > end )
+        goto invalid;
+    self->count = 0;
+    for ( const char *t = self->types; *t; t++ )
+        if ( *t != '[' && *t != ']' )
+            self->count++;
+    return 0;
+
+invalid:
+    PyErr_SetString(PyExc_ValueError, "not an OSC message");
+    return -1;
+}
+
+//  Compute the offsets of all arguments on first access
+static int
+s_pyosc_index(PyOscMessageObject *self)
+{
+    if ( self->tags )
+        return 0;
+    char *tags = (char *)PyMem_Malloc(self->count + 1);
+    uint32_t *offsets = (uint32_t *)PyMem_Malloc((self->count + 1) * sizeof(uint32_t));
+    if ( tags == NULL || offsets == NULL )
+    {
+        PyMem_Free(tags);
+        PyMem_Free(offsets);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    size_t off = self->argstart;
+    Py_ssize_t i = 0;
+    for ( const char *t = self->types; *t; t++ )
+    {
+        size_t len = 0;
+        switch (*t)
+        {
+        case '[': case ']':
+            continue;
+        case 'i': case 'f': case 'c': case 'r': case 'm':
+            len = 4; break;
+        case 'h': case 'd': case 't':
+            len = 8; break;
+        case 's': case 'S':
+        {
+            const byte *nul = off < self->size ? (const byte *)memchr(self->data + off, 0, self->size - off) : NULL;
+            if ( nul == NULL )
+                goto invalid;
+            len = s_osc_padded(nul - (self->data + off));
+            break;
+        }
+        case 'b':
+            if ( off + 4 > self->size )
+                goto invalid;
+            len = 4 + ((s_osc_u32(self->data + off) + 3) & ~(size_t)3);
+            break;
+        case 'T': case 'F': case 'N': case 'I':
+            break;
+        default:
+            goto invalid;
+        }
+        if ( off + len > self->size )
+            goto invalid;
+        tags[i] = *t;
+        offsets[i++] = (uint32_t)off;
+        off += len;
+    }
+    tags[i] = 0;
+    self->tags = tags;
+    self->offsets = offsets;
+    return 0;
+
+invalid:
+    PyMem_Free(tags);
+    PyMem_Free(offsets);
+    PyErr_SetString(PyExc_ValueError, "malformed OSC arguments");
+    return -1;
+}
+
+//  Takes ownership of the frame, returns NULL with an error set if it is
+//  not an OSC message
+static PyObject *
+pyosc_from_frame(PyTypeObject *type, zframe_t *frame)
+{
+    PyOscMessageObject *self = (PyOscMessageObject *) type->tp_alloc(type, 0);
+    if (self == NULL)
+    {
+        zframe_destroy(&frame);
+        return NULL;
+    }
+    self->frame = frame;
+    self->data = zframe_data(frame);
+    self->size = zframe_size(frame);
+    if ( s_pyosc_parse(self) < 0 )
+    {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+//  OscMessage(address, [data]) packs the data like a handler's return
+//  value, OscMessage(address, types, [data]) as the type tags, e.g. "iff",
+//  OscMessage(bytes) wraps a packed message
+static PyObject *
+PyOscMessage_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    PyObject *first, *types = NULL, *data = NULL;
+    if ( PyTuple_Size(args) > 2 )
+    {
+        if ( !PyArg_ParseTuple(args, "OUO!", &first, &types, &PyList_Type, &data) )
+            return NULL;
+    }
+    else if ( !PyArg_ParseTuple(args, "O|O!", &first, &PyList_Type, &data) )
+        return NULL;
+
+    zframe_t *frame = NULL;
+    if ( PyUnicode_Check(first) )
+    {
+        PyObject *empty = NULL;
+        if ( data == NULL )
+            data = empty = PyList_New(0);
+        frame = s_py_osc_pack(first, types, data);
+        Py_XDECREF(empty);
+        if ( frame == NULL )
+            return NULL;
+    }
+    else
+    {
+        Py_buffer view;
+        if ( PyObject_GetBuffer(first, &view, PyBUF_SIMPLE) < 0 )
+            return NULL;
+        frame = zframe_new(view.buf, view.len);
+        PyBuffer_Release(&view);
+    }
+    return pyosc_from_frame(type, frame);
+}
+
+static void
+PyOscMessage_dealloc(PyOscMessageObject *self)
+{
+    PyTypeObject *tp = Py_TYPE(self);
+    Py_CLEAR(self->address);
+    PyMem_Free(self->tags);
+    PyMem_Free(self->offsets);
+    zframe_destroy(&self->frame);
+    tp->tp_free((PyObject *) self);
+    Py_DECREF(tp);  // heap types are owned by their instances
+}
+
+static PyObject *
+PyOscMessage_address(PyOscMessageObject *self, void *closure)
+{
+    if ( self->address == NULL )
+        self->address = PyUnicode_DecodeUTF8((const char *)self->data, strlen((const char *)self->data), "replace");
+    Py_XINCREF(self->address);
+    return self->address;
+}
+
+static PyObject *
+PyOscMessage_types(PyOscMessageObject *self, void *closure)
+{
+    return PyUnicode_FromString(self->types);
+}
+
+static Py_ssize_t
+PyOscMessage_length(PyOscMessageObject *self)
+{
+    return self->count;
+}
+
+static PyObject *
+PyOscMessage_item(PyOscMessageObject *self, Py_ssize_t i)
+{
+    if ( i < 0 || i >= self->count )
+    {
+        PyErr_SetString(PyExc_IndexError, "OscMessage index out of range");
+        return NULL;
+    }
+    if ( s_pyosc_index(self) < 0 )
+        return NULL;
+
+    const byte *p = self->data + self->offsets[i];
+    switch (self->tags[i])
+    {
+    case 'i':
+        return PyLong_FromLong((int32_t)s_osc_u32(p));
+    case 'r':
+        return PyLong_FromUnsignedLong(s_osc_u32(p));
+    case 'h':
+        return PyLong_FromLongLong((int64_t)s_osc_u64(p));
+    case 't':
+        return PyLong_FromUnsignedLongLong(s_osc_u64(p));
+    case 'f':
+    {
+        uint32_t v = s_osc_u32(p);
+        float f;
+        memcpy(&f, &v, 4);
+        return PyFloat_FromDouble(f);
+    }
+    case 'd':
+    {
+        uint64_t v = s_osc_u64(p);
+        double d;
+        memcpy(&d, &v, 8);
+        return PyFloat_FromDouble(d);
+    }
+    case 's': case 'S':
+        return PyUnicode_DecodeUTF8((const char *)p, strlen((const char *)p), "replace");
+    case 'c':
+    {
+        char c = (char)s_osc_u32(p);
+        return PyUnicode_FromStringAndSize(&c, 1);
+    }
+    case 'm':
+        return PyBytes_FromStringAndSize((const char *)p, 4);
+    case 'b':
+    {
+        // a view into our buffer, keeps the message alive
+        PyObject *view = PyMemoryView_FromObject((PyObject *)self);
+        if ( view == NULL )
+            return NULL;
+        Py_ssize_t start = self->offsets[i] + 4;
+        PyObject *blob = PySequence_GetSlice(view, start, start + s_osc_u32(p));
+        Py_DECREF(view);
+        return blob;
+    }
+    case 'T':
+        Py_RETURN_TRUE;
+    case 'F':
+        Py_RETURN_FALSE;
+    default:    // N and I
+        Py_RETURN_NONE;
+    }
+}
+
+//  Iterating or unpacking touches all arguments, decode them at once. Not
+//  cached as blobs refer back to us.
+static PyObject *
+PyOscMessage_iter(PyOscMessageObject *self)
+{
+    PyObject *args = PyTuple_New(self->count);
+    for ( Py_ssize_t i = 0; args && i < self->count; i++ )
+    {
+        PyObject *item = PyOscMessage_item(self, i);
+        if ( item == NULL )
+            Py_CLEAR(args);
+        else
+            PyTuple_SET_ITEM(args, i, item);
+    }
+    if ( args == NULL )
+        return NULL;
+    PyObject *iter = PyObject_GetIter(args);
+    Py_DECREF(args);
+    return iter;
+}
+
+static PyObject *
+PyOscMessage_subscript(PyOscMessageObject *self, PyObject *key)
+{
+    if ( PySlice_Check(key) )
+    {
+        Py_ssize_t start, stop, step;
+        if ( PySlice_Unpack(key, &start, &stop, &step) < 0 )
+            return NULL;
+        Py_ssize_t n = PySlice_AdjustIndices(self->count, &start, &stop, step);
+        PyObject *ret = PyTuple_New(n);
+        for ( Py_ssize_t i = 0; ret && i < n; i++ )
+        {
+            PyObject *item = PyOscMessage_item(self, start + i * step);
+            if ( item == NULL )
+                Py_CLEAR(ret);
+            else
+                PyTuple_SET_ITEM(ret, i, item);
+        }
+        return ret;
+    }
+    Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if ( i == -1 && PyErr_Occurred() )
+        return NULL;
+    if ( i < 0 )
+        i += self->count;
+    return PyOscMessage_item(self, i);
+}
+
+//  array(index=0, native=False) returns the run of equally typed numbers
+//  starting at index as a memoryview without decoding them. It's in OSC
+//  byte order, numpy.asarray() takes it as is, native=True returns a copy
+//  in the machine's byte order. A blob returns its memoryview.
+static PyObject *
+PyOscMessage_array(PyOscMessageObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"index", "native", NULL};
+    Py_ssize_t index = 0;
+    int native = 0;
+    if ( !PyArg_ParseTupleAndKeywords(args, kwds, "|np", kwlist, &index, &native) )
+        return NULL;
+    if ( index < 0 )
+        index += self->count;
+    if ( index < 0 || index >= self->count )
+    {
+        PyErr_SetString(PyExc_IndexError, "OscMessage index out of range");
+        return NULL;
+    }
+    if ( s_pyosc_index(self) < 0 )
+        return NULL;
+
+    char tag = self->tags[index];
+    if ( tag == 'b' )
+        return PyOscMessage_item(self, index);
+    char format = tag == 'f' ? 'f' : tag == 'd' ? 'd' : tag == 'i' ? 'i' : tag == 'h' ? 'q' : 0;
+    if ( format == 0 )
+        return PyErr_Format(PyExc_TypeError, "argument %zd of type '%c' is not a number", index, tag);
+
+    Py_ssize_t count = 1;
+    while ( index + count < self->count && self->tags[index + count] == tag )
+        count++;
+    Py_ssize_t itemsize = tag == 'f' || tag == 'i' ? 4 : 8;
+    const byte *data = self->data + self->offsets[index];
+
+    if ( native )
+    {
+        PyObject *copy = PyByteArray_FromStringAndSize(NULL, count * itemsize);
+        if ( copy == NULL )
+            return NULL;
+        byte *dst = (byte *)PyByteArray_AS_STRING(copy);
+        for ( Py_ssize_t i = 0; i < count; i++, data += itemsize, dst += itemsize )
+        {
+            if ( itemsize == 4 )
+            {
+                uint32_t v = s_osc_u32(data);
+                memcpy(dst, &v, 4);
+            }
+            else
+            {
+                uint64_t v = s_osc_u64(data);
+                memcpy(dst, &v, 8);
+            }
+        }
+        PyObject *bytesview = PyMemoryView_FromObject(copy);
+        Py_DECREF(copy);
+        if ( bytesview == NULL )
+            return NULL;
+        PyObject *view = PyObject_CallMethod(bytesview, "cast", "C", format);
+        Py_DECREF(bytesview);
+        return view;
+    }
+
+    pyosc_state *state = (pyosc_state *)PyType_GetModuleState(Py_TYPE(self));
+    if ( state == NULL )
+        return NULL;
+    PyOscRunObject *run = (PyOscRunObject *)((PyTypeObject *)state->runtype)->tp_alloc((PyTypeObject *)state->runtype, 0);
+    if ( run == NULL )
+        return NULL;
+    Py_INCREF(self);
+    run->message = (PyObject *)self;
+    run->data = data;
+    run->count = count;
+    run->itemsize = itemsize;
+    run->format[0] = '>';
+    run->format[1] = format;
+    PyObject *view = PyMemoryView_FromObject((PyObject *)run);
+    Py_DECREF(run);
+    return view;
+}
+
+static PyMethodDef PyOscMessage_methods[] = {
+    {"array", (PyCFunction)(void(*)(void)) PyOscMessage_array, METH_VARARGS | METH_KEYWORDS,
+     "array(index=0, native=False): memoryview of the run of equally typed numbers at index"},
+    {NULL}  /* Sentinel */
+};
+
+static int
+PyOscMessage_getbuffer(PyOscMessageObject *self, Py_buffer *view, int flags)
+{
+    return PyBuffer_FillInfo(view, (PyObject *)self, (void *)self->data, (Py_ssize_t)self->size, 1, flags);
+}
+
+static PyObject *
+PyOscMessage_repr(PyOscMessageObject *self)
+{
+    PyObject *address = PyOscMessage_address(self, NULL);
+    PyObject *all = PySlice_New(NULL, NULL, NULL);
+    PyObject *args = address && all ? PyOscMessage_subscript(self, all) : NULL;
+    PyObject *ret = args ? PyUnicode_FromFormat("OscMessage(%R, %R)", address, args) : NULL;
+    Py_XDECREF(address);
+    Py_XDECREF(all);
+    Py_XDECREF(args);
+    return ret;
+}
+
+static PyGetSetDef PyOscMessage_getset[] = {
+    {"address", (getter) PyOscMessage_address, NULL, "The OSC address", NULL},
+    {"types", (getter) PyOscMessage_types, NULL, "The OSC type tags without the leading ','", NULL},
+    {NULL}  /* Sentinel */
+};
+
+static PyType_Slot PyOscMessage_slots[] = {
+    {Py_tp_new, PyOscMessage_new},
+    {Py_tp_dealloc, PyOscMessage_dealloc},
+    {Py_tp_repr, PyOscMessage_repr},
+    {Py_tp_getset, PyOscMessage_getset},
+    {Py_tp_methods, PyOscMessage_methods},
+    {Py_tp_iter, PyOscMessage_iter},
+    {Py_sq_length, PyOscMessage_length},
+    {Py_sq_item, PyOscMessage_item},
+    {Py_mp_length, PyOscMessage_length},
+    {Py_mp_subscript, PyOscMessage_subscript},
+    {Py_bf_getbuffer, PyOscMessage_getbuffer},
+    {Py_tp_doc, "OSC message decoded on access. OscMessage(address, [data]) or OscMessage(packed bytes)"},
+    {0, NULL}
+};
+
+static PyType_Spec PyOscMessage_spec = {
+    .name = "sph.OscMessage",
+    .basicsize = sizeof(PyOscMessageObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT,
+    .slots = PyOscMessage_slots,
+};
+
+static int
+pyosc_add_type(PyObject *m)
+{
+    pyosc_state *state = (pyosc_state *)PyModule_GetState(m);
+    state->runtype = PyType_FromModuleAndSpec(m, &PyOscRun_spec, NULL);
+    if (state->runtype == NULL)
+        return -1;
+
+    PyObject *type = PyType_FromModuleAndSpec(m, &PyOscMessage_spec, NULL);
+    if (type == NULL)
+        return -1;
+
+    if (PyModule_AddObject(m, "OscMessage", type) < 0) {
+        Py_DECREF(type);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+pyosc_traverse(PyObject *m, visitproc visit, void *arg)
+{
+    pyosc_state *state = (pyosc_state *)PyModule_GetState(m);
+    Py_VISIT(state->runtype);
+    return 0;
+}
+
+static int
+pyosc_clear(PyObject *m)
+{
+    pyosc_state *state = (pyosc_state *)PyModule_GetState(m);
+    Py_CLEAR(state->runtype);
+    return 0;
+}
+
+static void
+pyosc_free(void *m)
+{
+    pyosc_clear((PyObject *)m);
+}
+
+#ifdef __cplusplus
+} // end extern
+#endif
+#endif // PYOSC_H
@@ -1,3 +1,6 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE 1   // memfd_create and pipe2, as defined by Python.h
+#endif
 #include "pythonactor.h"
 #include "helpers.h"
 #include "pyzmsg.h"
@@ -8,11 +11,204 @@
 #elif defined(__WINDOWS__)
 #include <windows.h>
 #endif
-#ifdef __UTYPE_LINUX
-#include <sys/inotify.h>
+
+//  Enter python to run code of this actor. The shared interpreter is
+//  entered through the GIL state API, which is not compatible with
+//  subinterpreters, so isolated actors swap to their own thread state.
+//  https://docs.python.org/3/c-api/init.html#c.PyGILState_Ensure
+static void
+s_pythonactor_enter(pythonactor_t *self)
+{
+    int64_t start = self->profile ? zclock_usecs() : 0;
+    if (self->tstate)
+        PyEval_RestoreThread(self->tstate);
+    else
+        self->gstate = PyGILState_Ensure();
+    if ( self->profile )
+    {
+        self->profwait += zclock_usecs() - start;
+        self->profenters++;
+    }
+}
+
+static void
+s_pythonactor_leave(pythonactor_t *self)
+{
+    if (self->tstate)
+        PyEval_SaveThread();
+    else
+        PyGILState_Release(self->gstate);
+}
+
+//  Create an own interpreter with its own GIL (PEP 684) so this actor runs
+//  in parallel with other python actors. Must be called from the actor's
+//  thread as the thread state is bound to it.
+static bool
+s_pythonactor_isolate(pythonactor_t *self)
+{
+    assert(self->tstate == NULL);
+#if PY_VERSION_HEX >= 0x030C0000
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    PyThreadState *main_tstate = PyThreadState_Get();
+
+    // copy the search path of the main interpreter
+    zlist_t *paths = zlist_new();
+    zlist_autofree(paths);
+    PyObject *path = PySys_GetObject("path");
+    for (Py_ssize_t i = 0; path && i < PyList_Size(path); i++)
+    {
+        const char *p = PyUnicode_AsUTF8(PyList_GetItem(path, i));
+        if (p)
+            zlist_append(paths, (void *)p);
+        else
+            PyErr_Clear();
+    }
+
+    PyInterpreterConfig config = {
+        .use_main_obmalloc = 0,
+        .allow_fork = 0,
+        .allow_exec = 0,
+        .allow_threads = 1,
+        .allow_daemon_threads = 0,
+        .check_multi_interp_extensions = 1,
+        .gil = PyInterpreterConfig_OWN_GIL,
+    };
+    // on success we're in the new interpreter holding its GIL
+    PyStatus status = Py_NewInterpreterFromConfig(&self->tstate, &config);
+    if ( PyStatus_Exception(status) )
+    {
+        zsys_error("pythonactor: could not create an isolated interpreter: %s", status.err_msg ? status.err_msg : "unknown error");
+        self->tstate = NULL;
+        PyGILState_Release(gstate);
+        zlist_destroy(&paths);
+        return false;
+    }
+
+    PyObject *newpath = PyList_New(0);
+    for (const char *p = (const char *)zlist_first(paths); p; p = (const char *)zlist_next(paths))
+    {
+        PyObject *item = PyUnicode_DecodeFSDefault(p);
+        PyList_Append(newpath, item);
+        Py_DECREF(item);
+    }
+    PySys_SetObject("path", newpath);
+    Py_DECREF(newpath);
+    zlist_destroy(&paths);
+
+    PyObject *imp = PyImport_ImportModule("sph");
+    if (imp == NULL)
+        PyErr_Print();
+    Py_XDECREF(imp);
+
+    // release our GIL and return to the main interpreter to release its state
+    PyEval_SaveThread();
+    PyEval_RestoreThread(main_tstate);
+    PyGILState_Release(gstate);
+    return true;
+#else
+    zsys_warning("pythonactor: isolated actors need Python 3.12 or newer, using the shared interpreter");
+    return false;
+#endif
+}
+
+//  Destroy the own interpreter, its objects must be released already
+static void
+s_pythonactor_end_interpreter(pythonactor_t *self)
+{
+    if (self->tstate == NULL)
+        return;
+    PyEval_RestoreThread(self->tstate);
+    Py_EndInterpreter(self->tstate);
+    self->tstate = NULL;
+}
 
 zmsg_t *
 s_pythonactor_set_file(pythonactor_t *self, const char *filename);
+void
+s_py_set_timeout(pythonactor_t *self, sphactor_event_t *ev);
+static void
+s_py_set_pollfd(pythonactor_t *self, sphactor_actor_t *actor);
+
+#ifdef __UTYPE_LINUX
+#define PROCESS_RESTART_MIN     100     // ms before the first restart of a crashed child
+static void
+s_process_load(pythonactor_t *self, sphactor_actor_t *actor, const char *filename);
+static zmsg_t *
+s_process_handle_msg(pythonactor_t *self, sphactor_event_t *ev);
+static int
+s_process_stop(pythonactor_t *self, sphactor_actor_t *actor, bool quit);
+static void
+s_process_ensure(pythonactor_t *self, sphactor_actor_t *actor);
+static void
+s_process_names(pythonactor_t *self, sphactor_event_t *ev);
+#endif
+
+//  Set the actor's timeout, while a changed file settles it's applied after
+//  the reload
+static void
+s_pythonactor_set_timeout(pythonactor_t *self, sphactor_actor_t *actor, int64_t timeout)
+{
+    if ( self->reloadat )
+        self->reloadtimeout = timeout;
+    else if ( timeout != sphactor_actor_timeout(actor) )
+        sphactor_actor_set_timeout(actor, timeout);
+}
+
+//  Report how long the last (re)load took, the child process and the
+//  profile, a report replaces the previous one so it holds them all
+static void
+s_pythonactor_report(pythonactor_t *self, sphactor_actor_t *actor)
+{
+    if ( actor == NULL )
+        return;
+    char stat[32];
+    zosc_t *msg = zosc_new("/report");
+    if ( self->loaded )
+    {
+        snprintf(stat, sizeof(stat), "%.2f", self->loadtime / 1000.0);
+        zosc_append(msg, "ssss", "Load ms", stat, "Module", self->loaded);
+    }
+    if ( self->process )
+        zosc_append(msg, "sisisi",
+                    "Process", self->procpid,
+                    "Restarts", self->restarts,
+                    "Dropped", self->dropped);
+    if ( self->pyprofiler && self->proftop )
+    {
+        zosc_append(msg, "si", "Calls", (int)self->proflastcalls);
+        snprintf(stat, sizeof(stat), "%.1f", self->proflasthandler);
+        zosc_append(msg, "ss", "Handler usec", stat);
+        snprintf(stat, sizeof(stat), "%.1f", self->proflastsocket);
+        zosc_append(msg, "ss", "handleSocket usec", stat);
+        snprintf(stat, sizeof(stat), "%.1f", self->proflastwait);
+        zosc_append(msg, "ss", "GIL wait usec", stat);
+        zosc_append(msg, "ss", "Top", self->proftop);
+    }
+    sphactor_actor_set_custom_report_data(actor, msg);
+}
+
+//  (Re)load the script in our interpreter or in the child process
+static void
+s_pythonactor_reload(pythonactor_t *self, sphactor_actor_t *actor, const char *filename)
+{
+#ifdef __UTYPE_LINUX
+    if ( self->process )
+    {
+        s_process_load(self, actor, filename);
+        return;
+    }
+#endif
+    s_pythonactor_enter(self);
+    s_pythonactor_set_file(self, filename);
+    s_py_set_pollfd(self, actor);
+    s_pythonactor_leave(self);
+    s_pythonactor_report(self, actor);
+}
+
+#ifdef __UTYPE_LINUX
+#include <sys/inotify.h>
+
+#define INOTIFY_SETTLE_MS       50      // ms without file events before reloading
 
 static void
 s_handle_inotify_events(pythonactor_t *self, sphactor_actor_t *actorinst, int fd, int *wd)
@@ -27,50 +223,69 @@ s_handle_inotify_events(pythonactor_t *self, sphactor_actor_t *actorinst, int fd
        __attribute__ ((aligned(__alignof__(struct inotify_event))));
    const struct inotify_event *event;
    ssize_t len;
-
-   // TODO: We might need to loop on read until we have no events left?
-   /* If the nonblocking read() found no events to read, then
-      it returns -1 with errno set to EAGAIN. In that case,
-      we exit the loop. */
-
-   len = read(fd, buf, sizeof(buf));
+   bool changed = false;
+
+   /* Read until the nonblocking read() finds no events left, it
+      returns -1 with errno set to EAGAIN then. */
+   while ( (len = read(fd, buf, sizeof(buf))) > 0 ) {
+
+       /* Loop over all events in the buffer. */
+
+       for (char *ptr = buf; ptr < buf + len;
+               ptr += sizeof(struct inotify_event) + event->len) {
+
+           event = (const struct inotify_event *) ptr;
+
+           if ( event->mask & IN_DELETE_SELF || event->mask & IN_DELETE )
+           {
+               zsys_warning("Watched file %s is deleted", self->main_filename);
+               if ( self->reloadat )
+               {
+                   self->reloadat = 0;
+                   s_pythonactor_set_timeout(self, actorinst, self->reloadtimeout);
+               }
+               s_pythonactor_reload(self, actorinst, "");
+               return;
+           }
+           changed = true;
+       }
+   }
    if (len == -1 && errno != EAGAIN) {
        zsys_error("Inotify read failure");
    }
 
-   if (len <= 0)
-       return;
-
-   /* Loop over all events in the buffer. */
-
-   for (char *ptr = buf; ptr < buf + len;
-           ptr += sizeof(struct inotify_event) + event->len) {
-
-       event = (const struct inotify_event *) ptr;
-
-       if ( event->mask & IN_DELETE_SELF || event->mask & IN_DELETE )
-       {
-           zsys_warning("Watched file %s is deleted", self->main_filename);
-           PyGILState_STATE gstate;
-           gstate = PyGILState_Ensure();
-           s_pythonactor_set_file(self, "");
-           PyGILState_Release(gstate);
-           return;
-       }
-       /*
-       if (event->mask & IN_MODIFY)
-           printf("IN_MODIFY: ");
-       if (event->mask & IN_CLOSE_WRITE)
-           printf("IN_CLOSE_WRITE: ");
-       if (event->mask & IN_MOVE_SELF)
-           printf("IN_MOVE_SELF: ");
-        */
-       PyGILState_STATE gstate;
-       gstate = PyGILState_Ensure();
-       s_pythonactor_set_file(self, self->main_filename);
-       PyGILState_Release(gstate);
+   /* Editors often write a file in several steps, the actor's timer
+      reloads it once no more events came for a while. */
+   if ( changed )
+   {
+       if ( self->reloadat == 0 )
+           self->reloadtimeout = sphactor_actor_timeout(actorinst);
+       self->reloadat = zclock_mono() + INOTIFY_SETTLE_MS;
+       sphactor_actor_set_timeout(actorinst, INOTIFY_SETTLE_MS);
    }
-   fflush(stdout);
+}
+
+//  Timer event while the changed file settles, reloads it when it did
+static void
+s_handle_inotify_timer(pythonactor_t *self, sphactor_event_t *ev)
+{
+    sphactor_actor_t *actor = (sphactor_actor_t *)ev->actor;
+    int64_t wait = self->reloadat - zclock_mono();
+    if ( wait > 0 )
+    {
+        sphactor_actor_set_timeout(actor, wait);
+        return;
+    }
+    self->reloadat = 0;
+    sphactor_actor_set_timeout(actor, self->reloadtimeout);
+    // reloading skips the script when its content didn't change
+    s_pythonactor_reload(self, actor, self->main_filename);
+    if ( ! self->process && self->pyinstance )
+    {
+        s_pythonactor_enter(self);
+        s_py_set_timeout(self, ev);
+        s_pythonactor_leave(self);
+    }
 }
 
 static void
@@ -98,7 +313,7 @@ s_init_inotify(pythonactor_t *self, const char *filename, sphactor_actor_t *acto
     if (self->fd != -1)
         s_destroy_inotify(self, actorinst);
 
-    self->fd = inotify_init1(0);
+    self->fd = inotify_init1(IN_NONBLOCK);
     //zsys_info("Inotify fd is %i", self->fd);
     /*checking for error*/
     if (self->fd == -1)
@@ -125,6 +340,32 @@ s_init_inotify(pythonactor_t *self, const char *filename, sphactor_actor_t *acto
 static const char *pythonactorcapabilities =
         "capabilities\n"
         "    data\n"
+        "        name = \"isolated\"\n"
+        "        type = \"bool\"\n"
+        "        help = \"Run in an own interpreter with its own GIL, in parallel with other python actors (Python 3.12+). Extensions without sub-interpreter support, like numpy, cannot be imported then\"\n"
+        "        value = \"False\"\n"
+        "        api_call = \"SET ISOLATED\"\n"
+        "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"process\"\n"
+        "        type = \"bool\"\n"
+        "        help = \"Run in a child process which is restarted when it crashes (Linux)\"\n"
+        "        value = \"False\"\n"
+        "        api_call = \"SET PROCESS\"\n"
+        "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"profile\"\n"
+        "        type = \"bool\"\n"
+        "        help = \"Profile the handlers with cProfile and show the results in the report\"\n"
+        "        value = \"False\"\n"
+        "        api_call = \"SET PROFILE\"\n"
+        "        api_value = \"s\"\n"
+        "    data\n"
+        "        name = \"dump profile\"\n"
+        "        type = \"trigger\"\n"
+        "        help = \"Write the profile to a .pstats file next to the script\"\n"
+        "        api_call = \"DUMP PROFILE\"\n"
+        "    data\n"
         "        name = \"pyfile\"\n"
         "        type = \"filename\"\n"
         "        valid_files = \".py\"\n"
@@ -241,177 +482,569 @@ s_py_zosc_tuple(pythonactor_t *self, zosc_t *oscmsg)
     return rettuple;
 }
 
+//  Borrowed attribute of the instance, NULL without an error if it's not set
+static PyObject *
+s_py_member(PyObject *instance, PyObject *name)
+{
+    PyObject *member = NULL;
+#if PY_VERSION_HEX >= 0x030D0000
+    PyObject_GetOptionalAttr(instance, name, &member);
+#else
+    _PyObject_LookupAttr(instance, name, &member);
+#endif
+    PyErr_Clear();
+    return member;
+}
+
+//  Apply a timeout set with sph.set_timeout() or a change of the timeout
+//  member. The member is only converted when its value object changed.
 void
 s_py_set_timeout(pythonactor_t *self, sphactor_event_t *ev)
 {
     assert(self);
-    // get the optional timeout member to set the actor's timeout value
-    PyObject *pTimeOut = PyObject_GetAttrString(self->pyinstance, "timeout");
-    if (pTimeOut != NULL)
+    int64_t timeout;
+    if ( s_sph_timeout_set )
     {
-        // we have a timeout member
-        long tm = PyLong_AsLong(pTimeOut);
-        if ((int64_t)tm != sphactor_actor_timeout((sphactor_actor_t*)ev->actor) )
+        timeout = s_sph_timeout;
+        s_sph_timeout_set = false;
+    }
+    else
+    {
+        // get the optional timeout member to set the actor's timeout value
+        PyObject *pTimeOut = s_py_member(self->pyinstance, self->pytimeoutkey);
+        if ( pTimeOut == self->pytimeout && pTimeOut != NULL )
         {
-            sphactor_actor_set_timeout((sphactor_actor_t*)ev->actor, (int64_t)tm);
+            Py_DECREF(pTimeOut);
+            return;
         }
-        Py_DECREF(pTimeOut);
+        Py_XSETREF(self->pytimeout, pTimeOut);
+        if (pTimeOut != NULL)
+        {
+            // we have a timeout member
+            timeout = PyLong_AsLongLong(pTimeOut);
+            if ( timeout == -1 && PyErr_Occurred() )
+                PyErr_Print();
+        }
+        else    // if we do not find a timeout member we revert to infinite wait (-1)
+            timeout = -1;
     }
-    else    // if we do not find a timeout member we revert to infinite wait (-1)
-        sphactor_actor_set_timeout((sphactor_actor_t*)ev->actor, (int64_t)-1);
+    self->timeout = timeout;
+    // in a child process the parent sets it
+    if ( ev->actor )
+        s_pythonactor_set_timeout(self, (sphactor_actor_t*)ev->actor, timeout);
 }
 
-zmsg_t *
-s_pythonactor_set_file(pythonactor_t *self, const char *filename)
+//  Borrowed python string of str, only rebuilt when str changes
+static PyObject *
+s_py_str(PyObject **cache, const char *str)
 {
-    if ( streq(filename, "") )
+    if ( *cache == NULL || strcmp(PyUnicode_AsUTF8(*cache), str) != 0 )
+        Py_XSETREF(*cache, PyUnicode_InternFromString(str));
+    return *cache;
+}
+
+//  Profiling
+//
+//  In the shared interpreter the profiler is only enabled during the handler
+//  calls, so python code of other actors doesn't end up in the profile. An
+//  isolated actor has the interpreter to itself, there it stays enabled as
+//  toggling it is expensive since Python 3.12. The number of calls, their
+//  time and the time waiting for the GIL are reported per interval, the
+//  functions taking the most time since profiling started with the top of
+//  the profile.
+#define PROFILE_REPORT_INTERVAL 1000    // ms
+#define PROFILE_TOP             5       // functions in the report
+
+static void
+s_py_profile_enable(pythonactor_t *self, bool enable)
+{
+    PyObject *rc = PyObject_CallNoArgs(enable ? self->pyprofenable : self->pyprofdisable);
+    if ( rc == NULL )
+        PyErr_Print();
+    Py_XDECREF(rc);
+}
+
+static void
+s_py_profile_clear(pythonactor_t *self)
+{
+    if ( self->pyprofdisable )
+        s_py_profile_enable(self, false);
+    Py_CLEAR(self->pyprofiler);
+    Py_CLEAR(self->pyprofenable);
+    Py_CLEAR(self->pyprofdisable);
+    self->profcalls = self->profsocketcalls = self->profenters = 0;
+    self->proftime = self->profsockettime = self->profwait = 0;
+    zstr_free(&self->proftop);
+}
+
+static bool
+s_py_profile_start(pythonactor_t *self)
+{
+    PyObject *cprofile = PyImport_ImportModule("cProfile");
+    self->pyprofiler = cprofile ? PyObject_CallMethod(cprofile, "Profile", NULL) : NULL;
+    Py_XDECREF(cprofile);
+    if ( self->pyprofiler )
     {
-        self->fd = -1;
-        self->wd = -1;
-        Py_CLEAR(self->pyinstance);
-        Py_CLEAR(self->pymodule);
-        return NULL;
+        self->pyprofenable = PyObject_GetAttrString(self->pyprofiler, "enable");
+        self->pyprofdisable = PyObject_GetAttrString(self->pyprofiler, "disable");
     }
+    if ( self->pyprofenable == NULL || self->pyprofdisable == NULL )
+    {
+        PyErr_Print();
+        zsys_error("pythonactor: can't create a profiler, profiling is disabled");
+        s_py_profile_clear(self);
+        self->profile = false;
+        return false;
+    }
+    self->profreported = zclock_mono();
+    if ( self->tstate )
+        s_py_profile_enable(self, true);
+    return true;
+}
 
-    char *filebasename = s_basename(filename);
-    char *pyname = s_remove_ext(filebasename);
+static PyObject *
+s_py_call_profiled(pythonactor_t *self, PyObject *method, PyObject *const *args, size_t nargs)
+{
+    if ( self->pyprofiler == NULL && ! s_py_profile_start(self) )
+        return PyObject_Vectorcall(method, args, nargs | PY_VECTORCALL_ARGUMENTS_OFFSET, NULL);
+
+    if ( self->tstate == NULL )
+        s_py_profile_enable(self, true);
+    int64_t start = zclock_usecs();
+    PyObject *ret = PyObject_Vectorcall(method, args, nargs | PY_VECTORCALL_ARGUMENTS_OFFSET, NULL);
+    int64_t time = zclock_usecs() - start;
+    if ( self->tstate == NULL )
+    {
+        // keep the exception of the handler while disabling
+        PyObject *type, *value, *traceback;
+        PyErr_Fetch(&type, &value, &traceback);
+        s_py_profile_enable(self, false);
+        PyErr_Restore(type, value, traceback);
+    }
 
-    // Load or reload the module
-    // first check if we need to reload
-    if (self->pymodule && self->main_filename && streq(filename, self->main_filename) )
+    self->profcalls++;
+    self->proftime += time;
+    if ( method == self->pysocket || method == self->pybatch )
     {
-        PyObject *pyreloaded = PyImport_ReloadModule(self->pymodule);
-        if (pyreloaded == NULL)
-        {
-            if ( PyErr_Occurred() )
-                PyErr_Print();
-            zsys_error("Error reloading module %s", filename);
-            zstr_free(&pyname);
-            zstr_free(&filebasename);
-            return NULL;
-        }
-        Py_CLEAR(self->pymodule);
-        self->pymodule = pyreloaded;
+        self->profsocketcalls++;
+        self->profsockettime += time;
+    }
+    return ret;
+}
+
+//  The functions with the most time spent in themselves, one per line
+static void
+s_py_profile_top(pythonactor_t *self, char *buf, size_t size)
+{
+    buf[0] = 0;
+    PyObject *stats = PyObject_CallMethod(self->pyprofiler, "getstats", NULL);
+    if ( stats == NULL || ! PyList_Check(stats) )
+    {
+        PyErr_Print();
+        Py_XDECREF(stats);
+        return;
     }
-    else // load python file (module) normally
+    PyObject *top[PROFILE_TOP] = { NULL };
+    double toptime[PROFILE_TOP] = { 0 };
+    for ( Py_ssize_t i = 0; i < PyList_GET_SIZE(stats); i++ )
     {
-        //  import our python file
-        PyObject *pName;
-        pName = PyUnicode_DecodeFSDefault( pyname );
-        if ( pName == NULL )
-        {
-            if ( PyErr_Occurred() )
-                PyErr_Print();
-            zsys_error("error loading %s", pyname);
-            zstr_free(&pyname);
-            zstr_free(&filebasename);
-            return NULL;
-        }
+        PyObject *entry = PyList_GET_ITEM(stats, i);
+        PyObject *inlinetime = PyObject_GetAttrString(entry, "inlinetime");
+        double time = inlinetime ? PyFloat_AsDouble(inlinetime) : -1.;
+        Py_XDECREF(inlinetime);
+        PyErr_Clear();
+        int n = PROFILE_TOP;
+        while ( n > 0 && (top[n - 1] == NULL || time > toptime[n - 1]) )
+            n--;
+        if ( n == PROFILE_TOP )
+            continue;
+        memmove(top + n + 1, top + n, (PROFILE_TOP - n - 1) * sizeof(*top));
+        memmove(toptime + n + 1, toptime + n, (PROFILE_TOP - n - 1) * sizeof(*toptime));
+        top[n] = entry;
+        toptime[n] = time;
+    }
 
-        //  we loaded the file now import it
-        Py_CLEAR(self->pymodule);
-        self->pymodule = PyImport_Import( pName );
-        if ( self->pymodule == NULL )
+    size_t len = 0;
+    for ( int n = 0; n < PROFILE_TOP && top[n] && len < size; n++ )
+    {
+        // code objects or a description of a builtin
+        PyObject *code = PyObject_GetAttrString(top[n], "code");
+        if ( code && PyCode_Check(code) )
         {
-            if ( PyErr_Occurred() )
-                PyErr_Print();
-            zsys_error("error importing %s", filename);
-            Py_DECREF(pName);
-            zstr_free(&pyname);
-            zstr_free(&filebasename);
-            return NULL;
+            PyCodeObject *co = (PyCodeObject *)code;
+            char *file = s_basename(PyUnicode_AsUTF8(co->co_filename));
+            len += snprintf(buf + len, size - len, "%s%.1f ms %s (%s:%i)", n ? "\n" : "", toptime[n] * 1000.,
+                            PyUnicode_AsUTF8(co->co_name), file, co->co_firstlineno);
+            zstr_free(&file);
         }
-        Py_DECREF(pName);
-        // to be sure we have the updated code we also reload the module (workaround for loading updated file in new actor)
-        PyObject *pyreloaded = PyImport_ReloadModule(self->pymodule);
-        if (pyreloaded == NULL)
+        else if ( code )
         {
-            if ( PyErr_Occurred() )
-                PyErr_Print();
-            zsys_error("Error reloading module on fresh load %s", filename);
-            zstr_free(&pyname);
-            zstr_free(&filebasename);
-            return NULL;
+            PyObject *str = PyObject_Str(code);
+            len += snprintf(buf + len, size - len, "%s%.1f ms %s", n ? "\n" : "", toptime[n] * 1000.,
+                            str ? PyUnicode_AsUTF8(str) : "?");
+            Py_XDECREF(str);
         }
-        Py_CLEAR(self->pymodule);
-        self->pymodule = pyreloaded;
+        Py_XDECREF(code);
+        PyErr_Clear();
     }
-    // load the class
-    //  get the class with the same name as the filename
-    PyObject *pClass = PyObject_GetAttrString(self->pymodule, pyname );
-    if (pClass == NULL )
+    Py_DECREF(stats);
+}
+
+static void
+s_py_profile_report(pythonactor_t *self, sphactor_event_t *ev)
+{
+    if ( self->pyprofiler == NULL || ev->actor == NULL
+         || zclock_mono() - self->profreported < PROFILE_REPORT_INTERVAL )
+        return;
+
+    char top[1024];
+    s_py_profile_top(self, top, sizeof(top));
+    zstr_free(&self->proftop);
+    self->proftop = strdup(top);
+    self->proflastcalls = self->profcalls;
+    self->proflasthandler = self->profcalls ? (double)self->proftime / self->profcalls : 0.0;
+    self->proflastsocket = self->profsocketcalls ? (double)self->profsockettime / self->profsocketcalls : 0.0;
+    self->proflastwait = self->profenters ? (double)self->profwait / self->profenters : 0.0;
+    s_pythonactor_report(self, (sphactor_actor_t *)ev->actor);
+
+    self->profcalls = self->profsocketcalls = self->profenters = 0;
+    self->proftime = self->profsockettime = self->profwait = 0;
+    self->profreported = zclock_mono();
+}
+
+//  Write the profile in the pstats format next to the script
+static void
+s_py_profile_dump(pythonactor_t *self)
+{
+    if ( self->pyprofiler == NULL || self->main_filename == NULL )
     {
-        if (PyErr_Occurred())
-            PyErr_Print();
-        zsys_error("pClass is NULL");
-        Py_CLEAR(self->pymodule);
-        zstr_free(&pyname);
-        zstr_free(&filebasename);
-        return NULL;
+        zsys_warning("pythonactor: no profile to write, enable profiling first");
+        return;
+    }
+    char *path = s_remove_ext(self->main_filename);
+    char *pstats = zsys_sprintf("%s.pstats", path);
+    PyObject *rc = PyObject_CallMethod(self->pyprofiler, "dump_stats", "s", pstats);
+    if ( rc == NULL )
+    {
+        PyErr_Print();
+        zsys_error("pythonactor: can't write the profile to %s", pstats);
     }
+    else
+        zsys_info("pythonactor: profile written to %s", pstats);
+    Py_XDECREF(rc);
+    // writing disabled it
+    if ( self->tstate )
+        s_py_profile_enable(self, true);
+    zstr_free(&pstats);
+    zstr_free(&path);
+}
 
-    // instanciate the class and optionally destroy the old instance
-    // create an instance of the class
-    Py_CLEAR(self->pyinstance);
-    self->pyinstance = PyObject_CallObject((PyObject *) pClass, NULL);
-    if (self->pyinstance == NULL )
+//  Call a cached handler method with the given arguments followed by the
+//  event's type, name and uuid
+static PyObject *
+s_py_call_handler(pythonactor_t *self, PyObject *method, sphactor_event_t *ev, PyObject *arg1, PyObject *arg2)
+{
+    if ( method == NULL )
     {
-        if (PyErr_Occurred())
-            PyErr_Print();
-        zsys_error("pClass instance is NULL");
-        Py_DECREF(pClass);
-        Py_DECREF(self->pymodule);
-        self->pymodule = NULL;
-        zstr_free(&pyname);
-        zstr_free(&filebasename);
+        PyErr_SetString(PyExc_AttributeError, "the actor doesn't define this handler");
         return NULL;
     }
-    zsys_info("Successfully (re)loaded %s", filename);
+    // the first slot is free for the method to put the instance in
+    PyObject *args[6] = { NULL };
+    size_t nargs = 0;
+    if ( arg1 )
+        args[1 + nargs++] = arg1;
+    if ( arg2 )
+        args[1 + nargs++] = arg2;
+    args[1 + nargs++] = s_py_str(&self->pytype, ev->type);
+    args[1 + nargs++] = s_py_str(&self->pyname, ev->name);
+    args[1 + nargs++] = s_py_str(&self->pyuuid, ev->uuid);
+    if ( args[nargs - 2] == NULL || args[nargs - 1] == NULL || args[nargs] == NULL )
+        return NULL;
+    if ( self->profile )
+        return s_py_call_profiled(self, method, args + 1, nargs);
+    return PyObject_Vectorcall(method, args + 1, nargs | PY_VECTORCALL_ARGUMENTS_OFFSET, NULL);
+}
 
-    Py_DECREF(pClass);
-    zstr_free(&pyname);
-    zstr_free(&filebasename);
-    self->main_filename = strdup(filename);
-    return NULL;
+//  Bound method of the instance or NULL if it's not defined
+static PyObject *
+s_py_method(PyObject *instance, const char *name)
+{
+    PyObject *method = PyObject_GetAttrString(instance, name);
+    if ( method == NULL )
+        PyErr_Clear();
+    return method;
 }
 
-int python_init()
+//  Poll the file descriptor returned by the script's fileno(), the
+//  selector of an asyncio loop for example, to call handleCustomSocket
+//  when it's readable. Called after (re)loading the script.
+static void
+s_py_set_pollfd(pythonactor_t *self, sphactor_actor_t *actor)
 {
-    Py_UnbufferedStdioFlag = 1;
-    //  add internal wrapper to available modules
-    int rc = PyImport_AppendInittab("sph", PyInit_PyZmsg);
-    assert(rc == 0);
-    // Set the python home to our bundled python or system installed
-    // We need to check whether the PYTHONHOME env var is provided,
-    //   * if so let python handle it, we do nothing
-    //   * else check if we have a bundled python dir and set pythonhome to it
-    //   * otherwise do nothing hoping a system installed python is found?
-    //   ref: https://github.com/blender/blender/blob/594f47ecd2d5367ca936cf6fc6ec8168c2b360d0/source/blender/python/generic/py_capi_utils.c#L894
-    char *homepath = getenv("PYTHONHOME");
-    if ( homepath == NULL ) // PYTHONHOME not set so check for bundled python
+    if ( actor == NULL )    // in a child process only events drive the script
+        return;
+    int fd = -1;
+    PyObject *fileno = self->pycustom ? s_py_method(self->pyinstance, "fileno") : NULL;
+    if ( fileno )
     {
-        wchar_t pypath[PATH_MAX];
-#ifdef __UTYPE_OSX
-        char path[PATH_MAX];
-        CFURLRef res = CFBundleCopyResourcesDirectoryURL(CFBundleGetMainBundle());
-        CFURLGetFileSystemRepresentation(res, TRUE, (UInt8 *)path, PATH_MAX);
-        CFRelease(res);
-        // append python to our path
-        swprintf(pypath, PATH_MAX, L"%hs/python", path);
-#elif defined(__WINDOWS__)
-        wchar_t path[PATH_MAX];
-        GetModuleFileNameW(NULL, path, PATH_MAX);
-        // remove program name by finding the last delimiter
-        wchar_t *s = wcsrchr(path, L'\\');
-        if (s) *s = 0;
-        swprintf(pypath, PATH_MAX, L"%ls\\python", path);
-#else   // linux, we could check for __UTYPE_LINUX
-        size_t pathsize = PATH_MAX;
-        char path[PATH_MAX];
-        long result = readlink("/proc/self/exe", path, pathsize);
-        if (result == -1)
+        PyObject *rc = PyObject_CallNoArgs(fileno);
+        fd = rc ? (int)PyLong_AsLong(rc) : -1;
+        if ( PyErr_Occurred() )
         {
-            fprintf(stderr, "Error occurred calling readlink: %s\n", strerror(errno));
+            PyErr_Print();
+            fd = -1;
+        }
+        Py_XDECREF(rc);
+        Py_DECREF(fileno);
+    }
+    if ( fd == self->pyfd )
+        return;
+    if ( self->pyfd != -1 )
+        sphactor_actor_poller_remove(actor, (void *)&self->pyfd);
+    self->pyfd = fd;
+    if ( fd != -1 )
+        sphactor_actor_poller_add(actor, (void *)&self->pyfd);
+}
+
+//  Release the instance and what we cached from it
+static void
+s_pythonactor_clear_instance(pythonactor_t *self)
+{
+    Py_CLEAR(self->pyinstance);
+    Py_CLEAR(self->pytimer);
+    Py_CLEAR(self->pysocket);
+    Py_CLEAR(self->pybatch);
+    Py_CLEAR(self->pystop);
+    Py_CLEAR(self->pycustom);
+    Py_CLEAR(self->pytype);
+    Py_CLEAR(self->pyname);
+    Py_CLEAR(self->pyuuid);
+    Py_CLEAR(self->pytimeoutkey);
+    Py_CLEAR(self->pytimeout);
+}
+
+//  Scripts loaded in the current interpreter by path as (digest, module)
+//  tuples, actors running the same script share its module
+static PyObject *
+s_py_scripts(void)
+{
+    PyObject *interpdict = PyInterpreterState_GetDict(PyInterpreterState_Get());
+    if ( interpdict == NULL )
+        return NULL;
+    PyObject *scripts = PyDict_GetItemString(interpdict, "gazebosc.scripts");
+    if ( scripts == NULL )
+    {
+        scripts = PyDict_New();
+        if ( scripts == NULL || PyDict_SetItemString(interpdict, "gazebosc.scripts", scripts) == -1 )
+        {
+            Py_XDECREF(scripts);
+            return NULL;
+        }
+        Py_DECREF(scripts);
+    }
+    return scripts; // borrowed
+}
+
+//  Returns the module of the source, compiled once per content hash. The
+//  module is executed in sys.modules[pyname] like an import would.
+static PyObject *
+s_py_load_module(pythonactor_t *self, const char *filename, const char *pyname, const char *source, const char *digest)
+{
+    PyObject *scripts = s_py_scripts();
+    if ( scripts == NULL )
+        return NULL;
+    PyObject *entry = PyDict_GetItemString(scripts, filename);
+    if ( entry && streq(PyUnicode_AsUTF8(PyTuple_GET_ITEM(entry, 0)), digest) )
+    {
+        self->loaded = "shared";
+        Py_INCREF(PyTuple_GET_ITEM(entry, 1));
+        return PyTuple_GET_ITEM(entry, 1);
+    }
+
+    PyObject *code = Py_CompileStringExFlags(source, filename, Py_file_input, NULL, -1);
+    if ( code == NULL )
+        return NULL;
+    PyObject *module = NULL;
+    PyObject *name = PyUnicode_DecodeFSDefault(pyname);
+    PyObject *path = PyUnicode_DecodeFSDefault(filename);
+    if ( name && path )
+        module = PyImport_ExecCodeModuleObject(name, code, path, NULL);
+    Py_XDECREF(name);
+    Py_XDECREF(path);
+    Py_DECREF(code);
+    if ( module == NULL )
+    {
+        // the shared module might be half executed, don't hand it out again
+        PyObject *type, *value, *traceback;
+        PyErr_Fetch(&type, &value, &traceback);
+        if ( PyDict_DelItemString(scripts, filename) == -1 )
+            PyErr_Clear();
+        PyErr_Restore(type, value, traceback);
+        return NULL;
+    }
+    entry = Py_BuildValue("(sO)", digest, module);
+    if ( entry == NULL || PyDict_SetItemString(scripts, filename, entry) == -1 )
+        PyErr_Print();
+    Py_XDECREF(entry);
+    self->loaded = "compiled";
+    return module;
+}
+
+zmsg_t *
+s_pythonactor_set_file(pythonactor_t *self, const char *filename)
+{
+    self->loaded = NULL;
+    if ( streq(filename, "") )
+    {
+        self->fd = -1;
+        self->wd = -1;
+        s_pythonactor_clear_instance(self);
+        Py_CLEAR(self->pymodule);
+        zstr_free(&self->digest);
+        return NULL;
+    }
+
+    int64_t start = zclock_usecs();
+    zchunk_t *source = zchunk_slurp(filename, 0);
+    if ( source == NULL )
+    {
+        zsys_error("error reading %s", filename);
+        return NULL;
+    }
+    char *digest = strdup(zchunk_digest(source));
+    // nothing to do when the file was saved without changes
+    if ( self->pyinstance && self->main_filename && streq(filename, self->main_filename)
+         && self->digest && streq(digest, self->digest) )
+    {
+        zstr_free(&digest);
+        zchunk_destroy(&source);
+        self->loadtime = zclock_usecs() - start;
+        self->loaded = "unchanged";
+        return NULL;
+    }
+    zchunk_extend(source, "", 1);   // the compiler wants a terminated string
+
+    char *filebasename = s_basename(filename);
+    char *pyname = s_remove_ext(filebasename);
+
+    // Load or reload the module, compiling the source only once when
+    // multiple actors run it
+    Py_CLEAR(self->pymodule);
+    zstr_free(&self->digest);
+    self->pymodule = s_py_load_module(self, filename, pyname, (const char *)zchunk_data(source), digest);
+    zchunk_destroy(&source);
+    if ( self->pymodule == NULL )
+    {
+        if ( PyErr_Occurred() )
+            PyErr_Print();
+        zsys_error("error importing %s", filename);
+        zstr_free(&digest);
+        zstr_free(&pyname);
+        zstr_free(&filebasename);
+        return NULL;
+    }
+    // load the class
+    //  get the class with the same name as the filename
+    PyObject *pClass = PyObject_GetAttrString(self->pymodule, pyname );
+    if (pClass == NULL )
+    {
+        if (PyErr_Occurred())
+            PyErr_Print();
+        zsys_error("pClass is NULL");
+        Py_CLEAR(self->pymodule);
+        zstr_free(&digest);
+        zstr_free(&pyname);
+        zstr_free(&filebasename);
+        return NULL;
+    }
+
+    // instanciate the class and optionally destroy the old instance
+    // create an instance of the class
+    s_pythonactor_clear_instance(self);
+    self->pyinstance = PyObject_CallObject((PyObject *) pClass, NULL);
+    if (self->pyinstance == NULL )
+    {
+        if (PyErr_Occurred())
+            PyErr_Print();
+        zsys_error("pClass instance is NULL");
+        Py_DECREF(pClass);
+        Py_DECREF(self->pymodule);
+        self->pymodule = NULL;
+        zstr_free(&digest);
+        zstr_free(&pyname);
+        zstr_free(&filebasename);
+        return NULL;
+    }
+    self->loadtime = zclock_usecs() - start;
+    self->digest = digest;
+    zsys_info("Successfully (re)loaded %s in %.2f ms (%s)", filename, self->loadtime / 1000.0, self->loaded);
+    self->pytimer = s_py_method(self->pyinstance, "handleTimer");
+    self->pysocket = s_py_method(self->pyinstance, "handleSocket");
+    self->pybatch = s_py_method(self->pyinstance, "handleSocketBatch");
+    self->pystop = s_py_method(self->pyinstance, "handleStop");
+    self->pycustom = s_py_method(self->pyinstance, "handleCustomSocket");
+    self->pytimeoutkey = PyUnicode_InternFromString("timeout");
+    PyObject *oscmessages = PyObject_GetAttrString(self->pyinstance, "oscMessages");
+    self->oscmessages = oscmessages && PyObject_IsTrue(oscmessages) == 1;
+    Py_XDECREF(oscmessages);
+    PyErr_Clear();
+    if ( self->osctype == NULL )
+    {   //  sph.OscMessage of the interpreter we're in
+        PyObject *sph = PyImport_ImportModule("sph");
+        self->osctype = sph ? PyObject_GetAttrString(sph, "OscMessage") : NULL;
+        Py_XDECREF(sph);
+        if ( self->osctype == NULL )
+            PyErr_Print();
+    }
+
+    Py_DECREF(pClass);
+    zstr_free(&pyname);
+    zstr_free(&filebasename);
+    // filename can be our main_filename when reloading
+    char *old_filename = self->main_filename;
+    self->main_filename = strdup(filename);
+    zstr_free(&old_filename);
+    return NULL;
+}
+
+int python_init()
+{
+    Py_UnbufferedStdioFlag = 1;
+    //  add internal wrapper to available modules
+    int rc = PyImport_AppendInittab("sph", PyInit_PyZmsg);
+    assert(rc == 0);
+    // Set the python home to our bundled python or system installed
+    // We need to check whether the PYTHONHOME env var is provided,
+    //   * if so let python handle it, we do nothing
+    //   * else check if we have a bundled python dir and set pythonhome to it
+    //   * otherwise do nothing hoping a system installed python is found?
+    //   ref: https://github.com/blender/blender/blob/594f47ecd2d5367ca936cf6fc6ec8168c2b360d0/source/blender/python/generic/py_capi_utils.c#L894
+    char *homepath = getenv("PYTHONHOME");
+    if ( homepath == NULL ) // PYTHONHOME not set so check for bundled python
+    {
+        wchar_t pypath[PATH_MAX];
+#ifdef __UTYPE_OSX
+        char path[PATH_MAX];
+        CFURLRef res = CFBundleCopyResourcesDirectoryURL(CFBundleGetMainBundle());
+        CFURLGetFileSystemRepresentation(res, TRUE, (UInt8 *)path, PATH_MAX);
+        CFRelease(res);
+        // append python to our path
+        swprintf(pypath, PATH_MAX, L"%hs/python", path);
+#elif defined(__WINDOWS__)
+        wchar_t path[PATH_MAX];
+        GetModuleFileNameW(NULL, path, PATH_MAX);
+        // remove program name by finding the last delimiter
+        wchar_t *s = wcsrchr(path, L'\\');
+        if (s) *s = 0;
+        swprintf(pypath, PATH_MAX, L"%ls\\python", path);
+#else   // linux, we could check for __UTYPE_LINUX
+        size_t pathsize = PATH_MAX;
+        char path[PATH_MAX];
+        long result = readlink("/proc/self/exe", path, pathsize);
+        if (result == -1)
+        {
+            fprintf(stderr, "Error occurred calling readlink: %s\n", strerror(errno));
         }
         assert(result > -1);
         if (result > 0)
@@ -483,11 +1116,64 @@ pythonactor_new()
 
     self->pyinstance = NULL;
     self->main_filename = NULL;
+    self->digest = NULL;
+    self->loadtime = 0;
+    self->loaded = NULL;
     self->fd = -1;
     self->wd = -1;
+    self->reloadat = 0;
+    self->reloadtimeout = -1;
+    self->pyfd = -1;
+    self->isolated = false;
+    self->tstate = NULL;
+    self->pytimer = NULL;
+    self->pysocket = NULL;
+    self->pybatch = NULL;
+    self->pystop = NULL;
+    self->pycustom = NULL;
+    self->pytype = NULL;
+    self->pyname = NULL;
+    self->pyuuid = NULL;
+    self->pytimeoutkey = NULL;
+    self->pytimeout = NULL;
+    self->timeout = -1;
+    self->process = false;
+    self->procpid = -1;
+    self->procmem = NULL;
+    self->procwake = -1;
+    self->childwake = -1;
+    self->procdeath = -1;
+    self->procname = NULL;
+    self->procuuid = NULL;
+    self->procstarted = 0;
+    self->restartat = 0;
+#ifdef __UTYPE_LINUX
+    self->restartdelay = PROCESS_RESTART_MIN;
+#endif
+    self->restarts = 0;
+    self->dropped = 0;
+    self->profile = false;
+    self->pyprofiler = NULL;
+    self->pyprofenable = NULL;
+    self->pyprofdisable = NULL;
+    self->profreported = 0;
+    self->profcalls = 0;
+    self->profsocketcalls = 0;
+    self->proftime = 0;
+    self->profsockettime = 0;
+    self->profenters = 0;
+    self->profwait = 0;
+    self->proflastcalls = 0;
+    self->proflasthandler = 0.0;
+    self->proflastsocket = 0.0;
+    self->proflastwait = 0.0;
+    self->proftop = NULL;
+    self->oscmessages = false;
+    self->osctype = NULL;
 
     PyGILState_STATE gstate;
     gstate = PyGILState_Ensure();
+    //  SystemExit is a static type, the same object in isolated interpreters
     PyObject *builtins_module = PyImport_ImportModule("builtins");
     self->_exitexc = PyObject_GetAttrString(builtins_module, "SystemExit");
 
@@ -505,13 +1191,24 @@ pythonactor_destroy(pythonactor_t **self_p)
         pythonactor_t *self = *self_p;
         if (self->main_filename )
             zstr_free(&self->main_filename);
+        zstr_free(&self->digest);
+#ifdef __UTYPE_LINUX
+        s_process_stop(self, NULL, true);
+#endif
+        zstr_free(&self->procname);
+        zstr_free(&self->procuuid);
         // free the pyinstance
+        s_pythonactor_enter(self);
+        s_pythonactor_clear_instance(self);
+        Py_CLEAR(self->pymodule);
+        Py_CLEAR(self->osctype);
+        s_py_profile_clear(self);
+        s_pythonactor_leave(self);
+        s_pythonactor_end_interpreter(self);
+
         PyGILState_STATE gstate;
         gstate = PyGILState_Ensure();
-        Py_CLEAR(self->pyinstance);
-        Py_CLEAR(self->pymodule);
         Py_DECREF(self->_exitexc);
-
         PyGILState_Release(gstate);
 
         //  Free object itself
@@ -528,128 +1225,134 @@ pythonactor_init(pythonactor_t *self, sphactor_event_t *ev)
     return NULL;
 }
 
+//  Append what a python handler returned to the outgoing message: bytes,
+//  an (address, [data]) tuple, an OscMessage, a Zmsg or, from
+//  handleSocketBatch, a list of those.
+static void
+s_py_append_return(pythonactor_t *self, PyObject *pReturn, zmsg_t *retmsg)
+{
+    if (pReturn == Py_None)
+        return;
+
+    if ( PyObject_IsInstance(pReturn, self->_exitexc) )
+    {   //  Instead of calling sys.exit(), which is messy, an actor can
+        //  return SystemExit() to indicate termination of the application
+        zsys_info("Received instance of SystemExit! Terminating all execution.");
+#ifdef __WINDOWS__
+        GenerateConsoleCtrlEvent(0, 0); // send CTRL-C
+#else
+        kill(0, SIGTERM); // calling exit is not safe, so we're raising SIGTERM which will be caught by the main thread.
+#endif
+    }
+    else if (PyBytes_Check(pReturn))
+    {
+        // handle python bytes
+        Py_ssize_t size = PyBytes_Size(pReturn);
+        if ( size > 0 )
+            zmsg_addmem(retmsg, PyBytes_AsString(pReturn), size);
+        else
+            zsys_warning("zsock_resolvePyBytes has zero size");
+    }
+    else if ( self->osctype && PyObject_TypeCheck(pReturn, (PyTypeObject *)self->osctype) )
+    {
+        // already packed, send it as is
+        PyOscMessageObject *osc = (PyOscMessageObject *)pReturn;
+        zmsg_addmem(retmsg, osc->data, osc->size);
+    }
+    else if ( PyList_Check(pReturn) )
+    {
+        for ( Py_ssize_t i = 0; i < PyList_Size(pReturn); i++ )
+            s_py_append_return(self, PyList_GetItem(pReturn, i), retmsg);
+    }
+    else if ( PyTuple_Check(pReturn) ) // we expect a tuple in the format ( address, [data]) or ( address, types, [data])
+    {
+        // convert the tuple to an osc message
+        // first item must be the address string
+        PyObject *pAddress = PyTuple_Size(pReturn) > 1 ? PyTuple_GetItem(pReturn, 0) : NULL;
+        if ( pAddress == NULL || ! PyUnicode_Check(pAddress) )
+        {
+            zsys_error("first item in the tuple is not a string, first item should be the address string");
+        }
+        else
+        {
+            // optional type tags, e.g. "iff", to send the data as
+            PyObject *pTypes = PyTuple_Size(pReturn) > 2 ? PyTuple_GetItem(pReturn, 1) : NULL;
+            PyObject *pData = PyTuple_GetItem(pReturn, pTypes ? 2 : 1);
+            assert(pData);
+            if ( pTypes && ! PyUnicode_Check(pTypes) )
+            {
+                zsys_error("second item in the tuple should be the type tags string");
+            }
+            else if ( PyList_Check(pData) )
+            {
+                zframe_t *data = s_py_osc_pack(pAddress, pTypes, pData);
+                if ( data )
+                    zmsg_append(retmsg, &data);
+                else
+                {
+                    PyErr_Print();
+                    zsys_error("can't pack the data as OSC message %s", PyUnicode_AsUTF8(pAddress));
+                }
+            }
+        }
+    }
+    else // we expect a zmsg type
+    {
+        PyZmsgObject *c = (PyZmsgObject *)pReturn;
+        assert(c->msg);
+        //  It would be nicer if we could just return the zmsg in
+        //  the python object. However how do we then prevent destruction
+        //  by the garbage controller. For now move the frames.
+        zframe_t *f = zmsg_pop(c->msg);
+        while (f)
+        {
+            zmsg_append(retmsg, &f);
+            f = zmsg_pop(c->msg);
+        }
+    }
+}
+
+//  Return the message if it has frames, otherwise destroy it
+static zmsg_t *
+s_nonempty(zmsg_t **msg_p)
+{
+    if ( zmsg_size(*msg_p) == 0 )
+        zmsg_destroy(msg_p);
+    return *msg_p;
+}
+
 zmsg_t *
 pythonactor_timer(pythonactor_t *self, sphactor_event_t *ev)
 {
     assert(self);
     assert(self->pyinstance);
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
+    s_pythonactor_enter(self);
 
     if (ev->msg)
     {
         zmsg_destroy(&ev->msg);
     }
+    zmsg_t *retmsg = zmsg_new();
     // call member 'handleTimer' with event arguments
-    PyObject *pReturn = PyObject_CallMethod(self->pyinstance, "handleTimer", "sss", ev->type, ev->name, ev->uuid);
+    PyObject *pReturn = s_py_call_handler(self, self->pytimer, ev, NULL, NULL);
     if (pReturn == NULL)
     {
         PyErr_Print();
-        zsys_error("pythonactor: error calling handleSocket");
+        zsys_error("pythonactor: error calling handleTimer");
     }
     else
     {
         // try to acquire the timeout member and use it to set the timeout
         s_py_set_timeout(self, ev);
-
-        if (pReturn != Py_None)
-        {
-            if (PyBytes_Check(pReturn))
-            {
-                // handle python bytes
-                zmsg_t *ret = NULL;
-                Py_ssize_t size = PyBytes_Size(pReturn);
-                if ( size > 0 )
-                {
-                    ret = zmsg_new();
-    #ifdef _MSC_VER
-                    char *buf = (char *)_malloca( size );
-                    memcpy(buf, PyBytes_AsString(pReturn), size);
-                    zmsg_addmem(ret, buf, size);
-                    _freea(buf);
-    #else
-                    char buf[size];// = new char[size];
-                    memcpy(buf, PyBytes_AsString(pReturn), size);
-                    zmsg_addmem(ret, buf, size);
-    #endif
-                }
-                else
-                {
-                    zsys_warning("zsock_resolvePyBytes has zero size");
-                }
-                Py_DECREF(pReturn);  // decrease refcount to trigger destroy
-                // Release the GIL again as we are ready with Python
-                PyGILState_Release(gstate);
-                // already destroyed: zmsg_destroy(&ev->msg);
-                return ret;
-            }
-            else if ( PyTuple_Check(pReturn) ) // we expect a tuple in the format ( address, [data])
-            {
-                zmsg_t *ret = NULL; // our return
-                // convert the tuple to an osc message
-                Py_ssize_t tuple_len = PyTuple_Size(pReturn);
-                assert(tuple_len > 0 );
-                // first item must be the address string
-                PyObject *pAddress = PyTuple_GetItem(pReturn, 0);
-                assert(pAddress);
-                if ( ! PyUnicode_Check(pAddress) )
-                {
-                    zsys_error("first item in the tuple is not a string, first item should be the address string");
-                }
-                else
-                {
-                    PyObject *pData = PyTuple_GetItem(pReturn, 1);
-                    assert(pData);
-                    if ( PyList_Check(pData) )
-                    {
-                        zosc_t *retosc = s_py_zosc(pAddress, pData);
-                        assert(retosc);
-                        ret = zmsg_new();
-                        assert(ret);
-                        zframe_t *data = zosc_packx(&retosc);
-                        assert(data);
-                        zmsg_append(ret, &data);
-                    }
-                }
-                Py_DECREF(pReturn);  // decrease refcount to trigger destroy
-                // Release the GIL again as we are ready with Python
-                PyGILState_Release(gstate);
-                // already destroyed: zmsg_destroy(&ev->msg);
-                return ret;
-            }
-            else // we expect a zmsg type
-            {
-                // check whether we received our own message
-                PyZmsgObject *c = (PyZmsgObject *)pReturn;
-                assert(c->msg);
-                if (c->msg == ev->msg)
-                {
-                    zsys_info("we received our own message");
-                }
-                if ( zmsg_size(c->msg) > 0 )
-                {
-                    //  It would be nicer if we could just return the zmsg in
-                    //  the python object. However how do we then prevent destruction
-                    //  by the garbage controller. For now just duplicate.
-                    zmsg_t *ret = zmsg_dup( c->msg );
-                    Py_DECREF(pReturn);  // decrease refcount to trigger destroy
-                    // Release the GIL again as we are ready with Python
-                    PyGILState_Release(gstate);
-                    zmsg_destroy(&ev->msg);
-                    return ret;
-                }
-            }
-        }
-        else
-        {
-            zsys_error("We don't know what to do with the return value from python");
-        }
-        Py_XDECREF(pReturn);  // decrease refcount to trigger destroy
+        s_py_append_return(self, pReturn, retmsg);
+        Py_DECREF(pReturn);  // decrease refcount to trigger destroy
     }
+    if ( self->profile )
+        s_py_profile_report(self, ev);
     // Release the GIL again as we are ready with Python
-    PyGILState_Release(gstate); // TODO: didn't we already do this?
+    s_pythonactor_leave(self);
 
-    return NULL;
+    return s_nonempty(&retmsg);
 }
 
 zmsg_t *
@@ -674,19 +1377,28 @@ pythonactor_api(pythonactor_t *self, sphactor_event_t *ev)
 #ifdef __UTYPE_LINUX
         if ( self->main_filename == NULL || ! streq(filename, self->main_filename) )
             s_init_inotify(self, filename, (sphactor_actor_t *)ev->actor);
+        if ( self->process )
+        {
+            s_process_names(self, ev);
+            s_process_load(self, (sphactor_actor_t *)ev->actor, filename);
+            zstr_free(&filename);
+            zstr_free(&cmd);
+            return NULL;
+        }
 #endif
         //  Acquire the GIL
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
+        s_pythonactor_enter(self);
 
         s_pythonactor_set_file(self, filename);
+        s_py_set_pollfd(self, (sphactor_actor_t *)ev->actor);
 
         // get the optional timeout member to set the actor's timeout value
         if (self->pyinstance)
             s_py_set_timeout(self, ev);
 
         // Release the GIL
-        PyGILState_Release(gstate);
+        s_pythonactor_leave(self);
+        s_pythonactor_report(self, (sphactor_actor_t *)ev->actor);
 
 
         zstr_free(&filename);
@@ -695,40 +1407,196 @@ pythonactor_api(pythonactor_t *self, sphactor_event_t *ev)
 
     }
 
+    else if ( streq(cmd, "SET ISOLATED") )
+    {
+        char *value = zmsg_popstr(ev->msg);
+        bool isolated = value && streq(value, "True");
+        zstr_free(&value);
+        if ( isolated != self->isolated )
+        {
+            // move to the other interpreter and reload the file there
+            s_pythonactor_enter(self);
+            s_pythonactor_clear_instance(self);
+            Py_CLEAR(self->pymodule);
+            Py_CLEAR(self->osctype);
+            s_py_profile_clear(self);
+            s_py_set_pollfd(self, (sphactor_actor_t *)ev->actor);
+            s_pythonactor_leave(self);
+            s_pythonactor_end_interpreter(self);
+
+            self->isolated = isolated && s_pythonactor_isolate(self);
+            if ( self->main_filename && ! self->process )
+            {
+                s_pythonactor_enter(self);
+                s_pythonactor_set_file(self, self->main_filename);
+                s_py_set_pollfd(self, (sphactor_actor_t *)ev->actor);
+                if (self->pyinstance)
+                    s_py_set_timeout(self, ev);
+                s_pythonactor_leave(self);
+                s_pythonactor_report(self, (sphactor_actor_t *)ev->actor);
+            }
+        }
+    }
+    else if ( streq(cmd, "SET PROCESS") )
+    {
+        char *value = zmsg_popstr(ev->msg);
+        bool process = value && streq(value, "True");
+        zstr_free(&value);
+#ifdef __UTYPE_LINUX
+        sphactor_actor_t *actor = (sphactor_actor_t *)ev->actor;
+        if ( process && ! self->process )
+        {
+            // move the script from our interpreter to a child process
+            s_pythonactor_enter(self);
+            s_pythonactor_clear_instance(self);
+            Py_CLEAR(self->pymodule);
+            s_py_set_pollfd(self, actor);
+            s_pythonactor_leave(self);
+            self->loaded = NULL;    // the child loads it
+            self->process = true;
+            s_process_names(self, ev);
+            self->restartat = 0;
+            s_process_ensure(self, actor);
+        }
+        else if ( ! process && self->process )
+        {
+            s_process_stop(self, actor, true);
+            self->process = false;
+            self->restartat = 0;
+            s_pythonactor_set_timeout(self, actor, -1);
+            if ( self->main_filename )
+            {
+                s_pythonactor_enter(self);
+                s_pythonactor_set_file(self, self->main_filename);
+                s_py_set_pollfd(self, actor);
+                if (self->pyinstance)
+                    s_py_set_timeout(self, ev);
+                s_pythonactor_leave(self);
+            }
+            s_pythonactor_report(self, actor);
+        }
+#else
+        if ( process )
+            zsys_warning("pythonactor: running in a child process is only supported on Linux");
+#endif
+    }
+    else if ( streq(cmd, "SET PROFILE") )
+    {
+        char *value = zmsg_popstr(ev->msg);
+        bool profile = value && streq(value, "True");
+        zstr_free(&value);
+        if ( profile && self->process )
+            zsys_warning("pythonactor: profiling is not available for scripts running in a child process");
+        // the profiler is created on the first handler call
+        s_pythonactor_enter(self);
+        s_py_profile_clear(self);
+        self->profile = profile;
+        s_pythonactor_leave(self);
+        s_pythonactor_report(self, (sphactor_actor_t *)ev->actor);
+    }
+    else if ( streq(cmd, "DUMP PROFILE") )
+    {
+        s_pythonactor_enter(self);
+        s_py_profile_dump(self);
+        s_pythonactor_leave(self);
+    }
+
     if ( ev->msg ) zmsg_destroy(&ev->msg);
     zstr_free(&cmd);
     return NULL;
 }
 
+//  The data of an OSC frame for the handlers, an OscMessage if the actor
+//  asked for them or else a tuple of the decoded arguments. Takes
+//  ownership of the frame, returns NULL if it's not an OSC message.
+static PyObject *
+s_py_osc_data(pythonactor_t *self, zframe_t *oscf, PyObject **address)
+{
+    if ( self->oscmessages && self->osctype )
+    {
+        PyObject *data = pyosc_from_frame((PyTypeObject *)self->osctype, oscf);
+        if ( data == NULL )
+        {
+            PyErr_Print();
+            return NULL;
+        }
+        *address = PyOscMessage_address((PyOscMessageObject *)data, NULL);
+        return data;
+    }
+
+    zosc_t *oscm = zosc_fromframe(oscf);
+    assert(oscm);
+    *address = PyUnicode_FromString(zosc_address(oscm));
+    PyObject *data = s_py_zosc_tuple(self, oscm);
+    assert(data);
+    zosc_destroy(&oscm);
+    return data;
+}
+
+//  Pass all OSC messages at once to handleSocketBatch as a list of
+//  (address, data) tuples, or OscMessages, saving a python call per message
+static void
+s_pythonactor_socket_batch(pythonactor_t *self, sphactor_event_t *ev, zmsg_t *retmsg)
+{
+    PyObject *batch = PyList_New(0);
+    zframe_t *oscf = zmsg_pop(ev->msg);
+    while (oscf)
+    {
+        PyObject *address = NULL;
+        PyObject *data = s_py_osc_data(self, oscf, &address);
+        if ( data )
+        {
+            PyObject *item = self->oscmessages ? data : PyTuple_Pack(2, address, data);
+            PyList_Append(batch, item);
+            if ( item != data )
+                Py_DECREF(item);
+            Py_DECREF(data);
+            Py_DECREF(address);
+        }
+        oscf = zmsg_pop(ev->msg);
+    }
+
+    PyObject *pReturn = s_py_call_handler(self, self->pybatch, ev, batch, NULL);
+    Py_DECREF(batch);
+    if (pReturn == NULL)
+    {
+        PyErr_Print();
+        zsys_error("pythonactor: error calling handleSocketBatch");
+        return;
+    }
+    s_py_append_return(self, pReturn, retmsg);
+    Py_DECREF(pReturn);
+}
+
 zmsg_t *
 pythonactor_socket(pythonactor_t *self, sphactor_event_t *ev)
 {
     assert(self);
     assert(self->pyinstance);
     //zsys_info("Hello from py_class_actor wrapper: type=%s", ev->type);
-    //  This is not compatible with subinterpreters!
-    //  https://docs.python.org/3/c-api/init.html#c.PyGILState_Ensure
     //  Acquire the GIL
-    PyGILState_STATE gstate;
-    gstate = PyGILState_Ensure();
+    s_pythonactor_enter(self);
 
-    // create a python tuple from the osc message
-    zframe_t *oscf = zmsg_pop(ev->msg);
     zmsg_t *retmsg = zmsg_new();
+    if ( self->pybatch )
+        s_pythonactor_socket_batch(self, ev, retmsg);
+
+    // create a python tuple from the osc message
+    zframe_t *oscf = self->pybatch ? NULL : zmsg_pop(ev->msg);
     while (oscf)
     {
-        assert(oscf);
-        zosc_t *oscm = zosc_fromframe(oscf);
-        assert(oscm);
-        const char *oscaddress = zosc_address(oscm);
-        assert(oscaddress);
-        PyObject *py_osctuple = s_py_zosc_tuple(self, oscm);
-        assert(py_osctuple);
+        PyObject *address = NULL;
+        PyObject *data = s_py_osc_data(self, oscf, &address);
+        if ( data == NULL )
+        {
+            oscf = zmsg_pop(ev->msg);
+            continue;
+        }
 
         // call member 'handleMsg' with event arguments
-        PyObject *pReturn = PyObject_CallMethod(self->pyinstance, "handleSocket", "sOsss", oscaddress, py_osctuple, ev->type, ev->name, ev->uuid);
-        // destroy the osc message
-        zosc_destroy(&oscm);
+        PyObject *pReturn = s_py_call_handler(self, self->pysocket, ev, address, data);
+        Py_DECREF(address);
+        Py_DECREF(data);
 
         // check if null in case of error
         if (pReturn == NULL)
@@ -736,103 +1604,47 @@ pythonactor_socket(pythonactor_t *self, sphactor_event_t *ev)
             PyErr_Print();
             zsys_error("pythonactor: error calling handleSocket");
         }
-        else if ( PyObject_IsInstance(pReturn, self->_exitexc) )
-        {   //  Instead of calling sys.exit(), which is messy, an actor can
-            //  return SystemExit() to indicate termination of the application
-            zsys_info("Received instance of SystemExit! Terminating all execution.");
-#ifdef __WINDOWS__
-            GenerateConsoleCtrlEvent(0, 0); // send CTRL-C
-#else
-            kill(0, SIGTERM); // calling exit is not safe, so we're raising SIGTERM which will be caught by the main thread.
-#endif
-        }
-        else if (pReturn != Py_None)
+        else
         {
-            if (PyBytes_Check(pReturn))
-            {
-                // handle python bytes
-                zmsg_t *ret = NULL;
-                Py_ssize_t size = PyBytes_Size(pReturn);
-                if ( size > 0 )
-                {
-    #ifdef _MSC_VER
-                    char *buf = (char *)_malloca( size );
-                    memcpy(buf, PyBytes_AsString(pReturn), size);
-                    zmsg_addmem(retmsg, buf, size);
-                    _freea(buf);
-    #else
-                    char buf[size];// = new char[size];
-                    memcpy(buf, PyBytes_AsString(pReturn), size);
-                    zmsg_addmem(retmsg, buf, size);
-    #endif
-                }
-                else
-                {
-                    zsys_warning("zsock_resolvePyBytes has zero size");
-                }
-                Py_DECREF(pReturn);  // decrease refcount to trigger destroy
-            }
-            else if ( PyTuple_Check(pReturn) ) // we expect a tuple in the format ( address, [data])
-            {
-                // convert the tuple to an osc message
-                Py_ssize_t tuple_len = PyTuple_Size(pReturn);
-                assert(tuple_len > 0 );
-                // first item must be the address string
-                PyObject *pAddress = PyTuple_GetItem(pReturn, 0);
-                assert(pAddress);
-                if ( ! PyUnicode_Check(pAddress) )
-                {
-                    zsys_error("first item in the tuple is not a string, first item should be the address string");
-                }
-                else
-                {
-                    PyObject *pData = PyTuple_GetItem(pReturn, 1);
-                    assert(pData);
-                    if ( PyList_Check(pData) )
-                    {
-                        zosc_t *retosc = s_py_zosc(pAddress, pData);
-                        assert(retosc);
-                        zframe_t *data = zosc_packx(&retosc);
-                        assert(data);
-                        zmsg_append(retmsg, &data);
-                    }
-                }
-                Py_DECREF(pReturn);  // decrease refcount to trigger destroy
-            }
-            else // we expect a zmsg type
-            {
-                // check whether we received our own message
-                PyZmsgObject *c = (PyZmsgObject *)pReturn;
-                assert(c->msg);
-                if (c->msg == ev->msg)
-                {
-                    zsys_info("we received our own message");
-                }
-                if ( zmsg_size(c->msg) > 0 )
-                {
-                    //  It would be nicer if we could just return the zmsg in
-                    //  the python object. However how do we then prevent destruction
-                    //  by the garbage controller. For now just duplicate.
-                    zframe_t *f = zmsg_pop(c->msg);
-                    while (f)
-                    {
-                        zmsg_append(retmsg, &f);
-                        f = zmsg_pop(c->msg);
-                    }
-                    Py_DECREF(pReturn);  // decrease refcount to trigger destroy
-                }
-            }
+            s_py_append_return(self, pReturn, retmsg);
+            Py_DECREF(pReturn);  // decrease refcount to trigger destroy
         }
         oscf = zmsg_pop(ev->msg);
     }
 
     // try to acquire the timeout member and use it to set the timeout
     s_py_set_timeout(self, ev);
+    if ( self->profile )
+        s_py_profile_report(self, ev);
 
     // Release the GIL again as we are ready with Python
-    PyGILState_Release(gstate); // TODO: didn't we already do this?
+    s_pythonactor_leave(self);
 
-    return retmsg;
+    return s_nonempty(&retmsg);
+}
+
+//  The script's file descriptor is readable
+static zmsg_t *
+s_pythonactor_custom(pythonactor_t *self, sphactor_event_t *ev)
+{
+    s_pythonactor_enter(self);
+    zmsg_t *retmsg = zmsg_new();
+    PyObject *pReturn = s_py_call_handler(self, self->pycustom, ev, NULL, NULL);
+    if (pReturn == NULL)
+    {
+        PyErr_Print();
+        zsys_error("pythonactor: error calling handleCustomSocket");
+    }
+    else
+    {
+        s_py_set_timeout(self, ev);
+        s_py_append_return(self, pReturn, retmsg);
+        Py_DECREF(pReturn);
+    }
+    if ( self->profile )
+        s_py_profile_report(self, ev);
+    s_pythonactor_leave(self);
+    return s_nonempty(&retmsg);
 }
 
 zmsg_t *
@@ -842,6 +1654,12 @@ pythonactor_custom_socket(pythonactor_t *self, sphactor_event_t *ev)
     assert(ev->msg);
     // Get the socket...
     zframe_t *frame = zmsg_pop(ev->msg);
+    if (zframe_size(frame) == sizeof( void *) && *(void **)zframe_data(frame) == (void *)&self->pyfd )
+    {
+        zframe_destroy(&frame);
+        zmsg_destroy(&ev->msg);
+        return s_pythonactor_custom(self, ev);
+    }
     if (zframe_size(frame) == sizeof( void *) )
     {
         void *p = *(void **)zframe_data(frame);
@@ -862,9 +1680,8 @@ pythonactor_stop(pythonactor_t *self, sphactor_event_t *ev)
     assert(self);
     if (self->pyinstance)
     {
-        PyGILState_STATE gstate;
-        gstate = PyGILState_Ensure();
-        PyObject *pReturn = PyObject_CallMethod(self->pyinstance, "handleStop", "sss", ev->type, ev->name, ev->uuid);
+        s_pythonactor_enter(self);
+        PyObject *pReturn = s_py_call_handler(self, self->pystop, ev, NULL, NULL);
         Py_XINCREF(pReturn);  // increase refcount to prevent destroy
         if (!pReturn)
         {
@@ -872,8 +1689,12 @@ pythonactor_stop(pythonactor_t *self, sphactor_event_t *ev)
             zsys_error("pythonactor: error calling handleStop method");
         }
         Py_XDECREF(pReturn);  // decrease refcount to trigger destroy
-        PyGILState_Release(gstate);
+        s_pythonactor_leave(self);
     }
+    // handleStop closed it
+    if ( self->pyfd != -1 && ev->actor )
+        sphactor_actor_poller_remove((sphactor_actor_t *)ev->actor, (void *)&self->pyfd);
+    self->pyfd = -1;
     // remove the watched file
 #ifdef __UTYPE_LINUX
     s_destroy_inotify(self, (sphactor_actor_t *)ev->actor);
@@ -910,6 +1731,16 @@ pythonactor_handle_msg(pythonactor_t *self, sphactor_event_t *ev)
         return NULL; //pythonactor_init(self, ev);
     }
 
+#ifdef __UTYPE_LINUX
+    if ( self->reloadat && streq(ev->type, "TIME") )
+    {
+        s_handle_inotify_timer(self, ev);
+        return NULL;
+    }
+    if ( self->process )
+        return s_process_handle_msg(self, ev);
+#endif
+
     if (self->pyinstance == NULL)
     {
         //TODO this can kill the console zsys_warning("No valid python file has been loaded (yet)");
@@ -936,3 +1767,508 @@ pythonactor_handle_msg(pythonactor_t *self, sphactor_event_t *ev)
     return ret;
 }
 
+
+#ifdef __UTYPE_LINUX
+//  Out of process python actors
+//
+//  With the process option the script runs in a child gazebosc started with
+//  --python-worker, so a crashing or hanging script doesn't take the
+//  application down and doesn't contend for the GIL of the other actors.
+//  Events go to the child and replies come back over two shmrings in a
+//  memfd, each signalled with an eventfd. The child holds the write end of
+//  a pipe, when it closes the child died and it's restarted with a backoff.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include "shmring.h"
+
+#define PROCESS_RING_CAPACITY   (1 << 20)
+#define PROCESS_RESTART_MAX     10000
+#define PROCESS_RESTART_RESET   10000   // ms a child must run to reset the backoff
+
+//  Record kinds
+#define PROCESS_LOAD    'L'     // frames: filename, actor name, uuid, working dir
+#define PROCESS_SOCKET  'S'     // frames: the OSC messages
+#define PROCESS_TIMER   'T'
+#define PROCESS_STOP    'Q'
+#define PROCESS_REPLY   'R'     // frames: the reply, timeout: the script's timeout
+
+//  A record is this header followed by its frames, each a 4 byte size and
+//  the data padded to 4 bytes
+typedef struct {
+    uint32_t kind;
+    uint32_t frames;
+    int64_t  timeout;
+} s_process_record_t;
+
+//  The ring to the child (0) or from the child (1)
+static shmring_t *
+s_process_ring(void *mem, int index, bool init)
+{
+    size_t size = shmring_memsize(PROCESS_RING_CAPACITY);
+    return shmring_attach((byte *)mem + index * size, PROCESS_RING_CAPACITY, init);
+}
+
+//  Write a record holding the frames of msg, false if it doesn't fit
+static bool
+s_process_write(shmring_t *ring, uint32_t kind, int64_t timeout, zmsg_t *msg)
+{
+    size_t size = sizeof(s_process_record_t);
+    zframe_t *frame = msg ? zmsg_first(msg) : NULL;
+    for ( ; frame; frame = zmsg_next(msg) )
+        size += 4 + ((zframe_size(frame) + 3) & ~(size_t)3);
+    byte *dest = (byte *)shmring_reserve(ring, size);
+    if ( dest == NULL )
+        return false;
+
+    s_process_record_t record = { kind, msg ? (uint32_t)zmsg_size(msg) : 0, timeout };
+    memcpy(dest, &record, sizeof(record));
+    dest += sizeof(record);
+    for ( frame = msg ? zmsg_first(msg) : NULL; frame; frame = zmsg_next(msg) )
+    {
+        uint32_t fsize = (uint32_t)zframe_size(frame);
+        memcpy(dest, &fsize, 4);
+        memcpy(dest + 4, zframe_data(frame), fsize);
+        dest += 4 + ((fsize + 3) & ~3u);
+    }
+    shmring_commit(ring);
+    return true;
+}
+
+//  Read the oldest record, its frames are appended to msg. False if the
+//  ring is empty.
+static bool
+s_process_read(shmring_t *ring, s_process_record_t *record, zmsg_t *msg)
+{
+    size_t size;
+    byte *src = (byte *)shmring_peek(ring, &size);
+    if ( src == NULL )
+        return false;
+
+    memcpy(record, src, sizeof(*record));
+    src += sizeof(*record);
+    for ( uint32_t i = 0; i < record->frames; i++ )
+    {
+        uint32_t fsize;
+        memcpy(&fsize, src, 4);
+        zmsg_addmem(msg, src + 4, fsize);
+        src += 4 + ((fsize + 3) & ~3u);
+    }
+    shmring_release(ring);
+    return true;
+}
+
+static void
+s_wake(int fd)
+{
+    uint64_t one = 1;
+    ssize_t rc = write(fd, &one, sizeof(one));
+    (void)rc;   // only fails when the counter is saturated, it's awake then
+}
+
+//  The actor name and uuid for the handlers in the child
+static void
+s_process_names(pythonactor_t *self, sphactor_event_t *ev)
+{
+    if ( self->procname == NULL && ev->name )
+        self->procname = strdup(ev->name);
+    if ( self->procuuid == NULL && ev->uuid )
+        self->procuuid = strdup(ev->uuid);
+}
+
+static void
+s_process_send_load(pythonactor_t *self, const char *filename)
+{
+    char cwd[PATH_MAX];
+    zmsg_t *msg = zmsg_new();
+    zmsg_addstr(msg, filename);
+    zmsg_addstr(msg, self->procname ? self->procname : "");
+    zmsg_addstr(msg, self->procuuid ? self->procuuid : "");
+    zmsg_addstr(msg, getcwd(cwd, sizeof(cwd)) ? cwd : "");
+    if ( s_process_write(s_process_ring(self->procmem, 0, false), PROCESS_LOAD, 0, msg) )
+        s_wake(self->childwake);
+    else
+        zsys_error("pythonactor: can't pass %s to the child process", filename);
+    zmsg_destroy(&msg);
+}
+
+//  Close what s_process_start opened
+static void
+s_process_close(pythonactor_t *self)
+{
+    if ( self->procmem )
+        munmap(self->procmem, 2 * shmring_memsize(PROCESS_RING_CAPACITY));
+    self->procmem = NULL;
+    int *fds[] = { &self->procwake, &self->childwake, &self->procdeath };
+    for ( int i = 0; i < 3; i++ )
+    {
+        if ( *fds[i] != -1 )
+            close(*fds[i]);
+        *fds[i] = -1;
+    }
+}
+
+//  Start the child gazebosc running the script
+static bool
+s_process_start(pythonactor_t *self, sphactor_actor_t *actor)
+{
+    size_t memsize = 2 * shmring_memsize(PROCESS_RING_CAPACITY);
+    int death[2] = { -1, -1 };
+    int memfd = memfd_create("gazebosc-python", MFD_CLOEXEC);
+    if ( memfd == -1 || ftruncate(memfd, memsize) == -1 )
+    {
+        zsys_error("pythonactor: can't create shared memory: %s", strerror(errno));
+        if ( memfd != -1 )
+            close(memfd);
+        return false;
+    }
+    void *mem = mmap(NULL, memsize, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    self->procmem = mem == MAP_FAILED ? NULL : mem;
+    self->childwake = eventfd(0, EFD_CLOEXEC);
+    self->procwake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ( self->procmem == NULL || self->childwake == -1 || self->procwake == -1
+         || pipe2(death, O_CLOEXEC) == -1 )
+    {
+        zsys_error("pythonactor: can't set up the child process: %s", strerror(errno));
+        close(memfd);
+        s_process_close(self);
+        return false;
+    }
+    self->procdeath = death[0];
+    s_process_ring(self->procmem, 0, true);
+    s_process_ring(self->procmem, 1, true);
+
+    //  only async-signal-safe calls in the child until the exec
+    char memarg[16], childarg[16], procarg[16];
+    snprintf(memarg, sizeof(memarg), "%i", memfd);
+    snprintf(childarg, sizeof(childarg), "%i", self->childwake);
+    snprintf(procarg, sizeof(procarg), "%i", self->procwake);
+    char *argv[] = { "gazebosc", "--python-worker", memarg, childarg, procarg, NULL };
+    int fds[] = { memfd, self->childwake, self->procwake, death[1] };
+    pid_t parent = getpid();
+    pid_t pid = fork();
+    if ( pid == 0 )
+    {
+        //  SIGTERM when the thread of this actor is gone, also if we crash
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if ( getppid() != parent )
+            _exit(1);
+        for ( int i = 0; i < 4; i++ )
+            fcntl(fds[i], F_SETFD, 0);
+        execv("/proc/self/exe", argv);
+        _exit(127);
+    }
+    close(memfd);
+    close(death[1]);
+    if ( pid == -1 )
+    {
+        zsys_error("pythonactor: can't fork the child process: %s", strerror(errno));
+        s_process_close(self);
+        return false;
+    }
+
+    self->procpid = pid;
+    self->procstarted = zclock_mono();
+    sphactor_actor_poller_add(actor, (void *)&self->procwake);
+    sphactor_actor_poller_add(actor, (void *)&self->procdeath);
+    s_process_send_load(self, self->main_filename);
+    s_pythonactor_report(self, actor);
+    return true;
+}
+
+//  Stop the child, asking it to call handleStop first if quit. Returns its
+//  wait status.
+static int
+s_process_stop(pythonactor_t *self, sphactor_actor_t *actor, bool quit)
+{
+    int status = 0;
+    if ( self->procpid == -1 )
+        return status;
+
+    if ( quit && s_process_write(s_process_ring(self->procmem, 0, false), PROCESS_STOP, 0, NULL) )
+        s_wake(self->childwake);
+    //  a dead child can still take a moment to become a zombie
+    int64_t until = zclock_mono() + (quit ? 1000 : 100);
+    pid_t rc;
+    while ( (rc = waitpid(self->procpid, &status, WNOHANG)) == 0 && zclock_mono() < until )
+        zclock_sleep(10);
+    if ( rc == 0 )
+    {
+        zsys_warning("pythonactor: killing child process %i", self->procpid);
+        kill(self->procpid, SIGKILL);
+        waitpid(self->procpid, &status, 0);
+    }
+    self->procpid = -1;
+
+    if ( actor )
+    {
+        sphactor_actor_poller_remove(actor, (void *)&self->procwake);
+        sphactor_actor_poller_remove(actor, (void *)&self->procdeath);
+    }
+    s_process_close(self);
+    return status;
+}
+
+//  Try again later, backing off while it keeps failing
+static void
+s_process_schedule_restart(pythonactor_t *self, sphactor_actor_t *actor)
+{
+    zsys_info("pythonactor: restarting %s in %i ms", self->main_filename, self->restartdelay);
+    self->restartat = zclock_mono() + self->restartdelay;
+    s_pythonactor_set_timeout(self, actor, self->restartdelay);
+    self->restartdelay = self->restartdelay * 2 > PROCESS_RESTART_MAX ? PROCESS_RESTART_MAX : self->restartdelay * 2;
+}
+
+//  Start the child if it's not running and a restart is due
+static void
+s_process_ensure(pythonactor_t *self, sphactor_actor_t *actor)
+{
+    if ( self->procpid != -1 || self->main_filename == NULL || zclock_mono() < self->restartat )
+        return;
+    if ( self->restartat )
+        self->restarts++;
+    self->restartat = 0;
+    // no timer events until the child tells the script's timeout
+    s_pythonactor_set_timeout(self, actor, -1);
+    if ( ! s_process_start(self, actor) )
+        s_process_schedule_restart(self, actor);
+}
+
+static void
+s_process_died(pythonactor_t *self, sphactor_actor_t *actor)
+{
+    int64_t ran = zclock_mono() - self->procstarted;
+    int status = s_process_stop(self, actor, false);
+    if ( WIFSIGNALED(status) )
+        zsys_error("pythonactor: child process running %s killed by signal %i", self->main_filename, WTERMSIG(status));
+    else
+        zsys_error("pythonactor: child process running %s exited with %i", self->main_filename, WEXITSTATUS(status));
+    if ( ran > PROCESS_RESTART_RESET )
+        self->restartdelay = PROCESS_RESTART_MIN;
+    s_process_schedule_restart(self, actor);
+    s_pythonactor_report(self, actor);
+}
+
+//  Everything the child replied, the script's timeout of the last reply
+//  is applied
+static zmsg_t *
+s_process_replies(pythonactor_t *self, sphactor_actor_t *actor)
+{
+    uint64_t count;
+    ssize_t rc = read(self->procwake, &count, sizeof(count));
+    (void)rc;   // EAGAIN if we drained the replies of this wake already
+
+    zmsg_t *retmsg = zmsg_new();
+    shmring_t *ring = s_process_ring(self->procmem, 1, false);
+    s_process_record_t record;
+    bool replied = false;
+    int64_t timeout = -1;
+    while ( s_process_read(ring, &record, retmsg) )
+    {
+        replied = true;
+        timeout = record.timeout;
+    }
+    if ( replied )
+        s_pythonactor_set_timeout(self, actor, timeout);
+    return s_nonempty(&retmsg);
+}
+
+static void
+s_process_load(pythonactor_t *self, sphactor_actor_t *actor, const char *filename)
+{
+    if ( ! streq(filename, "") && (self->main_filename == NULL || ! streq(filename, self->main_filename)) )
+    {
+        char *old_filename = self->main_filename;
+        self->main_filename = strdup(filename);
+        zstr_free(&old_filename);
+    }
+    if ( self->procpid != -1 )
+        s_process_send_load(self, filename);
+    else if ( ! streq(filename, "") )
+    {
+        // don't wait for the backoff of a crashed script to load another
+        self->restartat = 0;
+        s_process_ensure(self, actor);
+    }
+}
+
+static zmsg_t *
+s_process_handle_msg(pythonactor_t *self, sphactor_event_t *ev)
+{
+    sphactor_actor_t *actor = (sphactor_actor_t *)ev->actor;
+    zmsg_t *ret = NULL;
+    if ( streq(ev->type, "FDSOCK") )
+    {
+        zframe_t *frame = zmsg_first(ev->msg);
+        void *p = zframe_size(frame) == sizeof(void *) ? *(void **)zframe_data(frame) : NULL;
+        if ( p == (void *)&self->procwake )
+            ret = s_process_replies(self, actor);
+        else if ( p == (void *)&self->procdeath )
+        {
+            ret = s_process_replies(self, actor);
+            s_process_died(self, actor);
+        }
+        else
+            return pythonactor_custom_socket(self, ev);
+    }
+    else if ( streq(ev->type, "TIME") )
+    {
+        if ( self->procpid == -1 )
+            s_process_ensure(self, actor);
+        else if ( s_process_write(s_process_ring(self->procmem, 0, false), PROCESS_TIMER, 0, NULL) )
+            s_wake(self->childwake);
+    }
+    else if ( streq(ev->type, "SOCK") )
+    {
+        s_process_ensure(self, actor);
+        if ( self->procpid != -1 && s_process_write(s_process_ring(self->procmem, 0, false), PROCESS_SOCKET, 0, ev->msg) )
+            s_wake(self->childwake);
+        else
+        {
+            // the child is down or can't keep up
+            self->dropped++;
+            s_pythonactor_report(self, actor);
+        }
+    }
+    else if ( streq(ev->type, "STOP") )
+    {
+        s_process_stop(self, actor, true);
+        self->restartat = 0;
+        s_destroy_inotify(self, actor);
+    }
+    if ( ev->msg )
+        zmsg_destroy(&ev->msg);
+    return ret;
+}
+
+//  Reply to the parent, waiting for room a while when it's behind
+static void
+s_worker_reply(shmring_t *ring, int wake, int64_t timeout, zmsg_t *msg)
+{
+    for ( int tries = 0; ! s_process_write(ring, PROCESS_REPLY, timeout, msg); tries++ )
+    {
+        if ( tries == 1000 )
+        {
+            zsys_warning("pythonactor: dropping a reply, the parent is not reading them");
+            return;
+        }
+        s_wake(wake);
+        zclock_sleep(1);
+    }
+    s_wake(wake);
+}
+
+int
+pythonactor_worker(int argc, char **argv)
+{
+    if ( argc < 3 )
+    {
+        zsys_error("usage: gazebosc --python-worker <memfd> <childwake> <procwake>");
+        return 1;
+    }
+    int memfd = atoi(argv[0]);
+    int childwake = atoi(argv[1]);
+    int procwake = atoi(argv[2]);
+
+    //  the parent stops us, not an interrupt from the terminal
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    signal(SIGINT, SIG_IGN);
+    //  main() made these only set a flag we don't check, the death signal
+    //  of the parent and its hangup must end us
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+
+    size_t memsize = 2 * shmring_memsize(PROCESS_RING_CAPACITY);
+    void *mem = mmap(NULL, memsize, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd);
+    if ( mem == MAP_FAILED )
+    {
+        zsys_error("pythonactor: can't map the shared memory: %s", strerror(errno));
+        return 1;
+    }
+    shmring_t *in = s_process_ring(mem, 0, false);
+    shmring_t *out = s_process_ring(mem, 1, false);
+
+    python_init();
+    pythonactor_t *self = pythonactor_new();
+    sphactor_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    bool quit = false;
+    while ( ! quit )
+    {
+        uint64_t count;
+        if ( read(childwake, &count, sizeof(count)) != sizeof(count) )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+        s_process_record_t record;
+        zmsg_t *msg = zmsg_new();
+        while ( ! quit && s_process_read(in, &record, msg) )
+        {
+            zmsg_t *ret = NULL;
+            if ( record.kind == PROCESS_LOAD )
+            {
+                char *filename = zmsg_popstr(msg);
+                char *cwd = NULL;
+                zstr_free(&self->procname);
+                zstr_free(&self->procuuid);
+                self->procname = zmsg_popstr(msg);
+                self->procuuid = zmsg_popstr(msg);
+                cwd = zmsg_popstr(msg);
+                ev.name = self->procname;
+                ev.uuid = self->procuuid;
+                //  follow the stage to its project directory
+                char current[PATH_MAX];
+                if ( cwd && *cwd && ! (getcwd(current, sizeof(current)) && streq(cwd, current)) && chdir(cwd) == 0 )
+                    python_add_path(cwd);
+
+                s_pythonactor_enter(self);
+                s_pythonactor_set_file(self, filename ? filename : "");
+                if ( self->pyinstance )
+                    s_py_set_timeout(self, &ev);
+                else
+                    self->timeout = -1;
+                s_pythonactor_leave(self);
+                zstr_free(&filename);
+                zstr_free(&cwd);
+            }
+            else
+            {
+                ev.type = record.kind == PROCESS_SOCKET ? "SOCK" :
+                          record.kind == PROCESS_TIMER ? "TIME" : "STOP";
+                ev.msg = msg;
+                msg = NULL;
+                ret = pythonactor_handle_msg(self, &ev);
+                quit = record.kind == PROCESS_STOP;
+            }
+            if ( ! quit )
+                s_worker_reply(out, procwake, self->timeout, ret);
+            zmsg_destroy(&ret);
+            if ( ev.msg )
+                zmsg_destroy(&ev.msg);
+            if ( msg == NULL )
+                msg = zmsg_new();
+        }
+        zmsg_destroy(&msg);
+    }
+
+    pythonactor_destroy(&self);
+    munmap(mem, memsize);
+    return 0;
+}
+#else
+int
+pythonactor_worker(int argc, char **argv)
+{
+    zsys_error("pythonactor: out of process python actors are only supported on Linux");
+    return 1;
+}
+#endif
@@ -12,11 +12,62 @@ extern "C" {
 struct _pythonactor_t
 {
     char     *main_filename;  // the full path to the main python source file
+    char     *digest;         // content hash of the loaded source file
+    int64_t  loadtime;        // usecs the last (re)load took
+    const char *loaded;       // how it was loaded: "compiled", "shared" or "unchanged"
     PyObject *pymodule;       // the imported pythonfile as a module
     PyObject *pyinstance;     // our python instance
     PyObject *_exitexc;       // ref to the SystemExit exception
     int      fd;              // filedescriptor for file change events
     int      wd;              // watch descriptor of the file change events
+    int64_t  reloadat;        // when to reload the changed file, 0 if not
+    int64_t  reloadtimeout;   // the actor's timeout to apply after reloading
+    int      pyfd;            // file descriptor of the script's fileno(), -1 if none
+    PyObject *pytimer;        // cached bound handler methods, NULL if not defined
+    PyObject *pysocket;
+    PyObject *pybatch;        // handleSocketBatch, used instead of handleSocket
+    PyObject *pystop;
+    PyObject *pycustom;       // handleCustomSocket, called when pyfd is readable
+    PyObject *pytype;         // cached event type, name and uuid strings
+    PyObject *pyname;
+    PyObject *pyuuid;
+    PyObject *pytimeoutkey;   // interned "timeout"
+    PyObject *pytimeout;      // the timeout member when it was last applied
+    int64_t  timeout;         // the script's timeout
+    bool     process;         // run the script in a child process (Linux)
+    int      procpid;         // pid of the child process, -1 if not running
+    void     *procmem;        // shared memory holding the rings to and from the child
+    int      procwake;        // eventfd the child signals replies on, polled
+    int      childwake;       // eventfd to signal the child with
+    int      procdeath;       // pipe closed when the child exits, polled
+    char     *procname;       // actor name and uuid passed to the child's handlers
+    char     *procuuid;
+    int64_t  procstarted;     // when the child was started
+    int64_t  restartat;       // when to restart a crashed child, 0 if not
+    int      restartdelay;    // restart backoff in ms
+    unsigned restarts;
+    unsigned dropped;         // events dropped as the child was down or behind
+    bool     profile;         // profile the handlers and report it
+    PyObject *pyprofiler;     // the cProfile.Profile while profiling
+    PyObject *pyprofenable;   // its bound enable and disable methods
+    PyObject *pyprofdisable;
+    int64_t  profreported;    // when the profile was last reported
+    unsigned profcalls;       // handler calls since the last report
+    unsigned profsocketcalls; // of which handleSocket(Batch) calls
+    int64_t  proftime;        // usecs spent in the handlers
+    int64_t  profsockettime;
+    unsigned profenters;      // times the GIL was acquired
+    int64_t  profwait;        // usecs waiting for the GIL
+    unsigned proflastcalls;   // the last reported interval: calls, average
+    double   proflasthandler; // usecs per handler call and GIL wait, the
+    double   proflastsocket;  // functions taking the most time
+    double   proflastwait;
+    char     *proftop;
+    bool     oscmessages;     // pass sph.OscMessage objects instead of tuples
+    PyObject *osctype;        // sph.OscMessage of the actor's interpreter
+    bool     isolated;        // run in an own sub-interpreter with its own GIL
+    PyThreadState *tstate;    // thread state of the own interpreter, NULL if shared
+    PyGILState_STATE gstate;  // GIL state while in the shared interpreter
 };
 
 typedef struct _pythonactor_t pythonactor_t;
@@ -38,6 +89,10 @@ zmsg_t *pythonactor_socket(pythonactor_t *self, sphactor_event_t *ev);
 zmsg_t *pythonactor_custom_socket(pythonactor_t *self, sphactor_event_t *ev);
 zmsg_t *pythonactor_stop(pythonactor_t *self, sphactor_event_t *ev);
 
+//  Main of a gazebosc started as the child process of an out of process
+//  python actor (Linux)
+int pythonactor_worker(int argc, char **argv);
+
 zmsg_t * pythonactor_handler(sphactor_event_t *ev, void *args);
 zmsg_t * pythonactor_handle_msg(pythonactor_t *self, sphactor_event_t *ev);
 
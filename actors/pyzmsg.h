@@ -3,6 +3,7 @@
 #include <Python.h>
 #include <structmember.h>
 #include <czmq.h>
+#include "pyosc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,8 +16,10 @@ typedef struct {
 static void
 PyZmsg_dealloc(PyZmsgObject *self)
 {
+    PyTypeObject *tp = Py_TYPE(self);
     zmsg_destroy(&self->msg);
-    Py_TYPE(self)->tp_free((PyObject *) self);
+    tp->tp_free((PyObject *) self);
+    Py_DECREF(tp);  // heap types are owned by their instances
 }
 
 static PyObject *
@@ -115,90 +118,92 @@ static PyMethodDef PyZmsg_methods[] = {
     {NULL}  /* Sentinel */
 };
 
-/*static PyTypeObject PyZmsgType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "internal.Zmsg",
-    .tp_doc = "Internal Sphactor Zmsg",
-    .tp_basicsize = sizeof(PyZmsgObject),
-    .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-    .tp_new = PyZmsg_new,
-    //.tp_init = (initproc) PyZmsg_init,
-    .tp_dealloc = (destructor) PyZmsg_dealloc,
-    //.tp_members = Custom_members,
-    .tp_methods = PyZmsg_methods,
-};*/
-
-static PyTypeObject PyZmsgType = {
-    PyObject_HEAD_INIT(NULL)
-    "internal.Zmsg",           // tp_name
-    sizeof(PyZmsgObject),      // tp_basicsize
-    0,                         // tp_itemsize
-    (destructor) PyZmsg_dealloc,
-    0,                         // tp_print
-    0,                         // tp_getattr
-    0,                         // tp_setattr
-    0,                         // tp_compare //tp_as_async
-    0,                         // tp_repr
-    0,                         // tp_as_number
-    0,                         // tp_as_sequence
-    0,                         // tp_as_mapping
-    0,                         // tp_hash
-    0,                         // tp_call
-    0,                         // tp_str
-    0,                         // tp_getattro
-    0,                         // tp_setattro
-    0,                         // tp_as_buffer
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,        // tp_flags
-    "Internal Sphactor Zmsg",  // tp_doc
-    0,		                     // tp_traverse
-    0,		                     // tp_clear
-    0,		                     // tp_richcompare
-    0,		                     // tp_weaklistoffset
-    0,		                     // tp_iter
-    0,		                     // tp_iternext
-    PyZmsg_methods,            // tp_methods
-    0,                         // tp_members
-    0,                         // tp_getset
-    0,                         // tp_base
-    0,                         // tp_dict
-    0,                         // tp_descr_get
-    0,                         // tp_descr_set
-    0,                         // tp_dictoffset
-    0,                         // tp_init
-    0,                         // tp_alloc
-    PyZmsg_new,          // tp_new
-  };
+//  The type and module are created per interpreter (PEP 489 multi-phase
+//  init with a heap type) so the sph module also loads in the isolated
+//  sub-interpreters of python actors.
+static PyType_Slot PyZmsg_slots[] = {
+    {Py_tp_dealloc, PyZmsg_dealloc},
+    {Py_tp_new, PyZmsg_new},
+    {Py_tp_methods, PyZmsg_methods},
+    {Py_tp_doc, "Internal Sphactor Zmsg"},
+    {0, NULL}
+};
+
+static PyType_Spec PyZmsg_spec = {
+    .name = "internal.Zmsg",
+    .basicsize = sizeof(PyZmsgObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .slots = PyZmsg_slots,
+};
+
+static int
+pyzmsg_exec(PyObject *m)
+{
+    PyObject *type = PyType_FromModuleAndSpec(m, &PyZmsg_spec, NULL);
+    if (type == NULL)
+        return -1;
+
+    if (PyModule_AddObject(m, "PyZmsg", type) < 0) {
+        Py_DECREF(type);
+        return -1;
+    }
+    return pyosc_add_type(m);
+}
+
+//  Timeout requested through sph.set_timeout() by the handler running on
+//  this thread, applied by the python actor when the handler returns
+#ifdef _MSC_VER
+static __declspec(thread) int64_t s_sph_timeout = 0;
+static __declspec(thread) bool s_sph_timeout_set = false;
+#else
+static _Thread_local int64_t s_sph_timeout = 0;
+static _Thread_local bool s_sph_timeout_set = false;
+#endif
+
+static PyObject *
+sph_set_timeout(PyObject *module, PyObject *arg)
+{
+    long long timeout = PyLong_AsLongLong(arg);
+    if ( timeout == -1 && PyErr_Occurred() )
+        return NULL;
+    s_sph_timeout = (int64_t)timeout;
+    s_sph_timeout_set = true;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef pyzmsg_methods[] = {
+    {"set_timeout", sph_set_timeout, METH_O,
+     "set_timeout(ms): time until the next handleTimer call, -1 to wait infinitely"},
+    {NULL}  /* Sentinel */
+};
+
+static PyModuleDef_Slot pyzmsg_slots[] = {
+    {Py_mod_exec, pyzmsg_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+    {0, NULL}
+};
 
 static PyModuleDef pyzmsgmodule = {
     PyModuleDef_HEAD_INIT,
     .m_name = "internalwrap",
     .m_doc = "Internal wrapper to zmsg type.",
-    .m_size = -1,
+    .m_size = sizeof(pyosc_state),
+    .m_methods = pyzmsg_methods,
+    .m_slots = pyzmsg_slots,
+    .m_traverse = pyosc_traverse,
+    .m_clear = pyosc_clear,
+    .m_free = pyosc_free,
 };
 
 PyMODINIT_FUNC
 PyInit_PyZmsg(void)
 {
-    PyObject *m;
-    if (PyType_Ready(&PyZmsgType) < 0)
-        return NULL;
-
-    m = PyModule_Create(&pyzmsgmodule);
-    if (m == NULL)
-        return NULL;
-
-    Py_INCREF(&PyZmsgType);
-    if (PyModule_AddObject(m, "PyZmsg", (PyObject *) &PyZmsgType) < 0) {
-        Py_DECREF(&PyZmsgType);
-        Py_DECREF(m);
-        return NULL;
-    }
-
-    return m;
+    return PyModuleDef_Init(&pyzmsgmodule);
 }
 #ifdef __cplusplus
 } // end extern
 #endif
 #endif // ZMSG_H
-
@@ -0,0 +1,110 @@
+#include "shmring.h"
+// only used by the out of process python actors for now
+#ifdef __UTYPE_LINUX
+#include <stdatomic.h>
+
+#define SHMRING_WRAP 0xFFFFFFFF    // record header marking the rest of the ring unused
+
+//  Producer and consumer fields are on their own cache lines
+struct _shmring_t {
+    _Atomic uint64_t head;      // bytes written by the producer
+    uint64_t reserved;          // size of the reserved record including a wrap
+    byte pad1[48];
+    _Atomic uint64_t tail;      // bytes released by the consumer
+    uint64_t peeked;            // size of the peeked record including a wrap
+    byte pad2[48];
+    uint64_t capacity;
+    byte pad3[56];
+    byte data[];
+};
+
+//  A record is an 8 byte header holding its size, then its data padded
+//  to 8 bytes
+static size_t
+s_record_size(size_t size)
+{
+    return 8 + ((size + 7) & ~(size_t)7);
+}
+
+size_t
+shmring_memsize(size_t capacity)
+{
+    return sizeof(shmring_t) + capacity;
+}
+
+shmring_t *
+shmring_attach(void *mem, size_t capacity, bool init)
+{
+    assert(capacity && (capacity & (capacity - 1)) == 0);
+    shmring_t *self = (shmring_t *)mem;
+    if ( init )
+    {
+        memset(self, 0, sizeof(shmring_t));
+        atomic_init(&self->head, 0);
+        atomic_init(&self->tail, 0);
+        self->capacity = capacity;
+    }
+    assert(self->capacity == capacity);
+    return self;
+}
+
+void *
+shmring_reserve(shmring_t *self, size_t size)
+{
+    size_t need = s_record_size(size);
+    if ( size >= SHMRING_WRAP || need > self->capacity / 2 )
+        return NULL;
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+    size_t pos = head & (self->capacity - 1);
+    // a record doesn't wrap, it starts at the beginning instead
+    size_t skip = self->capacity - pos < need ? self->capacity - pos : 0;
+    if ( head + skip + need - tail > self->capacity )
+        return NULL;
+    if ( skip )
+    {
+        *(uint32_t *)(self->data + pos) = SHMRING_WRAP;
+        pos = 0;
+    }
+    *(uint32_t *)(self->data + pos) = (uint32_t)size;
+    self->reserved = skip + need;
+    return self->data + pos + 8;
+}
+
+void
+shmring_commit(shmring_t *self)
+{
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    atomic_store_explicit(&self->head, head + self->reserved, memory_order_release);
+    self->reserved = 0;
+}
+
+void *
+shmring_peek(shmring_t *self, size_t *size)
+{
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_acquire);
+    if ( tail == head )
+        return NULL;
+    size_t pos = tail & (self->capacity - 1);
+    size_t skip = 0;
+    uint32_t recsize = *(uint32_t *)(self->data + pos);
+    if ( recsize == SHMRING_WRAP )
+    {
+        skip = self->capacity - pos;
+        pos = 0;
+        recsize = *(uint32_t *)self->data;
+    }
+    self->peeked = skip + s_record_size(recsize);
+    *size = recsize;
+    return self->data + pos + 8;
+}
+
+void
+shmring_release(shmring_t *self)
+{
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    atomic_store_explicit(&self->tail, tail + self->peeked, memory_order_release);
+    self->peeked = 0;
+}
+#endif // __UTYPE_LINUX
@@ -0,0 +1,33 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <czmq.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  Single producer, single consumer ring of variable sized records in
+//  memory shared between two processes. Records are written in place
+//  after reserving room for them and read in place until released.
+typedef struct _shmring_t shmring_t;
+
+//  Bytes of memory a ring holding capacity bytes of records takes,
+//  capacity must be a power of two
+size_t shmring_memsize(size_t capacity);
+//  The ring in mem, initialised by the side creating it
+shmring_t *shmring_attach(void *mem, size_t capacity, bool init);
+//  Room for a record of size bytes, NULL if the ring is full
+void *shmring_reserve(shmring_t *self, size_t size);
+//  Make the reserved record available to the consumer
+void shmring_commit(shmring_t *self);
+//  The oldest record and its size, NULL if the ring is empty
+void *shmring_peek(shmring_t *self, size_t *size);
+//  Free the peeked record
+void shmring_release(shmring_t *self);
+
+#ifdef __cplusplus
+} // end extern
+#endif
+
+#endif // SHMRING_H
@@ -0,0 +1,27 @@
+# CPU bound python actor of pythonactor_bench
+#
+# Runs a fixed loop on every timer event and on stop appends "calls seconds"
+# to the file named by GZB_BENCH_RESULTS.
+
+import os
+import time
+
+class cpubound(object):
+    def __init__(self, *args, **kwargs):
+        self.timeout = 0            # handleTimer as often as we can
+        self.calls = 0
+        self.start = None
+
+    def handleTimer(self, *args, **kwargs):
+        if self.start is None:
+            self.start = time.perf_counter()
+        total = 0
+        for i in range(20000):
+            total += i * i
+        self.calls += 1
+
+    def handleStop(self, *args, **kwargs):
+        results = os.environ.get("GZB_BENCH_RESULTS")
+        if results and self.start is not None:
+            with open(results, "a") as f:
+                f.write("{} {}\n".format(self.calls, time.perf_counter() - self.start))
@@ -0,0 +1,7 @@
+# Filter of pythonactor_filter_bench: passes on the rigid bodies with an even
+# id from the tuples handleSocket gets without oscMessages
+
+class evenid(object):
+    def handleSocket(self, address, data, *args, **kwargs):
+        if data[0] % 2 == 0:
+            return (address, "isfffffffi", list(data))
@@ -0,0 +1,9 @@
+# Filter of pythonactor_filter_bench: passes on the rigid bodies with an even
+# id as the sph.OscMessage it received
+
+class evenid_osc(object):
+    oscMessages = True
+
+    def handleSocket(self, address, data, *args, **kwargs):
+        if data[0] % 2 == 0:
+            return data
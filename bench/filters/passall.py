@@ -0,0 +1,6 @@
+# Filter of pythonactor_filter_bench: passes on every message from the tuples
+# handleSocket gets without oscMessages
+
+class passall(object):
+    def handleSocket(self, address, data, *args, **kwargs):
+        return (address, "isfffffffi", list(data))
@@ -0,0 +1,8 @@
+# Filter of pythonactor_filter_bench: passes on every message as the
+# sph.OscMessage it received
+
+class passall_osc(object):
+    oscMessages = True
+
+    def handleSocket(self, address, data, *args, **kwargs):
+        return data
@@ -0,0 +1,14 @@
+# Filter of pythonactor_filter_bench: reads every argument of the
+# sph.OscMessage it received and only passes on the end marker
+
+class readall_osc(object):
+    oscMessages = True
+
+    def __init__(self, *args, **kwargs):
+        self.height = 0.0
+
+    def handleSocket(self, address, data, *args, **kwargs):
+        id, name, x, y, z, qx, qy, qz, qw, active = data
+        self.height += y
+        if address == "/bench/end":
+            return data
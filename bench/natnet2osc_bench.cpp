@@ -0,0 +1,57 @@
+//
+// NatNet2OSC frame build time at 10, 100 and 500 rigid bodies
+//
+// usage: natnet2osc_bench
+//
+// Frames of the simulator's scene are decoded by the NatNet actor once,
+// the benchmark times building the /rigidBody messages, with velocities,
+// of every frame.
+//
+
+#include "natnet_corpus.h"
+#include "NatNet2OSCActor.h"
+#include <chrono>
+
+#define BENCH_FRAMES 240
+#define BENCH_PASSES 10
+
+int
+main( int argc, char **argv )
+{
+    printf("rigid bodies  usec/frame  messages/frame\n");
+    for ( int count : { 10, 100, 500 } ) {
+        NatNetCorpus corpus;
+        natnet_corpus_generate(corpus, count, 0, 0, BENCH_FRAMES);
+        NatNet natnet;
+        natnet_corpus_prepare(natnet, corpus);
+        std::vector<zframe_t *> frames;
+        for ( std::string &packet : corpus.frames ) {
+            char *data = &packet[0];
+            natnet.Unpack(&data);
+            frames.push_back(natnet.EncodeFrame());
+        }
+
+        NatNet2OSC osc;
+        osc.sendRigidbodies = true;
+        osc.sendVelocities = true;
+
+        double usecs = 0;
+        size_t messages = 0;
+        for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+            for ( zframe_t *frame : frames ) {
+                auto start = std::chrono::steady_clock::now();
+                osc.frame.parse(zframe_data(frame), zframe_size(frame));
+                osc.loadDescriptions();
+                zmsg_t *msg = osc.buildMessages();
+                usecs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+                messages += zmsg_size(msg);
+                zmsg_destroy(&msg);
+            }
+        }
+        double built = (double)BENCH_PASSES * frames.size();
+        printf("%12d  %10.1f  %14.0f\n", count, usecs / built, messages / built);
+        for ( zframe_t *frame : frames )
+            zframe_destroy(&frame);
+    }
+    return 0;
+}
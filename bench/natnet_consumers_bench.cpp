@@ -0,0 +1,113 @@
+//
+// CPU per frame of a NatNet actor with 1 and 6 NatNet2OSC consumers
+//
+// usage: natnet_consumers_bench [capture.pcap]
+//
+// Compares the decoded frames the NatNet actor publishes, which the
+// consumers read in place, with every consumer unpacking the NatNet packet
+// itself. Building the OSC messages costs the same either way and is
+// reported on its own. Without a capture 10 seconds of a simulated scene
+// are used: 60 rigid bodies, 4 skeletons and 200 markers.
+//
+
+#include "natnet_corpus.h"
+#include "NatNet2OSCActor.h"
+#include <chrono>
+#include <memory>
+
+#define BENCH_PASSES 3
+
+static double
+s_usecs_since( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The NatNet actor unpacks and encodes, each consumer parses the frame
+static double
+s_decoded( NatNetCorpus &corpus, int consumers, double *buildUsecs )
+{
+    NatNet natnet;
+    natnet_corpus_prepare(natnet, corpus);
+    std::vector<std::unique_ptr<NatNet2OSC>> osc;
+    for ( int i = 0; i < consumers; i++ ) {
+        osc.emplace_back(new NatNet2OSC());
+        osc.back()->sendMarkers = true;
+        osc.back()->sendRigidbodies = true;
+        osc.back()->sendSkeletons = true;
+    }
+
+    double decode = 0, build = 0;
+    for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+        for ( std::string &packet : corpus.frames ) {
+            auto start = std::chrono::steady_clock::now();
+            char *data = &packet[0];
+            natnet.Unpack(&data);
+            zframe_t *frame = natnet.EncodeFrame();
+            for ( auto &consumer : osc ) {
+                consumer->frame.parse(zframe_data(frame), zframe_size(frame));
+                consumer->loadDescriptions();
+            }
+            decode += s_usecs_since(start);
+
+            start = std::chrono::steady_clock::now();
+            for ( auto &consumer : osc ) {
+                zmsg_t *msg = consumer->buildMessages();
+                zmsg_destroy(&msg);
+            }
+            build += s_usecs_since(start);
+            zframe_destroy(&frame);
+        }
+    }
+    size_t frames = BENCH_PASSES * corpus.frames.size();
+    *buildUsecs = build / frames / consumers;
+    return decode / frames;
+}
+
+// The NatNet actor and every consumer unpack the packet
+static double
+s_reparsed( NatNetCorpus &corpus, int consumers )
+{
+    std::vector<std::unique_ptr<NatNet>> parsers;
+    for ( int i = 0; i <= consumers; i++ ) {
+        parsers.emplace_back(new NatNet());
+        natnet_corpus_prepare(*parsers.back(), corpus);
+    }
+
+    double decode = 0;
+    for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+        for ( std::string &packet : corpus.frames ) {
+            auto start = std::chrono::steady_clock::now();
+            for ( auto &parser : parsers ) {
+                char *data = &packet[0];
+                parser->Unpack(&data);
+            }
+            decode += s_usecs_since(start);
+        }
+    }
+    return decode / (BENCH_PASSES * corpus.frames.size());
+}
+
+int
+main( int argc, char **argv )
+{
+    NatNetCorpus corpus;
+    if ( argc > 1 ) {
+        if ( !natnet_corpus_load(corpus, argv[1]) ) {
+            fprintf(stderr, "can't read NatNet frames from %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else
+        natnet_corpus_generate(corpus, 60, 4, 200, 1200);
+
+    printf("%zu frames, usec per frame\n", corpus.frames.size());
+    printf("consumers  decoded frame  each unpacks  OSC per consumer\n");
+    for ( int consumers : { 1, 6 } ) {
+        double build;
+        double decoded = s_decoded(corpus, consumers, &build);
+        double reparsed = s_reparsed(corpus, consumers);
+        printf("%9d  %13.1f  %12.1f  %16.1f\n", consumers, decoded, reparsed, build);
+    }
+    return 0;
+}
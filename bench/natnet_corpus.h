@@ -0,0 +1,72 @@
+//
+// NatNet packets for the benchmarks: the frames of a Motive capture or
+// frames of a scene built by the NatNet Simulator
+//
+
+#ifndef GAZEBOSC_NATNETCORPUS_H
+#define GAZEBOSC_NATNETCORPUS_H
+
+#include "NatNetActor.h"
+#include "NatNetSimulatorActor.h"
+#include "NatNetCapture.h"
+#include <string>
+#include <vector>
+
+struct NatNetCorpus {
+    std::string pingResponse;       // empty if the capture has none
+    std::string modelDef;
+    std::vector<std::string> frames;
+};
+
+// Reads the frames of a pcap capture of a Motive server
+static inline bool
+natnet_corpus_load( NatNetCorpus &corpus, const char *path )
+{
+    NatNetCapture capture;
+    if ( !capture.open(path) || capture.frames.empty() )
+        return false;
+    corpus.pingResponse = capture.pingResponse;
+    corpus.modelDef = capture.modelDef;
+    corpus.frames.clear();
+    for ( NatNetCapture::Packet &packet : capture.frames )
+        corpus.frames.push_back(std::move(packet.data));
+    return true;
+}
+
+// Builds count frames of the simulator's scene, 120 per second
+static inline void
+natnet_corpus_generate( NatNetCorpus &corpus, int rigidbodies, int skeletons, int markers, int count )
+{
+    NatNetSimulator simulator;
+    simulator.rigidbodyCount = rigidbodies;
+    simulator.skeletonCount = skeletons;
+    simulator.markerCount = markers;
+
+    simulator.buildPingResponse();
+    corpus.pingResponse.assign(simulator.packet.begin(), simulator.packet.end());
+    simulator.buildModelDef();
+    corpus.modelDef.assign(simulator.packet.begin(), simulator.packet.end());
+    corpus.frames.clear();
+    for ( int i = 0; i < count; i++ ) {
+        simulator.buildFrame(i / 120.0);
+        corpus.frames.emplace_back(simulator.packet.begin(), simulator.packet.end());
+    }
+}
+
+// Hands the server version and the model definitions to the NatNet actor
+// the way they arrive on its command socket
+static inline void
+natnet_corpus_prepare( NatNet &natnet, NatNetCorpus &corpus )
+{
+    if ( !corpus.pingResponse.empty() )
+        natnet.HandleCommand((sPacket *)&corpus.pingResponse[0]);
+    else {
+        // a capture started after the client connected, assume NatNet 3.1
+        NatNet::NatNetVersion[0] = 3;
+        NatNet::NatNetVersion[1] = 1;
+    }
+    if ( !corpus.modelDef.empty() )
+        natnet.HandleCommand((sPacket *)&corpus.modelDef[0]);
+}
+
+#endif //GAZEBOSC_NATNETCORPUS_H
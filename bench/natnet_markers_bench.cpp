@@ -0,0 +1,131 @@
+//
+// Marker deduplication and tracking at 100, 1000 and 5000 markers
+//
+// usage: natnet_markers_bench
+//
+// Markers drift a few millimeters per frame and every tenth marker has a
+// duplicate 1mm away. NatNetMarkerFilter is compared with the pairwise
+// search it replaced, the remove_dups predicate and a nearest neighbour
+// scan over the previous frame. "ids changed" counts the markers that got
+// a new id after the first frame.
+//
+
+#include "NatNetMarkers.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+
+#define BENCH_DEDUP     0.005f
+#define BENCH_TRACK     0.05f
+
+static void
+s_pairwise_dedup( std::vector<Marker> &markers )
+{
+    std::vector<Marker> kept;
+    for ( const Marker &m : markers ) {
+        bool duplicate = false;
+        for ( const Marker &k : kept ) {
+            if ( glm::distance(m, k) <= BENCH_DEDUP ) {
+                duplicate = true;
+                break;
+            }
+        }
+        if ( !duplicate )
+            kept.push_back(m);
+    }
+    markers.swap(kept);
+}
+
+static void
+s_pairwise_track( const std::vector<Marker> &markers, std::vector<Marker> &previous, std::vector<int> &previousIds, int &nextId )
+{
+    std::vector<int> ids(markers.size(), -1);
+    std::vector<bool> claimed(previous.size(), false);
+    for ( size_t i = 0; i < markers.size(); i++ ) {
+        float best = BENCH_TRACK;
+        int match = -1;
+        for ( size_t j = 0; j < previous.size(); j++ ) {
+            float d = glm::distance(markers[i], previous[j]);
+            if ( !claimed[j] && d <= best ) {
+                best = d;
+                match = (int)j;
+            }
+        }
+        if ( match >= 0 ) {
+            ids[i] = previousIds[match];
+            claimed[match] = true;
+        }
+        else
+            ids[i] = nextId++;
+    }
+    previous = markers;
+    previousIds.swap(ids);
+}
+
+static double
+s_usecs_since( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int
+main( int argc, char **argv )
+{
+    printf("markers  filter usec/frame  pairwise usec/frame  kept  ids changed\n");
+    for ( int count : { 100, 1000, 5000 } ) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> place(0.0f, 1.0f);
+        std::normal_distribution<float> drift(0.0f, 0.002f);
+        std::vector<Marker> positions(count);
+        for ( Marker &p : positions )
+            p = Marker(place(rng) * 10.0f, place(rng) * 3.0f, place(rng) * 10.0f);
+
+        // the pairwise search takes over 0.1s per frame at 5000 markers
+        const int frameCount = count >= 5000 ? 20 : 200;
+        std::vector<std::vector<Marker>> frames(frameCount);
+        for ( std::vector<Marker> &frame : frames ) {
+            for ( int i = 0; i < count; i++ ) {
+                positions[i] += Marker(drift(rng), drift(rng), drift(rng));
+                frame.push_back(positions[i]);
+                if ( i % 10 == 0 )
+                    frame.push_back(positions[i] + Marker(0.001f, 0.0f, 0.0f));
+            }
+            std::shuffle(frame.begin(), frame.end(), rng);
+        }
+
+        NatNetMarkerFilter filter;
+        filter.dedupDistance = BENCH_DEDUP;
+        filter.trackDistance = BENCH_TRACK;
+        std::vector<Marker> none, markers;
+        size_t kept = 0;
+        int firstIds = 0, changed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for ( int f = 0; f < frameCount; f++ ) {
+            markers = frames[f];
+            filter.process(markers, none);
+            kept += markers.size();
+            for ( int32_t id : filter.ids() ) {
+                if ( f == 0 )
+                    firstIds = std::max(firstIds, id + 1);
+                else if ( id >= firstIds )
+                    changed++;
+            }
+        }
+        double filterUsecs = s_usecs_since(start) / frameCount;
+
+        std::vector<Marker> previous;
+        std::vector<int> previousIds;
+        int nextId = 0;
+        start = std::chrono::steady_clock::now();
+        for ( int f = 0; f < frameCount; f++ ) {
+            markers = frames[f];
+            s_pairwise_dedup(markers);
+            s_pairwise_track(markers, previous, previousIds, nextId);
+        }
+        double pairwiseUsecs = s_usecs_since(start) / frameCount;
+
+        printf("%7d  %17.1f  %19.1f  %4zu  %11d\n", count, filterUsecs, pairwiseUsecs, kept / frameCount, changed);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+//
+// Time and heap allocations per frame of NatNet::Unpack
+//
+// usage: natnet_unpack_bench [capture.pcap]
+//
+// Unpacks every frame of a Motive capture, or of 10 seconds of a simulated
+// scene with 60 rigid bodies, 4 skeletons and 200 markers, several times
+// over. The first pass sizes the frame buffers and isn't counted.
+//
+
+#include "natnet_corpus.h"
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+
+#define BENCH_PASSES 20
+
+// every operator new of the program is counted
+static size_t s_allocations = 0;
+
+void *
+operator new( size_t size )
+{
+    s_allocations++;
+    void *p = malloc(size ? size : 1);
+    if ( p == nullptr )
+        throw std::bad_alloc();
+    return p;
+}
+
+void
+operator delete( void *p ) noexcept
+{
+    free(p);
+}
+
+void
+operator delete( void *p, size_t ) noexcept
+{
+    free(p);
+}
+
+int
+main( int argc, char **argv )
+{
+    NatNetCorpus corpus;
+    if ( argc > 1 ) {
+        if ( !natnet_corpus_load(corpus, argv[1]) ) {
+            fprintf(stderr, "can't read NatNet frames from %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else
+        natnet_corpus_generate(corpus, 60, 4, 200, 1200);
+
+    NatNet natnet;
+    natnet_corpus_prepare(natnet, corpus);
+    for ( std::string &packet : corpus.frames ) {
+        char *data = &packet[0];
+        natnet.Unpack(&data);
+    }
+
+    size_t allocations = s_allocations;
+    uint64_t grows = natnet.unpackAllocations;
+    auto start = std::chrono::steady_clock::now();
+    for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+        for ( std::string &packet : corpus.frames ) {
+            char *data = &packet[0];
+            natnet.Unpack(&data);
+        }
+    }
+    double nsecs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double frames = (double)BENCH_PASSES * corpus.frames.size();
+
+    printf("frames:            %zu (%zu rigid bodies, %zu skeletons, %zu markers in the last)\n",
+           corpus.frames.size(), natnet.rigidbodies.size(), natnet.skeletons.size(), natnet.markers.size());
+    printf("ns/frame:          %.0f\n", nsecs / frames);
+    printf("allocations/frame: %.3f\n", (s_allocations - allocations) / frames);
+    printf("buffer grows:      %llu\n", (unsigned long long)(natnet.unpackAllocations - grows));
+    return 0;
+}
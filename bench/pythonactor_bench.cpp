@@ -0,0 +1,110 @@
+//
+// Aggregate throughput of 1 to 8 CPU bound python actors
+//
+// usage: pythonactor_bench [seconds] [max actors]
+//
+// Runs bench/cpubound.py in 1..max Python actors at once, sharing the main
+// interpreter, each in an isolated sub-interpreter (Python 3.12+) and each
+// in a child process (Linux). The handler calls per second of all actors are
+// summed. Sharing the GIL keeps the sum flat however many actors run, the
+// isolated and process modes should scale with the cores of the machine.
+//
+
+#include "libsphactor.h"
+#include "pythonactor.h"
+#include "config.h"
+#include <string>
+#include <vector>
+
+GZB_GLOBALS_t GZB_GLOBAL;
+
+#define BENCH_RESULTS "pythonactor_bench.results"
+
+// Runs count actors for the given seconds, returns their calls per second
+static double
+s_run( int count, const char *mode, int seconds )
+{
+    remove(BENCH_RESULTS);
+    std::vector<sphactor_t *> actors;
+    for ( int i = 0; i < count; i++ ) {
+        char name[32];
+        snprintf(name, sizeof(name), "cpubound%d", i);
+        sphactor_t *actor = sphactor_new_by_type("Python", name, zuuid_new());
+        if ( streq(mode, "isolated") )
+            sphactor_ask_api(actor, "SET ISOLATED", "s", "True");
+        else if ( streq(mode, "process") )
+            sphactor_ask_api(actor, "SET PROCESS", "s", "True");
+        sphactor_ask_api(actor, "SET FILE", "s", GZB_SOURCE_DIR "/bench/cpubound.py");
+        actors.push_back(actor);
+    }
+    zclock_sleep(seconds * 1000);
+    for ( sphactor_t *actor : actors )
+        sphactor_destroy(&actor);
+
+    // every actor appended its calls and seconds when it stopped
+    double rate = 0;
+    int reported = 0;
+    FILE *results = fopen(BENCH_RESULTS, "r");
+    if ( results ) {
+        unsigned long calls;
+        double secs;
+        while ( fscanf(results, "%lu %lf", &calls, &secs) == 2 ) {
+            if ( secs > 0 )
+                rate += calls / secs;
+            reported++;
+        }
+        fclose(results);
+    }
+    remove(BENCH_RESULTS);
+    if ( reported != count )
+        zsys_warning("pythonactor_bench: %d of %d %s actors reported", reported, count, mode);
+    return rate;
+}
+
+int
+main( int argc, char **argv )
+{
+#ifdef __UTYPE_LINUX
+    // the process mode runs our own executable as the child
+    if ( argc > 1 && streq(argv[1], "--python-worker") ) {
+        GZB_GLOBAL.RESOURCESPATH = strdup(GZB_SOURCE_DIR);
+        return pythonactor_worker(argc - 2, argv + 2);
+    }
+#endif
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    int maxActors = argc > 2 ? atoi(argv[2]) : 8;
+
+    zsys_init();
+    GZB_GLOBAL.RESOURCESPATH = strdup(GZB_SOURCE_DIR);
+#ifdef __WINDOWS__
+    _putenv_s("GZB_BENCH_RESULTS", BENCH_RESULTS);
+#else
+    setenv("GZB_BENCH_RESULTS", BENCH_RESULTS, 1);
+#endif
+    int rc = python_init();
+    assert( rc == 0 );
+
+    std::vector<const char *> modes = { "shared" };
+#if PY_VERSION_HEX >= 0x030C0000
+    modes.push_back("isolated");
+#endif
+#ifdef __UTYPE_LINUX
+    modes.push_back("process");
+#endif
+
+    printf("%d seconds per run, calls/s of all actors\n", seconds);
+    printf("actors");
+    for ( const char *mode : modes )
+        printf("  %10s", mode);
+    printf("\n");
+    for ( int count = 1; count <= maxActors; count++ ) {
+        printf("%6d", count);
+        for ( const char *mode : modes ) {
+            printf("  %10.0f", s_run(count, mode, seconds));
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    sphactor_dispose();
+    return 0;
+}
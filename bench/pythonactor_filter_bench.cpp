@@ -0,0 +1,152 @@
+//
+// Filter scripts taking tuples against the same filters taking sph.OscMessage
+//
+// usage: pythonactor_filter_bench [passes]
+//
+// The NatNet2OSC messages of 50 rigid bodies, 120 frames, are published to a
+// Python actor running one of the scripts in bench/filters. Every window of
+// frames ends with a /bench/end message the filters pass on, the benchmark
+// waits for it before sending the next window. Publishing and receiving the
+// frames costs the same for both kinds of script.
+//
+
+#include "natnet_corpus.h"
+#include "NatNet2OSCActor.h"
+#include "pythonactor.h"
+#include "config.h"
+#include <chrono>
+
+GZB_GLOBALS_t GZB_GLOBAL;
+
+#define BENCH_ENDPOINT  "inproc://pythonactor_filter_bench"
+#define BENCH_WINDOW    40      // frames in flight, below the high water marks
+#define BENCH_END       "/bench/end"
+
+static zmsg_t *
+s_end_msg()
+{
+    zosc_t *osc = zosc_create(BENCH_END, "isfffffffi", 0, "end", 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1);
+    zmsg_t *msg = zmsg_new();
+    zmsg_add(msg, zosc_packx(&osc));
+    return msg;
+}
+
+// Receives the filter's output up to the end marker, counts the other messages
+static bool
+s_wait_end( zsock_t *out, int timeout, size_t *messages )
+{
+    zpoller_t *poller = zpoller_new(out, NULL);
+    bool ended = false;
+    while ( !ended && zpoller_wait(poller, timeout) ) {
+        zmsg_t *msg = zmsg_recv(out);
+        for ( zframe_t *frame = zmsg_first(msg); frame; frame = zmsg_next(msg) ) {
+            if ( zframe_size(frame) >= sizeof(BENCH_END) && streq((char *)zframe_data(frame), BENCH_END) )
+                ended = true;
+            else
+                (*messages)++;
+        }
+        zmsg_destroy(&msg);
+    }
+    zpoller_destroy(&poller);
+    return ended;
+}
+
+// Runs the frames through the script passes times, returns usecs per message
+static double
+s_run( zsock_t *in, const char *script, std::vector<zmsg_t *> &frames, int passes, double *passed )
+{
+    sphactor_t *filter = sphactor_new_by_type("Python", script, zuuid_new());
+    std::string path = std::string(GZB_SOURCE_DIR "/bench/filters/") + script + ".py";
+    sphactor_ask_api(filter, "SET FILE", "s", path.c_str());
+    sphactor_ask_connect(filter, BENCH_ENDPOINT);
+    zsock_t *out = zsock_new_sub(sphactor_ask_endpoint(filter), "");
+
+    // the subscriptions take a moment
+    size_t messages = 0;
+    bool connected = false;
+    for ( int i = 0; i < 100 && !connected; i++ ) {
+        zmsg_t *end = s_end_msg();
+        zmsg_send(&end, in);
+        connected = s_wait_end(out, 50, &messages);
+    }
+    if ( !connected ) {
+        zsys_error("pythonactor_filter_bench: no output of %s", script);
+        zsock_destroy(&out);
+        sphactor_destroy(&filter);
+        return 0;
+    }
+    // end markers still underway from before the connection
+    while ( s_wait_end(out, 100, &messages) )
+        ;
+
+    messages = 0;
+    size_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    for ( int pass = 0; pass < passes; pass++ ) {
+        for ( size_t i = 0; i < frames.size(); i++ ) {
+            zmsg_t *msg = zmsg_dup(frames[i]);
+            sent += zmsg_size(msg);
+            zmsg_send(&msg, in);
+            if ( (i + 1) % BENCH_WINDOW == 0 || i + 1 == frames.size() ) {
+                zmsg_t *end = s_end_msg();
+                zmsg_send(&end, in);
+                if ( !s_wait_end(out, 5000, &messages) )
+                    zsys_error("pythonactor_filter_bench: %s lost the end marker", script);
+            }
+        }
+    }
+    double usecs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    zsock_destroy(&out);
+    sphactor_destroy(&filter);
+    *passed = (double)messages / sent;
+    return usecs / sent;
+}
+
+int
+main( int argc, char **argv )
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 20;
+
+    zsys_init();
+    GZB_GLOBAL.RESOURCESPATH = strdup(GZB_SOURCE_DIR);
+    int rc = python_init();
+    assert( rc == 0 );
+
+    // the messages a NatNet2OSC actor sends of a simulated scene
+    NatNetCorpus corpus;
+    natnet_corpus_generate(corpus, 50, 0, 0, 120);
+    NatNet natnet;
+    natnet_corpus_prepare(natnet, corpus);
+    NatNet2OSC osc;
+    osc.sendRigidbodies = true;
+    std::vector<zmsg_t *> frames;
+    for ( std::string &packet : corpus.frames ) {
+        char *data = &packet[0];
+        natnet.Unpack(&data);
+        zframe_t *frame = natnet.EncodeFrame();
+        osc.frame.parse(zframe_data(frame), zframe_size(frame));
+        osc.loadDescriptions();
+        frames.push_back(osc.buildMessages());
+        zframe_destroy(&frame);
+    }
+
+    zsock_t *in = zsock_new_pub("@" BENCH_ENDPOINT);
+    printf("%zu frames of %zu messages, %d passes, usec per message\n", frames.size(), zmsg_size(frames[0]), passes);
+    printf("filter    tuples  OscMessage  passed on\n");
+    for ( const char *script : { "passall", "evenid", "readall" } ) {
+        std::string lazy = std::string(script) + "_osc";
+        double passed, lazyPassed;
+        double usecs = s_run(in, script, frames, passes, &passed);
+        double lazyUsecs = s_run(in, lazy.c_str(), frames, passes, &lazyPassed);
+        if ( passed != lazyPassed )
+            zsys_warning("pythonactor_filter_bench: %s passed on %.2f, %s %.2f", script, passed, lazy.c_str(), lazyPassed);
+        printf("%-8s  %6.2f  %10.2f  %9.2f\n", script, usecs, lazyUsecs, passed);
+    }
+
+    zsock_destroy(&in);
+    for ( zmsg_t *msg : frames )
+        zmsg_destroy(&msg);
+    sphactor_dispose();
+    return 0;
+}
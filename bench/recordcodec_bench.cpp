@@ -0,0 +1,131 @@
+//
+// Compression ratio and throughput of the compressed recording format
+//
+// usage: recordcodec_bench [recording]
+//
+// Without a recording a minute of NatNet2OSC output at 120Hz is generated:
+// 20 rigid bodies and 50 markers.
+//
+
+#include "RecordCodec.h"
+#include <algorithm>
+#include <math.h>
+#include <string>
+#include <vector>
+
+struct BenchMessage {
+    unsigned int timeCode;
+    std::vector<byte> data;
+};
+
+static void
+s_add(std::vector<BenchMessage> &corpus, unsigned int timeCode, zosc_t *osc)
+{
+    BenchMessage msg;
+    msg.timeCode = timeCode;
+    const byte *data = zosc_data(osc);
+    msg.data.assign(data, data + zosc_size(osc));
+    corpus.push_back(std::move(msg));
+    zosc_destroy(&osc);
+}
+
+static void
+s_generate(std::vector<BenchMessage> &corpus)
+{
+    const int rate = 120, seconds = 60, bodies = 20, markers = 50;
+    for ( int f = 0; f < rate * seconds; f++ ) {
+        unsigned int timeCode = (unsigned int)(f * 1000 / rate);
+        double t = (double)f / rate;
+        for ( int i = 0; i < bodies; i++ ) {
+            std::string name = "body" + std::to_string(i + 1);
+            double a = t * 0.5 + i;
+            s_add(corpus, timeCode, zosc_create("/rigidBody", "isfffffff", i + 1, name.c_str(),
+                                                cos(a), 1.0 + 0.1 * sin(t * 3 + i), sin(a),
+                                                0.0, sin(a / 2), 0.0, cos(a / 2)));
+        }
+        for ( int i = 0; i < markers; i++ ) {
+            double a = t + i * 0.1;
+            s_add(corpus, timeCode, zosc_create("/marker", "ifff", i, cos(a) * 2, 0.5 + i * 0.02, sin(a) * 2));
+        }
+    }
+}
+
+static bool
+s_load(std::vector<BenchMessage> &corpus, const char *path)
+{
+    RecordReader reader;
+    if ( !reader.open(path) )
+        return false;
+    unsigned int timeCode;
+    zframe_t *frame;
+    while ( (frame = reader.next(&timeCode)) ) {
+        BenchMessage msg;
+        msg.timeCode = timeCode;
+        msg.data.assign(zframe_data(frame), zframe_data(frame) + zframe_size(frame));
+        corpus.push_back(std::move(msg));
+        zframe_destroy(&frame);
+    }
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    std::vector<BenchMessage> corpus;
+    if ( argc > 1 ) {
+        if ( !s_load(corpus, argv[1]) ) {
+            fprintf(stderr, "can't read recording %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else
+        s_generate(corpus);
+    if ( corpus.empty() ) {
+        fprintf(stderr, "no messages to compress\n");
+        return 1;
+    }
+
+    // The size of the raw recording format: a time_bytes header, the message and a newline
+    uint64_t rawFileSize = 0;
+    for ( const BenchMessage &msg : corpus )
+        rawFileSize += sizeof(time_bytes) + msg.data.size() + 1;
+
+    RecordEncoder encoder;
+    std::vector<byte> file;
+    for ( const BenchMessage &msg : corpus ) {
+        encoder.append(msg.timeCode, msg.data.data(), msg.data.size());
+        if ( encoder.pending() >= RECORD_CODEC_BLOCK_SIZE )
+            encoder.flush(file);
+    }
+    encoder.flush(file);
+
+    // Decode it again the way RecordReader plays it back and check every message
+    RecordDecoder decoder;
+    std::vector<byte> out;
+    size_t pos = 0, index = 0;
+    bool ok = true;
+    while ( ok && pos + RECORD_CODEC_BLOCK_HEADER <= file.size() ) {
+        uint32_t rawSize, compSize;
+        record_read_block_header(&file[pos], &rawSize, &compSize);
+        pos += RECORD_CODEC_BLOCK_HEADER;
+        ok = decoder.load(&file[pos], rawSize, compSize);
+        pos += compSize & ~RECORD_CODEC_STORED;
+        unsigned int timeCode;
+        while ( ok && decoder.next(&timeCode, out) ) {
+            ok = index < corpus.size() && corpus[index].timeCode == timeCode && corpus[index].data == out;
+            index++;
+        }
+    }
+    if ( !ok || index != corpus.size() ) {
+        fprintf(stderr, "decoding failed at message %zu\n", index);
+        return 1;
+    }
+
+    printf("messages:   %zu\n", corpus.size());
+    printf("raw:        %llu bytes\n", (unsigned long long)rawFileSize);
+    printf("compressed: %llu bytes, ratio %.2f\n", (unsigned long long)(file.size() + RECORD_CODEC_HEADER_SIZE),
+           (double)rawFileSize / (file.size() + RECORD_CODEC_HEADER_SIZE));
+    printf("encode:     %.1f MB/s\n", (double)encoder.bytesIn / (double)std::max<int64_t>(encoder.encodeUsecs, 1));
+    printf("decode:     %.1f MB/s\n", (double)decoder.bytesOut / (double)std::max<int64_t>(decoder.decodeUsecs, 1));
+    return 0;
+}
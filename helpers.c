@@ -89,74 +89,433 @@ void python_remove_path(const char *path)
     free(script);
 }
 
-zosc_t *
-s_py_zosc(PyObject *pAddress, PyObject *pData)
+//  Growable buffer for packing OSC messages
+typedef struct {
+    byte *data;
+    size_t size;
+    size_t capacity;
+} s_oscbuf_t;
+
+static byte *
+s_oscbuf_grow(s_oscbuf_t *buf, size_t size)
 {
-    assert( PyUnicode_Check(pAddress) );
-    assert( PyList_Check(pData) );
-    PyObject *stringbytes = PyUnicode_AsASCIIString(pAddress);
-    zosc_t *ret = zosc_new( PyBytes_AsString( stringbytes) );
-    Py_DECREF(stringbytes);
+    if ( buf->size + size > buf->capacity )
+    {
+        size_t capacity = buf->capacity ? buf->capacity : 256;
+        while ( capacity < buf->size + size )
+            capacity *= 2;
+        buf->data = (byte *)realloc(buf->data, capacity);
+        assert(buf->data);
+        buf->capacity = capacity;
+    }
+    byte *p = buf->data + buf->size;
+    buf->size += size;
+    return p;
+}
+
+static void
+s_oscbuf_u32(s_oscbuf_t *buf, uint32_t v)
+{
+    byte *p = s_oscbuf_grow(buf, 4);
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void
+s_oscbuf_u64(s_oscbuf_t *buf, uint64_t v)
+{
+    s_oscbuf_u32(buf, (uint32_t)(v >> 32));
+    s_oscbuf_u32(buf, (uint32_t)v);
+}
+
+//  data padded with zeros to 4 bytes, a string includes its terminator
+static void
+s_oscbuf_padded(s_oscbuf_t *buf, const void *data, size_t size, bool string)
+{
+    size_t padded = string ? (size + 4) & ~(size_t)3 : (size + 3) & ~(size_t)3;
+    byte *p = s_oscbuf_grow(buf, padded);
+    memcpy(p, data, size);
+    memset(p + size, 0, padded - size);
+}
+
+static bool
+s_little_endian()
+{
+    const uint16_t one = 1;
+    return *(const byte *)&one == 1;
+}
+
+//  Append a buffer (numpy array, array.array, memoryview...) as a run of
+//  OSC numbers of its type, or as a blob if it holds bytes
+static void
+s_py_osc_buffer(PyObject *item, s_oscbuf_t *types, s_oscbuf_t *args)
+{
+    Py_buffer view;
+    if ( PyObject_GetBuffer(item, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0 )
+    {
+        PyErr_Clear();
+        zsys_warning("only contiguous buffers can be sent");
+        return;
+    }
+    const char *format = view.format ? view.format : "B";
+    bool little = s_little_endian();
+    if ( *format == '<' )
+        little = true;
+    else if ( *format == '>' || *format == '!' )
+        little = false;
+    if ( strchr("@=<>!", *format) )
+        format++;
+    // OSC type of the elements, blobs for bytes
+    char type = 0;
+    if ( strchr("Bbcsp", *format) )
+        type = 'b';
+    else if ( *format == 'f' && view.itemsize == 4 )
+        type = 'f';
+    else if ( *format == 'd' && view.itemsize == 8 )
+        type = 'd';
+    else if ( strchr("hHiIlLqQnN", *format) && view.itemsize <= 8 )
+        type = view.itemsize <= 4 ? 'i' : 'h';
+    if ( type == 0 || format[1] != 0 )
+    {
+        zsys_warning("unsupported buffer format %s", view.format);
+        PyBuffer_Release(&view);
+        return;
+    }
+
+    if ( type == 'b' )
+    {
+        *s_oscbuf_grow(types, 1) = 'b';
+        s_oscbuf_u32(args, (uint32_t)view.len);
+        s_oscbuf_padded(args, view.buf, view.len, false);
+        PyBuffer_Release(&view);
+        return;
+    }
+
+    Py_ssize_t count = view.len / view.itemsize;
+    memset(s_oscbuf_grow(types, count), type, count);
+    bool sign = islower(*format);
+    const byte *src = (const byte *)view.buf;
+    for ( Py_ssize_t i = 0; i < count; i++, src += view.itemsize )
+    {
+        // read the element as unsigned in its byte order
+        uint64_t v = 0;
+        for ( Py_ssize_t b = 0; b < view.itemsize; b++ )
+            v |= (uint64_t)src[b] << ((little ? b : view.itemsize - 1 - b) * 8);
+        if ( sign && view.itemsize < 8 && (v >> (view.itemsize * 8 - 1)) )
+            v |= ~(uint64_t)0 << (view.itemsize * 8); // sign extend short ints
+        if ( view.itemsize == 8 )
+            s_oscbuf_u64(args, v);
+        else
+            s_oscbuf_u32(args, (uint32_t)v);
+    }
+    PyBuffer_Release(&view);
+}
 
-    // iterate
-    for ( Py_ssize_t i=0;i<PyList_Size(pData);++i )
+//  Append an argument, its OSC type follows from its python type
+static void
+s_py_osc_item(PyObject *item, s_oscbuf_t *types, s_oscbuf_t *args)
+{
+    // determine type, first check if boolean otherwise it will be an int
+    if (PyBool_Check(item))
+    {
+        *s_oscbuf_grow(types, 1) = item == Py_True ? 'T' : 'F';
+    }
+    else if ( PyLong_Check(item) )
     {
-        PyObject *item = PyList_GetItem(pData, i);
-        assert(item);
-        // determine type, first check if boolean otherwise it will be an int
-        if (PyBool_Check(item))
+        long long v = PyLong_AsLongLong(item);
+        if ( v == -1 && PyErr_Occurred() )
         {
-            long b = PyLong_AsLong(item);
-            if (b)
-                zosc_append(ret, "T");
-            else
-                zosc_append(ret, "F");
+            PyErr_Clear();
+            zsys_warning("int doesn't fit OSC type h");
+            return;
         }
-        else if ( PyLong_Check(item) )
+        *s_oscbuf_grow(types, 1) = 'h';
+        s_oscbuf_u64(args, (uint64_t)v);
+    }
+    else if (PyFloat_Check(item))
+    {
+        double v = PyFloat_AsDouble(item);
+        uint64_t u;
+        memcpy(&u, &v, 8);
+        *s_oscbuf_grow(types, 1) = 'd';
+        s_oscbuf_u64(args, u);
+    }
+    else if (PyUnicode_Check(item))
+    {
+        Py_ssize_t size;
+        const char *str = PyUnicode_AsUTF8AndSize(item, &size);
+        if ( str == NULL )
         {
-            long v = PyLong_AsLong(item);
-            zosc_append(ret, "h", v);
+            PyErr_Clear();
+            zsys_warning("can't encode string as UTF-8");
+            return;
         }
-        else if (PyFloat_Check(item))
+        *s_oscbuf_grow(types, 1) = 's';
+        s_oscbuf_padded(args, str, size, true);
+    }
+    else if (item == Py_None)
+    {
+        *s_oscbuf_grow(types, 1) = 'N';
+    }
+    else if (PyBytes_Check(item) && PyBytes_Size(item) == 4) // this can be used to force 32bit int, ie: struct.pack("I", 32)
+    {
+        uint32_t v;
+        memcpy(&v, PyBytes_AsString(item), 4);
+        *s_oscbuf_grow(types, 1) = 'i';
+        s_oscbuf_u32(args, v);
+    }
+    else if (PyObject_CheckBuffer(item)) // other bytes are blobs, arrays and ctypes values become runs of numbers
+    {
+        s_py_osc_buffer(item, types, args);
+    }
+    else if (PyList_Check(item) || PyTuple_Check(item)) // nested lists are OSC arrays
+    {
+        *s_oscbuf_grow(types, 1) = '[';
+        for ( Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(item); i++ )
+            s_py_osc_item(PySequence_Fast_GET_ITEM(item, i), types, args);
+        *s_oscbuf_grow(types, 1) = ']';
+    }
+    else
+        zsys_warning("unsupported python type %s", Py_TYPE(item)->tp_name);
+}
+
+//  Append an argument as the given OSC type, returns -1 with an exception
+//  set if the item can't be converted
+static int
+s_py_osc_typed_item(char tag, PyObject *item, s_oscbuf_t *types, s_oscbuf_t *args)
+{
+    switch (tag)
+    {
+    case 'i':
+    case 'h':
+    {
+        long long v = PyLong_AsLongLong(item);
+        if ( v == -1 && PyErr_Occurred() )
+            return -1;
+        if ( tag == 'h' )
+            s_oscbuf_u64(args, (uint64_t)v);
+        else if ( v >= INT32_MIN && v <= UINT32_MAX ) // unsigned values keep their bits
+            s_oscbuf_u32(args, (uint32_t)v);
+        else
         {
-            double v = PyFloat_AsDouble(item);
-            zosc_append(ret, "d", v);
+            PyErr_Format(PyExc_OverflowError, "%lld doesn't fit OSC type i", v);
+            return -1;
         }
-        else if (PyUnicode_Check(item))
+        break;
+    }
+    case 'f':
+    case 'd':
+    {
+        double v = PyFloat_AsDouble(item);
+        if ( v == -1.0 && PyErr_Occurred() )
+            return -1;
+        if ( tag == 'f' )
         {
-            PyObject* ascii = PyUnicode_AsASCIIString(item);
-            assert(ascii);
-            char* s = PyBytes_AsString(ascii);
-            zosc_append(ret, "s", s);
-            Py_DECREF(ascii);
+            float f = (float)v;
+            uint32_t u;
+            memcpy(&u, &f, 4);
+            s_oscbuf_u32(args, u);
         }
-        else if (PyBytes_Check(item)) // this can be used to force 32bit int, ie: struct.pack("I", 32)
+        else
         {
-            Py_ssize_t bytesize = PyBytes_Size(item);
-            if ( bytesize == 4 ) // 32bit int
-            {
-                char * buffer = PyBytes_AsString(item);
-                uint32_t* vp = (uint32_t *)(buffer);
-                zosc_append(ret, "i", *vp);
-            }
-            else
-                zsys_warning("I don't know what to do with these bytes, please help: https://github.com/hku-ect/gazebosc");
+            uint64_t u;
+            memcpy(&u, &v, 8);
+            s_oscbuf_u64(args, u);
         }
-        else
+        break;
+    }
+    case 's':
+    case 'S':
+    {
+        Py_ssize_t size;
+        const char *str = PyUnicode_Check(item) ? PyUnicode_AsUTF8AndSize(item, &size) : NULL;
+        if ( str == NULL )
         {
-            // not a supported native python type try ctypes
-            PyTypeObject* type = Py_TYPE(item);
-            const char * pytypename = _PyType_Name(type);
-            if (streq(pytypename, "c_int"))
-            {
-                zsys_warning("Unsupported ctypes.c_int until we find a way to access the value :S");
-            }
-            else
-                zsys_warning("unsupported python type");
+            if ( !PyErr_Occurred() )
+                PyErr_Format(PyExc_TypeError, "OSC type %c needs a str, not %s", tag, Py_TYPE(item)->tp_name);
+            return -1;
         }
+        s_oscbuf_padded(args, str, size, true);
+        break;
+    }
+    case 'b':
+    {
+        Py_buffer view;
+        if ( PyObject_GetBuffer(item, &view, PyBUF_SIMPLE) < 0 )
+            return -1;
+        s_oscbuf_u32(args, (uint32_t)view.len);
+        s_oscbuf_padded(args, view.buf, view.len, false);
+        PyBuffer_Release(&view);
+        break;
+    }
+    default:
+        PyErr_Format(PyExc_ValueError, "unsupported OSC type tag '%c'", tag);
+        return -1;
+    }
+    *s_oscbuf_grow(types, 1) = tag;
+    return 0;
+}
 
+//  Append the items of a list or tuple as the type tags. T, F, N and I
+//  take no item, an array [..] takes a list or tuple of its own. An array
+//  of a single type holds any number of items of that type, e.g. "[f]".
+static int
+s_py_osc_typed(const char *tags, size_t ntags, PyObject *seq, s_oscbuf_t *types, s_oscbuf_t *args)
+{
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    Py_ssize_t n = 0;
+    for ( size_t t = 0; t < ntags; t++ )
+    {
+        char tag = tags[t];
+        if ( strchr("TFNI", tag) )
+        {
+            *s_oscbuf_grow(types, 1) = tag;
+            continue;
+        }
+        if ( tag == ']' )
+        {
+            PyErr_SetString(PyExc_ValueError, "unbalanced ']' in OSC type tags");
+            return -1;
+        }
+        if ( n == count )
+        {
+            PyErr_Format(PyExc_ValueError, "no data left for OSC type tag '%c'", tag);
+            return -1;
+        }
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, n++);
+        if ( tag != '[' )
+        {
+            if ( s_py_osc_typed_item(tag, item, types, args) < 0 )
+                return -1;
+            continue;
+        }
+
+        // the array's tags up to the matching ']'
+        size_t start = ++t;
+        for ( int depth = 1; t < ntags; t++ )
+        {
+            if ( tags[t] == '[' )
+                depth++;
+            else if ( tags[t] == ']' && --depth == 0 )
+                break;
+        }
+        if ( t == ntags )
+        {
+            PyErr_SetString(PyExc_ValueError, "unbalanced '[' in OSC type tags");
+            return -1;
+        }
+        if ( !PyList_Check(item) && !PyTuple_Check(item) )
+        {
+            PyErr_Format(PyExc_TypeError, "OSC array needs a list or tuple, not %s", Py_TYPE(item)->tp_name);
+            return -1;
+        }
+        *s_oscbuf_grow(types, 1) = '[';
+        if ( t - start == 1 && !strchr("TFNI[", tags[start]) )
+        {
+            for ( Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(item); i++ )
+                if ( s_py_osc_typed_item(tags[start], PySequence_Fast_GET_ITEM(item, i), types, args) < 0 )
+                    return -1;
+        }
+        else if ( s_py_osc_typed(tags + start, t - start, item, types, args) < 0 )
+            return -1;
+        *s_oscbuf_grow(types, 1) = ']';
+    }
+    if ( n < count )
+    {
+        PyErr_Format(PyExc_ValueError, "%zd items of data, the OSC type tags take %zd", count, n);
+        return -1;
+    }
+    return 0;
+}
+
+//  Packing buffers of the thread, reused for the next message
+//  and the depth of nested packing
+#ifdef _MSC_VER
+static __declspec(thread) s_oscbuf_t s_osctypes = { NULL, 0, 0 };
+static __declspec(thread) s_oscbuf_t s_oscargs = { NULL, 0, 0 };
+static __declspec(thread) int s_oscdepth = 0;
+#else
+static _Thread_local s_oscbuf_t s_osctypes = { NULL, 0, 0 };
+static _Thread_local s_oscbuf_t s_oscargs = { NULL, 0, 0 };
+static _Thread_local int s_oscdepth = 0;
+#endif
+
+#define OSCBUF_KEEP     65536   // don't hold on to buffers of larger messages
+
+static void
+s_oscbuf_reuse(s_oscbuf_t *buf)
+{
+    buf->size = 0;
+    if ( buf->capacity > OSCBUF_KEEP )
+    {
+        free(buf->data);
+        buf->data = NULL;
+        buf->capacity = 0;
+    }
+}
+
+//  Pack an address and list of data as an OSC message. Without type tags
+//  the types follow from the python types: ints are sent as h, floats as d.
+//  With type tags, e.g. "iff", the data is converted to those types.
+//  Returns NULL with an exception set if the data doesn't match the tags.
+zframe_t *
+s_py_osc_pack(PyObject *pAddress, PyObject *pTypes, PyObject *pData)
+{
+    assert( PyUnicode_Check(pAddress) );
+    assert( PyList_Check(pData) || PyTuple_Check(pData) );
+    //  Converting the data runs python code (__index__, __float__) which can
+    //  pack a message itself, such a nested pack gets buffers of its own
+    s_oscbuf_t nestedtypes = { NULL, 0, 0 };
+    s_oscbuf_t nestedargs = { NULL, 0, 0 };
+    bool nested = s_oscdepth++ > 0;
+    s_oscbuf_t *types = nested ? &nestedtypes : &s_osctypes;
+    s_oscbuf_t *args = nested ? &nestedargs : &s_oscargs;
+    *s_oscbuf_grow(types, 1) = ',';
+
+    int rc = 0;
+    if ( pTypes )
+    {
+        Py_ssize_t ntags;
+        const char *tags = PyUnicode_AsUTF8AndSize(pTypes, &ntags);
+        if ( tags && *tags == ',' )
+        {
+            tags++;
+            ntags--;
+        }
+        rc = tags ? s_py_osc_typed(tags, ntags, pData, types, args) : -1;
+    }
+    else
+    {
+        for ( Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(pData); i++ )
+            s_py_osc_item(PySequence_Fast_GET_ITEM(pData, i), types, args);
     }
 
+    // address, type tags and arguments
+    Py_ssize_t addrsize;
+    const char *address = rc == 0 ? PyUnicode_AsUTF8AndSize(pAddress, &addrsize) : NULL;
+    zframe_t *ret = NULL;
+    if ( address )
+    {
+        size_t addrpadded = (addrsize + 4) & ~(size_t)3;
+        size_t typespadded = (types->size + 4) & ~(size_t)3;
+        ret = zframe_new(NULL, addrpadded + typespadded + args->size);
+        byte *p = zframe_data(ret);
+        memset(p, 0, addrpadded + typespadded);
+        memcpy(p, address, addrsize);
+        memcpy(p + addrpadded, types->data, types->size);
+        if ( args->size )
+            memcpy(p + addrpadded + typespadded, args->data, args->size);
+    }
+    s_oscdepth--;
+    if ( nested )
+    {
+        free(nestedtypes.data);
+        free(nestedargs.data);
+    }
+    else
+    {
+        s_oscbuf_reuse(types);
+        s_oscbuf_reuse(args);
+    }
     return ret;
 }
 
@@ -10,7 +10,7 @@ extern "C" {
 PyObject *python_call_file_func(const char *file, const char *func, const char *fmt, ...);
 void python_add_path(const char *path);
 void python_remove_path(const char *path);
-zosc_t *s_py_zosc(PyObject *pAddress, PyObject *pData);
+zframe_t *s_py_osc_pack(PyObject *pAddress, PyObject *pTypes, PyObject *pData);
 char *s_remove_ext(const char* myStr);
 char *s_basename(char const *path);
 bool s_dir_exists(const wchar_t *pypath);
@@ -326,6 +326,19 @@ int main(int argc, char** argv)
     SetConsoleCtrlHandler (s_exit_handler_fn, TRUE);
 #endif
 
+    // Offline recording inspection/conversion, doesn't load a stage
+    if ( argc > 1 && streq(argv[1], "--record-tool") )
+        return record_tool(argc - 2, argv + 2);
+
+#if defined(PYTHON3_FOUND) && defined(__UTYPE_LINUX)
+    // Child process of an out of process python actor, see pythonactor_worker
+    if ( argc > 1 && streq(argv[1], "--python-worker") )
+    {
+        set_global_resources();
+        return pythonactor_worker(argc - 2, argv + 2);
+    }
+#endif
+
     //
     set_global_resources();
     set_global_temp();
@@ -431,6 +444,7 @@ void register_actors() {
     sphactor_register<OSCMultiOut>( "OSC Multi Output", OSCMultiOut::capabilities);
     sphactor_register<NatNet>( "NatNet", NatNet::capabilities );
     sphactor_register<NatNet2OSC>( "NatNet2OSC", NatNet2OSC::capabilities );
+    sphactor_register<NatNetSimulator>( "NatNet Simulator", NatNetSimulator::capabilities );
     sphactor_register<Midi2OSC>( "Midi2OSC", Midi2OSC::capabilities );
 #ifdef HAVE_OPENVR
     sphactor_register<OpenVR>("OpenVR", OpenVR::capabilities);
@@ -0,0 +1,118 @@
+"""
+Base class for python actors running an asyncio event loop
+
+The loop runs in the actor's thread, driven by the actor: the selector of
+the loop is polled by the actor through fileno() and handleCustomSocket,
+the time until the next scheduled callback becomes the actor's timeout.
+Coroutines can await incoming messages and emit outgoing ones without
+extra threads:
+
+    import sphasync
+
+    class myactor(sphasync.AsyncActor):
+        async def main(self):
+            while True:
+                address, data = await self.receive()
+                reply = await fetch_something(data)
+                self.emit("/reply", [reply])
+
+Messages are (address, data) tuples or sph.OscMessage objects when the
+actor sets oscMessages. Anything a handler can return can be emitted.
+"""
+import asyncio
+import selectors
+
+POLL_INTERVAL = 10      # ms to run the loop when its selector can't be polled
+
+
+class AsyncActor(object):
+    def __init__(self, *args, **kwargs):
+        self.timeout = -1
+        self._outbox = []
+        self._loop = asyncio.SelectorEventLoop(selectors.DefaultSelector())
+        # make it the loop of this actor's thread, Python 3.9 binds
+        # asyncio.Queue to the current loop when created
+        asyncio.set_event_loop(self._loop)
+        self._inbox = asyncio.Queue()
+        self._main = self._loop.create_task(self.main())
+        # nothing wakes the selector yet, run the loop soon to start main()
+        self.timeout = 0
+
+    async def main(self):
+        """
+        Override to run the actor's coroutines, it's started with the actor
+        """
+        pass
+
+    async def receive(self):
+        """
+        Returns the next incoming message
+        """
+        return await self._inbox.get()
+
+    def emit(self, address, data=None):
+        """
+        Sends a message from the actor, an address with a list of data or
+        anything else a handler can return
+        """
+        self._outbox.append(address if data is None else (address, data))
+
+    @property
+    def loop(self):
+        return self._loop
+
+    def fileno(self):
+        """
+        The file descriptor of the loop's selector, -1 if it has none
+        """
+        try:
+            return self._loop._selector.fileno()
+        except AttributeError:
+            return -1
+
+    def _run(self):
+        # run the callbacks which are ready and the I/O without waiting
+        self._loop.call_soon(self._loop.stop)
+        self._loop.run_forever()
+        if self._main is not None and self._main.done():
+            # show why main() failed, once
+            main, self._main = self._main, None
+            if not main.cancelled() and main.exception():
+                raise main.exception()
+        self.timeout = self._next_timeout()
+        out, self._outbox = self._outbox, []
+        return out or None
+
+    def _next_timeout(self):
+        # the loop keeps its ready callbacks and timers in private members
+        loop = self._loop
+        if loop._ready:
+            timeout = 0
+        elif loop._scheduled:
+            delay = loop._scheduled[0].when() - loop.time()
+            timeout = max(0, int(delay * 1000 + 0.999))
+        else:
+            timeout = -1
+        if self.fileno() == -1 and (timeout == -1 or timeout > POLL_INTERVAL):
+            timeout = POLL_INTERVAL
+        return timeout
+
+    def handleSocketBatch(self, messages, *args, **kwargs):
+        for message in messages:
+            self._inbox.put_nowait(message)
+        return self._run()
+
+    def handleTimer(self, *args, **kwargs):
+        return self._run()
+
+    def handleCustomSocket(self, *args, **kwargs):
+        return self._run()
+
+    def handleStop(self, *args, **kwargs):
+        tasks = asyncio.all_tasks(self._loop)
+        for task in tasks:
+            task.cancel()
+        if tasks:
+            self._loop.run_until_complete(asyncio.gather(*tasks, return_exceptions=True))
+        self._loop.run_until_complete(self._loop.shutdown_asyncgens())
+        self._loop.close()
@@ -1,11 +1,16 @@
 # This is an example python actor
 #
 # Make sure the class name matches the filename! (without the .py file extension)
+#
+# With the actor's isolated option on the script runs in its own sub-interpreter (Python 3.12+).
+# Extension modules which don't support sub-interpreters, such as numpy, fail to import then.
 
 class actor(object):
     def __init__(self, *args, **kwargs):
         self.timeout = 1000         # Use this timeout value for when you need recurring handleTimer events
                                     # Set to -1 to wait infinite (default)
+                                    # Assigning it later changes the timeout, or call
+                                    # sph.set_timeout(ms) from a handler (import sph)
 
     def handleApi(self, command, *args, **kwargs):
         print("The API command is {} and its arguments is {}".format(command, args))
@@ -14,14 +19,40 @@ class actor(object):
     def handleSocket(self, address, data, *args, **kwargs):
         print("The osc address is {} and its data is {}".format(address, data))
         return ("/myreturnaddress", ["hello", 3, 2, 1])
+        # ints are sent as 64-bit (h) and floats as doubles (d), to send other types put
+        # the OSC type tags before the data: ("/myreturnaddress", "sifd", ["hello", 3, 2, 1])
+        # Supported are i h f d s S b T F N I, T F N and I take no data. An array [..] takes
+        # a list, "[f]" sends a list of any length as floats. Nested lists are sent as arrays.
+
+    # Define handleSocketBatch instead of handleSocket to receive all osc messages
+    # of an event at once as a list of (address, data) tuples. Return a list of replies.
+    #def handleSocketBatch(self, messages, *args, **kwargs):
+    #    return [ ("/myreturnaddress", [address]) for address, data in messages ]
+
+    # Set oscMessages to True to receive sph.OscMessage objects as data, also in handleSocketBatch
+    # instead of the tuples. Arguments are only decoded when accessed and an OscMessage can be
+    # returned to send it on as is, e.g. `if address.startswith("/rigidBody"): return data`.
+    # Replies can also be made with sph.OscMessage("/myreturnaddress", ["hello", 3])
+    # data.array(index) returns the run of equally typed numbers at index as a memoryview without
+    # decoding them, numpy.asarray(data.array(0)) gives an array of e.g. all floats of a pose.
+    # Returned data can hold numpy arrays or other buffers: float32 arrays are sent as OSC floats,
+    # bytes and bytearrays as blobs.
+    #oscMessages = True
 
     def handleTimer(self, *args, **kwargs):
         # This is a timed event, use it as you need
         print("My timed event with type: {}, name: {}, uuid: {}".format(args[0], args[1], args[2]))
         return ("/mytimedreturn", ["hello", 1, 2, 3])
 
+    # Define fileno() returning a file descriptor to have handleCustomSocket called when it's
+    # readable. Derive from sphasync.AsyncActor (import sphasync) instead of object to run an
+    # asyncio loop this way: its main() coroutine can `await self.receive()` incoming messages
+    # and send with self.emit("/myreturnaddress", ["hello"]), see misc/scripts/sphasync.py
+    #def fileno(self):
+    #    return self.mysocket.fileno()
+
     def handleCustomSocket(self, *args, **kwargs):
-        # We'll explain this in the future
+        # Called when the file descriptor returned by fileno() is readable
         return ("/myreturnaddress", ["hello", "world"])
 
     def handleStop(self, *args, **kwargs):